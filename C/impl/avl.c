@@ -863,6 +863,23 @@ void avl_free(struct libavl_allocator *allocator, void *block) {
 /* Default memory allocator that uses |malloc()| and |free()|. */
 struct libavl_allocator avl_allocator_default = { avl_malloc, avl_free };
 
+/* Allocates |size| bytes of space from the slabs of stSlab.h,
+ so |size| must not exceed |ST_SLAB_MAX_SIZE|. */
+void *
+avl_slabMalloc(struct libavl_allocator *allocator, size_t size) {
+    assert (allocator != NULL && size> 0);
+    return st_slabMalloc(size);
+}
+
+/* Frees |block| back to the slabs. */
+void avl_slabFree(struct libavl_allocator *allocator, void *block) {
+    assert (allocator != NULL && block != NULL);
+    st_slabFree(block);
+}
+
+/* Memory allocator that uses |st_slabMalloc()| and |st_slabFree()|. */
+struct libavl_allocator avl_allocator_slab = { avl_slabMalloc, avl_slabFree };
+
 #undef NDEBUG
 #include <assert.h>
 
@@ -143,69 +143,117 @@ void fastaWrite(char *sequence, char *header, FILE *file) {
     }
 }
 
-char *addSeqToList(char *seq, int64_t *length, int64_t *maxLength, char *fastaName, void *destination,
-        void (*addSeq)(void *, const char *, const char *, int64_t)) {
-    seq = arrayPrepareAppend(seq, maxLength, *length+1, sizeof(char));
-    seq[*length] = '\0';
-    addSeq(destination, fastaName, seq, *length);
-    (*length)  = 0;
-    return seq;
+/*
+ * Fasta files are read in blocks of this many bytes.
+ */
+#define FASTA_READ_BLOCK_SIZE (1 << 20)
+
+/*
+ * Returns non-zero iff the characters are all roman alphabet characters or gaps. Written
+ * without branches so that the compiler vectorises the loop.
+ */
+static bool fastaIsValidSequence(const char *sequence, int64_t length) {
+    unsigned char invalid = 0;
+    for (int64_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char) sequence[i];
+        invalid |= (unsigned char) ((unsigned char) ((c | 0x20) - 'a') >= 26) & (c != '-');
+    }
+    return invalid == 0;
 }
 
-void fastaReadToFunction(FILE *fastaFile, void *destination, void (*addSeq)(void *, const char *, const char *, int64_t)) {
-    //reads in group of sequences INT_32o lists
-    char j;
-    int64_t k;
-    char *seq = NULL;
-    int64_t seqLength = 0;
-    char cA[STRING_ARRAY_SIZE];
-    int64_t l;
+/*
+ * Appends the characters to the buffer, growing it as needed and leaving space for a terminating zero.
+ */
+static char *fastaAppend(char *buffer, int64_t *length, int64_t *maxLength, const char *string, int64_t stringLength) {
+    if (*length + stringLength + 1 > *maxLength) {
+        *maxLength = 2 * (*length + stringLength + 1);
+        buffer = st_realloc(buffer, *maxLength);
+    }
+    memcpy(buffer + *length, string, stringLength);
+    *length += stringLength;
+    return buffer;
+}
 
-    k=0;
-    while((j = getc(fastaFile)) != EOF) { //initial terminating characters
-        if(j == '>') { //fasta start
-            fastaStart:
-            cA[0] = '\0';
-            l = 0;
-            while(TRUE) {
-                j = getc(fastaFile);
-                if(j == EOF) {
-                    seq = addSeqToList(seq, &k, &seqLength, cA, destination, addSeq); //lax qualification for a sequence
-                    goto cleanup;
-                }
-                if(j == '\n')  {
-                    break;
+/*
+ * Appends part of a sequence, which contains no '>', to seq, dropping white space.
+ */
+static char *fastaAppendSequence(char *seq, int64_t *seqLength, int64_t *seqMaxLength, const char *string,
+        int64_t stringLength) {
+    const char *end = string + stringLength;
+    while (string < end) {
+        const char *newLine = memchr(string, '\n', end - string);
+        const char *lineEnd = newLine != NULL ? newLine : end;
+        if (fastaIsValidSequence(string, lineEnd - string)) {
+            seq = fastaAppend(seq, seqLength, seqMaxLength, string, lineEnd - string);
+        } else { //The line contains spaces or tabs, or isn't valid
+            for (const char *c = string; c < lineEnd; c++) {
+                if (*c != ' ' && *c != '\t') {
+                    if (!isalpha((unsigned char) *c) && *c != '-') {
+                        //For safety and sanity I only allows roman alphabet characters and gaps in fasta sequences.
+                        st_errAbort("!!Got an unexpected character in input fasta sequence: '%c' \n", *c);
+                    }
+                    seq = fastaAppend(seq, seqLength, seqMaxLength, c, 1);
                 }
-                //add to name string
-                cA[l++] = j;
-                cA[l] = '\0';
             }
-            while(TRUE) { //start of sequence
-                j = getc(fastaFile);
-                if(j == EOF) {
-                    seq = addSeqToList(seq, &k, &seqLength, cA, destination, addSeq);
-                    goto cleanup;
+        }
+        string = newLine != NULL ? newLine + 1 : end;
+    }
+    return seq;
+}
+
+void fastaReadToFunction(FILE *fastaFile, void *destination, void (*addSeq)(void *, const char *, const char *, int64_t)) {
+    //reads in group of sequences, a block of the file at a time
+    char *block = st_malloc(FASTA_READ_BLOCK_SIZE);
+    int64_t headerLength = 0, headerMaxLength = 1, seqLength = 0, seqMaxLength = 1;
+    char *header = st_malloc(headerMaxLength);
+    char *seq = st_malloc(seqMaxLength);
+    enum { beforeFirstHeader, inHeader, inSequence } state = beforeFirstHeader;
+    size_t blockLength;
+    while ((blockLength = fread(block, sizeof(char), FASTA_READ_BLOCK_SIZE, fastaFile)) > 0) {
+        const char *c = block, *end = block + blockLength;
+        while (c < end) {
+            if (state == inSequence) {
+                const char *nextHeader = memchr(c, '>', end - c);
+                seq = fastaAppendSequence(seq, &seqLength, &seqMaxLength, c, (nextHeader != NULL ? nextHeader : end) - c);
+                if (nextHeader == NULL) {
+                    c = end;
+                } else { //end of seq
+                    header[headerLength] = '\0';
+                    seq[seqLength] = '\0';
+                    addSeq(destination, header, seq, seqLength);
+                    headerLength = 0;
+                    seqLength = 0;
+                    state = inHeader;
+                    c = nextHeader + 1;
                 }
-                if(j != '\n' && j != ' ' && j != '\t') {
-                    if(j == '>') {
-                        //end of seq
-                        seq = addSeqToList(seq, &k, &seqLength, cA, destination, addSeq);
-                        goto fastaStart;
-                    }
-                    else { //valid char
-                        if(!isalpha(j) && j != '-') {
-                             //For safety and sanity I only allows roman alphabet characters and gaps in fasta sequences.
-                             st_errAbort("!!Got an unexpected character in input fasta sequence: '%c' \n", j);
-                        }
-                        seq = arrayPrepareAppend(seq, &seqLength, k+1, sizeof(char));
-                        seq[k++] = j;
-                    }
+            } else if (state == inHeader) { //headers may be of any length
+                const char *newLine = memchr(c, '\n', end - c);
+                header = fastaAppend(header, &headerLength, &headerMaxLength, c, (newLine != NULL ? newLine : end) - c);
+                if (newLine == NULL) {
+                    c = end;
+                } else {
+                    state = inSequence;
+                    c = newLine + 1;
+                }
+            } else { //initial terminating characters
+                const char *firstHeader = memchr(c, '>', end - c);
+                if (firstHeader == NULL) {
+                    c = end;
+                } else {
+                    state = inHeader;
+                    c = firstHeader + 1;
                 }
             }
         }
     }
-    cleanup:
-    if (seq != NULL) free(seq);
+    if (state != beforeFirstHeader) { //lax qualification for a sequence
+        header[headerLength] = '\0';
+        seq[seqLength] = '\0';
+        addSeq(destination, header, seq, seqLength);
+    }
+    free(block);
+    free(header);
+    free(seq);
 }
 
 // for programmer clarity when using fastaRead(_functoin)
@@ -239,6 +287,17 @@ stHash *fastaReadToMap(FILE *fastaFile) {
 	return fastaRead_map;
 }
 
+static void fastaRead_readToPackedSeqMapFunction(void *fastaRead_map, const char *fastaHeader, const char *sequence, int64_t length) {
+    stHash_insert((stHash *)fastaRead_map, stString_copy(fastaHeader), stPackedSeq_construct2(sequence, length));
+}
+
+stHash *fastaReadToPackedSeqMap(FILE *fastaFile) {
+    stHash *fastaRead_map = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free,
+            (void (*)(void *)) stPackedSeq_destruct);
+    fastaReadToFunction(fastaFile, fastaRead_map, fastaRead_readToPackedSeqMapFunction);
+    return fastaRead_map;
+}
+
 /////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////
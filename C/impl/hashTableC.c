@@ -62,9 +62,19 @@ create_hashtable(uint64_t minsize, uint64_t(*hashf)(const void*), int(*eqf)(
     //my additions
     h->keyFree = keyFree;
     h->valueFree = valueFree;
+    h->useSlabs = 0;
     return h;
 }
 
+/*****************************************************************************/
+void hashtable_freeEntry(struct hashtable *h, struct entry *e) {
+    if (h->useSlabs) {
+        st_slabFree(e);
+    } else {
+        free(e);
+    }
+}
+
 /*****************************************************************************/
 uint64_t hashP(struct hashtable *h, void *k) {
     /* Aim to protect against poor hash functions by adding logic here
@@ -153,7 +163,7 @@ int64_t hashtable_insert(struct hashtable *h, void *k, void *v) {
             exit(1);
         }
     }
-    e = (struct entry *) st_malloc(sizeof(struct entry));
+    e = (struct entry *) (h->useSlabs ? st_slabMalloc(sizeof(struct entry)) : st_malloc(sizeof(struct entry)));
     if (NULL == e) {
         --(h->entrycount);
         return 0;
@@ -208,7 +218,7 @@ hashtable_remove(struct hashtable *h, void *k, int64_t freeKey) {
             if (freeKey) {
                 h->keyFree(e->k);
             }
-            free(e);
+            hashtable_freeEntry(h, e);
             return v;
         }
         pE = &(e->next);
@@ -233,7 +243,7 @@ void hashtable_destroy(struct hashtable *h, int64_t free_values,
                     e = e->next;
                     h->keyFree(f->k);
                     h->valueFree(f->v);
-                    free(f);
+                    hashtable_freeEntry(h, f);
                 }
             }
         } else {
@@ -243,7 +253,7 @@ void hashtable_destroy(struct hashtable *h, int64_t free_values,
                     f = e;
                     e = e->next;
                     h->keyFree(f->k);
-                    free(f);
+                    hashtable_freeEntry(h, f);
                 }
             }
         }
@@ -255,7 +265,7 @@ void hashtable_destroy(struct hashtable *h, int64_t free_values,
                     f = e;
                     e = e->next;
                     h->valueFree(f->v);
-                    free(f);
+                    hashtable_freeEntry(h, f);
                 }
             }
         } else {
@@ -264,7 +274,7 @@ void hashtable_destroy(struct hashtable *h, int64_t free_values,
                 while (NULL != e) {
                     f = e;
                     e = e->next;
-                    free(f);
+                    hashtable_freeEntry(h, f);
                 }
             }
         }
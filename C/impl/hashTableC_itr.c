@@ -115,7 +115,7 @@ hashtable_iterator_remove(struct hashtable_itr *itr)
     remember_parent = itr->parent;
     ret = hashtable_iterator_advance(itr);
     if (itr->parent == remember_e) { itr->parent = remember_parent; }
-    free(remember_e);
+    hashtable_freeEntry(itr->h, remember_e);
     return ret;
 }
 
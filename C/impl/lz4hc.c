@@ -170,6 +170,8 @@ typedef struct _U64_S { U64 v; } U64_S;
 #define HASH_MASK (HASHTABLESIZE - 1)
 
 #define MAX_NB_ATTEMPTS 256
+#define DEFAULT_COMPRESSIONLEVEL 9   // Searches up to 1<<(level-1) = MAX_NB_ATTEMPTS matches
+#define MAX_COMPRESSIONLEVEL 16
 
 #define ML_BITS  4
 #define ML_MASK  (size_t)((1U<<ML_BITS)-1)
@@ -222,6 +224,7 @@ typedef struct
     HTYPE hashTable[HASHTABLESIZE];
     U16 chainTable[MAXD];
     const BYTE* nextToUpdate;
+    int maxAttempts;
 } LZ4HC_Data_Structure;
 
 
@@ -312,6 +315,7 @@ inline static int LZ4HC_Init (LZ4HC_Data_Structure* hc4, const BYTE* base)
     MEM_INIT(hc4->chainTable, 0xFF, sizeof(hc4->chainTable));
     hc4->nextToUpdate = base + LZ4_ARCH64;
     hc4->base = base;
+    hc4->maxAttempts = MAX_NB_ATTEMPTS;
     return 1;
 }
 
@@ -376,7 +380,7 @@ forceinline static int LZ4HC_InsertAndFindBestMatch (LZ4HC_Data_Structure* hc4,
     HTYPE* const HashTable = hc4->hashTable;
     const BYTE* ref;
     INITBASE(base,hc4->base);
-    int nbAttempts=MAX_NB_ATTEMPTS;
+    int nbAttempts=hc4->maxAttempts;
     size_t repl=0, ml=0;
     U16 delta;
 
@@ -444,7 +448,7 @@ forceinline static int LZ4HC_InsertAndGetWiderMatch (LZ4HC_Data_Structure* hc4,
     HTYPE* const HashTable = hc4->hashTable;
     INITBASE(base,hc4->base);
     const BYTE*  ref;
-    int nbAttempts = MAX_NB_ATTEMPTS;
+    int nbAttempts = hc4->maxAttempts;
     int delta = (int)(ip-startLimit);
 
     // First Match
@@ -728,3 +732,19 @@ int LZ4_compressHC(const char* source,
 }
 
 
+int LZ4_compressHC2(const char* source,
+                 char* dest,
+                 int isize,
+                 int compressionLevel)
+{
+    void* ctx = LZ4HC_Create((const BYTE*)source);
+    if (compressionLevel < 1) compressionLevel = DEFAULT_COMPRESSIONLEVEL;
+    if (compressionLevel > MAX_COMPRESSIONLEVEL) compressionLevel = MAX_COMPRESSIONLEVEL;
+    ((LZ4HC_Data_Structure*)ctx)->maxAttempts = 1 << (compressionLevel-1);
+    int result = LZ4_compressHCCtx(ctx, source, dest, isize);
+    LZ4HC_Free (&ctx);
+
+    return result;
+}
+
+
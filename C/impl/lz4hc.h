@@ -50,6 +50,15 @@ LZ4_compressHC :
 */
 
 
+int LZ4_compressHC2 (const char* source, char* dest, int isize, int compressionLevel);
+
+/*
+LZ4_compressHC2 :
+	As LZ4_compressHC, but the match finder searches up to 1<<(compressionLevel-1) matches at each position.
+	compressionLevel : from 1 (fastest) to 16 (best compression); 0 selects the default level of LZ4_compressHC (9)
+*/
+
+
 /* Note :
 Decompression functions are provided within regular LZ4 source code (see "lz4.h") (BSD license)
 */
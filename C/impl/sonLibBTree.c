@@ -0,0 +1,487 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * sonLibBTree.c
+ *
+ * B+-tree backing stSortedSet, see sonLibBTreePrivate.h.
+ */
+
+#include "sonLibGlobalsInternal.h"
+#include "sonLibBTreePrivate.h"
+
+#define BTREE_MIN_LENGTH (ST_BTREE_ORDER / 2) // Least length of a node other than the root.
+#define BTREE_MAX_HEIGHT 24 // Enough for any tree, as nodes below the root have at least 16 children.
+
+static stBTreeLeaf *newLeaf(void) {
+    stBTreeLeaf *leaf = st_slabMalloc(sizeof(stBTreeLeaf));
+    leaf->node.length = 0;
+    leaf->node.isLeaf = 1;
+    leaf->previous = NULL;
+    leaf->next = NULL;
+    return leaf;
+}
+
+static stBTreeInternal *newInternal(void) {
+    stBTreeInternal *internal = st_slabMalloc(sizeof(stBTreeInternal));
+    internal->node.length = 0;
+    internal->node.isLeaf = 0;
+    return internal;
+}
+
+/*
+ * Returns the number of the elements that are less than x.
+ */
+static inline int32_t lowerBound(void **elements, int32_t length, const void *x,
+                                 int (*compareFn)(const void *, const void *)) {
+    int32_t low = 0, high = length;
+    while (low < high) {
+        int32_t mid = (low + high) / 2;
+        if (compareFn(elements[mid], x) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/*
+ * Returns the number of the elements that are less than or equal to x.
+ */
+static inline int32_t upperBound(void **elements, int32_t length, const void *x,
+                                 int (*compareFn)(const void *, const void *)) {
+    int32_t low = 0, high = length;
+    while (low < high) {
+        int32_t mid = (low + high) / 2;
+        if (compareFn(elements[mid], x) <= 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/*
+ * Returns the leaf that holds x, if x is in the tree. If path is non-null the internal
+ * nodes on the way, and the index of the child taken in each, are recorded.
+ */
+static stBTreeLeaf *findLeaf(stBTree *tree, const void *x, stBTreeInternal **path, int32_t *indices) {
+    stBTreeNode *node = tree->root;
+    for (int32_t depth = 0; !node->isLeaf; depth++) {
+        stBTreeInternal *internal = (stBTreeInternal *) node;
+        int32_t i = upperBound(internal->keys, node->length - 1, x, tree->compareFn);
+        if (path != NULL) {
+            path[depth] = internal;
+            indices[depth] = i;
+        }
+        node = internal->children[i];
+    }
+    return (stBTreeLeaf *) node;
+}
+
+/*
+ * Sets the separator of the leaf at the end of the path, which is held by the deepest
+ * node on the path that was not entered through its first child. Called when the least
+ * element of the leaf changes.
+ */
+static void setSeparator(stBTree *tree, stBTreeInternal **path, int32_t *indices, void *element) {
+    for (int32_t depth = tree->height - 1; depth >= 0; depth--) {
+        if (indices[depth] > 0) {
+            path[depth]->keys[indices[depth] - 1] = element;
+            return;
+        }
+    }
+}
+
+stBTree *stBTree_construct(int (*compareFn)(const void *, const void *)) {
+    return stBTree_constructFromSortedArray(compareFn, NULL, 0);
+}
+
+stBTree *stBTree_constructFromSortedArray(int (*compareFn)(const void *, const void *), void **elements,
+                                          int64_t length) {
+    stBTree *tree = st_malloc(sizeof(stBTree));
+    tree->compareFn = compareFn;
+    tree->size = length;
+    tree->height = 0;
+    // Spread the elements evenly over as few leaves as will hold them, so each
+    // leaf but a lone root is at least half full.
+    int64_t numNodes = length == 0 ? 1 : (length + ST_BTREE_ORDER - 1) / ST_BTREE_ORDER;
+    stBTreeNode **nodes = st_malloc(numNodes * sizeof(stBTreeNode *));
+    void **mins = st_malloc(numNodes * sizeof(void *));
+    stBTreeLeaf *previous = NULL;
+    for (int64_t i = 0; i < numNodes; i++) {
+        int64_t start = i * length / numNodes, end = (i + 1) * length / numNodes;
+        stBTreeLeaf *leaf = newLeaf();
+        if (end > start) {
+            memcpy(leaf->elements, elements + start, (end - start) * sizeof(void *));
+        }
+        leaf->node.length = (int32_t) (end - start);
+        leaf->previous = previous;
+        if (previous != NULL) {
+            previous->next = leaf;
+        }
+        previous = leaf;
+        nodes[i] = &leaf->node;
+        mins[i] = length == 0 ? NULL : elements[start];
+    }
+    tree->firstLeaf = (stBTreeLeaf *) nodes[0];
+    tree->lastLeaf = previous;
+    // Build the levels of internal nodes in the same way, in place, as the parents
+    // never outnumber the children.
+    while (numNodes > 1) {
+        int64_t numParents = (numNodes + ST_BTREE_ORDER - 1) / ST_BTREE_ORDER;
+        for (int64_t i = 0; i < numParents; i++) {
+            int64_t start = i * numNodes / numParents, end = (i + 1) * numNodes / numParents;
+            stBTreeInternal *internal = newInternal();
+            for (int64_t j = start; j < end; j++) {
+                internal->children[j - start] = nodes[j];
+                if (j > start) {
+                    internal->keys[j - start - 1] = mins[j];
+                }
+            }
+            internal->node.length = (int32_t) (end - start);
+            nodes[i] = &internal->node;
+            mins[i] = mins[start];
+        }
+        numNodes = numParents;
+        tree->height++;
+    }
+    tree->root = nodes[0];
+    free(nodes);
+    free(mins);
+    return tree;
+}
+
+static void destructNode(stBTreeNode *node, void (*destructElementFn)(void *)) {
+    if (node->isLeaf) {
+        if (destructElementFn != NULL) {
+            stBTreeLeaf *leaf = (stBTreeLeaf *) node;
+            for (int32_t i = 0; i < node->length; i++) {
+                destructElementFn(leaf->elements[i]);
+            }
+        }
+    } else {
+        stBTreeInternal *internal = (stBTreeInternal *) node;
+        for (int32_t i = 0; i < node->length; i++) {
+            destructNode(internal->children[i], destructElementFn);
+        }
+    }
+    st_slabFree(node);
+}
+
+void stBTree_destruct(stBTree *tree, void (*destructElementFn)(void *)) {
+    destructNode(tree->root, destructElementFn);
+    free(tree);
+}
+
+/*
+ * Adds the child, whose least element is key, to the last node of the path, after the
+ * child the path went through, splitting nodes up the path as they fill.
+ */
+static void insertChild(stBTree *tree, stBTreeInternal **path, int32_t *indices, stBTreeNode *child, void *key) {
+    for (int32_t depth = tree->height - 1; depth >= 0; depth--) {
+        stBTreeInternal *internal = path[depth];
+        int32_t i = indices[depth] + 1, length = internal->node.length;
+        if (length < ST_BTREE_ORDER) {
+            memmove(internal->children + i + 1, internal->children + i, (length - i) * sizeof(stBTreeNode *));
+            memmove(internal->keys + i, internal->keys + i - 1, (length - i) * sizeof(void *));
+            internal->children[i] = child;
+            internal->keys[i - 1] = key;
+            internal->node.length++;
+            return;
+        }
+        // Split the full node, passing the least element of the new right half up.
+        stBTreeNode *children[ST_BTREE_ORDER + 1];
+        void *keys[ST_BTREE_ORDER];
+        memcpy(children, internal->children, i * sizeof(stBTreeNode *));
+        children[i] = child;
+        memcpy(children + i + 1, internal->children + i, (length - i) * sizeof(stBTreeNode *));
+        memcpy(keys, internal->keys, (i - 1) * sizeof(void *));
+        keys[i - 1] = key;
+        memcpy(keys + i, internal->keys + i - 1, (length - i) * sizeof(void *));
+        int32_t leftLength = (ST_BTREE_ORDER + 1) / 2, rightLength = ST_BTREE_ORDER + 1 - leftLength;
+        stBTreeInternal *right = newInternal();
+        memcpy(internal->children, children, leftLength * sizeof(stBTreeNode *));
+        memcpy(internal->keys, keys, (leftLength - 1) * sizeof(void *));
+        internal->node.length = leftLength;
+        memcpy(right->children, children + leftLength, rightLength * sizeof(stBTreeNode *));
+        memcpy(right->keys, keys + leftLength, (rightLength - 1) * sizeof(void *));
+        right->node.length = rightLength;
+        child = &right->node;
+        key = keys[leftLength - 1];
+    }
+    // The root was split, so grow a new one.
+    assert(tree->height < BTREE_MAX_HEIGHT);
+    stBTreeInternal *root = newInternal();
+    root->children[0] = tree->root;
+    root->children[1] = child;
+    root->keys[0] = key;
+    root->node.length = 2;
+    tree->root = &root->node;
+    tree->height++;
+}
+
+void *stBTree_insert(stBTree *tree, void *element) {
+    stBTreeInternal *path[BTREE_MAX_HEIGHT];
+    int32_t indices[BTREE_MAX_HEIGHT];
+    stBTreeLeaf *leaf = findLeaf(tree, element, path, indices);
+    int32_t i = lowerBound(leaf->elements, leaf->node.length, element, tree->compareFn), length = leaf->node.length;
+    if (i < length && tree->compareFn(leaf->elements[i], element) == 0) {
+        void *replaced = leaf->elements[i];
+        leaf->elements[i] = element;
+        if (i == 0) {
+            setSeparator(tree, path, indices, element);
+        }
+        return replaced;
+    }
+    // An element only goes first in a leaf if it is the first leaf, so no separator changes.
+    tree->size++;
+    if (length < ST_BTREE_ORDER) {
+        memmove(leaf->elements + i + 1, leaf->elements + i, (length - i) * sizeof(void *));
+        leaf->elements[i] = element;
+        leaf->node.length++;
+        return NULL;
+    }
+    void *elements[ST_BTREE_ORDER + 1];
+    memcpy(elements, leaf->elements, i * sizeof(void *));
+    elements[i] = element;
+    memcpy(elements + i + 1, leaf->elements + i, (length - i) * sizeof(void *));
+    int32_t leftLength = (ST_BTREE_ORDER + 1) / 2, rightLength = ST_BTREE_ORDER + 1 - leftLength;
+    stBTreeLeaf *right = newLeaf();
+    memcpy(leaf->elements, elements, leftLength * sizeof(void *));
+    leaf->node.length = leftLength;
+    memcpy(right->elements, elements + leftLength, rightLength * sizeof(void *));
+    right->node.length = rightLength;
+    right->previous = leaf;
+    right->next = leaf->next;
+    if (leaf->next != NULL) {
+        leaf->next->previous = right;
+    } else {
+        tree->lastLeaf = right;
+    }
+    leaf->next = right;
+    insertChild(tree, path, indices, &right->node, right->elements[0]);
+    return NULL;
+}
+
+/*
+ * Moves the last element or child of left, the child before node, to the front of node.
+ */
+static void borrowFromLeft(stBTreeInternal *parent, int32_t i, stBTreeNode *left, stBTreeNode *node) {
+    if (node->isLeaf) {
+        stBTreeLeaf *leftLeaf = (stBTreeLeaf *) left, *leaf = (stBTreeLeaf *) node;
+        memmove(leaf->elements + 1, leaf->elements, node->length * sizeof(void *));
+        leaf->elements[0] = leftLeaf->elements[left->length - 1];
+        parent->keys[i - 1] = leaf->elements[0];
+    } else {
+        stBTreeInternal *leftInternal = (stBTreeInternal *) left, *internal = (stBTreeInternal *) node;
+        memmove(internal->children + 1, internal->children, node->length * sizeof(stBTreeNode *));
+        memmove(internal->keys + 1, internal->keys, (node->length - 1) * sizeof(void *));
+        internal->children[0] = leftInternal->children[left->length - 1];
+        internal->keys[0] = parent->keys[i - 1];
+        parent->keys[i - 1] = leftInternal->keys[left->length - 2];
+    }
+    left->length--;
+    node->length++;
+}
+
+/*
+ * Moves the first element or child of right, the child after node, to the end of node.
+ */
+static void borrowFromRight(stBTreeInternal *parent, int32_t i, stBTreeNode *node, stBTreeNode *right) {
+    if (node->isLeaf) {
+        stBTreeLeaf *leaf = (stBTreeLeaf *) node, *rightLeaf = (stBTreeLeaf *) right;
+        leaf->elements[node->length] = rightLeaf->elements[0];
+        memmove(rightLeaf->elements, rightLeaf->elements + 1, (right->length - 1) * sizeof(void *));
+        parent->keys[i] = rightLeaf->elements[0];
+    } else {
+        stBTreeInternal *internal = (stBTreeInternal *) node, *rightInternal = (stBTreeInternal *) right;
+        internal->children[node->length] = rightInternal->children[0];
+        internal->keys[node->length - 1] = parent->keys[i];
+        parent->keys[i] = rightInternal->keys[0];
+        memmove(rightInternal->children, rightInternal->children + 1, (right->length - 1) * sizeof(stBTreeNode *));
+        memmove(rightInternal->keys, rightInternal->keys + 1, (right->length - 2) * sizeof(void *));
+    }
+    right->length--;
+    node->length++;
+}
+
+/*
+ * Merges right, child i + 1 of the parent, into left, child i, and frees it.
+ */
+static void merge(stBTree *tree, stBTreeInternal *parent, int32_t i, stBTreeNode *left, stBTreeNode *right) {
+    if (left->isLeaf) {
+        stBTreeLeaf *leftLeaf = (stBTreeLeaf *) left, *rightLeaf = (stBTreeLeaf *) right;
+        memcpy(leftLeaf->elements + left->length, rightLeaf->elements, right->length * sizeof(void *));
+        leftLeaf->next = rightLeaf->next;
+        if (rightLeaf->next != NULL) {
+            rightLeaf->next->previous = leftLeaf;
+        } else {
+            tree->lastLeaf = leftLeaf;
+        }
+    } else {
+        stBTreeInternal *leftInternal = (stBTreeInternal *) left, *rightInternal = (stBTreeInternal *) right;
+        leftInternal->keys[left->length - 1] = parent->keys[i];
+        memcpy(leftInternal->keys + left->length, rightInternal->keys, (right->length - 1) * sizeof(void *));
+        memcpy(leftInternal->children + left->length, rightInternal->children,
+               right->length * sizeof(stBTreeNode *));
+    }
+    left->length += right->length;
+    st_slabFree(right);
+    int32_t length = parent->node.length;
+    memmove(parent->keys + i, parent->keys + i + 1, (length - i - 2) * sizeof(void *));
+    memmove(parent->children + i + 1, parent->children + i + 2, (length - i - 2) * sizeof(stBTreeNode *));
+    parent->node.length--;
+}
+
+/*
+ * Restores the least length of the node at the end of the path, and of its ancestors
+ * in turn, by borrowing from or merging with a sibling.
+ */
+static void rebalance(stBTree *tree, stBTreeInternal **path, int32_t *indices, stBTreeNode *node) {
+    for (int32_t depth = tree->height - 1; depth >= 0 && node->length < BTREE_MIN_LENGTH; depth--) {
+        stBTreeInternal *parent = path[depth];
+        int32_t i = indices[depth];
+        stBTreeNode *left = i > 0 ? parent->children[i - 1] : NULL;
+        stBTreeNode *right = i + 1 < parent->node.length ? parent->children[i + 1] : NULL;
+        if (left != NULL && left->length > BTREE_MIN_LENGTH) {
+            borrowFromLeft(parent, i, left, node);
+            return;
+        }
+        if (right != NULL && right->length > BTREE_MIN_LENGTH) {
+            borrowFromRight(parent, i, node, right);
+            return;
+        }
+        if (left != NULL) {
+            merge(tree, parent, i - 1, left, node);
+        } else {
+            merge(tree, parent, i, node, right);
+        }
+        node = &parent->node;
+    }
+    if (!tree->root->isLeaf && tree->root->length == 1) {
+        stBTreeInternal *root = (stBTreeInternal *) tree->root;
+        tree->root = root->children[0];
+        tree->height--;
+        st_slabFree(root);
+    }
+}
+
+void *stBTree_remove(stBTree *tree, const void *element) {
+    stBTreeInternal *path[BTREE_MAX_HEIGHT];
+    int32_t indices[BTREE_MAX_HEIGHT];
+    stBTreeLeaf *leaf = findLeaf(tree, element, path, indices);
+    int32_t i = lowerBound(leaf->elements, leaf->node.length, element, tree->compareFn);
+    if (i == leaf->node.length || tree->compareFn(leaf->elements[i], element) != 0) {
+        return NULL;
+    }
+    void *removed = leaf->elements[i];
+    memmove(leaf->elements + i, leaf->elements + i + 1, (leaf->node.length - i - 1) * sizeof(void *));
+    leaf->node.length--;
+    tree->size--;
+    if (i == 0 && leaf->node.length > 0) {
+        setSeparator(tree, path, indices, leaf->elements[0]);
+    }
+    rebalance(tree, path, indices, &leaf->node);
+    return removed;
+}
+
+void *stBTree_search(stBTree *tree, const void *element) {
+    stBTreeLeaf *leaf = findLeaf(tree, element, NULL, NULL);
+    int32_t i = lowerBound(leaf->elements, leaf->node.length, element, tree->compareFn);
+    return i < leaf->node.length && tree->compareFn(leaf->elements[i], element) == 0 ? leaf->elements[i] : NULL;
+}
+
+/*
+ * Returns the element at index i of the leaf, or if i is off either end of the leaf,
+ * the nearest element of the neighbouring leaf, or NULL.
+ */
+static void *getElement(stBTreeLeaf *leaf, int32_t i) {
+    if (i < 0) {
+        leaf = leaf->previous;
+        return leaf == NULL ? NULL : leaf->elements[leaf->node.length - 1];
+    }
+    if (i >= leaf->node.length) {
+        leaf = leaf->next;
+        return leaf == NULL ? NULL : leaf->elements[0];
+    }
+    return leaf->elements[i];
+}
+
+void *stBTree_searchLessThanOrEqual(stBTree *tree, const void *element) {
+    stBTreeLeaf *leaf = findLeaf(tree, element, NULL, NULL);
+    return getElement(leaf, upperBound(leaf->elements, leaf->node.length, element, tree->compareFn) - 1);
+}
+
+void *stBTree_searchLessThan(stBTree *tree, const void *element) {
+    stBTreeLeaf *leaf = findLeaf(tree, element, NULL, NULL);
+    return getElement(leaf, lowerBound(leaf->elements, leaf->node.length, element, tree->compareFn) - 1);
+}
+
+void *stBTree_searchGreaterThanOrEqual(stBTree *tree, const void *element) {
+    stBTreeLeaf *leaf = findLeaf(tree, element, NULL, NULL);
+    return getElement(leaf, lowerBound(leaf->elements, leaf->node.length, element, tree->compareFn));
+}
+
+void *stBTree_searchGreaterThan(stBTree *tree, const void *element) {
+    stBTreeLeaf *leaf = findLeaf(tree, element, NULL, NULL);
+    return getElement(leaf, upperBound(leaf->elements, leaf->node.length, element, tree->compareFn));
+}
+
+void *stBTree_getFirst(stBTree *tree) {
+    return tree->size == 0 ? NULL : tree->firstLeaf->elements[0];
+}
+
+void *stBTree_getLast(stBTree *tree) {
+    return tree->size == 0 ? NULL : tree->lastLeaf->elements[tree->lastLeaf->node.length - 1];
+}
+
+void *stBTree_find(stBTree *tree, const void *element, stBTreePosition *position) {
+    stBTreeLeaf *leaf = findLeaf(tree, element, NULL, NULL);
+    int32_t i = lowerBound(leaf->elements, leaf->node.length, element, tree->compareFn);
+    if (i == leaf->node.length || tree->compareFn(leaf->elements[i], element) != 0) {
+        return NULL;
+    }
+    position->leaf = leaf;
+    position->index = i;
+    return leaf->elements[i];
+}
+
+void *stBTree_getNext(stBTree *tree, stBTreePosition *position) {
+    if (position->leaf == NULL) {
+        if (tree->size == 0) {
+            return NULL;
+        }
+        position->leaf = tree->firstLeaf;
+        position->index = 0;
+    } else if (++position->index == position->leaf->node.length) {
+        position->leaf = position->leaf->next;
+        position->index = 0;
+        if (position->leaf == NULL) {
+            return NULL;
+        }
+    }
+    return position->leaf->elements[position->index];
+}
+
+void *stBTree_getPrevious(stBTree *tree, stBTreePosition *position) {
+    if (position->leaf == NULL) {
+        if (tree->size == 0) {
+            return NULL;
+        }
+        position->leaf = tree->lastLeaf;
+        position->index = tree->lastLeaf->node.length - 1;
+    } else if (position->index-- == 0) {
+        position->leaf = position->leaf->previous;
+        if (position->leaf == NULL) {
+            return NULL;
+        }
+        position->index = position->leaf->node.length - 1;
+    }
+    return position->leaf->elements[position->index];
+}
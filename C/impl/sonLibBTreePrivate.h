@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * sonLibBTreePrivate.h
+ *
+ * B+-tree used as an alternative backend for stSortedSet. The elements are held
+ * in the leaves, up to ST_BTREE_ORDER to a leaf, and the leaves are linked in
+ * order, so iteration walks arrays rather than chasing a pointer per element.
+ * Each internal node holds its children and, for every child but the first, the
+ * least element under that child, so a search makes one comparison pass over a
+ * node per level. The separators are always the least element of their subtree
+ * (they are updated on removal), so the tree never holds a pointer to an element
+ * that has been removed.
+ */
+
+#ifndef SONLIB_BTREE_PRIVATE_H_
+#define SONLIB_BTREE_PRIVATE_H_
+
+// The most elements in a leaf and children of an internal node. Nodes other
+// than the root hold at least half this many.
+#define ST_BTREE_ORDER 32
+
+typedef struct _stBTree stBTree;
+
+typedef struct _stBTreeNode {
+    int32_t length; // Number of elements of a leaf, or children of an internal node.
+    bool isLeaf;
+} stBTreeNode;
+
+typedef struct _stBTreeLeaf {
+    stBTreeNode node;
+    struct _stBTreeLeaf *previous;
+    struct _stBTreeLeaf *next;
+    void *elements[ST_BTREE_ORDER];
+} stBTreeLeaf;
+
+typedef struct _stBTreeInternal {
+    stBTreeNode node;
+    void *keys[ST_BTREE_ORDER - 1]; // keys[i] is the least element under children[i + 1].
+    stBTreeNode *children[ST_BTREE_ORDER];
+} stBTreeInternal;
+
+struct _stBTree {
+    stBTreeNode *root; // An empty leaf if the tree is empty.
+    stBTreeLeaf *firstLeaf;
+    stBTreeLeaf *lastLeaf;
+    int64_t size;
+    int32_t height; // Number of levels of internal nodes.
+    int (*compareFn)(const void *, const void *);
+};
+
+/*
+ * A position in the tree, used by iterators. If leaf is NULL the position is before the
+ * first and after the last element.
+ */
+typedef struct _stBTreePosition {
+    stBTreeLeaf *leaf;
+    int32_t index;
+} stBTreePosition;
+
+stBTree *stBTree_construct(int (*compareFn)(const void *, const void *));
+
+/*
+ * Builds a tree from the given elements, which must be in strictly increasing order,
+ * in linear time.
+ */
+stBTree *stBTree_constructFromSortedArray(int (*compareFn)(const void *, const void *), void **elements,
+                                          int64_t length);
+
+/*
+ * Frees the tree, calling the destructor (if non-null) on each element.
+ */
+void stBTree_destruct(stBTree *tree, void (*destructElementFn)(void *));
+
+/*
+ * Inserts the element, replacing any equal element. Returns the replaced element, or NULL.
+ */
+void *stBTree_insert(stBTree *tree, void *element);
+
+/*
+ * Removes and returns the element equal to the given one, or returns NULL if there is none.
+ */
+void *stBTree_remove(stBTree *tree, const void *element);
+
+void *stBTree_search(stBTree *tree, const void *element);
+
+void *stBTree_searchLessThanOrEqual(stBTree *tree, const void *element);
+
+void *stBTree_searchLessThan(stBTree *tree, const void *element);
+
+void *stBTree_searchGreaterThanOrEqual(stBTree *tree, const void *element);
+
+void *stBTree_searchGreaterThan(stBTree *tree, const void *element);
+
+void *stBTree_getFirst(stBTree *tree);
+
+void *stBTree_getLast(stBTree *tree);
+
+/*
+ * Sets the position to the element equal to the given one, returning it, or returns
+ * NULL and leaves the position unchanged if there is none.
+ */
+void *stBTree_find(stBTree *tree, const void *element, stBTreePosition *position);
+
+/*
+ * Moves the position to the next element and returns it. From the null position this
+ * is the first element; after the last element the position becomes null and NULL is returned.
+ */
+void *stBTree_getNext(stBTree *tree, stBTreePosition *position);
+
+/*
+ * As stBTree_getNext, but moving to the previous element.
+ */
+void *stBTree_getPrevious(stBTree *tree, stBTreePosition *position);
+
+#endif /* SONLIB_BTREE_PRIVATE_H_ */
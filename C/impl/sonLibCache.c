@@ -7,18 +7,36 @@
 //Cache functions
 
 #include "sonLibGlobalsInternal.h"
+#include <pthread.h>
+
+typedef struct _cacheRecord stCacheRecord;
 
 struct stCache {
     stSortedSet *cache;
+    /*
+     * Fragments in order of last use, most recent first, for eviction.
+     */
+    stCacheRecord *mostRecent, *leastRecent;
+    int64_t maxSize; //The budget for the total size of the fragments, in bytes.
+    int64_t size; //The current total size of the fragments.
+    int64_t hits, misses, evictions;
+    /*
+     * If non-null the cache is thread safe, and records are instead held in these unsynchronised
+     * caches, chosen by the hash of the key, each guarded by its own lock.
+     */
+    stCache **shards;
+    pthread_mutex_t *shardLocks;
+    int64_t numShards;
 };
 
-typedef struct _cacheRecord {
+struct _cacheRecord {
     /*
      * A little object for storing records in the cache.
      */
     int64_t key, start, size;
     char *record;
-} stCacheRecord;
+    stCacheRecord *moreRecent, *lessRecent;
+};
 
 static int cacheRecord_cmp(const void *a, const void *b) {
     const stCacheRecord *i = a;
@@ -63,9 +81,68 @@ static stCacheRecord *cacheRecord_construct(int64_t key,
     record->size = size;
     record->record = copyMemory ? memcpy(st_malloc(size), value, size)
             : (char *) value;
+    record->moreRecent = NULL;
+    record->lessRecent = NULL;
     return record;
 }
 
+static void unlinkRecord(stCache *cache, stCacheRecord *record) {
+    if (record->moreRecent != NULL) {
+        record->moreRecent->lessRecent = record->lessRecent;
+    } else {
+        cache->mostRecent = record->lessRecent;
+    }
+    if (record->lessRecent != NULL) {
+        record->lessRecent->moreRecent = record->moreRecent;
+    } else {
+        cache->leastRecent = record->moreRecent;
+    }
+    record->moreRecent = NULL;
+    record->lessRecent = NULL;
+}
+
+static void linkRecordAsMostRecent(stCache *cache, stCacheRecord *record) {
+    record->moreRecent = NULL;
+    record->lessRecent = cache->mostRecent;
+    if (cache->mostRecent != NULL) {
+        cache->mostRecent->moreRecent = record;
+    } else {
+        cache->leastRecent = record;
+    }
+    cache->mostRecent = record;
+}
+
+static void touchRecord(stCache *cache, stCacheRecord *record) {
+    if (cache->mostRecent != record) {
+        unlinkRecord(cache, record);
+        linkRecordAsMostRecent(cache, record);
+    }
+}
+
+static void insertRecord(stCache *cache, stCacheRecord *record) {
+    stSortedSet_insert(cache->cache, record);
+    linkRecordAsMostRecent(cache, record);
+    cache->size += record->size;
+}
+
+static void removeRecord(stCache *cache, stCacheRecord *record) {
+    stSortedSet_remove(cache->cache, record);
+    unlinkRecord(cache, record);
+    cache->size -= record->size;
+    cacheRecord_destruct(record);
+}
+
+static void evictRecords(stCache *cache) {
+    /*
+     * Evicts the least recently used fragments until the cache is within budget, though never the
+     * most recently used fragment.
+     */
+    while (cache->size > cache->maxSize && cache->leastRecent != cache->mostRecent) {
+        removeRecord(cache, cache->leastRecent);
+        cache->evictions++;
+    }
+}
+
 static stCacheRecord *getLessThanOrEqualRecord(stCache *cache,
         int64_t key, int64_t start, int64_t size) {
     stCacheRecord record = getTempRecord(key, start, size);
@@ -126,19 +203,19 @@ static stCacheRecord *mergeRecords(stCacheRecord *record1,
     return record3;
 }
 
-void deleteRecord(stCache *cache, int64_t key,
+static void deleteRecord(stCache *cache, int64_t key,
         int64_t start, int64_t size) {
     assert(!stCache_containsRecord(cache, key, start, size)); //Will not delete a record wholly contained in.
     stCacheRecord *record = getLessThanOrEqualRecord(cache, key, start,
             size);
     while (record != NULL && recordOverlapsWith(record, key, start, size)) { //could have multiple fragments in there to remove.
         if (recordContainedIn(record, key, start, size)) { //We get rid of the record because it is contained in the range
-            stSortedSet_remove(cache->cache, record);
-            cacheRecord_destruct(record);
+            removeRecord(cache, record);
             record = getLessThanOrEqualRecord(cache, key, start, size);
         } else { //The range overlaps with, but is not fully contained in, so we trim it..
             assert(record->start < start);
             assert(record->start + record->size > start);
+            cache->size -= record->size - (start - record->start);
             record->size = start - record->start;
             assert(record->size >= 0);
             break;
@@ -147,8 +224,7 @@ void deleteRecord(stCache *cache, int64_t key,
     record = getGreaterThanOrEqualRecord(cache, key, start, size);
     while (record != NULL && recordOverlapsWith(record, key, start, size)) { //could have multiple fragments in there to remove.
         if (recordContainedIn(record, key, start, size)) { //We get rid of the record because it is contained in the range
-            stSortedSet_remove(cache->cache, record);
-            cacheRecord_destruct(record);
+            removeRecord(cache, record);
             record = getGreaterThanOrEqualRecord(cache, key, start, size);
         } else { //The range overlaps with, but is not fully contained in, so we trim it..
             assert(record->start < start + size);
@@ -159,6 +235,7 @@ void deleteRecord(stCache *cache, int64_t key,
             char *newMem = memcpy(st_malloc(newSize),
                     record->record + start + size - record->start, newSize);
             free(record->record);
+            cache->size -= record->size - newSize;
             record->record = newMem;
             record->start = newStart;
             record->size = newSize;
@@ -168,30 +245,155 @@ void deleteRecord(stCache *cache, int64_t key,
 }
 
 
+static int64_t getShardIndex(stCache *cache, int64_t key) {
+    uint64_t h = (uint64_t) key;
+    h = (h ^ (h >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    h = (h ^ (h >> 27)) * UINT64_C(0x94d049bb133111eb);
+    return (int64_t) ((h ^ (h >> 31)) % cache->numShards);
+}
+
+static stCache *lockShard(stCache *cache, int64_t shardIndex) {
+    pthread_mutex_lock(&cache->shardLocks[shardIndex]);
+    return cache->shards[shardIndex];
+}
+
+static void unlockShard(stCache *cache, int64_t shardIndex) {
+    pthread_mutex_unlock(&cache->shardLocks[shardIndex]);
+}
+
+static int64_t getShardMaxSize(stCache *cache, int64_t maxSizeInBytes) {
+    return maxSizeInBytes == INT64_MAX ? INT64_MAX : maxSizeInBytes / cache->numShards;
+}
+
 /*
  * Public functions
  */
 
 stCache *stCache_construct(void) {
-    stCache *cache = st_malloc(sizeof(stCache));
+    return stCache_construct2(INT64_MAX);
+}
+
+stCache *stCache_construct2(int64_t maxSizeInBytes) {
+    assert(maxSizeInBytes >= 0);
+    stCache *cache = st_calloc(1, sizeof(stCache));
     cache->cache = stSortedSet_construct3(cacheRecord_cmp,
             (void(*)(void *)) cacheRecord_destruct);
+    cache->maxSize = maxSizeInBytes;
+    return cache;
+}
+
+stCache *stCache_construct3(int64_t maxSizeInBytes, int64_t numShards) {
+    assert(numShards >= 0);
+    stCache *cache = stCache_construct2(maxSizeInBytes);
+    if (numShards > 0) {
+        cache->numShards = numShards;
+        cache->shards = st_malloc(numShards * sizeof(stCache *));
+        cache->shardLocks = st_malloc(numShards * sizeof(pthread_mutex_t));
+        for (int64_t i = 0; i < numShards; i++) {
+            cache->shards[i] = stCache_construct2(getShardMaxSize(cache, maxSizeInBytes));
+            int pthreadError = pthread_mutex_init(&cache->shardLocks[i], NULL);
+            if (pthreadError) {
+                st_errAbort("stCache: pthread_mutex_init failed: %s", strerror(pthreadError));
+            }
+        }
+    }
     return cache;
 }
 
 void stCache_destruct(stCache *cache) {
+    if (cache->shards != NULL) {
+        for (int64_t i = 0; i < cache->numShards; i++) {
+            stCache_destruct(cache->shards[i]);
+            pthread_mutex_destroy(&cache->shardLocks[i]);
+        }
+        free(cache->shards);
+        free(cache->shardLocks);
+    }
     stSortedSet_destruct(cache->cache);
     free(cache);
 }
 
 void stCache_clear(stCache *cache) {
+    if (cache->shards != NULL) {
+        for (int64_t i = 0; i < cache->numShards; i++) {
+            stCache_clear(lockShard(cache, i));
+            unlockShard(cache, i);
+        }
+        return;
+    }
     stSortedSet_destruct(cache->cache);
     cache->cache = stSortedSet_construct3(cacheRecord_cmp,
             (void(*)(void *)) cacheRecord_destruct);
+    cache->mostRecent = NULL;
+    cache->leastRecent = NULL;
+    cache->size = 0;
+}
+
+void stCache_setMaxSize(stCache *cache, int64_t maxSizeInBytes) {
+    assert(maxSizeInBytes >= 0);
+    cache->maxSize = maxSizeInBytes;
+    if (cache->shards != NULL) {
+        for (int64_t i = 0; i < cache->numShards; i++) {
+            stCache_setMaxSize(lockShard(cache, i), getShardMaxSize(cache, maxSizeInBytes));
+            unlockShard(cache, i);
+        }
+        return;
+    }
+    evictRecords(cache);
+}
+
+/*
+ * Sums one of the statistics over the shards of a thread safe cache.
+ */
+static int64_t sumOverShards(stCache *cache, int64_t (*getStatistic)(stCache *)) {
+    int64_t total = 0;
+    for (int64_t i = 0; i < cache->numShards; i++) {
+        total += getStatistic(lockShard(cache, i));
+        unlockShard(cache, i);
+    }
+    return total;
+}
+
+int64_t stCache_getMaxSize(stCache *cache) {
+    return cache->maxSize;
+}
+
+int64_t stCache_getSize(stCache *cache) {
+    if (cache->shards != NULL) {
+        return sumOverShards(cache, stCache_getSize);
+    }
+    return cache->size;
+}
+
+int64_t stCache_getHits(stCache *cache) {
+    if (cache->shards != NULL) {
+        return sumOverShards(cache, stCache_getHits);
+    }
+    return cache->hits;
+}
+
+int64_t stCache_getMisses(stCache *cache) {
+    if (cache->shards != NULL) {
+        return sumOverShards(cache, stCache_getMisses);
+    }
+    return cache->misses;
+}
+
+int64_t stCache_getEvictions(stCache *cache) {
+    if (cache->shards != NULL) {
+        return sumOverShards(cache, stCache_getEvictions);
+    }
+    return cache->evictions;
 }
 
 void stCache_setRecord(stCache *cache, int64_t key,
        int64_t start, int64_t size,  const void *value) {
+    if (cache->shards != NULL) {
+        int64_t i = getShardIndex(cache, key);
+        stCache_setRecord(lockShard(cache, i), key, start, size, value);
+        unlockShard(cache, i);
+        return;
+    }
     //If the record is already contained we update a portion of it.
     assert(value != NULL);
     if (stCache_containsRecord(cache, key, start, size)) {
@@ -202,6 +404,7 @@ void stCache_setRecord(stCache *cache, int64_t key,
         assert(record->start <= start);
         assert(record->start + record->size >= start + size);
         memcpy(record->record + start - record->start, value, size);
+        touchRecord(cache, record);
         return;
     }
     //Get rid of bits that are contained in this record..
@@ -214,8 +417,7 @@ void stCache_setRecord(stCache *cache, int64_t key,
     assert(record2 != NULL);
     if (record1 != NULL && recordsAdjacent(record1, record2)) {
         stCacheRecord *i = mergeRecords(record1, record2);
-        stSortedSet_remove(cache->cache, record1);
-        cacheRecord_destruct(record1);
+        removeRecord(cache, record1);
         cacheRecord_destruct(record2);
         record2 = i;
     }
@@ -223,16 +425,36 @@ void stCache_setRecord(stCache *cache, int64_t key,
             start, size);
     if (record3 != NULL && recordsAdjacent(record2, record3)) {
         stCacheRecord *i = mergeRecords(record2, record3);
-        stSortedSet_remove(cache->cache, record3);
+        removeRecord(cache, record3);
         cacheRecord_destruct(record2);
-        cacheRecord_destruct(record3);
         record2 = i;
     }
-    stSortedSet_insert(cache->cache, record2);
+    insertRecord(cache, record2);
+    evictRecords(cache);
+}
+
+void stCache_removeRecord(stCache *cache, int64_t key) {
+    if (cache->shards != NULL) {
+        int64_t i = getShardIndex(cache, key);
+        stCache_removeRecord(lockShard(cache, i), key);
+        unlockShard(cache, i);
+        return;
+    }
+    stCacheRecord *record = getGreaterThanOrEqualRecord(cache, key, 0, 0);
+    while (record != NULL && record->key == key) {
+        removeRecord(cache, record);
+        record = getGreaterThanOrEqualRecord(cache, key, 0, 0);
+    }
 }
 
 bool stCache_containsRecord(stCache *cache, int64_t key,
         int64_t start, int64_t size) {
+    if (cache->shards != NULL) {
+        int64_t i = getShardIndex(cache, key);
+        bool contained = stCache_containsRecord(lockShard(cache, i), key, start, size);
+        unlockShard(cache, i);
+        return contained;
+    }
     assert(start >= 0);
     assert(size >= 0);
     stCacheRecord *record = getLessThanOrEqualRecord(cache, key, start,
@@ -247,11 +469,20 @@ bool stCache_containsRecord(stCache *cache, int64_t key,
     if (size != INT64_MAX && start + size > record->start + record->size) { //If the record has a known length check we have all that we want.
         return 0;
     }
+    if (size == INT64_MAX && start != INT64_MAX && start > record->start + record->size) { //Else check the fragment at least reaches the start.
+        return 0;
+    }
     return 1;
 }
 
 void *stCache_getRecord(stCache *cache, int64_t key,
         int64_t start, int64_t size, int64_t *sizeRead) {
+    if (cache->shards != NULL) {
+        int64_t i = getShardIndex(cache, key);
+        void *value = stCache_getRecord(lockShard(cache, i), key, start, size, sizeRead);
+        unlockShard(cache, i);
+        return value;
+    }
     if (stCache_containsRecord(cache, key, start, size)) {
         stCacheRecord *record = getLessThanOrEqualRecord(cache, key,
                 start, size);
@@ -266,8 +497,11 @@ void *stCache_getRecord(stCache *cache, int64_t key,
         *sizeRead = i;
         char *cA = st_malloc(i);
         memcpy(cA, record->record + j, i);
+        touchRecord(cache, record);
+        cache->hits++;
         return cA;
     }
+    cache->misses++;
     return NULL;
 }
 
@@ -87,6 +87,435 @@ void *stCompression_decompress(void *compressedData, int64_t compressedSizeInByt
     return st_realloc(buffer, sizeof(char) * outputOffset);
 }
 
+/*
+ * Framed lz4 compression.
+ *
+ * A frame starts with a header of the magic string "stL4", the block size (uint32) and the size
+ * of the uncompressed data (int64, or -1 if it was written as a stream). Then follow the blocks, each
+ * a header of its uncompressed size and stored size (uint32s, the top bit of the stored size set if
+ * the block is stored uncompressed) followed by the stored bytes. A block header of two zeros ends
+ * the frame. Integers are little endian. Blocks are compressed independently of each other, so
+ * can be compressed and decompressed in parallel, and the sizes in the headers let the output
+ * of decompression be allocated once.
+ */
+#define ST_FRAME_MAGIC "stL4"
+#define ST_FRAME_HEADER_SIZE 16
+#define ST_FRAME_BLOCK_HEADER_SIZE 8
+#define ST_FRAME_BLOCK_STORED 0x80000000u
+//2^22, big enough for lz4's 64KB window to find nearly all the matches there are.
+#define ST_FRAME_BLOCK_SIZE 4194304
+//The number of blocks per thread a stream reader or writer buffers.
+#define ST_FRAME_BLOCKS_PER_THREAD 2
+
+static void putUint32(char *p, uint32_t i) {
+    for (int64_t j = 0; j < 4; j++) {
+        p[j] = (char) (i >> (8 * j));
+    }
+}
+
+static uint32_t getUint32(const char *p) {
+    uint32_t i = 0;
+    for (int64_t j = 0; j < 4; j++) {
+        i |= ((uint32_t) (unsigned char) p[j]) << (8 * j);
+    }
+    return i;
+}
+
+static void putFrameHeader(char *p, int64_t sizeInBytes) {
+    memcpy(p, ST_FRAME_MAGIC, 4);
+    putUint32(p + 4, ST_FRAME_BLOCK_SIZE);
+    putUint32(p + 8, (uint32_t) ((uint64_t) sizeInBytes));
+    putUint32(p + 12, (uint32_t) ((uint64_t) sizeInBytes >> 32));
+}
+
+/*
+ * Checks the frame header, returning the uncompressed size it gives.
+ */
+static int64_t getFrameHeader(const char *p) {
+    if (memcmp(p, ST_FRAME_MAGIC, 4) != 0) {
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Tried to decompress data that is not an lz4 frame");
+    }
+    if (getUint32(p + 4) != ST_FRAME_BLOCK_SIZE) {
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Got an lz4 frame with an unsupported block size of %" PRIu32,
+                getUint32(p + 4));
+    }
+    return (int64_t) (getUint32(p + 8) | ((uint64_t) getUint32(p + 12) << 32));
+}
+
+/*
+ * Reads a block header, returning false for the end of the frame.
+ */
+static bool getBlockHeader(const char *p, int64_t *size, int64_t *storedSize, bool *stored) {
+    *size = getUint32(p);
+    uint32_t i = getUint32(p + 4);
+    *stored = (i & ST_FRAME_BLOCK_STORED) != 0;
+    *storedSize = i & ~ST_FRAME_BLOCK_STORED;
+    if (*size == 0 && i == 0) {
+        return 0;
+    }
+    if (*size == 0 || *size > ST_FRAME_BLOCK_SIZE || *storedSize > LZ4_compressBound(ST_FRAME_BLOCK_SIZE)
+            || (*stored && *storedSize != *size)) {
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Got a corrupt block header in an lz4 frame");
+    }
+    return 1;
+}
+
+static int64_t getBlockSlotSize(void) {
+    return ST_FRAME_BLOCK_HEADER_SIZE + LZ4_compressBound(ST_FRAME_BLOCK_SIZE);
+}
+
+/*
+ * Compresses a block of at most ST_FRAME_BLOCK_SIZE bytes, with its header, into dest, which must
+ * have room for getBlockSlotSize() bytes. Returns the number of bytes written. Blocks that do not
+ * compress are stored as they are.
+ */
+static int64_t compressBlock(const char *data, int64_t size, char *dest, int64_t level) {
+    int64_t compressedSize;
+    if (level <= 0) {
+        compressedSize = LZ4_compress_limitedOutput(data, dest + ST_FRAME_BLOCK_HEADER_SIZE, size, size - 1);
+    } else {
+        compressedSize = LZ4_compressHC2(data, dest + ST_FRAME_BLOCK_HEADER_SIZE, size, level);
+    }
+    putUint32(dest, size);
+    if (compressedSize <= 0 || compressedSize >= size) {
+        memcpy(dest + ST_FRAME_BLOCK_HEADER_SIZE, data, size);
+        putUint32(dest + 4, size | ST_FRAME_BLOCK_STORED);
+        return ST_FRAME_BLOCK_HEADER_SIZE + size;
+    }
+    putUint32(dest + 4, compressedSize);
+    return ST_FRAME_BLOCK_HEADER_SIZE + compressedSize;
+}
+
+/*
+ * A block to compress or decompress.
+ */
+typedef struct _frameBlock {
+    const char *input;
+    int64_t inputSize;
+    char *output;
+    int64_t outputSize; // The size of the output, once compressed or when decompressing
+    bool stored;
+    bool failed;
+} frameBlock;
+
+typedef struct _frameBlocks {
+    frameBlock *blocks;
+    int64_t level;
+} frameBlocks;
+
+static void compressBlocks(int64_t start, int64_t end, frameBlocks *frameBlocks) {
+    for (int64_t i = start; i < end; i++) {
+        frameBlock *block = &frameBlocks->blocks[i];
+        block->outputSize = compressBlock(block->input, block->inputSize, block->output, frameBlocks->level);
+    }
+}
+
+static void decompressBlocks(int64_t start, int64_t end, frameBlocks *frameBlocks) {
+    for (int64_t i = start; i < end; i++) {
+        frameBlock *block = &frameBlocks->blocks[i];
+        if (block->stored) {
+            memcpy(block->output, block->input, block->outputSize);
+        } else {
+            block->failed = LZ4_uncompress_unknownOutputSize(block->input, block->output, block->inputSize,
+                    block->outputSize) != block->outputSize;
+        }
+    }
+}
+
+/*
+ * Runs the function over the blocks, in parallel if there is a thread pool.
+ */
+static void runBlocks(stThreadPool *threadPool, frameBlock *blocks, int64_t numBlocks, int64_t level,
+        void (*fn)(int64_t, int64_t, frameBlocks *)) {
+    frameBlocks frameBlocks = { blocks, level };
+    if (threadPool == NULL) {
+        fn(0, numBlocks, &frameBlocks);
+    } else {
+        stThreadPool_parallelFor(threadPool, numBlocks, 1, (void (*)(int64_t, int64_t, void *)) fn, &frameBlocks);
+    }
+}
+
+/*
+ * The calling thread works too, so a pool is only needed for more than one thread.
+ */
+static stThreadPool *constructThreadPool(int64_t numThreads) {
+    return numThreads > 1 ? stThreadPool_construct(numThreads - 1, NULL, NULL) : NULL;
+}
+
+static void destructThreadPool(stThreadPool *threadPool) {
+    if (threadPool != NULL) {
+        stThreadPool_destruct(threadPool);
+    }
+}
+
+void *stCompression_compressFramed(void *data, int64_t sizeInBytes, int64_t *compressedSizeInBytes, int64_t level,
+        int64_t numThreads) {
+    int64_t numBlocks = (sizeInBytes + ST_FRAME_BLOCK_SIZE - 1) / ST_FRAME_BLOCK_SIZE;
+    int64_t slotSize = getBlockSlotSize();
+    /*
+     * Each block is compressed into its own slot of the buffer, then the slots are moved down
+     * to follow one another.
+     */
+    char *buffer = st_malloc(ST_FRAME_HEADER_SIZE + numBlocks * slotSize + ST_FRAME_BLOCK_HEADER_SIZE);
+    frameBlock *blocks = st_calloc(numBlocks, sizeof(frameBlock));
+    for (int64_t i = 0; i < numBlocks; i++) {
+        blocks[i].input = ((char *) data) + i * ST_FRAME_BLOCK_SIZE;
+        blocks[i].inputSize = i + 1 < numBlocks ? ST_FRAME_BLOCK_SIZE : sizeInBytes - i * ST_FRAME_BLOCK_SIZE;
+        blocks[i].output = buffer + ST_FRAME_HEADER_SIZE + i * slotSize;
+    }
+    stThreadPool *threadPool = constructThreadPool(numThreads);
+    runBlocks(threadPool, blocks, numBlocks, level, compressBlocks);
+    destructThreadPool(threadPool);
+    putFrameHeader(buffer, sizeInBytes);
+    int64_t outputOffset = ST_FRAME_HEADER_SIZE;
+    for (int64_t i = 0; i < numBlocks; i++) {
+        memmove(buffer + outputOffset, blocks[i].output, blocks[i].outputSize);
+        outputOffset += blocks[i].outputSize;
+    }
+    memset(buffer + outputOffset, 0, ST_FRAME_BLOCK_HEADER_SIZE);
+    outputOffset += ST_FRAME_BLOCK_HEADER_SIZE;
+    free(blocks);
+    *compressedSizeInBytes = outputOffset;
+    return st_realloc(buffer, outputOffset);
+}
+
+void *stCompression_decompressFramed(void *compressedData, int64_t compressedSizeInBytes, int64_t *sizeInBytes,
+        int64_t numThreads) {
+    const char *input = compressedData;
+    if (compressedSizeInBytes < ST_FRAME_HEADER_SIZE + ST_FRAME_BLOCK_HEADER_SIZE) {
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Tried to decompress an lz4 frame of only %" PRIi64 " bytes",
+                compressedSizeInBytes);
+    }
+    int64_t frameSize = getFrameHeader(input);
+    /*
+     * Walk the block headers to count the blocks and the size of the output.
+     */
+    int64_t inputOffset = ST_FRAME_HEADER_SIZE, outputSize = 0, numBlocks = 0;
+    int64_t size, storedSize;
+    bool stored;
+    while (1) {
+        if (inputOffset + ST_FRAME_BLOCK_HEADER_SIZE > compressedSizeInBytes) {
+            stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Got a truncated lz4 frame");
+        }
+        if (!getBlockHeader(input + inputOffset, &size, &storedSize, &stored)) {
+            break;
+        }
+        inputOffset += ST_FRAME_BLOCK_HEADER_SIZE + storedSize;
+        outputSize += size;
+        numBlocks++;
+    }
+    if (inputOffset + ST_FRAME_BLOCK_HEADER_SIZE != compressedSizeInBytes || (frameSize != -1 && frameSize != outputSize)) {
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Got an lz4 frame whose size does not match its headers");
+    }
+    char *output = st_malloc(outputSize);
+    frameBlock *blocks = st_calloc(numBlocks, sizeof(frameBlock));
+    inputOffset = ST_FRAME_HEADER_SIZE;
+    outputSize = 0;
+    for (int64_t i = 0; i < numBlocks; i++) {
+        getBlockHeader(input + inputOffset, &blocks[i].outputSize, &blocks[i].inputSize, &blocks[i].stored);
+        blocks[i].input = input + inputOffset + ST_FRAME_BLOCK_HEADER_SIZE;
+        blocks[i].output = output + outputSize;
+        inputOffset += ST_FRAME_BLOCK_HEADER_SIZE + blocks[i].inputSize;
+        outputSize += blocks[i].outputSize;
+    }
+    stThreadPool *threadPool = constructThreadPool(numThreads);
+    runBlocks(threadPool, blocks, numBlocks, 0, decompressBlocks);
+    destructThreadPool(threadPool);
+    for (int64_t i = 0; i < numBlocks; i++) {
+        if (blocks[i].failed) {
+            free(blocks);
+            free(output);
+            stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Got a corrupt block in an lz4 frame");
+        }
+    }
+    free(blocks);
+    *sizeInBytes = outputSize;
+    return output;
+}
+
+struct _stCompressionWriter {
+    FILE *file;
+    int64_t level;
+    stThreadPool *threadPool;
+    int64_t maxBlocks;
+    char *buffer; // Up to maxBlocks blocks of data to compress
+    int64_t bufferLength;
+    char *output; // A slot for each compressed block
+    frameBlock *blocks;
+};
+
+struct _stCompressionReader {
+    FILE *file;
+    stThreadPool *threadPool;
+    int64_t maxBlocks;
+    char *input; // A slot for each compressed block
+    char *buffer; // The decompressed blocks
+    int64_t bufferLength;
+    int64_t bufferOffset;
+    frameBlock *blocks;
+    bool finished;
+    bool failed; // A read threw, so the buffered data can't be trusted
+};
+
+static void writeBytes(FILE *file, const char *data, int64_t size) {
+    if (fwrite(data, 1, size, file) != (size_t) size) {
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Failed to write %" PRIi64 " bytes of an lz4 frame", size);
+    }
+}
+
+static void readBytes(FILE *file, char *data, int64_t size) {
+    if (fread(data, 1, size, file) != (size_t) size) {
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Got a truncated lz4 frame");
+    }
+}
+
+stCompressionWriter *stCompressionWriter_construct(FILE *file, int64_t level, int64_t numThreads) {
+    char header[ST_FRAME_HEADER_SIZE];
+    putFrameHeader(header, -1);
+    writeBytes(file, header, ST_FRAME_HEADER_SIZE);
+    stCompressionWriter *writer = st_calloc(1, sizeof(stCompressionWriter));
+    writer->file = file;
+    writer->level = level;
+    writer->threadPool = constructThreadPool(numThreads);
+    writer->maxBlocks = (numThreads > 1 ? numThreads : 1) * ST_FRAME_BLOCKS_PER_THREAD;
+    writer->buffer = st_malloc(writer->maxBlocks * ST_FRAME_BLOCK_SIZE);
+    writer->output = st_malloc(writer->maxBlocks * getBlockSlotSize());
+    writer->blocks = st_calloc(writer->maxBlocks, sizeof(frameBlock));
+    return writer;
+}
+
+/*
+ * Compresses the buffered blocks in parallel and writes them out in order.
+ */
+static void stCompressionWriter_flush(stCompressionWriter *writer) {
+    int64_t numBlocks = (writer->bufferLength + ST_FRAME_BLOCK_SIZE - 1) / ST_FRAME_BLOCK_SIZE;
+    for (int64_t i = 0; i < numBlocks; i++) {
+        frameBlock *block = &writer->blocks[i];
+        block->input = writer->buffer + i * ST_FRAME_BLOCK_SIZE;
+        block->inputSize = i + 1 < numBlocks ? ST_FRAME_BLOCK_SIZE : writer->bufferLength - i * ST_FRAME_BLOCK_SIZE;
+        block->output = writer->output + i * getBlockSlotSize();
+    }
+    runBlocks(writer->threadPool, writer->blocks, numBlocks, writer->level, compressBlocks);
+    for (int64_t i = 0; i < numBlocks; i++) {
+        writeBytes(writer->file, writer->blocks[i].output, writer->blocks[i].outputSize);
+    }
+    writer->bufferLength = 0;
+}
+
+void stCompressionWriter_write(stCompressionWriter *writer, const void *data, int64_t sizeInBytes) {
+    int64_t bufferSize = writer->maxBlocks * ST_FRAME_BLOCK_SIZE;
+    while (sizeInBytes > 0) {
+        int64_t length = bufferSize - writer->bufferLength < sizeInBytes ? bufferSize - writer->bufferLength
+                : sizeInBytes;
+        memcpy(writer->buffer + writer->bufferLength, data, length);
+        writer->bufferLength += length;
+        data = ((const char *) data) + length;
+        sizeInBytes -= length;
+        if (writer->bufferLength == bufferSize) {
+            stCompressionWriter_flush(writer);
+        }
+    }
+}
+
+static void freeWriter(stCompressionWriter *writer) {
+    destructThreadPool(writer->threadPool);
+    free(writer->buffer);
+    free(writer->output);
+    free(writer->blocks);
+    free(writer);
+}
+
+void stCompressionWriter_destruct(stCompressionWriter *writer) {
+    stTry {
+        stCompressionWriter_flush(writer);
+        char end[ST_FRAME_BLOCK_HEADER_SIZE] = { 0 };
+        writeBytes(writer->file, end, ST_FRAME_BLOCK_HEADER_SIZE);
+    } stCatch(except) {
+        freeWriter(writer);
+        stThrow(except);
+    } stTryEnd;
+    freeWriter(writer);
+}
+
+stCompressionReader *stCompressionReader_construct(FILE *file, int64_t numThreads) {
+    char header[ST_FRAME_HEADER_SIZE];
+    readBytes(file, header, ST_FRAME_HEADER_SIZE);
+    getFrameHeader(header);
+    stCompressionReader *reader = st_calloc(1, sizeof(stCompressionReader));
+    reader->file = file;
+    reader->threadPool = constructThreadPool(numThreads);
+    reader->maxBlocks = (numThreads > 1 ? numThreads : 1) * ST_FRAME_BLOCKS_PER_THREAD;
+    reader->input = st_malloc(reader->maxBlocks * getBlockSlotSize());
+    reader->buffer = st_malloc(reader->maxBlocks * ST_FRAME_BLOCK_SIZE);
+    reader->blocks = st_calloc(reader->maxBlocks, sizeof(frameBlock));
+    return reader;
+}
+
+/*
+ * Reads up to maxBlocks blocks and decompresses them in parallel.
+ */
+static void stCompressionReader_fill(stCompressionReader *reader) {
+    int64_t numBlocks = 0;
+    reader->bufferLength = 0;
+    reader->bufferOffset = 0;
+    while (numBlocks < reader->maxBlocks) {
+        frameBlock *block = &reader->blocks[numBlocks];
+        char *slot = reader->input + numBlocks * getBlockSlotSize();
+        readBytes(reader->file, slot, ST_FRAME_BLOCK_HEADER_SIZE);
+        if (!getBlockHeader(slot, &block->outputSize, &block->inputSize, &block->stored)) {
+            reader->finished = 1;
+            break;
+        }
+        readBytes(reader->file, slot + ST_FRAME_BLOCK_HEADER_SIZE, block->inputSize);
+        block->input = slot + ST_FRAME_BLOCK_HEADER_SIZE;
+        block->output = reader->buffer + reader->bufferLength;
+        block->failed = 0;
+        reader->bufferLength += block->outputSize;
+        numBlocks++;
+    }
+    runBlocks(reader->threadPool, reader->blocks, numBlocks, 0, decompressBlocks);
+    for (int64_t i = 0; i < numBlocks; i++) {
+        if (reader->blocks[i].failed) {
+            stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Got a corrupt block in an lz4 frame");
+        }
+    }
+}
+
+int64_t stCompressionReader_read(stCompressionReader *reader, void *data, int64_t sizeInBytes) {
+    if (reader->failed) {
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Tried to read from an lz4 frame after a previous read failed");
+    }
+    int64_t bytesRead = 0;
+    while (bytesRead < sizeInBytes) {
+        if (reader->bufferOffset == reader->bufferLength) {
+            if (reader->finished) {
+                break;
+            }
+            stTry {
+                stCompressionReader_fill(reader);
+            } stCatch(except) {
+                reader->failed = 1;
+                stThrow(except);
+            } stTryEnd;
+            continue;
+        }
+        int64_t length = reader->bufferLength - reader->bufferOffset < sizeInBytes - bytesRead
+                ? reader->bufferLength - reader->bufferOffset : sizeInBytes - bytesRead;
+        memcpy(((char *) data) + bytesRead, reader->buffer + reader->bufferOffset, length);
+        reader->bufferOffset += length;
+        bytesRead += length;
+    }
+    return bytesRead;
+}
+
+void stCompressionReader_destruct(stCompressionReader *reader) {
+    destructThreadPool(reader->threadPool);
+    free(reader->input);
+    free(reader->buffer);
+    free(reader->blocks);
+    free(reader);
+}
+
 #define Z_CHUNK 262144
 
 void *stCompression_compressZlib(void *data, int64_t sizeInBytes, int64_t *compressedSizeInBytes, int64_t level) {
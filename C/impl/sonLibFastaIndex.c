@@ -0,0 +1,336 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * sonLibFastaIndex.c
+ *
+ * For each sequence the index holds its length, the offset in the file of its first base,
+ * and the number of bases and bytes (including the newline) in each of its lines, which
+ * must all be the same bar the last. The offset of any base is then computed without
+ * reading the file, which is mapped into memory so that just the bases asked for are paged in.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "sonLibGlobalsInternal.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+const char *ST_FASTA_INDEX_EXCEPTION = "ST_FASTA_INDEX_EXCEPTION";
+
+typedef struct _stFastaIndexEntry {
+    char *name;
+    int64_t length;
+    int64_t offset;
+    int64_t lineBases;
+    int64_t lineWidth;
+} stFastaIndexEntry;
+
+struct _stFastaIndex {
+    char *fastaFile;
+    char *data;
+    int64_t dataLength;
+    stList *entries;
+    stHash *nameToEntry;
+};
+
+static void stFastaIndexEntry_destruct(stFastaIndexEntry *entry) {
+    free(entry->name);
+    free(entry);
+}
+
+/*
+ * Adds the entry, unless a sequence of the same name is already indexed, in which case
+ * the entry is discarded, as the first sequence of a name is the one that is returned.
+ */
+static void stFastaIndex_addEntry(stFastaIndex *fastaIndex, stFastaIndexEntry *entry) {
+    if (stHash_search(fastaIndex->nameToEntry, entry->name) != NULL) {
+        st_logInfo("Ignoring duplicate sequence name %s in fasta file %s\n", entry->name, fastaIndex->fastaFile);
+        stFastaIndexEntry_destruct(entry);
+        return;
+    }
+    stList_append(fastaIndex->entries, entry);
+    stHash_insert(fastaIndex->nameToEntry, entry->name, entry);
+}
+
+static void stFastaIndex_clearEntries(stFastaIndex *fastaIndex) {
+    stHash_destruct(fastaIndex->nameToEntry);
+    stList_destruct(fastaIndex->entries);
+    fastaIndex->entries = stList_construct3(0, (void (*)(void *)) stFastaIndexEntry_destruct);
+    fastaIndex->nameToEntry = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, NULL, NULL);
+}
+
+/*
+ * Returns the offset in the file of the ith base of the sequence.
+ */
+static inline int64_t stFastaIndexEntry_getOffset(stFastaIndexEntry *entry, int64_t i) {
+    return entry->offset + (i / entry->lineBases) * entry->lineWidth + i % entry->lineBases;
+}
+
+/*
+ * Builds the index by scanning the mapped file a line at a time.
+ */
+static void stFastaIndex_build(stFastaIndex *fastaIndex) {
+    const char *c = fastaIndex->data, *end = fastaIndex->data + fastaIndex->dataLength;
+    while (c < end) {
+        const char *newLine = memchr(c, '\n', end - c);
+        if (*c != '>') { //blank lines or text before the first header
+            c = newLine != NULL ? newLine + 1 : end;
+            continue;
+        }
+        const char *nameEnd = c + 1;
+        while (nameEnd < end && !isspace((unsigned char) *nameEnd)) {
+            nameEnd++;
+        }
+        stFastaIndexEntry *entry = st_calloc(1, sizeof(stFastaIndexEntry));
+        entry->name = stString_getSubString(c, 1, nameEnd - c - 1);
+        c = newLine != NULL ? newLine + 1 : end;
+        entry->offset = c - fastaIndex->data;
+        bool seenLastLine = false;
+        while (c < end && *c != '>') {
+            newLine = memchr(c, '\n', end - c);
+            const char *lineEnd = newLine != NULL ? newLine : end;
+            int64_t lineWidth = (newLine != NULL ? newLine + 1 : end) - c;
+            int64_t lineBases = lineEnd - c;
+            if (lineBases > 0 && lineEnd[-1] == '\r') {
+                lineBases--;
+            }
+            if (lineBases > 0) {
+                if (entry->lineBases == 0) {
+                    entry->lineBases = lineBases;
+                    entry->lineWidth = lineWidth;
+                } else if (seenLastLine || lineBases > entry->lineBases
+                        || (lineBases == entry->lineBases && newLine != NULL && lineWidth != entry->lineWidth)) {
+                    int64_t lineNumber = 1;
+                    for (const char *d = fastaIndex->data; d < c; d++) {
+                        lineNumber += *d == '\n';
+                    }
+                    stList_append(fastaIndex->entries, entry); //so that it is freed with the index
+                    stThrowNew(ST_FASTA_INDEX_EXCEPTION,
+                            "Lines of sequence %s in fasta file %s have differing lengths, at line %" PRIi64,
+                            entry->name, fastaIndex->fastaFile, lineNumber);
+                }
+                seenLastLine = lineBases < entry->lineBases;
+                entry->length += lineBases;
+            } else {
+                seenLastLine = true;
+            }
+            c = newLine != NULL ? newLine + 1 : end;
+        }
+        stFastaIndex_addEntry(fastaIndex, entry);
+    }
+}
+
+/*
+ * Returns non-zero iff the entry lies within the mapped file.
+ */
+static bool stFastaIndexEntry_isValid(stFastaIndex *fastaIndex, stFastaIndexEntry *entry) {
+    if (entry->length < 0 || entry->offset < 0 || entry->offset > fastaIndex->dataLength) {
+        return 0;
+    }
+    if (entry->length == 0) {
+        return 1;
+    }
+    return entry->lineBases > 0 && entry->lineWidth >= entry->lineBases
+            && stFastaIndexEntry_getOffset(entry, entry->length - 1) < fastaIndex->dataLength;
+}
+
+/*
+ * Loads the index from a .fai file, returning non-zero iff the file could be read and describes
+ * sequences within the fasta file.
+ */
+static bool stFastaIndex_load(stFastaIndex *fastaIndex, const char *indexFile) {
+    FILE *fileHandle = fopen(indexFile, "r");
+    if (fileHandle == NULL) {
+        return 0;
+    }
+    bool valid = 1;
+    char *line;
+    while (valid && (line = stFile_getLineFromFile(fileHandle)) != NULL) {
+        stList *tokens = stString_splitByString(line, "\t");
+        stFastaIndexEntry *entry = st_calloc(1, sizeof(stFastaIndexEntry));
+        valid = stList_length(tokens) >= 5
+                && sscanf(stList_get(tokens, 1), "%" SCNi64, &entry->length) == 1
+                && sscanf(stList_get(tokens, 2), "%" SCNi64, &entry->offset) == 1
+                && sscanf(stList_get(tokens, 3), "%" SCNi64, &entry->lineBases) == 1
+                && sscanf(stList_get(tokens, 4), "%" SCNi64, &entry->lineWidth) == 1;
+        if (valid) {
+            entry->name = stString_copy(stList_get(tokens, 0));
+            valid = stFastaIndexEntry_isValid(fastaIndex, entry);
+        }
+        if (valid) {
+            stFastaIndex_addEntry(fastaIndex, entry);
+        } else {
+            stFastaIndexEntry_destruct(entry);
+        }
+        stList_destruct(tokens);
+        free(line);
+    }
+    fclose(fileHandle);
+    if (!valid) {
+        st_logInfo("Ignoring invalid fasta index %s\n", indexFile);
+        stFastaIndex_clearEntries(fastaIndex);
+    }
+    return valid;
+}
+
+stFastaIndex *stFastaIndex_construct(const char *fastaFile) {
+    int fd = open(fastaFile, O_RDONLY);
+    if (fd < 0) {
+        stThrowNew(ST_FASTA_INDEX_EXCEPTION, "Could not open fasta file %s", fastaFile);
+    }
+    struct stat fastaStat;
+    if (fstat(fd, &fastaStat) != 0) {
+        close(fd);
+        stThrowNew(ST_FASTA_INDEX_EXCEPTION, "Could not stat fasta file %s", fastaFile);
+    }
+    char *data = NULL;
+    if (fastaStat.st_size > 0) {
+        data = mmap(NULL, fastaStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            stThrowNew(ST_FASTA_INDEX_EXCEPTION, "Could not map fasta file %s into memory", fastaFile);
+        }
+    }
+    close(fd); //the mapping keeps the file open
+
+    stFastaIndex *fastaIndex = st_malloc(sizeof(stFastaIndex));
+    fastaIndex->fastaFile = stString_copy(fastaFile);
+    fastaIndex->data = data;
+    fastaIndex->dataLength = fastaStat.st_size;
+    fastaIndex->entries = stList_construct3(0, (void (*)(void *)) stFastaIndexEntry_destruct);
+    fastaIndex->nameToEntry = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, NULL, NULL);
+
+    char *indexFile = stString_print("%s.fai", fastaFile);
+    struct stat indexStat;
+    if (stat(indexFile, &indexStat) != 0 || indexStat.st_mtime < fastaStat.st_mtime
+            || !stFastaIndex_load(fastaIndex, indexFile)) {
+        stTry {
+            stFastaIndex_build(fastaIndex);
+        } stCatch(except) {
+            free(indexFile);
+            stFastaIndex_destruct(fastaIndex);
+            stThrow(except);
+        } stTryEnd;
+        stTry {
+            stFastaIndex_write(fastaIndex, indexFile);
+        } stCatch(except) { //the directory may not be writable, in which case the index is rebuilt each time
+            st_logInfo("Could not save the index of fasta file %s: %s\n", fastaFile, stExcept_getMsg(except));
+        } stTryEnd;
+    }
+    free(indexFile);
+    return fastaIndex;
+}
+
+void stFastaIndex_destruct(stFastaIndex *fastaIndex) {
+    if (fastaIndex->data != NULL) {
+        munmap(fastaIndex->data, fastaIndex->dataLength);
+    }
+    stHash_destruct(fastaIndex->nameToEntry);
+    stList_destruct(fastaIndex->entries);
+    free(fastaIndex->fastaFile);
+    free(fastaIndex);
+}
+
+void stFastaIndex_write(stFastaIndex *fastaIndex, const char *indexFile) {
+    FILE *fileHandle = fopen(indexFile, "w");
+    if (fileHandle == NULL) {
+        stThrowNew(ST_FASTA_INDEX_EXCEPTION, "Could not open fasta index file %s for writing", indexFile);
+    }
+    for (int64_t i = 0; i < stList_length(fastaIndex->entries); i++) {
+        stFastaIndexEntry *entry = stList_get(fastaIndex->entries, i);
+        fprintf(fileHandle, "%s\t%" PRIi64 "\t%" PRIi64 "\t%" PRIi64 "\t%" PRIi64 "\n", entry->name, entry->length,
+                entry->offset, entry->lineBases, entry->lineWidth);
+    }
+    if (fclose(fileHandle) != 0) {
+        stThrowNew(ST_FASTA_INDEX_EXCEPTION, "Could not write fasta index file %s", indexFile);
+    }
+}
+
+int64_t stFastaIndex_getSequenceNumber(stFastaIndex *fastaIndex) {
+    return stList_length(fastaIndex->entries);
+}
+
+const char *stFastaIndex_getSequenceName(stFastaIndex *fastaIndex, int64_t i) {
+    return ((stFastaIndexEntry *) stList_get(fastaIndex->entries, i))->name;
+}
+
+bool stFastaIndex_containsSequence(stFastaIndex *fastaIndex, const char *name) {
+    return stHash_search(fastaIndex->nameToEntry, (void *) name) != NULL;
+}
+
+static stFastaIndexEntry *stFastaIndex_getEntry(stFastaIndex *fastaIndex, const char *name) {
+    stFastaIndexEntry *entry = stHash_search(fastaIndex->nameToEntry, (void *) name);
+    if (entry == NULL) {
+        stThrowNew(ST_FASTA_INDEX_EXCEPTION, "No sequence named %s in fasta file %s", name, fastaIndex->fastaFile);
+    }
+    return entry;
+}
+
+int64_t stFastaIndex_getSequenceLength(stFastaIndex *fastaIndex, const char *name) {
+    return stFastaIndex_getEntry(fastaIndex, name)->length;
+}
+
+static stFastaIndexEntry *stFastaIndex_getEntryForInterval(stFastaIndex *fastaIndex, const char *name,
+        int64_t start, int64_t length) {
+    stFastaIndexEntry *entry = stFastaIndex_getEntry(fastaIndex, name);
+    if (start < 0 || length < 0 || start + length > entry->length) {
+        stThrowNew(ST_FASTA_INDEX_EXCEPTION,
+                "Interval %" PRIi64 "-%" PRIi64 " is not within sequence %s of length %" PRIi64,
+                start, start + length, name, entry->length);
+    }
+    return entry;
+}
+
+char *stFastaIndex_getSubsequence(stFastaIndex *fastaIndex, const char *name, int64_t start, int64_t length) {
+    stFastaIndexEntry *entry = stFastaIndex_getEntryForInterval(fastaIndex, name, start, length);
+    char *subsequence = st_malloc(length + 1);
+    int64_t i = 0;
+    while (i < length) { //copy a line at a time
+        int64_t j = start + i;
+        int64_t lineLength = entry->lineBases - j % entry->lineBases;
+        if (lineLength > length - i) {
+            lineLength = length - i;
+        }
+        memcpy(subsequence + i, fastaIndex->data + stFastaIndexEntry_getOffset(entry, j), lineLength);
+        i += lineLength;
+    }
+    subsequence[length] = '\0';
+    return subsequence;
+}
+
+stPackedSeq *stFastaIndex_getPackedSubsequence(stFastaIndex *fastaIndex, const char *name, int64_t start,
+        int64_t length) {
+    stFastaIndexEntry *entry = stFastaIndex_getEntryForInterval(fastaIndex, name, start, length);
+    stPackedSeq *subsequence = stPackedSeq_construct2("", 0);
+    int64_t i = 0;
+    while (i < length) { //pack a line at a time
+        int64_t j = start + i;
+        int64_t lineLength = entry->lineBases - j % entry->lineBases;
+        if (lineLength > length - i) {
+            lineLength = length - i;
+        }
+        stPackedSeq_append(subsequence, fastaIndex->data + stFastaIndexEntry_getOffset(entry, j), lineLength);
+        i += lineLength;
+    }
+    return subsequence;
+}
+
+char *stFastaIndex_getSequence(stFastaIndex *fastaIndex, const char *name) {
+    return stFastaIndex_getSubsequence(fastaIndex, name, 0, stFastaIndex_getSequenceLength(fastaIndex, name));
+}
+
+const char *stFastaIndex_getSubsequenceView(stFastaIndex *fastaIndex, const char *name, int64_t start,
+        int64_t length) {
+    stFastaIndexEntry *entry = stFastaIndex_getEntryForInterval(fastaIndex, name, start, length);
+    if (length == 0) {
+        return fastaIndex->data + entry->offset;
+    }
+    if (start % entry->lineBases + length > entry->lineBases) { //broken by a newline
+        return NULL;
+    }
+    return fastaIndex->data + stFastaIndexEntry_getOffset(entry, start);
+}
@@ -13,10 +13,21 @@
 #include "sonLibGlobalsInternal.h"
 #include "hashTableC.h"
 #include "hashTableC_itr.h"
+#include "sonLibOpenHashPrivate.h"
 
 struct _stHash {
-    struct hashtable *hash;
+    stHashType type;
+    struct hashtable *hash; // Used if type == stHashTypeChained or stHashTypeChainedSlab
+    stOpenHash *openHash; // Used if type == stHashTypeOpenAddressing
     bool destructKeys, destructValues;
+    void (*keyFree)(void *); // The open addressing table does not store its destructors
+    void (*valueFree)(void *);
+};
+
+struct _stHashIterator {
+    stHash *hash;
+    struct hashtable_itr chainedIterator;
+    uint64_t index;
 };
 
 uint64_t stHash_pointer(const void *k) {
@@ -43,29 +54,62 @@ stHash *stHash_construct2(void(*destructKeys)(void *), void(*destructValues)(voi
 }
 
 stHash *stHash_construct3(uint64_t(*hashKey)(const void *), int(*hashEqualsKey)(const void *, const void *), void(*destructKeys)(void *), void(*destructValues)(void *)) {
+    return stHash_construct4(hashKey, hashEqualsKey, destructKeys, destructValues, stHashTypeChained);
+}
+
+stHash *stHash_construct4(uint64_t(*hashKey)(const void *), int(*hashEqualsKey)(const void *, const void *),
+        void(*destructKeys)(void *), void(*destructValues)(void *), stHashType type) {
     stHash *hash = st_malloc(sizeof(stHash));
-    hash->hash = create_hashtable(0, hashKey, hashEqualsKey, destructKeys, destructValues);
+    hash->type = type;
+    if (type == stHashTypeOpenAddressing) {
+        hash->hash = NULL;
+        hash->openHash = stOpenHash_construct(hashKey, hashEqualsKey);
+    } else {
+        hash->hash = create_hashtable(0, hashKey, hashEqualsKey, destructKeys, destructValues);
+        hash->hash->useSlabs = type == stHashTypeChainedSlab;
+        hash->openHash = NULL;
+    }
     hash->destructKeys = destructKeys != NULL;
     hash->destructValues = destructValues != NULL;
+    hash->keyFree = destructKeys;
+    hash->valueFree = destructValues;
     return hash;
 }
 
 void stHash_destruct(stHash *hash) {
-    hashtable_destroy(hash->hash, hash->destructValues, hash->destructKeys);
+    if (hash->type == stHashTypeOpenAddressing) {
+        stOpenHash_destruct(hash->openHash, hash->keyFree, hash->valueFree);
+    } else {
+        hashtable_destroy(hash->hash, hash->destructValues, hash->destructKeys);
+    }
     free(hash);
 }
 
+stHashType stHash_getType(stHash *hash) {
+    return hash->type;
+}
+
 void stHash_setDestructKeys(stHash *hash, void(*destructor)(void *)) {
     hash->destructKeys = destructor != NULL;
-    hash->hash->keyFree = destructor;
+    hash->keyFree = destructor;
+    if (hash->hash != NULL) {
+        hash->hash->keyFree = destructor;
+    }
 }
 
 void stHash_setDestructValues(stHash *hash, void(*destructor)(void *)) {
     hash->destructValues = destructor != NULL;
-    hash->hash->valueFree = destructor;
+    hash->valueFree = destructor;
+    if (hash->hash != NULL) {
+        hash->hash->valueFree = destructor;
+    }
 }
 
 void stHash_insert(stHash *hash, void *key, void *value) {
+    if (hash->type == stHashTypeOpenAddressing) { // Single probe upsert
+        stOpenHash_insert(hash->openHash, key, value);
+        return;
+    }
     if (stHash_search(hash, key) != NULL) { //This will ensure we don't end up with duplicate keys..
         stHash_remove(hash, key);
     }
@@ -73,29 +117,58 @@ void stHash_insert(stHash *hash, void *key, void *value) {
 }
 
 void *stHash_search(stHash *hash, void *key) {
+    if (hash->type == stHashTypeOpenAddressing) {
+        return stOpenHash_search(hash->openHash, key);
+    }
     return hashtable_search(hash->hash, key);
 }
 
 void *stHash_remove(stHash *hash, void *key) {
+    if (hash->type == stHashTypeOpenAddressing) {
+        return stOpenHash_remove(hash->openHash, key, NULL);
+    }
     return hashtable_remove(hash->hash, key, 0);
 }
 
 void *stHash_removeAndFreeKey(stHash *hash, void *key) {
+    if (hash->type == stHashTypeOpenAddressing) {
+        void *removedKey = NULL;
+        uint64_t count = hash->openHash->count;
+        void *value = stOpenHash_remove(hash->openHash, key, &removedKey);
+        if (hash->openHash->count < count) {
+            hash->keyFree(removedKey);
+        }
+        return value;
+    }
     return hashtable_remove(hash->hash, key, 1);
 }
 
 int64_t stHash_size(stHash *hash) {
+    if (hash->type == stHashTypeOpenAddressing) {
+        return hash->openHash->count;
+    }
     return hashtable_count(hash->hash);
 }
 
 stHashIterator *stHash_getIterator(stHash *hash) {
-    return hashtable_iterator(hash->hash);
+    stHashIterator *iterator = st_malloc(sizeof(stHashIterator));
+    iterator->hash = hash;
+    iterator->index = 0;
+    if (hash->type != stHashTypeOpenAddressing) {
+        struct hashtable_itr *chainedIterator = hashtable_iterator(hash->hash);
+        iterator->chainedIterator = *chainedIterator;
+        free(chainedIterator);
+    }
+    return iterator;
 }
 
 void *stHash_getNext(stHashIterator *iterator) {
-    if (iterator->e != NULL) {
-        void *o = hashtable_iterator_key(iterator);
-        hashtable_iterator_advance(iterator);
+    if (iterator->hash->type == stHashTypeOpenAddressing) {
+        return stOpenHash_getNext(iterator->hash->openHash, &iterator->index);
+    }
+    if (iterator->chainedIterator.e != NULL) {
+        void *o = hashtable_iterator_key(&iterator->chainedIterator);
+        hashtable_iterator_advance(&iterator->chainedIterator);
         return o;
     }
     return NULL;
@@ -103,10 +176,7 @@ void *stHash_getNext(stHashIterator *iterator) {
 
 stHashIterator *stHash_copyIterator(stHashIterator *iterator) {
     stHashIterator *iterator2 = st_malloc(sizeof(stHashIterator));
-    iterator2->h = iterator->h;
-    iterator2->e = iterator->e;
-    iterator2->parent = iterator->parent;
-    iterator2->index = iterator->index;
+    *iterator2 = *iterator;
     return iterator2;
 }
 
@@ -165,7 +235,7 @@ stHash *stHash_invert(stHash *hash, uint64_t(*hashKey)(const void *), int(*equal
     /*
      * Inverts the hash.
      */
-    stHash *invertedHash = stHash_construct3(hashKey, equalsFn, destructKeys, destructValues);
+    stHash *invertedHash = stHash_construct4(hashKey, equalsFn, destructKeys, destructValues, hash->type);
     stHashIterator *hashIt = stHash_getIterator(hash);
     void *key;
     while ((key = stHash_getNext(hashIt)) != NULL) {
@@ -180,16 +250,16 @@ stHash *stHash_invert(stHash *hash, uint64_t(*hashKey)(const void *), int(*equal
 }
 // interface to underlying functions
 uint64_t (*stHash_getHashFunction(stHash *hash))(const void *) {
-    return hash->hash->hashfn;
+    return hash->type == stHashTypeOpenAddressing ? hash->openHash->hashFn : hash->hash->hashfn;
 }
 int (*stHash_getEqualityFunction(stHash *hash))(const void *, const void *) {
-    return hash->hash->eqfn;
+    return hash->type == stHashTypeOpenAddressing ? hash->openHash->equalsFn : hash->hash->eqfn;
 }
 void (*stHash_getKeyDestructorFunction(stHash *hash))(void *) {
-    return hash->hash->keyFree;
+    return hash->keyFree;
 }
 void (*stHash_getValueDestructorFunction(stHash *hash))(void *) {
-    return hash->hash->valueFree;
+    return hash->valueFree;
 }
 
 static int unsigned_cmp(const unsigned *x, const unsigned *y) {
@@ -203,6 +273,10 @@ static int unsigned_cmp(const unsigned *x, const unsigned *y) {
 }
 
 void stHash_printDiagnostics(stHash *hash) {
+    if (hash->type == stHashTypeOpenAddressing) {
+        stOpenHash_printDiagnostics(hash->openHash);
+        return;
+    }
     struct hashtable *h = hash->hash;
     unsigned *bucketLoad = st_malloc(h->tablelength * sizeof(unsigned));
     unsigned *occupiedBucketLoad = st_malloc(h->entrycount * sizeof(unsigned));
@@ -11,6 +11,11 @@
  *      Author: benedictpaten
  */
 
+#define _POSIX_C_SOURCE 200809L
+
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
 #include "sonLibGlobalsInternal.h"
 #include "sonLibKVDatabasePrivate.h"
 #include "sonLibString.h"
@@ -55,13 +60,36 @@ stKVDatabase *stKVDatabase_construct(stKVDatabaseConf *conf, bool create) {
                     "requested MySQL database, however sonlib is not compiled with MySql support");
 #endif
             break;
+        case stKVDatabaseTypeLogStructured:
+            stKVDatabase_initialise_logStructured(database, conf, create);
+            break;
         default:
             stThrowNew(ST_KV_DATABASE_EXCEPTION_ID,
                     "BUG: unrecognized database type");
     }
+    if (stKVDatabaseConf_getCompression(conf) != stKVDatabaseCompressionNone) {
+        stKVDatabase *compressedDatabase = st_calloc(1, sizeof(struct stKVDatabase));
+        compressedDatabase->conf = stKVDatabaseConf_constructClone(conf);
+        compressedDatabase->deleted = false;
+        stKVDatabase_initialise_compressed(compressedDatabase, database, stKVDatabaseConf_getCompression(conf));
+        return compressedDatabase;
+    }
     return database;
 }
 
+stKVDatabase *stKVDatabase_constructCached(stKVDatabase *database, int64_t cacheSizeInBytes,
+        int64_t writeBufferSizeInBytes) {
+    if (database->deleted) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID,
+                "Trying to cache a database that has been deleted");
+    }
+    stKVDatabase *cachedDatabase = st_calloc(1, sizeof(struct stKVDatabase));
+    cachedDatabase->conf = stKVDatabaseConf_constructClone(database->conf);
+    cachedDatabase->deleted = false;
+    stKVDatabase_initialise_cache(cachedDatabase, database, cacheSizeInBytes, writeBufferSizeInBytes);
+    return cachedDatabase;
+}
+
 void stKVDatabase_destruct(stKVDatabase *database) {
     if (!database->deleted) {
         stTry {
@@ -91,6 +119,27 @@ void stKVDatabase_deleteFromDisk(stKVDatabase *database) {
     database->deleted = true;
 }
 
+void stKVDatabase_flush(stKVDatabase *database) {
+    if (database->deleted) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID,
+                "Trying to flush a database that has been deleted");
+    }
+    if (database->flush == NULL) {
+        return;
+    }
+    stTry {
+            database->flush(database);
+        }stCatch(ex)
+            {
+                if (isRetryExcept(ex)) {
+                    stThrow(ex);
+                } else {
+                    stThrowNewCause(ex, ST_KV_DATABASE_EXCEPTION_ID,
+                            "stKVDatabase_flush failed");
+                }
+            }stTryEnd;
+}
+
 bool stKVDatabase_containsRecord(stKVDatabase *database, int64_t key) {
     if (database->deleted) {
         stThrowNew(ST_KV_DATABASE_EXCEPTION_ID,
@@ -461,6 +510,113 @@ void *stKVDatabase_getPartialRecord(stKVDatabase *database, int64_t key,
     return data;
 }
 
+stKVDatabaseRecordView *stKVDatabaseRecordView_constructCopy(void *record, int64_t size) {
+    stKVDatabaseRecordView *view = st_calloc(1, sizeof(stKVDatabaseRecordView));
+    view->record = record;
+    view->size = size;
+    return view;
+}
+
+stKVDatabaseRecordView *stKVDatabaseRecordView_constructMapped(int fd, int64_t offset, int64_t size, const char *path) {
+    if (size == 0) { //Can't map nothing
+        return stKVDatabaseRecordView_constructCopy(st_malloc(1), 0);
+    }
+    int64_t pageOffset = offset % sysconf(_SC_PAGESIZE); //Mappings must start at a page boundary
+    void *mapping = mmap(NULL, pageOffset + size, PROT_READ, MAP_PRIVATE, fd, offset - pageOffset);
+    if (mapping == MAP_FAILED) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Mapping %lld bytes of %s at offset %lld failed: %s",
+                (long long) size, path, (long long) offset, strerror(errno));
+    }
+    stKVDatabaseRecordView *view = st_calloc(1, sizeof(stKVDatabaseRecordView));
+    view->mapping = mapping;
+    view->mappingSize = pageOffset + size;
+    view->record = (char *) mapping + pageOffset;
+    view->size = size;
+    return view;
+}
+
+const void *stKVDatabaseRecordView_getRecord(stKVDatabaseRecordView *view, int64_t *recordSize) {
+    *recordSize = view->size;
+    return view->record;
+}
+
+void stKVDatabaseRecordView_destruct(stKVDatabaseRecordView *view) {
+    if (view->mapping != NULL) {
+        munmap(view->mapping, view->mappingSize);
+    } else {
+        free((void *) view->record);
+    }
+    free(view);
+}
+
+stKVDatabaseRecordView *stKVDatabase_getRecordView(stKVDatabase *database, int64_t key) {
+    if (database->deleted) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID,
+                "Trying to get a record from a database that has already been deleted");
+    }
+    stKVDatabaseRecordView *view = NULL;
+    stTry {
+            if (database->getRecordView != NULL) {
+                view = database->getRecordView(database, key);
+            } else {
+                int64_t recordSize;
+                void *record = database->getRecord2(database, key, &recordSize);
+                if (record != NULL) {
+                    view = stKVDatabaseRecordView_constructCopy(record, recordSize);
+                }
+            }
+        }stCatch(ex)
+            {
+                if (isRetryExcept(ex)) {
+                    stThrow(ex);
+                } else {
+                    stThrowNewCause(ex, ST_KV_DATABASE_EXCEPTION_ID,
+                            "stKVDatabase_getRecordView key %lld failed",
+                            (long long) key);
+                }
+            }stTryEnd;
+    return view;
+}
+
+stKVDatabaseRecordView *stKVDatabase_getPartialRecordView(stKVDatabase *database, int64_t key,
+        int64_t zeroBasedByteOffset, int64_t sizeInBytes, int64_t recordSize) {
+    if (database->deleted) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID,
+                "Trying to get a record from a database that has already been deleted");
+    }
+    if (zeroBasedByteOffset < 0 || sizeInBytes < 0 || zeroBasedByteOffset
+            + sizeInBytes > recordSize) {
+        stThrowNew(
+                ST_KV_DATABASE_EXCEPTION_ID,
+                "Partial record retrieval to out of bounds memory, requested start: %lld, requested size: %lld, entry size: %lld",
+                (long long) zeroBasedByteOffset, (long long) sizeInBytes,
+                (long long) recordSize);
+    }
+    stKVDatabaseRecordView *view = NULL;
+    stTry {
+            if (database->getPartialRecordView != NULL) {
+                view = database->getPartialRecordView(database, key,
+                        zeroBasedByteOffset, sizeInBytes, recordSize);
+            } else {
+                view = stKVDatabaseRecordView_constructCopy(database->getPartialRecord(database, key,
+                        zeroBasedByteOffset, sizeInBytes, recordSize), sizeInBytes);
+            }
+        }stCatch(ex)
+            {
+                if (isRetryExcept(ex)) {
+                    stThrow(ex);
+                } else {
+                    stThrowNewCause(
+                            ex,
+                            ST_KV_DATABASE_EXCEPTION_ID,
+                            "stKVDatabase_getPartialRecordView key %lld offset %lld size %lld failed",
+                            (long long) key, (long long) zeroBasedByteOffset,
+                            (long long) sizeInBytes);
+                }
+            }stTryEnd;
+    return view;
+}
+
 stKVDatabaseBulkResult *stKVDatabaseBulkResult_construct(void* value, int64_t sizeOfRecord)
 {
 	/* convention is to not bother creating a result for NULL values */
@@ -552,6 +708,10 @@ void stKVDatabase_removeRecord(stKVDatabase *database, int64_t key) {
             }stTryEnd;
 }
 
+double stKVDatabase_getCompressionRatio(stKVDatabase *database) {
+    return database->getCompressionRatio != NULL ? database->getCompressionRatio(database) : 1.0;
+}
+
 stKVDatabaseConf *stKVDatabase_getConf(stKVDatabase *database) {
     return database->conf;
 }
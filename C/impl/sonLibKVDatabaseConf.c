@@ -33,6 +33,7 @@ struct stKVDatabaseConf {
     char *password;
     char *databaseName;
     char *tableName;
+    stKVDatabaseCompression compression;
 };
 
 stKVDatabaseConf *stKVDatabaseConf_constructTokyoCabinet(const char *databaseDir) {
@@ -42,6 +43,13 @@ stKVDatabaseConf *stKVDatabaseConf_constructTokyoCabinet(const char *databaseDir
     return conf;
 }
 
+stKVDatabaseConf *stKVDatabaseConf_constructLogStructured(const char *databaseDir) {
+    stKVDatabaseConf *conf = stSafeCCalloc(sizeof(stKVDatabaseConf));
+    conf->type = stKVDatabaseTypeLogStructured;
+    conf->databaseDir = stString_copy(databaseDir);
+    return conf;
+}
+
 stKVDatabaseConf *stKVDatabaseConf_constructKyotoTycoon(const char *host, unsigned port, int timeout,
 														int64_t maxRecordSize, int64_t maxBulkSetSize,
 														int64_t maxBulkSetNumRecords,
@@ -210,6 +218,28 @@ static int64_t getXMLMaxKTBulkSetNumRecords(stHash *hash) {
     }
 }
 
+/*
+ * Sets the compression of the conf from the XML. If the compression is invalid the hash and
+ * the conf are freed before the exception is thrown.
+ */
+static void setXmlCompression(stHash *hash, stKVDatabaseConf *databaseConf) {
+    const char *value = stHash_search(hash, "compression");
+    if (value == NULL || stString_eq(value, "none")) {
+        databaseConf->compression = stKVDatabaseCompressionNone;
+    } else if (stString_eq(value, "lz4")) {
+        databaseConf->compression = stKVDatabaseCompressionLz4;
+    } else if (stString_eq(value, "lz4hc")) {
+        databaseConf->compression = stKVDatabaseCompressionLz4hc;
+    } else if (stString_eq(value, "zlib")) {
+        databaseConf->compression = stKVDatabaseCompressionZlib;
+    } else {
+        stExcept *except = stExcept_new(ST_KV_DATABASE_EXCEPTION_ID, "invalid database compression \"%s\"", value);
+        stKVDatabaseConf_destruct(databaseConf);
+        stHash_destruct(hash);
+        stThrow(except);
+    }
+}
+
 static stKVDatabaseConf *constructFromString(const char *xmlString) {
     stHash *hash = hackParseXmlString(xmlString);
     stKVDatabaseConf *databaseConf = NULL;
@@ -220,6 +250,8 @@ static stKVDatabaseConf *constructFromString(const char *xmlString) {
     }
     if (stString_eq(type, "tokyo_cabinet")) {
         databaseConf = stKVDatabaseConf_constructTokyoCabinet(getXmlValueRequired(hash, "database_dir"));
+    } else if (stString_eq(type, "log_structured")) {
+        databaseConf = stKVDatabaseConf_constructLogStructured(getXmlValueRequired(hash, "database_dir"));
     } else if (stString_eq(type, "kyoto_tycoon")) {
         databaseConf = stKVDatabaseConf_constructKyotoTycoon(getXmlValueRequired(hash, "host"), 
                                                         getXmlPort(hash), 
@@ -236,6 +268,7 @@ static stKVDatabaseConf *constructFromString(const char *xmlString) {
     } else {
         stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "invalid database type \"%s\"", type);
     }
+    setXmlCompression(hash, databaseConf);
     stHash_destruct(hash);
     return databaseConf;
 }
@@ -265,6 +298,7 @@ stKVDatabaseConf *stKVDatabaseConf_constructClone(stKVDatabaseConf *srcConf) {
     conf->password = stString_copy(srcConf->password);
     conf->databaseName = stString_copy(srcConf->databaseName);
     conf->tableName = stString_copy(srcConf->tableName);
+    conf->compression = srcConf->compression;
     return conf;
 }
 
@@ -280,6 +314,14 @@ void stKVDatabaseConf_destruct(stKVDatabaseConf *conf) {
     }
 }
 
+void stKVDatabaseConf_setCompression(stKVDatabaseConf *conf, stKVDatabaseCompression compression) {
+    conf->compression = compression;
+}
+
+stKVDatabaseCompression stKVDatabaseConf_getCompression(stKVDatabaseConf *conf) {
+    return conf->compression;
+}
+
 stKVDatabaseType stKVDatabaseConf_getType(stKVDatabaseConf *conf) {
     return conf->type;
 }
@@ -21,6 +21,7 @@ struct stKVDatabase {
     bool deleted;
     void (*destruct)(stKVDatabase *);
     void (*deleteDatabase)(stKVDatabase *);
+    void (*flush)(stKVDatabase *); //May be NULL if the database doesn't hold back writes.
     bool (*containsRecord)(stKVDatabase *, int64_t);
     void (*insertRecord)(stKVDatabase *, int64_t, const void *, int64_t);
     void (*insertInt64)(stKVDatabase *, int64_t, int64_t);
@@ -38,6 +39,10 @@ struct stKVDatabase {
     stList *(*bulkGetRecords)(stKVDatabase *database, stList* keys);
     stList *(*bulkGetRecordsRange)(stKVDatabase *database, int64_t firstKey, int64_t numRecords);
     void (*removeRecord)(stKVDatabase *, int64_t key);
+    //May be NULL, in which case the record is copied with getRecord2 or getPartialRecord.
+    stKVDatabaseRecordView *(*getRecordView)(stKVDatabase *database, int64_t key);
+    stKVDatabaseRecordView *(*getPartialRecordView)(stKVDatabase *database, int64_t key, int64_t zeroBasedByteOffset, int64_t sizeInBytes, int64_t recordSize);
+    double (*getCompressionRatio)(stKVDatabase *database); //May be NULL if the database doesn't compress records.
 };
 
 enum stKVDatabaseBulkRequestType {
@@ -56,6 +61,13 @@ struct stKVDatabaseBulkResult {
 	int64_t size;
 };
 
+struct stKVDatabaseRecordView {
+    const void *record;
+    int64_t size;
+    void *mapping; //If non-null, the memory mapping holding the record, else the record is allocated memory.
+    int64_t mappingSize;
+};
+
 /*
  * Function initialises the pointers of the stKVDatabase object with functions for tokyoCabinet.
  */
@@ -66,9 +78,39 @@ void stKVDatabase_initialise_tokyoCabinet(stKVDatabase *database, stKVDatabaseCo
  */
 void stKVDatabase_initialise_MySql(stKVDatabase *database, stKVDatabaseConf *conf, bool create);
 
+/*
+ * Function initialises the pointers of the stKVDatabase object with functions for the log structured database.
+ */
+void stKVDatabase_initialise_logStructured(stKVDatabase *database, stKVDatabaseConf *conf, bool create);
+
+/*
+ * Function initialises the pointers of the stKVDatabase object with functions for a cache in front of the
+ * wrapped database, which it takes ownership of.
+ */
+void stKVDatabase_initialise_cache(stKVDatabase *database, stKVDatabase *wrappedDatabase, int64_t cacheSizeInBytes,
+        int64_t writeBufferSizeInBytes);
+
+/*
+ * Function initialises the pointers of the stKVDatabase object with functions that compress the records
+ * of the wrapped database, which it takes ownership of.
+ */
+void stKVDatabase_initialise_compressed(stKVDatabase *database, stKVDatabase *wrappedDatabase,
+        stKVDatabaseCompression compression);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
+/*
+ * Constructs a view of a record held in allocated memory, which the view takes ownership of.
+ */
+stKVDatabaseRecordView *stKVDatabaseRecordView_constructCopy(void *record, int64_t size);
+
+/*
+ * Constructs a view of size bytes of the open file, starting at the given offset, by mapping them into memory.
+ * The file may be closed, or replaced, while the view exists, but must not be truncated or overwritten.
+ */
+stKVDatabaseRecordView *stKVDatabaseRecordView_constructMapped(int fd, int64_t offset, int64_t size, const char *path);
+
 void stKVDatabase_initialise_kyotoTycoon(stKVDatabase *database, stKVDatabaseConf *conf, bool create);
 /*
  * Function initialises the pointers of the stKVDatabase object with functions for Big Record File.
@@ -5,77 +5,229 @@
  */
 
 /*
- * Write records directly to binary files, in a one record per
- * file scheme.  Designed to be used in conjunction with Kyoto Tycoon
- * as a work-around for "network errors" that invariably arise when
- * trying to write large records (>200MB) to the database.
+ * Write records directly to binary files.  Designed to be used in
+ * conjunction with Kyoto Tycoon as a work-around for "network errors"
+ * that invariably arise when trying to write large records (>200MB) to
+ * the database.
+ *
+ * Everything lives in one directory (ROOT_DIR_TAG) in the database dir
+ * from the conf.  Each big record is a file of its own, placed in one of
+ * 256 * 256 subdirectories by a hash of its key so no directory gets too
+ * big.  Small records are instead appended to shared segment files, so they
+ * don't each use an inode.  Where each record is kept is appended to an
+ * index file, which is read back when the database is opened, rather than
+ * scanning directories.  Once most of a segment is superseded its live
+ * records are moved to the current segment and the segment is removed.
  *
  * Doesn't fully implement the sonLib database interface (and is not
  * made public) but is consistent enough that it could be if needed...
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <dirent.h>
 #include <limits.h>
 #include "sonLibGlobalsInternal.h"
 #include "sonLibKVDatabasePrivate.h"
-#include "sonLibSortedSet.h"
+#include "sonLibString.h"
 #include "stSafeC.h"
-#include "sonLibTuples.h"
 
 /*
- * tag used to construct files for storing big records.  these all just
- * get dumped in the database dir from the conf.  note that this string
- * is used, hackily, by cactus_progressive when deleting databases..
+ * tag used, in earlier versions, to construct the files for storing big
+ * records, which were all just dumped in the database dir from the conf,
+ * named <database name>.<tag><key>.
+ * note that this string is used, hackily, by cactus_progressive when
+ * deleting databases..  databases in that layout are moved into the
+ * current one when opened.
  */
 #define RECORD_FILE_TAG "BIG__RECORD__FILE__"
 
 /*
- * Maximum number of records stored in the base directory.  If there
- * are too many files, it's probably time for a rethink.  The value below
- * is relatively high mostly just for unit testing.
+ * the directory, within the database dir, holding the records.
+ */
+#define ROOT_DIR_TAG "BIG__RECORD__FILES"
+
+#define INDEX_FILE_NAME "index"
+#define INDEX_MAGIC "stKVBRF1"
+#define INDEX_MAGIC_SIZE 8
+#define INDEX_ENTRY_SIZE ((int64_t)(4 * sizeof(int64_t)))
+
+/*
+ * Values of an index entry's segment that aren't segments.
+ */
+#define FILE_SEGMENT -1
+#define REMOVED_SEGMENT -2
+
+/*
+ * Records smaller than this are put in segments.
  */
-#define MAX_NUMBER_ENTRIES 2048
+#define MAX_SEGMENT_RECORD_SIZE ((int64_t)1 << 16)
+
+/*
+ * A new segment is started when a record would take the current one over
+ * this size.
+ */
+#define MAX_SEGMENT_SIZE ((int64_t)1 << 26)
+
+/*
+ * The index file is rewritten once it holds this many entries more than
+ * twice the number of records.
+ */
+#define MIN_INDEX_GARBAGE 65536
 
 #define MAXIMUM_PATH_LENGTH 4096
+
+typedef struct _recordLocation {
+	int64_t key;
+	int64_t segment; /* FILE_SEGMENT if the record has its own file */
+	int64_t offset; /* offset in the segment */
+	int64_t size;
+	/* the other records in the same segment */
+	struct _recordLocation* previousInSegment;
+	struct _recordLocation* nextInSegment;
+} RecordLocation;
+
+typedef struct _bigRecordDB {
+	char* rootPath;
+	stHash* locations; /* the RecordLocations, keyed by themselves */
+	int indexFd;
+	int64_t indexEntries; /* number of entries in the index file */
+	int segmentFd; /* the segment being appended to */
+	int64_t segment;
+	int64_t segmentSize;
+	int64_t* segmentLiveBytes; /* bytes of current records in each segment */
+	RecordLocation** segmentRecords; /* the first record in each segment */
+	int64_t numberOfSegments;
+} BigRecordDB;
+
+static uint64_t recordLocation_hashKey(const void* location)
+{
+	return (uint64_t)((const RecordLocation*)location)->key;
+}
+
+static int recordLocation_equalKey(const void* location1, const void* location2)
+{
+	return ((const RecordLocation*)location1)->key ==
+			((const RecordLocation*)location2)->key;
+}
+
+static BigRecordDB* getBigRecordDB(stKVDatabase* database)
+{
+	return (BigRecordDB*)database->dbImpl;
+}
+
+static RecordLocation* getLocation(BigRecordDB* db, int64_t key)
+{
+	RecordLocation location;
+	location.key = key;
+	return stHash_search(db->locations, &location);
+}
+
+static void writeFully(int fd, const void* buffer, int64_t size,
+		int64_t offset, const char* path)
+{
+	while (size > 0)
+	{
+		ssize_t i = pwrite(fd, buffer, size, offset);
+		if (i < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Write file: %s: %s", path,
+					strerror(errno));
+		}
+		buffer = (const char*)buffer + i;
+		size -= i;
+		offset += i;
+	}
+}
+
+static void readFully(int fd, void* buffer, int64_t size, int64_t offset,
+		const char* path)
+{
+	while (size > 0)
+	{
+		ssize_t i = pread(fd, buffer, size, offset);
+		if (i <= 0)
+		{
+			if (i < 0 && errno == EINTR)
+				continue;
+			stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Read file: %s: %s", path,
+					i < 0 ? strerror(errno) : "unexpected end of file");
+		}
+		buffer = (char*)buffer + i;
+		size -= i;
+		offset += i;
+	}
+}
+
+/*
+ * Get the path of the directory holding the file for the record with
+ * the given key, spreading the keys evenly over the subdirectories.
+ * NEEDS TO BE FREED!!
+ */
+static char* createRecordDirPath(BigRecordDB* db, int64_t key)
+{
+	uint64_t hash = (uint64_t)key * 0x9E3779B97F4A7C15ULL;
+	return stString_print("%s/%02x/%02x", db->rootPath,
+			(unsigned int)(hash >> 56), (unsigned int)((hash >> 48) & 0xff));
+}
+
 /*
  * Get the full path of the file corresponding to the record
  * with the given key.  NEEDS TO BE FREED!!
  */
-static char* createRecordPath(stKVDatabaseConf* conf, int64_t key)
+static char* createRecordPath(BigRecordDB* db, int64_t key)
 {
-	const char *basePath = stKVDatabaseConf_getDir(conf);
-	const char *name = stKVDatabaseConf_getDatabaseName(conf);
-	if (name == NULL)
-		name = "db";
-	int64_t size = strlen(basePath) + strlen(name) +
-			strlen(RECORD_FILE_TAG) + 65;
-	char* recordPath = (char*)malloc(size * sizeof(char));
-	sprintf(recordPath, "%s/%s.%s%lld", basePath, name, RECORD_FILE_TAG,
-			(long long int)key);
+	char* dirPath = createRecordDirPath(db, key);
+	char* recordPath = stString_print("%s/%lld", dirPath, (long long int)key);
+	free(dirPath);
 	return recordPath;
 }
 
+static char* createSegmentPath(BigRecordDB* db, int64_t segment)
+{
+	return stString_print("%s/segment.%lld", db->rootPath, (long long int)segment);
+}
+
+static int openFile(const char* path, int flags)
+{
+	int fd = open(path, flags, S_IRUSR | S_IWUSR);
+	if (fd < 0)
+	{
+		stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Open file: %s: %s", path,
+				strerror(errno));
+	}
+	return fd;
+}
+
 /*
- * visit every record in the directory.  currently implemented
- * as just a flat directory where records are stored in files
- * including the RECORD_FILE_TAG.
+ * visit every record of the named database in the directory, as stored by
+ * earlier versions: a flat directory where records are stored in files
+ * starting with the database name and the RECORD_FILE_TAG.  Records of
+ * other databases sharing the directory are left alone.
  */
-static size_t visitRecords(const char* basePath,
+static size_t visitRecords(const char* basePath, const char* name,
 		void (*fileFn)(const char* recordPath, void* arg), void* argument)
 {
 	DIR *dp;
 	struct dirent *ep;
 	char filePathBuffer[MAXIMUM_PATH_LENGTH];
+	char* prefix = stString_print("%s.%s", name, RECORD_FILE_TAG);
+	size_t prefixLength = strlen(prefix);
 	dp = opendir(basePath);
 	int64_t numRecords = 0;
 	if (dp != NULL)
 	{
 		while ((ep = readdir(dp)) != NULL)
 		{
-			if (strstr(ep->d_name, RECORD_FILE_TAG) != NULL)
+			if (strncmp(ep->d_name, prefix, prefixLength) == 0)
 			{
 				sprintf(filePathBuffer, "%s/%s", basePath, ep->d_name);
 				if (fileFn != NULL)
@@ -87,114 +239,525 @@ static size_t visitRecords(const char* basePath,
 		}
 		(void)closedir(dp);
 	}
+	free(prefix);
 	return numRecords;
 }
 
+/* get around complicated casting
+ */
+static void remove_with_arg(const char* path, void* arg)
+{
+	remove(path);
+}
+
 /*
- * add a path to a sorted set
+ * remove a directory and everything in it.
  */
-static void add_to_sortedSet(const char* recordPath, void* arg)
+static void removeDirectory(const char* path)
 {
-	stSortedSet* sortedSet = (stSortedSet*)arg;
-	const char* fileName = strstr(recordPath, RECORD_FILE_TAG);
-	assert (fileName != NULL);
-	const char* keyString = fileName + strlen(RECORD_FILE_TAG);
-	assert (keyString != NULL);
-	int64_t key = atol(keyString);
-	stSortedSet_insert(sortedSet, stIntTuple_construct1( key));
+	DIR* dp = opendir(path);
+	if (dp == NULL)
+	{
+		return;
+	}
+	struct dirent* ep;
+	while ((ep = readdir(dp)) != NULL)
+	{
+		if (strcmp(ep->d_name, ".") != 0 && strcmp(ep->d_name, "..") != 0)
+		{
+			char* childPath = stString_print("%s/%s", path, ep->d_name);
+			if (remove(childPath) != 0)
+			{
+				removeDirectory(childPath);
+			}
+			free(childPath);
+		}
+	}
+	(void)closedir(dp);
+	rmdir(path);
 }
 
-/* get around complicated casting
+static int64_t* getSegmentLiveBytes(BigRecordDB* db, int64_t segment)
+{
+	if (segment >= db->numberOfSegments)
+	{
+		int64_t numberOfSegments = segment * 2 + 1;
+		db->segmentLiveBytes = st_realloc(db->segmentLiveBytes,
+				numberOfSegments * sizeof(int64_t));
+		memset(db->segmentLiveBytes + db->numberOfSegments, 0,
+				(numberOfSegments - db->numberOfSegments) * sizeof(int64_t));
+		db->segmentRecords = st_realloc(db->segmentRecords,
+				numberOfSegments * sizeof(RecordLocation*));
+		memset(db->segmentRecords + db->numberOfSegments, 0,
+				(numberOfSegments - db->numberOfSegments) * sizeof(RecordLocation*));
+		db->numberOfSegments = numberOfSegments;
+	}
+	return &db->segmentLiveBytes[segment];
+}
+
+/*
+ * Adds the record to those of its segment, so a segment's records can be
+ * found without looking at every location.
  */
-static void remove_with_arg(const char* path, void* arg)
+static void addToSegment(BigRecordDB* db, RecordLocation* location)
 {
-	remove(path);
+	*getSegmentLiveBytes(db, location->segment) += location->size;
+	location->previousInSegment = NULL;
+	location->nextInSegment = db->segmentRecords[location->segment];
+	if (location->nextInSegment != NULL)
+	{
+		location->nextInSegment->previousInSegment = location;
+	}
+	db->segmentRecords[location->segment] = location;
+}
+
+static void removeFromSegment(BigRecordDB* db, RecordLocation* location)
+{
+	db->segmentLiveBytes[location->segment] -= location->size;
+	if (location->previousInSegment != NULL)
+	{
+		location->previousInSegment->nextInSegment = location->nextInSegment;
+	}
+	else
+	{
+		db->segmentRecords[location->segment] = location->nextInSegment;
+	}
+	if (location->nextInSegment != NULL)
+	{
+		location->nextInSegment->previousInSegment = location->previousInSegment;
+	}
+}
+
+/*
+ * Sets where the record is kept in memory, returning the previous
+ * location (or a location with REMOVED_SEGMENT if there wasn't one).
+ */
+static RecordLocation setLocation(BigRecordDB* db, int64_t key,
+		int64_t segment, int64_t offset, int64_t size)
+{
+	RecordLocation previous = { key, REMOVED_SEGMENT, 0, 0 };
+	RecordLocation* location = getLocation(db, key);
+	if (location != NULL)
+	{
+		previous = *location;
+		if (previous.segment >= 0)
+		{
+			removeFromSegment(db, location);
+		}
+		if (segment == REMOVED_SEGMENT)
+		{
+			stHash_remove(db->locations, location);
+			free(location);
+			return previous;
+		}
+	}
+	else if (segment == REMOVED_SEGMENT)
+	{
+		return previous;
+	}
+	else
+	{
+		location = st_malloc(sizeof(RecordLocation));
+		location->key = key;
+		stHash_insert(db->locations, location, location);
+	}
+	location->segment = segment;
+	location->offset = offset;
+	location->size = size;
+	if (segment >= 0)
+	{
+		addToSegment(db, location);
+	}
+	return previous;
+}
+
+static void writeIndexEntry(BigRecordDB* db, int64_t key, int64_t segment,
+		int64_t offset, int64_t size)
+{
+	int64_t entry[4] = { key, segment, offset, size };
+	char* indexPath = stString_print("%s/%s", db->rootPath, INDEX_FILE_NAME);
+	writeFully(db->indexFd, entry, INDEX_ENTRY_SIZE,
+			INDEX_MAGIC_SIZE + db->indexEntries * INDEX_ENTRY_SIZE, indexPath);
+	free(indexPath);
+	db->indexEntries++;
+}
+
+/*
+ * Rewrites the index file with just the current locations.
+ */
+static void compactIndex(BigRecordDB* db)
+{
+	char* indexPath = stString_print("%s/%s", db->rootPath, INDEX_FILE_NAME);
+	char* compactPath = stString_print("%s.compact", indexPath);
+	int fd = openFile(compactPath, O_RDWR | O_CREAT | O_TRUNC);
+	stList* locations = stHash_getValues(db->locations);
+	int64_t* entries = st_malloc(stList_length(locations) * INDEX_ENTRY_SIZE + 1);
+	for (int64_t i = 0; i < stList_length(locations); i++)
+	{
+		RecordLocation* location = stList_get(locations, i);
+		entries[4 * i] = location->key;
+		entries[4 * i + 1] = location->segment;
+		entries[4 * i + 2] = location->offset;
+		entries[4 * i + 3] = location->size;
+	}
+	writeFully(fd, INDEX_MAGIC, INDEX_MAGIC_SIZE, 0, compactPath);
+	writeFully(fd, entries, stList_length(locations) * INDEX_ENTRY_SIZE,
+			INDEX_MAGIC_SIZE, compactPath);
+	if (fsync(fd) != 0 || rename(compactPath, indexPath) != 0)
+	{
+		stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Rename file: %s: %s",
+				compactPath, strerror(errno));
+	}
+	close(db->indexFd);
+	db->indexFd = fd;
+	db->indexEntries = stList_length(locations);
+	stList_destruct(locations);
+	free(entries);
+	free(compactPath);
+	free(indexPath);
+}
+
+/*
+ * Records a change of location in the index file.
+ */
+static void logLocation(BigRecordDB* db, int64_t key, int64_t segment,
+		int64_t offset, int64_t size)
+{
+	if (db->indexEntries >= 2 * stHash_size(db->locations) + MIN_INDEX_GARBAGE)
+	{
+		compactIndex(db);
+	}
+	writeIndexEntry(db, key, segment, offset, size);
+}
+
+static void startSegment(BigRecordDB* db, int64_t segment)
+{
+	if (db->segmentFd >= 0)
+	{
+		close(db->segmentFd);
+	}
+	char* segmentPath = createSegmentPath(db, segment);
+	db->segmentFd = openFile(segmentPath, O_RDWR | O_CREAT);
+	struct stat fileStat;
+	if (fstat(db->segmentFd, &fileStat) != 0)
+	{
+		stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Read file: %s", segmentPath);
+	}
+	free(segmentPath);
+	db->segment = segment;
+	db->segmentSize = fileStat.st_size;
+	getSegmentLiveBytes(db, segment);
+}
+
+/*
+ * Appends the value to the current segment, returning its offset.
+ */
+static int64_t appendToSegment(BigRecordDB* db, const void* value,
+		int64_t sizeOfRecord)
+{
+	if (db->segmentSize + sizeOfRecord > MAX_SEGMENT_SIZE)
+	{
+		startSegment(db, db->segment + 1);
+	}
+	char* segmentPath = createSegmentPath(db, db->segment);
+	int64_t offset = db->segmentSize;
+	writeFully(db->segmentFd, value, sizeOfRecord, offset, segmentPath);
+	free(segmentPath);
+	db->segmentSize += sizeOfRecord;
+	return offset;
+}
+
+/*
+ * Moves the live records out of a mostly superseded segment, then
+ * removes it.
+ */
+static void relocateSegment(BigRecordDB* db, int64_t segment)
+{
+	char* segmentPath = createSegmentPath(db, segment);
+	if (db->segmentLiveBytes[segment] > 0)
+	{
+		int fd = openFile(segmentPath, O_RDONLY);
+		char* buffer = st_malloc(MAX_SEGMENT_RECORD_SIZE);
+		/* each record moved leaves the segment's records */
+		RecordLocation* location;
+		while ((location = db->segmentRecords[segment]) != NULL)
+		{
+			readFully(fd, buffer, location->size, location->offset, segmentPath);
+			int64_t offset = appendToSegment(db, buffer, location->size);
+			logLocation(db, location->key, db->segment, offset, location->size);
+			setLocation(db, location->key, db->segment, offset, location->size);
+		}
+		free(buffer);
+		close(fd);
+	}
+	assert(db->segmentLiveBytes[segment] == 0);
+	unlink(segmentPath);
+	free(segmentPath);
+}
+
+/*
+ * Cleans up after a record is superseded or removed.
+ */
+static void releaseLocation(BigRecordDB* db, RecordLocation* previous,
+		int64_t segment)
+{
+	if (previous->segment == FILE_SEGMENT && segment != FILE_SEGMENT)
+	{
+		char* recordPath = createRecordPath(db, previous->key);
+		remove(recordPath);
+		free(recordPath);
+	}
+	else if (previous->segment >= 0 && previous->segment != db->segment
+			&& db->segmentLiveBytes[previous->segment] < MAX_SEGMENT_SIZE / 4)
+	{
+		relocateSegment(db, previous->segment);
+	}
 }
 
 /*
- * build a sorted set of records in the given directory
+ * Reads the index file, building the locations.
+ * An incomplete entry at the end, left by a write that was cut short,
+ * is removed.
  */
-static stSortedSet* constructDB(stKVDatabaseConf *conf, bool create)
+static void readIndex(BigRecordDB* db, const char* indexPath)
+{
+	struct stat fileStat;
+	char magic[INDEX_MAGIC_SIZE];
+	if (fstat(db->indexFd, &fileStat) != 0 || fileStat.st_size < INDEX_MAGIC_SIZE)
+	{
+		stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Read file: %s", indexPath);
+	}
+	readFully(db->indexFd, magic, INDEX_MAGIC_SIZE, 0, indexPath);
+	if (memcmp(magic, INDEX_MAGIC, INDEX_MAGIC_SIZE) != 0)
+	{
+		stThrowNew(ST_KV_DATABASE_EXCEPTION_ID,
+				"The file %s is not a big record index", indexPath);
+	}
+	int64_t numberOfEntries = (fileStat.st_size - INDEX_MAGIC_SIZE) / INDEX_ENTRY_SIZE;
+	int64_t maxSegment = 0;
+	int64_t bufferEntries = 4096;
+	int64_t* entries = st_malloc(bufferEntries * INDEX_ENTRY_SIZE);
+	for (int64_t i = 0; i < numberOfEntries; i += bufferEntries)
+	{
+		int64_t j = numberOfEntries - i < bufferEntries ? numberOfEntries - i : bufferEntries;
+		readFully(db->indexFd, entries, j * INDEX_ENTRY_SIZE,
+				INDEX_MAGIC_SIZE + i * INDEX_ENTRY_SIZE, indexPath);
+		for (int64_t k = 0; k < j; k++)
+		{
+			int64_t* entry = entries + 4 * k;
+			setLocation(db, entry[0], entry[1], entry[2], entry[3]);
+			if (entry[1] > maxSegment)
+			{
+				maxSegment = entry[1];
+			}
+		}
+	}
+	free(entries);
+	if (INDEX_MAGIC_SIZE + numberOfEntries * INDEX_ENTRY_SIZE < fileStat.st_size &&
+			ftruncate(db->indexFd, INDEX_MAGIC_SIZE + numberOfEntries * INDEX_ENTRY_SIZE) != 0)
+	{
+		stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Write file: %s", indexPath);
+	}
+	db->indexEntries = numberOfEntries;
+	/* segments emptied by a relocation that was cut short */
+	for (int64_t segment = 0; segment < maxSegment; segment++)
+	{
+		if (*getSegmentLiveBytes(db, segment) == 0)
+		{
+			char* segmentPath = createSegmentPath(db, segment);
+			unlink(segmentPath);
+			free(segmentPath);
+		}
+	}
+	startSegment(db, maxSegment);
+}
+
+static void writeRecord(BigRecordDB* db, int64_t key, const void* value,
+		int64_t sizeOfRecord);
+
+/*
+ * move a record file, as stored by earlier versions, into the database
+ */
+static void importRecordFile(const char* recordPath, void* arg)
+{
+	BigRecordDB* db = (BigRecordDB*)arg;
+	/* the key follows the last tag, as the name may include the tag too */
+	const char* keyString = strstr(recordPath, RECORD_FILE_TAG) + strlen(RECORD_FILE_TAG);
+	const char* nextTag;
+	while ((nextTag = strstr(keyString, RECORD_FILE_TAG)) != NULL)
+	{
+		keyString = nextTag + strlen(RECORD_FILE_TAG);
+	}
+	int64_t key = atol(keyString);
+	FILE* recHandle = fopen(recordPath, "rb");
+	if (recHandle == NULL)
+	{
+		stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Read file: %s", recordPath);
+	}
+	fseeko(recHandle, 0, SEEK_END);
+	int64_t fileSize = ftello(recHandle);
+	rewind(recHandle);
+	void* buffer = stSafeCMalloc(fileSize + 1);
+	if (fileSize > 0 && fread(buffer, fileSize, 1, recHandle) != 1)
+	{
+		stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Read file: %s", recordPath);
+	}
+	fclose(recHandle);
+	writeRecord(db, key, buffer, fileSize);
+	free(buffer);
+	remove(recordPath);
+}
+
+/*
+ * open the directory of records, reading the index
+ */
+static BigRecordDB* constructDB(stKVDatabaseConf *conf, bool create)
 {
 	const char *basePath = stKVDatabaseConf_getDir(conf);
-    mkdir(basePath, S_IRWXU);
-    stSortedSet* sortedSet = stSortedSet_construct3(
-    		(int (*)(const void *, const void *))stIntTuple_cmpFn,
-    		(void (*)(void *))stIntTuple_destruct);
-    if (create == true)
-    {
-    	visitRecords(basePath, remove_with_arg, NULL);
-    }
-    else
-    {
-    	visitRecords(basePath, add_to_sortedSet, sortedSet);
-    }
-    return sortedSet;
+	const char *name = stKVDatabaseConf_getDatabaseName(conf);
+	if (name == NULL)
+		name = "db";
+	mkdir(basePath, S_IRWXU);
+	BigRecordDB* db = st_calloc(1, sizeof(BigRecordDB));
+	db->rootPath = stString_print("%s/%s.%s", basePath, name, ROOT_DIR_TAG);
+	db->locations = stHash_construct4(recordLocation_hashKey,
+			recordLocation_equalKey, free, NULL, stHashTypeOpenAddressing);
+	db->segmentFd = -1;
+	if (create == true)
+	{
+		removeDirectory(db->rootPath);
+		visitRecords(basePath, name, remove_with_arg, NULL);
+	}
+	mkdir(db->rootPath, S_IRWXU);
+	char* indexPath = stString_print("%s/%s", db->rootPath, INDEX_FILE_NAME);
+	char* compactPath = stString_print("%s.compact", indexPath);
+	unlink(compactPath); /* left if a compaction was cut short */
+	free(compactPath);
+	db->indexFd = open(indexPath, O_RDWR);
+	if (db->indexFd >= 0)
+	{
+		readIndex(db, indexPath);
+	}
+	else
+	{
+		db->indexFd = openFile(indexPath, O_RDWR | O_CREAT | O_TRUNC);
+		writeFully(db->indexFd, INDEX_MAGIC, INDEX_MAGIC_SIZE, 0, indexPath);
+		startSegment(db, 0);
+		visitRecords(basePath, name, importRecordFile, db);
+	}
+	free(indexPath);
+	return db;
 }
 
 /*
- * database in memory is just a sorted set, so we destroy that.
+ * database in memory is just the locations, so we destroy them.
  */
 static void destructDB(stKVDatabase *database)
 {
-	stSortedSet* sortedSet  = (stSortedSet*)database->dbImpl;
-    if (sortedSet != NULL)
-    {
-    	stSortedSet_destruct(sortedSet);
-    }
-    database->dbImpl = NULL;
+	BigRecordDB* db = getBigRecordDB(database);
+	if (db != NULL)
+	{
+		close(db->indexFd);
+		close(db->segmentFd);
+		stHash_destruct(db->locations);
+		free(db->segmentLiveBytes);
+		free(db->segmentRecords);
+		free(db->rootPath);
+		free(db);
+	}
+	database->dbImpl = NULL;
 }
 
-/* delete every file beginning with RECORD_FILE_TAG
- * in the database directory
+/* delete the directory of records
  */
 static void deleteDB(stKVDatabase *database)
 {
+	char* rootPath = stString_copy(getBigRecordDB(database)->rootPath);
 	/* destruct called to be consistent with other dbs */
 	destructDB(database);
-	stKVDatabaseConf* conf = stKVDatabase_getConf(database);
-	const char *basePath = stKVDatabaseConf_getDir(conf);
-	visitRecords(basePath, remove_with_arg, NULL);
+	removeDirectory(rootPath);
+	free(rootPath);
+}
+
+static void flush(stKVDatabase *database)
+{
+	BigRecordDB* db = getBigRecordDB(database);
+	if (fsync(db->segmentFd) != 0 || fsync(db->indexFd) != 0)
+	{
+		stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Flushing %s failed: %s",
+				db->rootPath, strerror(errno));
+	}
 }
 
 /* check if a record already exists */
 static bool containsRecord(stKVDatabase *database, int64_t key)
 {
-	stSortedSet* sortedSet  = (stSortedSet*)database->dbImpl;
-	stIntTuple* tuple = stIntTuple_construct1( key);
-	void* found = stSortedSet_search(sortedSet, tuple);
-	stIntTuple_destruct(tuple);
-	return found != NULL;
+	return getLocation(getBigRecordDB(database), key) != NULL;
 }
 
-/* write the record as a file in the directory, and add the key
- * to the in-memory sorted set.
+/*
+ * write the record as a file of its own, replacing rather than
+ * overwriting any existing file so views of the old record stay intact.
  */
-static void insertRecord(stKVDatabase *database, int64_t key, const void *value,
+static void writeRecordFile(BigRecordDB* db, int64_t key, const void *value,
 		int64_t sizeOfRecord)
 {
-	stSortedSet* sortedSet  = (stSortedSet*)database->dbImpl;
-	if (stSortedSet_size(sortedSet) >= MAX_NUMBER_ENTRIES)
+	char* recordPath = createRecordPath(db, key);
+	char* tempPath = stString_print("%s.tmp", recordPath);
+	FILE* recHandle = fopen(tempPath, "wb");
+	if (recHandle == NULL && errno == ENOENT)
 	{
-		stThrowNew(ST_KV_DATABASE_EXCEPTION_ID,
-				"Database capacity reached: %lld", (int64_t)MAX_NUMBER_ENTRIES);
+		/* subdirectories are made when first needed */
+		char* dirPath = createRecordDirPath(db, key);
+		dirPath[strlen(dirPath) - 3] = '\0';
+		mkdir(dirPath, S_IRWXU);
+		dirPath[strlen(dirPath)] = '/';
+		mkdir(dirPath, S_IRWXU);
+		free(dirPath);
+		recHandle = fopen(tempPath, "wb");
 	}
-	char* recordPath = createRecordPath(stKVDatabase_getConf(database), key);
-	FILE* recHandle = fopen(recordPath, "wb");
 	if (recHandle == NULL)
 	{
-		stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Open file: %s", recordPath);
+		stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Open file: %s", tempPath);
 	}
-	size_t retVal = fwrite(value, sizeOfRecord, 1, recHandle);
-	if (retVal != 1)
+	if (sizeOfRecord > 0 && fwrite(value, sizeOfRecord, 1, recHandle) != 1)
 	{
-		stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Write file: %s", recordPath);
+		stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Write file: %s", tempPath);
 	}
-	stSortedSet_insert(sortedSet, stIntTuple_construct1( key));
-	fclose(recHandle);
+	if (fclose(recHandle) != 0 || rename(tempPath, recordPath) != 0)
+	{
+		stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Rename file: %s", tempPath);
+	}
+	free(tempPath);
 	free(recordPath);
 }
 
+/* write the record, to a file of its own if big or else to the current
+ * segment, then note where it is in the index.
+ */
+static void writeRecord(BigRecordDB* db, int64_t key, const void *value,
+		int64_t sizeOfRecord)
+{
+	int64_t segment = FILE_SEGMENT, offset = 0;
+	if (sizeOfRecord < MAX_SEGMENT_RECORD_SIZE)
+	{
+		offset = appendToSegment(db, value, sizeOfRecord);
+		segment = db->segment;
+	}
+	else
+	{
+		writeRecordFile(db, key, value, sizeOfRecord);
+	}
+	logLocation(db, key, segment, offset, sizeOfRecord);
+	RecordLocation previous = setLocation(db, key, segment, offset, sizeOfRecord);
+	releaseLocation(db, &previous, segment);
+}
+
+static void insertRecord(stKVDatabase *database, int64_t key, const void *value,
+		int64_t sizeOfRecord)
+{
+	writeRecord(getBigRecordDB(database), key, value, sizeOfRecord);
+}
 
 static void updateRecord(stKVDatabase *database, int64_t key, const void *value,
 		int64_t sizeOfRecord)
@@ -210,8 +773,26 @@ static void setRecord(stKVDatabase *database, int64_t key, const void *value,
 
 static int64_t numberOfRecords(stKVDatabase *database)
 {
-	stSortedSet* sortedSet  = (stSortedSet*)database->dbImpl;
-	return (int64_t)stSortedSet_size(sortedSet);
+	return stHash_size(getBigRecordDB(database)->locations);
+}
+
+/*
+ * read part of the record from its file or segment.
+ * NEEDS TO BE FREED
+ */
+static void* readRecord(BigRecordDB* db, RecordLocation* location,
+		int64_t zeroBasedByteOffset, int64_t sizeInBytes)
+{
+	char* path = location->segment == FILE_SEGMENT ?
+			createRecordPath(db, location->key) :
+			createSegmentPath(db, location->segment);
+	int fd = openFile(path, O_RDONLY);
+	void* buffer = stSafeCMalloc(sizeInBytes + 1);
+	readFully(fd, buffer, sizeInBytes,
+			location->offset + zeroBasedByteOffset, path);
+	close(fd);
+	free(path);
+	return buffer;
 }
 
 /*
@@ -219,29 +800,14 @@ static int64_t numberOfRecords(stKVDatabase *database)
  */
 static void* getRecord2(stKVDatabase *database, int64_t key, int64_t* recordSize)
 {
-	if (containsRecord(database, key) == false)
+	BigRecordDB* db = getBigRecordDB(database);
+	RecordLocation* location = getLocation(db, key);
+	if (location == NULL)
 	{
 		return NULL;
 	}
-	char* recordPath = createRecordPath(stKVDatabase_getConf(database), key);
-	FILE* recHandle = fopen(recordPath, "rb");
-	if (recHandle == NULL)
-	{
-		stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Read file: %s", recordPath);
-	}
-	fseek(recHandle, 0, SEEK_END);
-	long fileSize = ftell(recHandle);
-	rewind(recHandle);
-	void* buffer = stSafeCMalloc(fileSize);
-	size_t retVal = fread(buffer, fileSize, 1, recHandle);
-	if (retVal != 1)
-	{
-		stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Read file: %s", recordPath);
-	}
-	fclose(recHandle);
-	free(recordPath);
-	*recordSize = fileSize;
-	return buffer;
+	*recordSize = location->size;
+	return readRecord(db, location, 0, location->size);
 }
 
 /*
@@ -258,47 +824,70 @@ static void *getPartialRecord(stKVDatabase *database, int64_t key,
 		int64_t zeroBasedByteOffset, int64_t sizeInBytes, int64_t recordSize)
 {
 	assert (zeroBasedByteOffset + sizeInBytes <= recordSize);
-	if (containsRecord(database, key) == false || sizeInBytes == 0)
+	BigRecordDB* db = getBigRecordDB(database);
+	RecordLocation* location = getLocation(db, key);
+	if (location == NULL || sizeInBytes == 0)
 	{
 		return NULL;
 	}
-	char* recordPath = createRecordPath(stKVDatabase_getConf(database), key);
-	FILE* recHandle = fopen(recordPath, "rb");
-	if (recHandle == NULL)
+	return readRecord(db, location, zeroBasedByteOffset, sizeInBytes);
+}
+
+/* map the part of the record file into memory rather than reading it,
+ * records in segments are small so are just copied */
+static stKVDatabaseRecordView *getPartialRecordView(stKVDatabase *database, int64_t key,
+		int64_t zeroBasedByteOffset, int64_t sizeInBytes, int64_t recordSize)
+{
+	assert (zeroBasedByteOffset + sizeInBytes <= recordSize);
+	BigRecordDB* db = getBigRecordDB(database);
+	RecordLocation* location = getLocation(db, key);
+	if (location == NULL)
 	{
-		stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Read file: %s", recordPath);
+		stThrowNew(ST_KV_DATABASE_EXCEPTION_ID,
+				"Record key not found: %lld", (long long)key);
 	}
-	fseek(recHandle, (long)zeroBasedByteOffset, 0);
-	void* buffer = stSafeCMalloc(sizeInBytes);
-	size_t retVal = fread(buffer, sizeInBytes, 1, recHandle);
-	if (retVal != 1)
+	if (location->segment != FILE_SEGMENT)
 	{
-		stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Read file: %s", recordPath);
+		return stKVDatabaseRecordView_constructCopy(
+				readRecord(db, location, zeroBasedByteOffset, sizeInBytes), sizeInBytes);
 	}
-	fclose(recHandle);
+	char* recordPath = createRecordPath(db, key);
+	int fd = openFile(recordPath, O_RDONLY);
+	stKVDatabaseRecordView *view = NULL;
+	stTry {
+		view = stKVDatabaseRecordView_constructMapped(fd, zeroBasedByteOffset,
+				sizeInBytes, recordPath);
+	} stCatch(ex) {
+		close(fd);
+		free(recordPath);
+		stThrow(ex);
+	} stTryEnd;
+	close(fd); /* the mapping outlives the descriptor */
 	free(recordPath);
-	return buffer;
+	return view;
 }
 
-static void removeRecord(stKVDatabase *database, int64_t key)
+static stKVDatabaseRecordView *getRecordView(stKVDatabase *database, int64_t key)
 {
-	if (containsRecord(database, key) == false)
+	RecordLocation* location = getLocation(getBigRecordDB(database), key);
+	if (location == NULL)
 	{
-		stThrowNew(ST_KV_DATABASE_EXCEPTION_ID,
-				"Removing key not found: %lld", key);
+		return NULL;
 	}
-	stSortedSet* sortedSet  = (stSortedSet*)database->dbImpl;
-	stIntTuple* tuple = stIntTuple_construct1( key);
-	stSortedSet_remove(sortedSet, tuple);
-	stIntTuple_destruct(tuple);
-	char* recordPath = createRecordPath(stKVDatabase_getConf(database), key);
-	int retVal = remove(recordPath);
-	if (retVal != 0)
+	return getPartialRecordView(database, key, 0, location->size, location->size);
+}
+
+static void removeRecord(stKVDatabase *database, int64_t key)
+{
+	BigRecordDB* db = getBigRecordDB(database);
+	if (getLocation(db, key) == NULL)
 	{
 		stThrowNew(ST_KV_DATABASE_EXCEPTION_ID,
-				"Removing file returned error %d: %lld ", retVal, key);
+				"Removing key not found: %lld", (long long)key);
 	}
-	free(recordPath);
+	logLocation(db, key, REMOVED_SEGMENT, 0, 0);
+	RecordLocation previous = setLocation(db, key, REMOVED_SEGMENT, 0, 0);
+	releaseLocation(db, &previous, REMOVED_SEGMENT);
 }
 
 void stKVDatabase_initialise_bigRecordFile(stKVDatabase *database,
@@ -308,6 +897,7 @@ void stKVDatabase_initialise_bigRecordFile(stKVDatabase *database,
     database->secondaryDB = NULL;
     database->destruct = destructDB;
     database->deleteDatabase = deleteDB;
+    database->flush = flush;
     database->containsRecord = containsRecord;
     database->insertRecord = insertRecord;
     database->insertInt64 = NULL;
@@ -325,6 +915,6 @@ void stKVDatabase_initialise_bigRecordFile(stKVDatabase *database,
     database->bulkGetRecords = NULL;
     database->bulkGetRecordsRange = NULL;
     database->removeRecord = removeRecord;
+    database->getRecordView = getRecordView;
+    database->getPartialRecordView = getPartialRecordView;
 }
-
-
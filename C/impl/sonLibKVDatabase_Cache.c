@@ -0,0 +1,521 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * sonLibKVDatabase_Cache.c
+ *
+ * A database that wraps another, serving reads from an in memory cache and
+ * holding writes in a buffer until they can be sent on together with a bulk set.
+ *
+ * Whole records are held in the cache as a fragment starting with the size of the
+ * record, stored as an int64_t, followed by the record itself, so that partial
+ * reads of a record at offset x are cached at offset x + sizeof(int64_t) and are
+ * served by any whole copy of the record. Only the wrapped database's int64 functions
+ * know how it encodes int64 records, so those are written through, after sending on
+ * any buffered write of the same record.
+ */
+
+#include "sonLibGlobalsInternal.h"
+#include "sonLibKVDatabasePrivate.h"
+
+#define RECORD_HEADER_SIZE ((int64_t) sizeof(int64_t))
+
+typedef struct _cachedDB {
+    stKVDatabase *database; //The wrapped database.
+    stCache *cache; //Records and record fragments read from or written to the database.
+    stHash *writeBuffer; //Writes not yet sent to the database, at most one per key, as stKVDatabaseBulkRequests.
+    int64_t writeBufferSize; //Total size of the records in the write buffer.
+    int64_t maxWriteBufferSize;
+} CachedDB;
+
+static CachedDB *getCachedDB(stKVDatabase *database) {
+    return (CachedDB *) database->dbImpl;
+}
+
+static stHash *constructWriteBuffer(void) {
+    return stHash_construct3((uint64_t (*)(const void *)) stIntTuple_hashKey,
+            (int (*)(const void *, const void *)) stIntTuple_equalsFn,
+            (void (*)(void *)) stIntTuple_destruct,
+            (void (*)(void *)) stKVDatabaseBulkRequest_destruct);
+}
+
+static stKVDatabaseBulkRequest *getBufferedWrite(CachedDB *cachedDB, int64_t key) {
+    stIntTuple *tuple = stIntTuple_constructInline1(key);
+    stKVDatabaseBulkRequest *request = stHash_search(cachedDB->writeBuffer, tuple);
+    stIntTuple_destruct(tuple);
+    return request;
+}
+
+/*
+ * Takes the buffered write for the key out of the write buffer, returning NULL if there isn't one.
+ * The request must be freed.
+ */
+static stKVDatabaseBulkRequest *removeBufferedWrite(CachedDB *cachedDB, int64_t key) {
+    stIntTuple *tuple = stIntTuple_constructInline1(key);
+    stKVDatabaseBulkRequest *request = stHash_removeAndFreeKey(cachedDB->writeBuffer, tuple);
+    stIntTuple_destruct(tuple);
+    if (request != NULL) {
+        cachedDB->writeBufferSize -= request->size;
+    }
+    return request;
+}
+
+/*
+ * Puts a whole record in the cache, unless it would not fit.
+ */
+static void cacheRecord(CachedDB *cachedDB, int64_t key, const void *value, int64_t size) {
+    if (size > stCache_getMaxSize(cachedDB->cache) - RECORD_HEADER_SIZE) {
+        return;
+    }
+    char *buffer = st_malloc(RECORD_HEADER_SIZE + size);
+    memcpy(buffer, &size, RECORD_HEADER_SIZE);
+    memcpy(buffer + RECORD_HEADER_SIZE, value, size);
+    stCache_setRecord(cachedDB->cache, key, 0, RECORD_HEADER_SIZE + size, buffer);
+    free(buffer);
+}
+
+/*
+ * Gets a copy of the whole record from the write buffer or the cache, returning NULL if
+ * neither has it.
+ */
+static void *getLocalRecord(CachedDB *cachedDB, int64_t key, int64_t *recordSize) {
+    stKVDatabaseBulkRequest *request = getBufferedWrite(cachedDB, key);
+    if (request != NULL) {
+        *recordSize = request->size;
+        return memcpy(st_malloc(request->size), request->value, request->size);
+    }
+    if (stCache_containsRecord(cachedDB->cache, key, 0, RECORD_HEADER_SIZE)) {
+        int64_t sizeRead;
+        int64_t *size = stCache_getRecord(cachedDB->cache, key, 0, RECORD_HEADER_SIZE, &sizeRead);
+        *recordSize = *size;
+        free(size);
+        if (*recordSize == 0) {
+            return st_malloc(0);
+        }
+        return stCache_getRecord(cachedDB->cache, key, RECORD_HEADER_SIZE, *recordSize, &sizeRead);
+    }
+    return NULL;
+}
+
+/*
+ * Sends a single request on to the database.
+ */
+static void writeRequest(CachedDB *cachedDB, stKVDatabaseBulkRequest *request) {
+    switch (request->type) {
+        case INSERT:
+            stKVDatabase_insertRecord(cachedDB->database, request->key, request->value, request->size);
+            break;
+        case UPDATE:
+            stKVDatabase_updateRecord(cachedDB->database, request->key, request->value, request->size);
+            break;
+        case SET:
+            stKVDatabase_setRecord(cachedDB->database, request->key, request->value, request->size);
+            break;
+    }
+}
+
+/*
+ * Drops from the write buffer the inserts of records that the database already has, checking
+ * all the buffered inserts with one bulk get if the database supports it. Returns the number
+ * of inserts dropped, setting storedKey to the key of one of them.
+ */
+static int64_t removeStoredInserts(CachedDB *cachedDB, int64_t *storedKey) {
+    stList *requests = stHash_getValues(cachedDB->writeBuffer);
+    stList *keys = stList_construct();
+    for (int64_t i = 0; i < stList_length(requests); i++) {
+        stKVDatabaseBulkRequest *request = stList_get(requests, i);
+        if (request->type == INSERT) {
+            stList_append(keys, &request->key);
+        }
+    }
+    stList_destruct(requests);
+    stList *storedKeys = stList_construct3(0, (void (*)(void *)) stIntTuple_destruct);
+    if (stList_length(keys) > 0) {
+        if (cachedDB->database->bulkGetRecords != NULL) {
+            stList *results = stKVDatabase_bulkGetRecords(cachedDB->database, keys);
+            for (int64_t i = 0; i < stList_length(results); i++) {
+                if (((stKVDatabaseBulkResult *) stList_get(results, i))->value != NULL) {
+                    stList_append(storedKeys, stIntTuple_construct1(*(int64_t *) stList_get(keys, i)));
+                }
+            }
+            stList_destruct(results);
+        } else {
+            for (int64_t i = 0; i < stList_length(keys); i++) {
+                if (stKVDatabase_containsRecord(cachedDB->database, *(int64_t *) stList_get(keys, i))) {
+                    stList_append(storedKeys, stIntTuple_construct1(*(int64_t *) stList_get(keys, i)));
+                }
+            }
+        }
+    }
+    stList_destruct(keys);
+    int64_t storedInserts = stList_length(storedKeys);
+    for (int64_t i = 0; i < storedInserts; i++) {
+        *storedKey = stIntTuple_get(stList_get(storedKeys, i), 0);
+        stKVDatabaseBulkRequest_destruct(removeBufferedWrite(cachedDB, *storedKey));
+    }
+    stList_destruct(storedKeys);
+    return storedInserts;
+}
+
+/*
+ * Sends the contents of the write buffer on to the database, in one bulk set if the database
+ * supports it, and moves the written records into the cache. Inserts of records the database
+ * already has are dropped and reported, once the other writes have been sent.
+ */
+static void flushWriteBuffer(CachedDB *cachedDB) {
+    if (stHash_size(cachedDB->writeBuffer) == 0) {
+        return;
+    }
+    int64_t storedKey = 0;
+    int64_t storedInserts = removeStoredInserts(cachedDB, &storedKey);
+    stList *requests = stHash_getValues(cachedDB->writeBuffer);
+    if (cachedDB->database->bulkSetRecords != NULL) {
+        stKVDatabase_bulkSetRecords(cachedDB->database, requests);
+    } else {
+        for (int64_t i = 0; i < stList_length(requests); i++) {
+            writeRequest(cachedDB, stList_get(requests, i));
+        }
+    }
+    for (int64_t i = 0; i < stList_length(requests); i++) {
+        stKVDatabaseBulkRequest *request = stList_get(requests, i);
+        cacheRecord(cachedDB, request->key, request->value, request->size);
+    }
+    stList_destruct(requests);
+    stHash_destruct(cachedDB->writeBuffer);
+    cachedDB->writeBuffer = constructWriteBuffer();
+    cachedDB->writeBufferSize = 0;
+    if (storedInserts > 0) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID,
+                "Attempt to insert %lld keys in the database that already exist, including: %lld",
+                (long long) storedInserts, (long long) storedKey);
+    }
+}
+
+/*
+ * Sends any buffered write of the record on to the database and drops the record from the cache,
+ * ready for an operation on the record to be passed through to the database.
+ */
+static void writeThrough(CachedDB *cachedDB, int64_t key) {
+    stKVDatabaseBulkRequest *request = removeBufferedWrite(cachedDB, key);
+    if (request != NULL) {
+        writeRequest(cachedDB, request);
+        stKVDatabaseBulkRequest_destruct(request);
+    }
+    stCache_removeRecord(cachedDB->cache, key);
+}
+
+/*
+ * Returns true if the record is in the write buffer or the cache.
+ */
+static bool containsLocalRecord(CachedDB *cachedDB, int64_t key) {
+    return getBufferedWrite(cachedDB, key) != NULL
+            || stCache_containsRecord(cachedDB->cache, key, 0, RECORD_HEADER_SIZE);
+}
+
+static void bufferWrite(CachedDB *cachedDB, int64_t key, const void *value, int64_t sizeOfRecord,
+        enum stKVDatabaseBulkRequestType type) {
+    /*
+     * Only the buffer and the cache are checked here, so a write is not held up by a look up in
+     * the database. An insert of a record that is only in the database fails when it is flushed.
+     */
+    if (type == INSERT && containsLocalRecord(cachedDB, key)) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Attempt to insert a key in the database that already exists: %lld",
+                (long long) key);
+    }
+    stCache_removeRecord(cachedDB->cache, key);
+    stKVDatabaseBulkRequest *request = removeBufferedWrite(cachedDB, key);
+    if (request != NULL) {
+        /*
+         * Coalesce with the earlier write. A record that is yet to be inserted must still be
+         * inserted, and one that has been set may now be updated or set. (An insert of a
+         * buffered record has already been rejected.)
+         */
+        if (request->type == INSERT || request->type == SET) {
+            type = request->type;
+        }
+        stKVDatabaseBulkRequest_destruct(request);
+    }
+    switch (type) {
+        case INSERT:
+            request = stKVDatabaseBulkRequest_constructInsertRequest(key, value, sizeOfRecord);
+            break;
+        case UPDATE:
+            request = stKVDatabaseBulkRequest_constructUpdateRequest(key, value, sizeOfRecord);
+            break;
+        case SET:
+            request = stKVDatabaseBulkRequest_constructSetRequest(key, value, sizeOfRecord);
+            break;
+    }
+    stHash_insert(cachedDB->writeBuffer, stIntTuple_constructInline1(key), request);
+    cachedDB->writeBufferSize += sizeOfRecord;
+    if (cachedDB->writeBufferSize > cachedDB->maxWriteBufferSize) {
+        flushWriteBuffer(cachedDB);
+    }
+}
+
+/*
+ * Removes the record from the buffer and the cache, returning true if it must also be removed
+ * from the database.
+ */
+static bool removeLocalRecord(CachedDB *cachedDB, int64_t key) {
+    stCache_removeRecord(cachedDB->cache, key);
+    stKVDatabaseBulkRequest *request = removeBufferedWrite(cachedDB, key);
+    if (request == NULL) {
+        return true;
+    }
+    enum stKVDatabaseBulkRequestType type = request->type;
+    stKVDatabaseBulkRequest_destruct(request);
+    if (type == SET) { //We don't know if the set would have been an insert or an update.
+        return stKVDatabase_containsRecord(cachedDB->database, key);
+    }
+    return type == UPDATE;
+}
+
+static void freeCachedDB(stKVDatabase *database) {
+    CachedDB *cachedDB = getCachedDB(database);
+    stKVDatabase_destruct(cachedDB->database);
+    stCache_destruct(cachedDB->cache);
+    stHash_destruct(cachedDB->writeBuffer);
+    free(cachedDB);
+    database->dbImpl = NULL;
+}
+
+static void destructDB(stKVDatabase *database) {
+    stTry {
+        flushWriteBuffer(getCachedDB(database));
+    } stCatch(ex) {
+        freeCachedDB(database);
+        stThrow(ex);
+    } stTryEnd;
+    freeCachedDB(database);
+}
+
+static void deleteDB(stKVDatabase *database) {
+    stKVDatabase_deleteFromDisk(getCachedDB(database)->database);
+    freeCachedDB(database);
+}
+
+static void flush(stKVDatabase *database) {
+    CachedDB *cachedDB = getCachedDB(database);
+    flushWriteBuffer(cachedDB);
+    stKVDatabase_flush(cachedDB->database);
+}
+
+static bool containsRecord(stKVDatabase *database, int64_t key) {
+    CachedDB *cachedDB = getCachedDB(database);
+    return containsLocalRecord(cachedDB, key) || stKVDatabase_containsRecord(cachedDB->database, key);
+}
+
+static void insertRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    bufferWrite(getCachedDB(database), key, value, sizeOfRecord, INSERT);
+}
+
+static void updateRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    bufferWrite(getCachedDB(database), key, value, sizeOfRecord, UPDATE);
+}
+
+static void setRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    bufferWrite(getCachedDB(database), key, value, sizeOfRecord, SET);
+}
+
+static void bulkSetRecords(stKVDatabase *database, stList *records) {
+    CachedDB *cachedDB = getCachedDB(database);
+    for (int64_t i = 0; i < stList_length(records); i++) {
+        stKVDatabaseBulkRequest *request = stList_get(records, i);
+        bufferWrite(cachedDB, request->key, request->value, request->size, request->type);
+    }
+}
+
+static void insertInt64(stKVDatabase *database, int64_t key, int64_t value) {
+    CachedDB *cachedDB = getCachedDB(database);
+    writeThrough(cachedDB, key);
+    stKVDatabase_insertInt64(cachedDB->database, key, value);
+}
+
+static void updateInt64(stKVDatabase *database, int64_t key, int64_t value) {
+    CachedDB *cachedDB = getCachedDB(database);
+    writeThrough(cachedDB, key);
+    stKVDatabase_updateInt64(cachedDB->database, key, value);
+}
+
+static int64_t incrementInt64(stKVDatabase *database, int64_t key, int64_t incrementAmount) {
+    CachedDB *cachedDB = getCachedDB(database);
+    writeThrough(cachedDB, key);
+    return stKVDatabase_incrementInt64(cachedDB->database, key, incrementAmount);
+}
+
+static int64_t getInt64(stKVDatabase *database, int64_t key) {
+    CachedDB *cachedDB = getCachedDB(database);
+    writeThrough(cachedDB, key);
+    return stKVDatabase_getInt64(cachedDB->database, key);
+}
+
+static void removeRecord(stKVDatabase *database, int64_t key) {
+    CachedDB *cachedDB = getCachedDB(database);
+    if (removeLocalRecord(cachedDB, key)) {
+        stKVDatabase_removeRecord(cachedDB->database, key);
+    }
+}
+
+static void bulkRemoveRecords(stKVDatabase *database, stList *records) {
+    CachedDB *cachedDB = getCachedDB(database);
+    stList *toRemove = stList_construct();
+    for (int64_t i = 0; i < stList_length(records); i++) {
+        stIntTuple *tuple = stList_get(records, i);
+        if (removeLocalRecord(cachedDB, stIntTuple_get(tuple, 0))) {
+            stList_append(toRemove, tuple);
+        }
+    }
+    if (cachedDB->database->bulkRemoveRecords != NULL) {
+        stKVDatabase_bulkRemoveRecords(cachedDB->database, toRemove);
+    } else {
+        for (int64_t i = 0; i < stList_length(toRemove); i++) {
+            stKVDatabase_removeRecord(cachedDB->database, stIntTuple_get(stList_get(toRemove, i), 0));
+        }
+    }
+    stList_destruct(toRemove);
+}
+
+static int64_t numberOfRecords(stKVDatabase *database) {
+    CachedDB *cachedDB = getCachedDB(database);
+    flushWriteBuffer(cachedDB);
+    return stKVDatabase_getNumberOfRecords(cachedDB->database);
+}
+
+static void *getRecord2(stKVDatabase *database, int64_t key, int64_t *recordSize) {
+    CachedDB *cachedDB = getCachedDB(database);
+    void *record = getLocalRecord(cachedDB, key, recordSize);
+    if (record == NULL) {
+        record = stKVDatabase_getRecord2(cachedDB->database, key, recordSize);
+        if (record != NULL) {
+            cacheRecord(cachedDB, key, record, *recordSize);
+        }
+    }
+    return record;
+}
+
+static void *getRecord(stKVDatabase *database, int64_t key) {
+    int64_t i;
+    return getRecord2(database, key, &i);
+}
+
+static void *getPartialRecord(stKVDatabase *database, int64_t key, int64_t zeroBasedByteOffset, int64_t sizeInBytes,
+        int64_t recordSize) {
+    CachedDB *cachedDB = getCachedDB(database);
+    stKVDatabaseBulkRequest *request = getBufferedWrite(cachedDB, key);
+    if (request != NULL) {
+        if (zeroBasedByteOffset + sizeInBytes > request->size) {
+            stThrowNew(ST_KV_DATABASE_EXCEPTION_ID,
+                    "Partial record retrieval to out of bounds memory, record size: %" PRIi64, request->size);
+        }
+        return memcpy(st_malloc(sizeInBytes), (char *) request->value + zeroBasedByteOffset, sizeInBytes);
+    }
+    int64_t sizeRead;
+    void *record = stCache_getRecord(cachedDB->cache, key, RECORD_HEADER_SIZE + zeroBasedByteOffset, sizeInBytes,
+            &sizeRead);
+    if (record == NULL) {
+        record = stKVDatabase_getPartialRecord(cachedDB->database, key, zeroBasedByteOffset, sizeInBytes, recordSize);
+        if (record != NULL && sizeInBytes <= stCache_getMaxSize(cachedDB->cache)) {
+            stCache_setRecord(cachedDB->cache, key, RECORD_HEADER_SIZE + zeroBasedByteOffset, sizeInBytes, record);
+        }
+    }
+    return record;
+}
+
+static stList *bulkGetRecords(stKVDatabase *database, stList *keys) {
+    CachedDB *cachedDB = getCachedDB(database);
+    stList *results = stList_construct3(stList_length(keys), (void (*)(void *)) stKVDatabaseBulkResult_destruct);
+    stList *missingKeys = stList_construct();
+    stList *missingIndices = stList_construct3(0, (void (*)(void *)) stIntTuple_destruct);
+    for (int64_t i = 0; i < stList_length(keys); i++) {
+        int64_t key = *(int64_t *) stList_get(keys, i);
+        int64_t recordSize;
+        void *record = getLocalRecord(cachedDB, key, &recordSize);
+        if (record != NULL) {
+            stList_set(results, i, stKVDatabaseBulkResult_construct(record, recordSize));
+        } else {
+            stList_append(missingKeys, stList_get(keys, i));
+            stList_append(missingIndices, stIntTuple_constructInline1(i));
+        }
+    }
+    if (stList_length(missingKeys) > 0) {
+        stList *missingResults;
+        if (cachedDB->database->bulkGetRecords != NULL) {
+            missingResults = stKVDatabase_bulkGetRecords(cachedDB->database, missingKeys);
+        } else {
+            missingResults = stList_construct3(0, (void (*)(void *)) stKVDatabaseBulkResult_destruct);
+            for (int64_t i = 0; i < stList_length(missingKeys); i++) {
+                int64_t recordSize = 0;
+                void *record = stKVDatabase_getRecord2(cachedDB->database, *(int64_t *) stList_get(missingKeys, i),
+                        &recordSize);
+                stList_append(missingResults, stKVDatabaseBulkResult_construct(record, recordSize));
+            }
+        }
+        assert(stList_length(missingResults) == stList_length(missingKeys));
+        stList_setDestructor(missingResults, NULL); //The results are handed on
+        for (int64_t i = 0; i < stList_length(missingResults); i++) {
+            stKVDatabaseBulkResult *result = stList_get(missingResults, i);
+            if (result->value != NULL) {
+                cacheRecord(cachedDB, *(int64_t *) stList_get(missingKeys, i), result->value, result->size);
+            }
+            stList_set(results, stIntTuple_get(stList_get(missingIndices, i), 0), result);
+        }
+        stList_destruct(missingResults);
+    }
+    stList_destruct(missingKeys);
+    stList_destruct(missingIndices);
+    return results;
+}
+
+static stList *bulkGetRecordsRange(stKVDatabase *database, int64_t firstKey, int64_t numRecords) {
+    int64_t *keyArray = st_malloc(numRecords * sizeof(int64_t));
+    stList *keys = stList_construct2(numRecords);
+    for (int64_t i = 0; i < numRecords; i++) {
+        keyArray[i] = firstKey + i;
+        stList_set(keys, i, &keyArray[i]);
+    }
+    stList *results = bulkGetRecords(database, keys);
+    stList_destruct(keys);
+    free(keyArray);
+    return results;
+}
+
+static double getCompressionRatio(stKVDatabase *database) {
+    return stKVDatabase_getCompressionRatio(getCachedDB(database)->database);
+}
+
+void stKVDatabase_initialise_cache(stKVDatabase *database, stKVDatabase *wrappedDatabase, int64_t cacheSizeInBytes,
+        int64_t writeBufferSizeInBytes) {
+    CachedDB *cachedDB = st_malloc(sizeof(CachedDB));
+    cachedDB->database = wrappedDatabase;
+    cachedDB->cache = stCache_construct2(cacheSizeInBytes);
+    cachedDB->writeBuffer = constructWriteBuffer();
+    cachedDB->writeBufferSize = 0;
+    cachedDB->maxWriteBufferSize = writeBufferSizeInBytes;
+    database->dbImpl = cachedDB;
+    database->secondaryDB = NULL;
+    database->destruct = destructDB;
+    database->deleteDatabase = deleteDB;
+    database->flush = flush;
+    database->containsRecord = containsRecord;
+    database->insertRecord = insertRecord;
+    database->insertInt64 = insertInt64;
+    database->updateRecord = updateRecord;
+    database->updateInt64 = updateInt64;
+    database->setRecord = setRecord;
+    database->incrementInt64 = incrementInt64;
+    database->bulkSetRecords = bulkSetRecords;
+    database->bulkRemoveRecords = bulkRemoveRecords;
+    database->numberOfRecords = numberOfRecords;
+    database->getRecord = getRecord;
+    database->getInt64 = getInt64;
+    database->getRecord2 = getRecord2;
+    database->getPartialRecord = getPartialRecord;
+    database->bulkGetRecords = bulkGetRecords;
+    database->bulkGetRecordsRange = bulkGetRecordsRange;
+    database->removeRecord = removeRecord;
+    database->getCompressionRatio = getCompressionRatio;
+}
@@ -0,0 +1,441 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * sonLibKVDatabase_Compressed.c
+ *
+ * A database that wraps another, compressing records as they are written and
+ * decompressing them as they are read.
+ *
+ * A record is split into blocks of BLOCK_SIZE bytes that are compressed independently,
+ * so a partial read only decompresses the blocks it overlaps. The stored record is a
+ * header of the magic number, the size of the record, the block size and the number of
+ * blocks, followed by the offset of the end of each block from the end of the header,
+ * then the blocks. A block that does not compress is stored as it is, which is known by
+ * its stored size being the block size. Int64 records are passed straight through, and
+ * are read back as they are: a compressed record is never as small as an int64.
+ */
+
+#include <zlib.h>
+#include "lz4.h"
+#include "lz4hc.h"
+#include "sonLibGlobalsInternal.h"
+#include "sonLibKVDatabasePrivate.h"
+
+#define MAGIC_NUMBER ((int64_t) 0x315a564b7473) //"stKVZ1"
+#define BLOCK_SIZE ((int64_t) 65536)
+#define HEADER_SIZE ((int64_t) (4 * sizeof(int64_t)))
+
+typedef struct _compressedDB {
+    stKVDatabase *database; //The wrapped database.
+    stKVDatabaseCompression compression;
+    int64_t bytesWritten; //Total size of the records written, before compression.
+    int64_t compressedBytesWritten; //And after.
+} CompressedDB;
+
+static CompressedDB *getCompressedDB(stKVDatabase *database) {
+    return (CompressedDB *) database->dbImpl;
+}
+
+static int64_t readInt64(const char *buffer, int64_t i) {
+    int64_t j;
+    memcpy(&j, buffer + i * sizeof(int64_t), sizeof(int64_t));
+    return j;
+}
+
+static void writeInt64(char *buffer, int64_t i, int64_t j) {
+    memcpy(buffer + i * sizeof(int64_t), &j, sizeof(int64_t));
+}
+
+/*
+ * Compresses a block into dest, which has room for LZ4_compressBound(size) bytes, returning its
+ * compressed size, or 0 if it does not compress.
+ */
+static int64_t compressBlock(stKVDatabaseCompression compression, const char *block, int64_t size, char *dest) {
+    int64_t compressedSize = 0;
+    if (compression == stKVDatabaseCompressionLz4) {
+        compressedSize = LZ4_compress_limitedOutput(block, dest, size, size - 1);
+    } else if (compression == stKVDatabaseCompressionLz4hc) {
+        compressedSize = LZ4_compressHC2(block, dest, size, 0);
+    } else {
+        assert(compression == stKVDatabaseCompressionZlib);
+        uLongf destSize = LZ4_compressBound(size);
+        if (compress2((Bytef *) dest, &destSize, (const Bytef *) block, size, 1) == Z_OK) {
+            compressedSize = destSize;
+        }
+    }
+    return compressedSize < size ? compressedSize : 0;
+}
+
+static bool decompressBlock(stKVDatabaseCompression compression, const char *block, int64_t compressedSize,
+        char *dest, int64_t size) {
+    if (compressedSize == size) {
+        memcpy(dest, block, size);
+        return 1;
+    }
+    if (compression == stKVDatabaseCompressionZlib) {
+        uLongf destSize = size;
+        return uncompress((Bytef *) dest, &destSize, (const Bytef *) block, compressedSize) == Z_OK
+                && destSize == (uLongf) size;
+    }
+    return LZ4_uncompress_unknownOutputSize(block, dest, compressedSize, size) == size;
+}
+
+/*
+ * Returns the compressed form of the record, putting its size in compressedSize.
+ */
+static char *compressRecord(CompressedDB *compressedDB, const void *value, int64_t size, int64_t *compressedSize) {
+    int64_t numBlocks = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    int64_t dataStart = HEADER_SIZE + numBlocks * sizeof(int64_t);
+    char *record = st_malloc(dataStart + size + LZ4_compressBound(BLOCK_SIZE));
+    writeInt64(record, 0, MAGIC_NUMBER);
+    writeInt64(record, 1, size);
+    writeInt64(record, 2, BLOCK_SIZE);
+    writeInt64(record, 3, numBlocks);
+    int64_t offset = 0;
+    for (int64_t i = 0; i < numBlocks; i++) {
+        const char *block = (const char *) value + i * BLOCK_SIZE;
+        int64_t blockSize = i + 1 < numBlocks ? BLOCK_SIZE : size - i * BLOCK_SIZE;
+        //Blocks that don't compress are copied, so the blocks written so far are never bigger than the record.
+        int64_t blockCompressedSize = compressBlock(compressedDB->compression, block, blockSize,
+                record + dataStart + offset);
+        if (blockCompressedSize == 0) {
+            memcpy(record + dataStart + offset, block, blockSize);
+            blockCompressedSize = blockSize;
+        }
+        offset += blockCompressedSize;
+        writeInt64(record + HEADER_SIZE, i, offset);
+    }
+    *compressedSize = dataStart + offset;
+    compressedDB->bytesWritten += size;
+    compressedDB->compressedBytesWritten += *compressedSize;
+    return st_realloc(record, *compressedSize);
+}
+
+/*
+ * Decompresses the bytes [zeroBasedByteOffset, zeroBasedByteOffset + sizeInBytes) of the compressed record,
+ * where sizeInBytes may be -1 for the whole record, putting the record's size in recordSize.
+ */
+static void *decompressRecord(CompressedDB *compressedDB, int64_t key, const char *compressedRecord,
+        int64_t compressedSize, int64_t zeroBasedByteOffset, int64_t sizeInBytes, int64_t *recordSize) {
+    if (compressedSize == sizeof(int64_t)) { //An int64 record, which is stored uncompressed.
+        *recordSize = compressedSize;
+        if (sizeInBytes == -1) {
+            sizeInBytes = *recordSize;
+        }
+        if (zeroBasedByteOffset + sizeInBytes > *recordSize) {
+            stThrowNew(ST_KV_DATABASE_EXCEPTION_ID,
+                    "Partial record retrieval to out of bounds memory, record size: %lld", (long long) *recordSize);
+        }
+        char *record = st_malloc(sizeInBytes > 0 ? sizeInBytes : 1);
+        memcpy(record, compressedRecord + zeroBasedByteOffset, sizeInBytes);
+        return record;
+    }
+    if (compressedSize < HEADER_SIZE || readInt64(compressedRecord, 0) != MAGIC_NUMBER) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID,
+                "The record %lld is not compressed, was the database written without compression?",
+                (long long) key);
+    }
+    *recordSize = readInt64(compressedRecord, 1);
+    int64_t blockSize = readInt64(compressedRecord, 2), numBlocks = readInt64(compressedRecord, 3);
+    int64_t dataStart = HEADER_SIZE + numBlocks * sizeof(int64_t);
+    if (blockSize <= 0 || numBlocks != (*recordSize + blockSize - 1) / blockSize || dataStart > compressedSize) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "The compressed record %lld is corrupt", (long long) key);
+    }
+    if (sizeInBytes == -1) {
+        sizeInBytes = *recordSize;
+    }
+    if (zeroBasedByteOffset + sizeInBytes > *recordSize) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID,
+                "Partial record retrieval to out of bounds memory, record size: %lld", (long long) *recordSize);
+    }
+    char *record = st_malloc(sizeInBytes > 0 ? sizeInBytes : 1);
+    char *buffer = st_malloc(blockSize);
+    const char *offsets = compressedRecord + HEADER_SIZE;
+    for (int64_t i = zeroBasedByteOffset / blockSize; i * blockSize < zeroBasedByteOffset + sizeInBytes; i++) {
+        int64_t start = i > 0 ? readInt64(offsets, i - 1) : 0, end = readInt64(offsets, i);
+        int64_t size = i + 1 < numBlocks ? blockSize : *recordSize - i * blockSize;
+        if (start > end || dataStart + end > compressedSize
+                || !decompressBlock(compressedDB->compression, compressedRecord + dataStart + start, end - start,
+                        buffer, size)) {
+            free(buffer);
+            free(record);
+            stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "The compressed record %lld is corrupt", (long long) key);
+        }
+        //Copy the part of the block that overlaps the requested bytes.
+        int64_t from = zeroBasedByteOffset > i * blockSize ? zeroBasedByteOffset - i * blockSize : 0;
+        int64_t to = zeroBasedByteOffset + sizeInBytes < i * blockSize + size ?
+                zeroBasedByteOffset + sizeInBytes - i * blockSize : size;
+        memcpy(record + i * blockSize + from - zeroBasedByteOffset, buffer + from, to - from);
+    }
+    free(buffer);
+    return record;
+}
+
+static void freeCompressedDB(stKVDatabase *database) {
+    CompressedDB *compressedDB = getCompressedDB(database);
+    if (compressedDB->bytesWritten > 0) {
+        st_logInfo("Compressed %" PRIi64 " bytes of records to %" PRIi64 " bytes, a ratio of %f\n",
+                compressedDB->bytesWritten, compressedDB->compressedBytesWritten,
+                (double) compressedDB->compressedBytesWritten / compressedDB->bytesWritten);
+    }
+    stKVDatabase_destruct(compressedDB->database);
+    free(compressedDB);
+    database->dbImpl = NULL;
+}
+
+static void destructDB(stKVDatabase *database) {
+    freeCompressedDB(database);
+}
+
+static void deleteDB(stKVDatabase *database) {
+    stKVDatabase_deleteFromDisk(getCompressedDB(database)->database);
+    freeCompressedDB(database);
+}
+
+static void flush(stKVDatabase *database) {
+    stKVDatabase_flush(getCompressedDB(database)->database);
+}
+
+static bool containsRecord(stKVDatabase *database, int64_t key) {
+    return stKVDatabase_containsRecord(getCompressedDB(database)->database, key);
+}
+
+static void insertRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    CompressedDB *compressedDB = getCompressedDB(database);
+    int64_t compressedSize;
+    char *record = compressRecord(compressedDB, value, sizeOfRecord, &compressedSize);
+    stTry {
+        stKVDatabase_insertRecord(compressedDB->database, key, record, compressedSize);
+    } stCatch(ex) {
+        free(record);
+        stThrow(ex);
+    } stTryEnd;
+    free(record);
+}
+
+static void updateRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    CompressedDB *compressedDB = getCompressedDB(database);
+    int64_t compressedSize;
+    char *record = compressRecord(compressedDB, value, sizeOfRecord, &compressedSize);
+    stTry {
+        stKVDatabase_updateRecord(compressedDB->database, key, record, compressedSize);
+    } stCatch(ex) {
+        free(record);
+        stThrow(ex);
+    } stTryEnd;
+    free(record);
+}
+
+static void setRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    CompressedDB *compressedDB = getCompressedDB(database);
+    int64_t compressedSize;
+    char *record = compressRecord(compressedDB, value, sizeOfRecord, &compressedSize);
+    stTry {
+        stKVDatabase_setRecord(compressedDB->database, key, record, compressedSize);
+    } stCatch(ex) {
+        free(record);
+        stThrow(ex);
+    } stTryEnd;
+    free(record);
+}
+
+static void bulkSetRecords(stKVDatabase *database, stList *records) {
+    CompressedDB *compressedDB = getCompressedDB(database);
+    stList *compressedRecords = stList_construct3(stList_length(records),
+            (void (*)(void *)) stKVDatabaseBulkRequest_destruct);
+    for (int64_t i = 0; i < stList_length(records); i++) {
+        stKVDatabaseBulkRequest *request = stList_get(records, i);
+        stKVDatabaseBulkRequest *compressedRequest = st_malloc(sizeof(stKVDatabaseBulkRequest));
+        compressedRequest->key = request->key;
+        compressedRequest->type = request->type;
+        compressedRequest->value = compressRecord(compressedDB, request->value, request->size,
+                &compressedRequest->size);
+        stList_set(compressedRecords, i, compressedRequest);
+    }
+    stTry {
+        stKVDatabase_bulkSetRecords(compressedDB->database, compressedRecords);
+    } stCatch(ex) {
+        stList_destruct(compressedRecords);
+        stThrow(ex);
+    } stTryEnd;
+    stList_destruct(compressedRecords);
+}
+
+static void bulkRemoveRecords(stKVDatabase *database, stList *records) {
+    CompressedDB *compressedDB = getCompressedDB(database);
+    if (compressedDB->database->bulkRemoveRecords != NULL) {
+        stKVDatabase_bulkRemoveRecords(compressedDB->database, records);
+    } else {
+        for (int64_t i = 0; i < stList_length(records); i++) {
+            stKVDatabase_removeRecord(compressedDB->database, stIntTuple_get(stList_get(records, i), 0));
+        }
+    }
+}
+
+static void insertInt64(stKVDatabase *database, int64_t key, int64_t value) {
+    stKVDatabase_insertInt64(getCompressedDB(database)->database, key, value);
+}
+
+static void updateInt64(stKVDatabase *database, int64_t key, int64_t value) {
+    stKVDatabase_updateInt64(getCompressedDB(database)->database, key, value);
+}
+
+static int64_t incrementInt64(stKVDatabase *database, int64_t key, int64_t incrementAmount) {
+    return stKVDatabase_incrementInt64(getCompressedDB(database)->database, key, incrementAmount);
+}
+
+static int64_t getInt64(stKVDatabase *database, int64_t key) {
+    return stKVDatabase_getInt64(getCompressedDB(database)->database, key);
+}
+
+static void removeRecord(stKVDatabase *database, int64_t key) {
+    stKVDatabase_removeRecord(getCompressedDB(database)->database, key);
+}
+
+static int64_t numberOfRecords(stKVDatabase *database) {
+    return stKVDatabase_getNumberOfRecords(getCompressedDB(database)->database);
+}
+
+/*
+ * Reads the compressed record through a view, so that file based databases only read
+ * the parts of a big record that are decompressed.
+ */
+static void *getPartialRecord2(stKVDatabase *database, int64_t key, int64_t zeroBasedByteOffset,
+        int64_t sizeInBytes, int64_t *recordSize) {
+    CompressedDB *compressedDB = getCompressedDB(database);
+    stKVDatabaseRecordView *view = stKVDatabase_getRecordView(compressedDB->database, key);
+    if (view == NULL) {
+        return NULL;
+    }
+    int64_t compressedSize;
+    const char *compressedRecord = stKVDatabaseRecordView_getRecord(view, &compressedSize);
+    void *record = NULL;
+    stTry {
+        record = decompressRecord(compressedDB, key, compressedRecord, compressedSize, zeroBasedByteOffset,
+                sizeInBytes, recordSize);
+    } stCatch(ex) {
+        stKVDatabaseRecordView_destruct(view);
+        stThrow(ex);
+    } stTryEnd;
+    stKVDatabaseRecordView_destruct(view);
+    return record;
+}
+
+static void *getRecord2(stKVDatabase *database, int64_t key, int64_t *recordSize) {
+    return getPartialRecord2(database, key, 0, -1, recordSize);
+}
+
+static void *getRecord(stKVDatabase *database, int64_t key) {
+    int64_t i;
+    return getRecord2(database, key, &i);
+}
+
+static void *getPartialRecord(stKVDatabase *database, int64_t key, int64_t zeroBasedByteOffset, int64_t sizeInBytes,
+        int64_t recordSize) {
+    int64_t recordSize2;
+    void *record = getPartialRecord2(database, key, zeroBasedByteOffset, sizeInBytes, &recordSize2);
+    if (record == NULL) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "The record does not exist: %lld for partial retrieval",
+                (long long) key);
+    }
+    if (recordSize2 != recordSize) {
+        free(record);
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "The given record size is incorrect: %lld, should be %lld",
+                (long long) recordSize, (long long) recordSize2);
+    }
+    return record;
+}
+
+/*
+ * Decompresses each of the results in place.
+ */
+static stList *decompressResults(CompressedDB *compressedDB, stList *keys, stList *results) {
+    for (int64_t i = 0; i < stList_length(results); i++) {
+        stKVDatabaseBulkResult *result = stList_get(results, i);
+        if (result->value != NULL) {
+            int64_t recordSize;
+            void *record = NULL;
+            stTry {
+                record = decompressRecord(compressedDB, *(int64_t *) stList_get(keys, i), result->value,
+                        result->size, 0, -1, &recordSize);
+            } stCatch(ex) {
+                stList_destruct(results);
+                stThrow(ex);
+            } stTryEnd;
+            free(result->value);
+            result->value = record;
+            result->size = recordSize;
+        }
+    }
+    return results;
+}
+
+static stList *bulkGetRecords(stKVDatabase *database, stList *keys) {
+    CompressedDB *compressedDB = getCompressedDB(database);
+    stList *results;
+    if (compressedDB->database->bulkGetRecords != NULL) {
+        results = stKVDatabase_bulkGetRecords(compressedDB->database, keys);
+    } else {
+        results = stList_construct3(0, (void (*)(void *)) stKVDatabaseBulkResult_destruct);
+        for (int64_t i = 0; i < stList_length(keys); i++) {
+            int64_t recordSize = 0;
+            void *record = stKVDatabase_getRecord2(compressedDB->database, *(int64_t *) stList_get(keys, i),
+                    &recordSize);
+            stList_append(results, stKVDatabaseBulkResult_construct(record, recordSize));
+        }
+    }
+    return decompressResults(compressedDB, keys, results);
+}
+
+static stList *bulkGetRecordsRange(stKVDatabase *database, int64_t firstKey, int64_t numRecords) {
+    int64_t *keyArray = st_malloc(numRecords * sizeof(int64_t));
+    stList *keys = stList_construct2(numRecords);
+    for (int64_t i = 0; i < numRecords; i++) {
+        keyArray[i] = firstKey + i;
+        stList_set(keys, i, &keyArray[i]);
+    }
+    stList *results = bulkGetRecords(database, keys);
+    stList_destruct(keys);
+    free(keyArray);
+    return results;
+}
+
+static double getCompressionRatio(stKVDatabase *database) {
+    CompressedDB *compressedDB = getCompressedDB(database);
+    return compressedDB->bytesWritten > 0 ?
+            (double) compressedDB->compressedBytesWritten / compressedDB->bytesWritten : 1.0;
+}
+
+void stKVDatabase_initialise_compressed(stKVDatabase *database, stKVDatabase *wrappedDatabase,
+        stKVDatabaseCompression compression) {
+    CompressedDB *compressedDB = st_calloc(1, sizeof(CompressedDB));
+    compressedDB->database = wrappedDatabase;
+    compressedDB->compression = compression;
+    database->dbImpl = compressedDB;
+    database->secondaryDB = NULL;
+    database->destruct = destructDB;
+    database->deleteDatabase = deleteDB;
+    database->flush = flush;
+    database->containsRecord = containsRecord;
+    database->insertRecord = insertRecord;
+    database->insertInt64 = insertInt64;
+    database->updateRecord = updateRecord;
+    database->updateInt64 = updateInt64;
+    database->setRecord = setRecord;
+    database->incrementInt64 = incrementInt64;
+    database->bulkSetRecords = bulkSetRecords;
+    database->bulkRemoveRecords = bulkRemoveRecords;
+    database->numberOfRecords = numberOfRecords;
+    database->getRecord = getRecord;
+    database->getInt64 = getInt64;
+    database->getRecord2 = getRecord2;
+    database->getPartialRecord = getPartialRecord;
+    database->bulkGetRecords = bulkGetRecords;
+    database->bulkGetRecordsRange = bulkGetRecordsRange;
+    database->removeRecord = removeRecord;
+    database->getCompressionRatio = getCompressionRatio;
+}
@@ -31,11 +31,14 @@
 //Database functions
 #ifdef HAVE_KYOTO_TYCOON
 #include <unistd.h>
+#include <pthread.h>
 #include <ktremotedb.h>
 #include <kclangc.h>
 #include <algorithm>
+#include <map>
 #include "sonLibGlobalsInternal.h"
 #include "sonLibKVDatabasePrivate.h"
+#include "stThreadPool.h"
 
 using namespace std;
 using namespace kyototycoon;
@@ -45,15 +48,40 @@ using namespace kyototycoon;
 int64_t XT = kc::INT64MAX;
 
 /*
- * construct in the Kyoto Tycoon case means connect to the remote DB
-*/
-static RemoteDB *constructDB(stKVDatabaseConf *conf, bool create) {
+ * the number of batches of a bulk set that are sent at once, each over its
+ * own connection.
+ */
+#define BULK_SET_CONNECTIONS 4
 
-    // we actually do need a local DB dir for Kyoto Tycoon to store the sequences file
-    const char *dbDir = stKVDatabaseConf_getDir(conf);
-    mkdir(dbDir, S_IRWXU); // just let open of database generate error (FIXME: would be better to make this report errors)
+typedef struct _ktDB {
+	RemoteDB *rdb; // used for everything but the batches of bulk sets
+	// the connections used by bulk sets, opened on the first one
+	stThreadPool *bulkSetThreadPool;
+	vector<RemoteDB *> freeBulkSetConnections;
+	pthread_mutex_t bulkSetConnectionsLock;
+} KTDB;
+
+/*
+ * a batch of records for a single set_bulk_binary call
+ */
+typedef struct _bulkSetBatch {
+	KTDB *ktDB;
+	vector<RemoteDB::BulkRecord> recs;
+	string error; // empty unless the set failed
+} BulkSetBatch;
+
+static KTDB *getKTDB(stKVDatabase *database) {
+	return (KTDB *)database->dbImpl;
+}
 
+static RemoteDB *getRemoteDB(stKVDatabase *database) {
+	return getKTDB(database)->rdb;
+}
 
+/*
+ * open a connection to the remote DB
+*/
+static RemoteDB *openConnection(stKVDatabaseConf *conf) {
     const char *dbRemote_Host = stKVDatabaseConf_getHost(conf);
     unsigned dbRemote_Port = stKVDatabaseConf_getPort(conf);
     int timeout = stKVDatabaseConf_getTimeout(conf);
@@ -69,6 +97,33 @@ static RemoteDB *constructDB(stKVDatabaseConf *conf, bool create) {
     return rdb;
 }
 
+static void closeConnection(RemoteDB *rdb) {
+    // close the connection: first try a graceful close, then a forced close
+    if (!rdb->close(true)) {
+        if (!rdb->close(false)) {
+            stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Closing database error: %s",rdb->error().name());
+        }
+    }
+    // delete the local in-memory object
+    delete rdb;
+}
+
+/*
+ * construct in the Kyoto Tycoon case means connect to the remote DB
+*/
+static KTDB *constructDB(stKVDatabaseConf *conf, bool create) {
+
+    // we actually do need a local DB dir for Kyoto Tycoon to store the sequences file
+    const char *dbDir = stKVDatabaseConf_getDir(conf);
+    mkdir(dbDir, S_IRWXU); // just let open of database generate error (FIXME: would be better to make this report errors)
+
+    KTDB *ktDB = new KTDB();
+    ktDB->rdb = openConnection(conf);
+    ktDB->bulkSetThreadPool = NULL;
+    pthread_mutex_init(&ktDB->bulkSetConnectionsLock, NULL);
+    return ktDB;
+}
+
 static stKVDatabase* constructBigRecordDB(stKVDatabaseConf *conf, bool create) {
 	if (stKVDatabaseConf_getMaxKTRecordSize(conf) != kc::INT64MAX) {
 		// warning: bypassing stKVDatabase_construct()
@@ -84,18 +139,19 @@ static stKVDatabase* constructBigRecordDB(stKVDatabaseConf *conf, bool create) {
 /* closes the remote DB connection and deletes the rdb object, but does not destroy the 
 remote database */
 static void destructDB(stKVDatabase *database) {
-    RemoteDB *rdb = (RemoteDB*)database->dbImpl;
-    if (rdb != NULL) {
-
-        // close the connection: first try a graceful close, then a forced close
-        if (!rdb->close(true)) {
-            if (!rdb->close(false)) {
-                stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Closing database error: %s",rdb->error().name());
+    KTDB *ktDB = getKTDB(database);
+    if (ktDB != NULL) {
+        database->dbImpl = NULL;
+        if (ktDB->bulkSetThreadPool != NULL) {
+            stThreadPool_destruct(ktDB->bulkSetThreadPool);
+            for (size_t i = 0; i < ktDB->freeBulkSetConnections.size(); i++) {
+                closeConnection(ktDB->freeBulkSetConnections[i]);
             }
         }
-        // delete the local in-memory object
-        delete rdb; 
-        database->dbImpl = NULL;
+        pthread_mutex_destroy(&ktDB->bulkSetConnectionsLock);
+        RemoteDB *rdb = ktDB->rdb;
+        delete ktDB;
+        closeConnection(rdb);
     }
     if (database->secondaryDB != NULL) {
     	stKVDatabase_destruct(database->secondaryDB);
@@ -104,9 +160,8 @@ static void destructDB(stKVDatabase *database) {
 
 /* WARNING: removes all records from the remote database */
 static void deleteDB(stKVDatabase *database) {
-    RemoteDB *rdb = (RemoteDB *)database->dbImpl;
-    if (rdb != NULL) {
-        rdb->clear();
+    if (getKTDB(database) != NULL) {
+        getRemoteDB(database)->clear();
     }
     if (database->secondaryDB != NULL) {
     	database->secondaryDB->deleteDatabase(database->secondaryDB);
@@ -118,13 +173,13 @@ static void deleteDB(stKVDatabase *database) {
 
 /* check if a record already exists in the kt database*/
 static bool recordInTycoon(stKVDatabase *database, int64_t key) {
-	RemoteDB *rdb = (RemoteDB *)database->dbImpl;
+	RemoteDB *rdb = getRemoteDB(database);
     size_t sp;
     char *cA;
     if ((cA = rdb->get((char *)&key, (size_t)sizeof(key), &sp, NULL)) == NULL) {
         return false;
     } else {
-        delete cA;
+        delete[] cA;
         return true;
     }
 }
@@ -145,7 +200,7 @@ static bool recordOnDisk(stKVDatabase *database, int64_t key)
 static void removeRecordFromTycoonIfPresent(stKVDatabase *database, int64_t key)
 {
 	if (recordInTycoon(database, key) == true) {
-		RemoteDB *rdb = (RemoteDB *)database->dbImpl;
+		RemoteDB *rdb = getRemoteDB(database);
 		if (!rdb->remove((char *)&key, (size_t)sizeof(int64_t))) {
 			stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Removing key/value to database error: %s", rdb->error().name());
 		}
@@ -184,7 +239,7 @@ static void insertRecord(stKVDatabase *database, int64_t key, const void *value,
 	else
 	{
 		removeRecordFromDiskIfPresent(database, key);
-		RemoteDB *rdb = (RemoteDB *)database->dbImpl;
+		RemoteDB *rdb = getRemoteDB(database);
 
 		size_t sizeOfKey = sizeof(int64_t);
 		// add method: If the key already exists the record will not be modified and it'll return false
@@ -195,7 +250,7 @@ static void insertRecord(stKVDatabase *database, int64_t key, const void *value,
 }
 
 static void insertInt64(stKVDatabase *database, int64_t key, int64_t value) {
-    RemoteDB *rdb = (RemoteDB *)database->dbImpl;
+    RemoteDB *rdb = getRemoteDB(database);
 
     // Normalize a 64-bit number in the native order into the network byte order.
     // little endian (our x86 linux machine) to big Endian....
@@ -207,7 +262,7 @@ static void insertInt64(stKVDatabase *database, int64_t key, int64_t value) {
 }
 
 static void updateInt64(stKVDatabase *database, int64_t key, int64_t value) {
-    RemoteDB *rdb = (RemoteDB *)database->dbImpl;
+    RemoteDB *rdb = getRemoteDB(database);
 
     // Normalize a 64-bit number in the native order into the network byte order.
     // little endian (our x86 linux machine) to big Endian....
@@ -230,7 +285,7 @@ static void updateRecord(stKVDatabase *database, int64_t key, const void *value,
 	else
 	{
 		removeRecordFromDiskIfPresent(database, key);
-		RemoteDB *rdb = (RemoteDB *)database->dbImpl;
+		RemoteDB *rdb = getRemoteDB(database);
 		// replace method: If the key doesn't already exist it won't be created, and we'll get an error
 		if (!rdb->replace((char *)&key, (size_t)sizeof(int64_t), (const char *)value, sizeOfRecord)) {
 			stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Updating key/value to database error: %s", rdb->error().name());
@@ -250,7 +305,7 @@ static void setRecord(stKVDatabase *database, int64_t key, const void *value, in
 	else
 	{
 		removeRecordFromDiskIfPresent(database, key);
-		RemoteDB *rdb = (RemoteDB *)database->dbImpl;
+		RemoteDB *rdb = getRemoteDB(database);
 		if (!rdb->set((char *)&key, (size_t)sizeof(int64_t), (const char *)value, sizeOfRecord)) {
 			stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "kyoto tycoon setting key/value failed: %s", rdb->error().name());
 		}
@@ -260,7 +315,7 @@ static void setRecord(stKVDatabase *database, int64_t key, const void *value, in
 /* increment a record by the specified numerical value: atomic operation */
 /* return the new record value */
 static int64_t incrementInt64(stKVDatabase *database, int64_t key, int64_t incrementAmount) {
-    RemoteDB *rdb = (RemoteDB *)database->dbImpl;
+    RemoteDB *rdb = getRemoteDB(database);
     int64_t returnValue = kyotocabinet::INT64MIN;
 
     size_t sizeOfKey = sizeof(int64_t);
@@ -272,68 +327,153 @@ static int64_t incrementInt64(stKVDatabase *database, int64_t key, int64_t incre
     return returnValue;
 }
 
-// sets a bulk list of records atomically 
+/*
+ * send a batch of a bulk set over a free connection, run by the bulk set
+ * thread pool.  errors are left in the batch, as exceptions can't be
+ * thrown from the pool's threads.
+ */
+static void *setBulkSetBatch(void *arg) {
+	BulkSetBatch *batch = (BulkSetBatch *)arg;
+	KTDB *ktDB = batch->ktDB;
+	pthread_mutex_lock(&ktDB->bulkSetConnectionsLock);
+	assert(ktDB->freeBulkSetConnections.empty() == false);
+	RemoteDB *rdb = ktDB->freeBulkSetConnections.back();
+	ktDB->freeBulkSetConnections.pop_back();
+	pthread_mutex_unlock(&ktDB->bulkSetConnectionsLock);
+
+	if (rdb->set_bulk_binary(batch->recs) < 1) {
+		assert(rdb->error().name() != NULL);
+		batch->error = rdb->error().name();
+	}
+
+	pthread_mutex_lock(&ktDB->bulkSetConnectionsLock);
+	ktDB->freeBulkSetConnections.push_back(rdb);
+	pthread_mutex_unlock(&ktDB->bulkSetConnectionsLock);
+	return NULL;
+}
+
+static stThreadPool *getBulkSetThreadPool(stKVDatabase *database) {
+	KTDB *ktDB = getKTDB(database);
+	if (ktDB->bulkSetThreadPool == NULL) {
+		for (int64_t i = 0; i < BULK_SET_CONNECTIONS; i++) {
+			ktDB->freeBulkSetConnections.push_back(openConnection(stKVDatabase_getConf(database)));
+		}
+		ktDB->bulkSetThreadPool = stThreadPool_construct(BULK_SET_CONNECTIONS, setBulkSetBatch, NULL);
+	}
+	return ktDB->bulkSetThreadPool;
+}
+
+/*
+ * the last request for each key in a bulk set, in list order, so that the
+ * batches of a bulk set never hold two writes of the same key.
+ */
+static vector<stKVDatabaseBulkRequest *> getLastRequests(stList *records) {
+	map<int64_t, int64_t> lastIndex;
+	for(int64_t i=0; i<stList_length(records); i++) {
+		lastIndex[((stKVDatabaseBulkRequest *)stList_get(records, i))->key] = i;
+	}
+	vector<stKVDatabaseBulkRequest *> requests;
+	requests.reserve(lastIndex.size());
+	for(int64_t i=0; i<stList_length(records); i++) {
+		stKVDatabaseBulkRequest *request = (stKVDatabaseBulkRequest *)stList_get(records, i);
+		if (lastIndex[request->key] == i) {
+			requests.push_back(request);
+		}
+	}
+	return requests;
+}
+
+/*
+ * sets records too big for kt in the secondary, and removes from the secondary
+ * those going to kt.  run while the batches are sent: as no key is both in a
+ * batch and too big for kt, the two never touch the same key.
+ */
+static void setSecondaryRecords(stKVDatabase *database, const vector<stKVDatabaseBulkRequest *> &requests,
+		int64_t maxRecordSize) {
+	for(size_t i=0; i<requests.size(); i++) {
+		stKVDatabaseBulkRequest *request = requests[i];
+		if (request->size > maxRecordSize) {
+			assert(database->secondaryDB != NULL);
+			removeRecordFromTycoonIfPresent(database, request->key);
+			database->secondaryDB->setRecord(database->secondaryDB, request->key, request->value, request->size);
+		}
+		else {
+			removeRecordFromDiskIfPresent(database, request->key);
+		}
+	}
+}
+
+// sets a bulk list of records, sending several batches at once.  only the last
+// request for each key is sent, so the batches can be sent in any order.
 static void bulkSetRecords(stKVDatabase *database, stList *records) {
 	stKVDatabaseConf* conf = stKVDatabase_getConf(database);
 	int64_t maxRecordSize = stKVDatabaseConf_getMaxKTRecordSize(conf);
 	int64_t maxBulkSetSize = stKVDatabaseConf_getMaxKTBulkSetSize(conf);
 	int64_t maxBulkSetNumRecords = stKVDatabaseConf_getMaxKTBulkSetNumRecords(conf);
-    RemoteDB *rdb = (RemoteDB *)database->dbImpl;
-    vector<RemoteDB::BulkRecord> recs;
-    recs.reserve(stList_length(records));
-    RemoteDB::BulkRecord templateRec;
-    templateRec.dbidx = 0;
-    templateRec.xt = XT;
-    int64_t runningSize = 0;
-
-    // copy the records from our C data structure to the CPP map needed for the Tycoon API
-    for(int32_t i=0; i<stList_length(records); i++) {
-        stKVDatabaseBulkRequest *request = (stKVDatabaseBulkRequest *)stList_get(records, i);
-
-        // current batch can't get any bigger so we write and clear it
-        if ((runningSize + request->size > maxBulkSetSize ||
-        	 (int64_t)recs.size() >= maxBulkSetNumRecords) && recs.empty() == false) {
-        	int64_t retVal = rdb->set_bulk_binary(recs);
-			if (retVal < 1) {
-				assert(rdb->error().name() != NULL);
-				fprintf(stderr, "Throwing an exception with the string %s\n", rdb->error().name());
-				stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "kyoto tycoon set bulk record failed: %s", rdb->error().name());
-			}
-			recs.clear();
+	vector<stKVDatabaseBulkRequest *> requests = getLastRequests(records);
+
+	vector<BulkSetBatch *> batches;
+	BulkSetBatch *batch = NULL;
+	int64_t runningSize = 0;
+
+	// split the records into batches, building each record in place in its batch
+	for(size_t i=0; i<requests.size(); i++) {
+		stKVDatabaseBulkRequest *request = requests[i];
+		if (request->size > maxRecordSize) {
+			continue;
+		}
+		// current batch can't get any bigger so we start another
+		if (batch == NULL || ((runningSize + request->size > maxBulkSetSize ||
+				(int64_t)batch->recs.size() >= maxBulkSetNumRecords) && batch->recs.empty() == false)) {
+			batch = new BulkSetBatch();
+			batch->ktDB = getKTDB(database);
+			batches.push_back(batch);
 			runningSize = 0;
-        }
-        // record too big for kt, we put in the secondary
-        if (request->size > maxRecordSize) {
-        	assert(database->secondaryDB != NULL);
-        	removeRecordFromTycoonIfPresent(database, request->key);
-        	database->secondaryDB->setRecord(database->secondaryDB, request->key, request->value, request->size);
-        }
-        else
-        {
-        	removeRecordFromDiskIfPresent(database, request->key);
-        	templateRec.key = string((const char *)&(request->key), sizeof(int64_t));
-        	templateRec.value = string((const char *)request->value, request->size);
-        	recs.push_back(templateRec);
-			runningSize += request->size;
-        }
-    }
+		}
+		batch->recs.resize(batch->recs.size() + 1);
+		RemoteDB::BulkRecord &rec = batch->recs.back();
+		rec.dbidx = 0;
+		rec.xt = XT;
+		rec.key.assign((const char *)&(request->key), sizeof(int64_t));
+		rec.value.assign((const char *)request->value, request->size);
+		runningSize += request->size;
+	}
 
-    // test for empty list   
-    if (recs.empty() == false) {
-		// set values, atomic = true
-		int64_t retVal = rdb->set_bulk_binary(recs);
-		if (retVal < 1) {
-			assert(rdb->error().name() != NULL);
-			fprintf(stderr, "Throwing an exception with the string %s\n", rdb->error().name());
-			stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "kyoto tycoon set bulk record failed: %s", rdb->error().name());
+	stThreadPool *threadPool = batches.empty() ? NULL : getBulkSetThreadPool(database);
+	for (size_t i = 0; i < batches.size(); i++) {
+		stThreadPool_push(threadPool, batches[i]);
+	}
+	stTry {
+		setSecondaryRecords(database, requests, maxRecordSize);
+	} stCatch(except) {
+		if (threadPool != NULL) {
+			stThreadPool_wait(threadPool);
 		}
-    }
-    //printf("size of insert: %d\n", retVal);
+		for (size_t i = 0; i < batches.size(); i++) {
+			delete batches[i];
+		}
+		stThrow(except);
+	} stTryEnd;
+	if (threadPool == NULL) {
+		return;
+	}
+	stThreadPool_wait(threadPool);
+
+	string error;
+	for (size_t i = 0; i < batches.size(); i++) {
+		if (error.empty()) {
+			error = batches[i]->error;
+		}
+		delete batches[i];
+	}
+	if (error.empty() == false) {
+		stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "kyoto tycoon set bulk record failed: %s", error.c_str());
+	}
 }
 
 // remove a bulk list atomically 
 static void bulkRemoveRecords(stKVDatabase *database, stList *records) {
-    RemoteDB *rdb = (RemoteDB *)database->dbImpl;
+    RemoteDB *rdb = getRemoteDB(database);
     vector<string> keys;
 
 	for(int32_t i=0; i<stList_length(records); i++) {
@@ -357,7 +497,7 @@ static void bulkRemoveRecords(stKVDatabase *database, stList *records) {
 }
 
 static int64_t numberOfRecords(stKVDatabase *database) {
-    RemoteDB *rdb = (RemoteDB *)database->dbImpl;
+    RemoteDB *rdb = getRemoteDB(database);
     int64_t count = rdb->count();
     if (database->secondaryDB != NULL) {
     	count += database->secondaryDB->numberOfRecords(database->secondaryDB);
@@ -373,13 +513,13 @@ static void *getRecord2(stKVDatabase *database, int64_t key, int64_t *recordSize
 	}
 	else if (recordInTycoon(database, key) == true)
 	{
-		RemoteDB *rdb = (RemoteDB *)database->dbImpl;
+		RemoteDB *rdb = getRemoteDB(database);
 		//Return value must be freed.
 		size_t i;
 		char* newRecord = rdb->get((char *)&key, (size_t)sizeof(int64_t), &i, NULL);
 		*recordSize = (int64_t)i;
 		record = (char*)memcpy(st_malloc(*recordSize), newRecord, *recordSize);
-		delete newRecord;
+		delete[] newRecord;
 	}
         
     return record;
@@ -393,12 +533,12 @@ static void *getRecord(stKVDatabase *database, int64_t key) {
 
 /* get a single non-string record */
 static int64_t getInt64(stKVDatabase *database, int64_t key) {
-    RemoteDB *rdb = (RemoteDB *)database->dbImpl;
+    RemoteDB *rdb = getRemoteDB(database);
 
     size_t sp;
     char *newRecord = rdb->get((char *)&key, sizeof(int64_t), &sp, NULL);
     char* record = (char*)memcpy(st_malloc( sizeof(int64_t)), newRecord,  sizeof(int64_t));
-    delete newRecord;
+    delete[] newRecord;
 
     // convert from KC native big-endian back to little-endian Intel...
     return kyotocabinet::ntoh64(*((int64_t*)record));
@@ -436,13 +576,38 @@ static void *getPartialRecord(stKVDatabase *database, int64_t key, int64_t zeroB
 	}
 }
 
+/* records too big for tycoon are mapped from their files, others are copied */
+static stKVDatabaseRecordView *getRecordView(stKVDatabase *database, int64_t key) {
+	if (recordOnDisk(database, key) == true)
+	{
+		return database->secondaryDB->getRecordView(database->secondaryDB, key);
+	}
+	int64_t recordSize;
+	void *record = getRecord2(database, key, &recordSize);
+	return record == NULL ? NULL : stKVDatabaseRecordView_constructCopy(record, recordSize);
+}
+
+static stKVDatabaseRecordView *getPartialRecordView(stKVDatabase *database, int64_t key, int64_t zeroBasedByteOffset, int64_t sizeInBytes, int64_t recordSize) {
+	stKVDatabaseConf* conf = stKVDatabase_getConf(database);
+	if (recordSize > stKVDatabaseConf_getMaxKTRecordSize(conf))
+	{
+		assert (database->secondaryDB != NULL);
+		if (recordOnDisk(database, key) == false)
+		{
+			stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "The record does not exist: %lld for partial retrieval", (long long)key);
+		}
+		return database->secondaryDB->getPartialRecordView(database->secondaryDB, key, zeroBasedByteOffset, sizeInBytes, recordSize);
+	}
+	return stKVDatabaseRecordView_constructCopy(getPartialRecord(database, key, zeroBasedByteOffset, sizeInBytes, recordSize), sizeInBytes);
+}
+
 /* do a bulk get based on a list of keys.  */
 static stList *bulkGetRecords(stKVDatabase *database, stList* keys)
 {
 	stKVDatabaseConf* conf = stKVDatabase_getConf(database);
 	int64_t maxBulkSetNumRecords = stKVDatabaseConf_getMaxKTBulkSetNumRecords(conf);
 	int32_t n = stList_length(keys);
-	RemoteDB *rdb = (RemoteDB *)database->dbImpl;
+	RemoteDB *rdb = getRemoteDB(database);
 	RemoteDB::BulkRecord templateRec;
 	templateRec.dbidx = 0;
 	templateRec.xt = XT;
@@ -481,9 +646,14 @@ static stList *bulkGetRecords(stKVDatabase *database, stList* keys)
 				if (stList_get(results, j) == NULL)
 				{
 					RemoteDB::BulkRecord& curRecord = recs.at(recIdx++);
-					int64_t recordSize = curRecord.value.length() * sizeof(char);
-					void* record = st_malloc(recordSize);
-					memcpy(record, curRecord.value.data(), recordSize);
+					void* record = NULL;
+					int64_t recordSize = 0;
+					if (curRecord.xt >= 0) // missing records have a negative xt
+					{
+						recordSize = curRecord.value.length() * sizeof(char);
+						record = st_malloc(recordSize);
+						memcpy(record, curRecord.value.data(), recordSize);
+					}
 					stKVDatabaseBulkResult* result = stKVDatabaseBulkResult_construct(record, recordSize);
 					stList_set(results, j, result);
 				}
@@ -515,7 +685,7 @@ static stList *bulkGetRecordsRange(stKVDatabase *database, int64_t firstKey, int
 	}
 	if (keysVec.empty() == false)
 	{
-		RemoteDB *rdb = (RemoteDB *)database->dbImpl;
+		RemoteDB *rdb = getRemoteDB(database);
 		map<string, string> recs;
 		int64_t retVal = rdb->get_bulk(keysVec, &recs);
 		if (retVal < 0)
@@ -553,7 +723,7 @@ static void removeRecord(stKVDatabase *database, int64_t key) {
 	}
 	else
 	{
-		RemoteDB *rdb = (RemoteDB *)database->dbImpl;
+		RemoteDB *rdb = getRemoteDB(database);
 		if (!rdb->remove((char *)&key, (size_t)sizeof(int64_t))) {
 			stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Removing key/value to database error: %s", rdb->error().name());
 		}
@@ -583,6 +753,8 @@ void stKVDatabase_initialise_kyotoTycoon(stKVDatabase *database, stKVDatabaseCon
     database->bulkGetRecords = bulkGetRecords;
     database->bulkGetRecordsRange = bulkGetRecordsRange;
     database->removeRecord = removeRecord;
+    database->getRecordView = getRecordView;
+    database->getPartialRecordView = getPartialRecordView;
 }
 
 #endif
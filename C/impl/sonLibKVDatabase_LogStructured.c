@@ -0,0 +1,655 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * sonLibKVDatabase_LogStructured.c
+ *
+ * A database held in a single file in the database directory, to which every write is
+ * appended as an entry: the key, the size of the value (or -1 if the entry removes the
+ * record) then the value. An in memory hash of the keys gives the entry holding the current
+ * value of each record, and is rebuilt by reading through the file when the database is
+ * opened. Writes are gathered in a buffer before being written to the file. Once the space
+ * taken by superseded entries is larger than that of the current ones the file is rewritten,
+ * in key order, with just the current entries. As bytes in the file are never overwritten,
+ * big values can be viewed by mapping them into memory, and the views stay valid.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include "sonLibGlobalsInternal.h"
+#include "sonLibKVDatabasePrivate.h"
+#include "sonLibString.h"
+
+#define LOG_FILE_NAME "data.log"
+#define LOG_MAGIC "stKVLog1"
+#define LOG_MAGIC_SIZE 8
+#define ENTRY_HEADER_SIZE ((int64_t) (2 * sizeof(int64_t)))
+#define REMOVED_RECORD_SIZE -1
+#define WRITE_BUFFER_SIZE (1 << 20)
+/*
+ * The file is only compacted once there are at least this many bytes of superseded entries.
+ */
+#define MIN_COMPACTION_GARBAGE ((int64_t) 1 << 24)
+/*
+ * Views of smaller values are copies, as mapping them would cost more than copying.
+ */
+#define MIN_MAPPED_VIEW_SIZE ((int64_t) 1 << 16)
+
+typedef struct _logRecord {
+    int64_t key;
+    int64_t offset; //Offset of the record's entry in the log.
+    int64_t size; //Size of the value.
+} LogRecord;
+
+typedef struct _logDB {
+    char *logPath;
+    int fd;
+    stHash *index; //The LogRecords, keyed by themselves.
+    int64_t fileSize; //The number of bytes written to the file.
+    char *writeBuffer; //Entries following the end of the file, yet to be written.
+    int64_t writeBufferLength;
+    int64_t liveBytes; //Size of the entries of the records in the index.
+} LogDB;
+
+static uint64_t logRecord_hashKey(const void *record) {
+    return (uint64_t) ((const LogRecord *) record)->key;
+}
+
+static int logRecord_equalKey(const void *record1, const void *record2) {
+    return ((const LogRecord *) record1)->key == ((const LogRecord *) record2)->key;
+}
+
+static int logRecord_cmpByKey(const void *record1, const void *record2) {
+    int64_t i = ((const LogRecord *) record1)->key, j = ((const LogRecord *) record2)->key;
+    return i > j ? 1 : (i < j ? -1 : 0);
+}
+
+static int logRecord_cmpByOffset(const void *record1, const void *record2) {
+    int64_t i = ((const LogRecord *) record1)->offset, j = ((const LogRecord *) record2)->offset;
+    return i > j ? 1 : (i < j ? -1 : 0);
+}
+
+static LogDB *getLogDB(stKVDatabase *database) {
+    return (LogDB *) database->dbImpl;
+}
+
+static LogRecord *getLogRecord(LogDB *logDB, int64_t key) {
+    LogRecord record;
+    record.key = key;
+    return stHash_search(logDB->index, &record);
+}
+
+static int64_t getLogSize(LogDB *logDB) {
+    return logDB->fileSize + logDB->writeBufferLength;
+}
+
+static void writeFully(int fd, const void *buffer, int64_t size, int64_t offset, const char *path) {
+    while (size > 0) {
+        ssize_t i = pwrite(fd, buffer, size, offset);
+        if (i < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Writing to the database file %s failed: %s", path,
+                    strerror(errno));
+        }
+        buffer = (const char *) buffer + i;
+        size -= i;
+        offset += i;
+    }
+}
+
+static void readFully(int fd, void *buffer, int64_t size, int64_t offset, const char *path) {
+    while (size > 0) {
+        ssize_t i = pread(fd, buffer, size, offset);
+        if (i <= 0) {
+            if (i < 0 && errno == EINTR) {
+                continue;
+            }
+            stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Reading from the database file %s failed: %s", path,
+                    i < 0 ? strerror(errno) : "unexpected end of file");
+        }
+        buffer = (char *) buffer + i;
+        size -= i;
+        offset += i;
+    }
+}
+
+static void flushWriteBuffer(LogDB *logDB) {
+    writeFully(logDB->fd, logDB->writeBuffer, logDB->writeBufferLength, logDB->fileSize, logDB->logPath);
+    logDB->fileSize += logDB->writeBufferLength;
+    logDB->writeBufferLength = 0;
+}
+
+/*
+ * Copies size bytes of the log starting at offset, which may still be in the write buffer.
+ * Entries are never split between the file and the buffer.
+ */
+static void readLog(LogDB *logDB, void *buffer, int64_t size, int64_t offset) {
+    if (offset >= logDB->fileSize) {
+        assert(offset + size <= getLogSize(logDB));
+        memcpy(buffer, logDB->writeBuffer + (offset - logDB->fileSize), size);
+    } else {
+        readFully(logDB->fd, buffer, size, offset, logDB->logPath);
+    }
+}
+
+/*
+ * Appends an entry to the log, returning its offset.
+ */
+static int64_t appendEntry(LogDB *logDB, int64_t key, const void *value, int64_t size) {
+    int64_t header[2] = { key, size };
+    int64_t valueSize = size > 0 ? size : 0;
+    if (logDB->writeBufferLength + ENTRY_HEADER_SIZE + valueSize > WRITE_BUFFER_SIZE) {
+        flushWriteBuffer(logDB);
+    }
+    int64_t offset = getLogSize(logDB);
+    if (ENTRY_HEADER_SIZE + valueSize > WRITE_BUFFER_SIZE) { //Too big to buffer, so write it straight out
+        writeFully(logDB->fd, header, ENTRY_HEADER_SIZE, offset, logDB->logPath);
+        writeFully(logDB->fd, value, valueSize, offset + ENTRY_HEADER_SIZE, logDB->logPath);
+        logDB->fileSize += ENTRY_HEADER_SIZE + valueSize;
+    } else {
+        memcpy(logDB->writeBuffer + logDB->writeBufferLength, header, ENTRY_HEADER_SIZE);
+        if (valueSize > 0) {
+            memcpy(logDB->writeBuffer + logDB->writeBufferLength + ENTRY_HEADER_SIZE, value, valueSize);
+        }
+        logDB->writeBufferLength += ENTRY_HEADER_SIZE + valueSize;
+    }
+    return offset;
+}
+
+/*
+ * Puts the record in the index, replacing any previous version.
+ */
+static void indexRecord(LogDB *logDB, int64_t key, int64_t offset, int64_t size) {
+    LogRecord *record = getLogRecord(logDB, key);
+    if (record == NULL) {
+        record = st_malloc(sizeof(LogRecord));
+        record->key = key;
+        stHash_insert(logDB->index, record, record);
+    } else {
+        logDB->liveBytes -= ENTRY_HEADER_SIZE + record->size;
+    }
+    record->offset = offset;
+    record->size = size;
+    logDB->liveBytes += ENTRY_HEADER_SIZE + size;
+}
+
+static void unindexRecord(LogDB *logDB, int64_t key) {
+    LogRecord *record = getLogRecord(logDB, key);
+    if (record != NULL) {
+        logDB->liveBytes -= ENTRY_HEADER_SIZE + record->size;
+        stHash_remove(logDB->index, record);
+        free(record);
+    }
+}
+
+static stList *getRecordsInKeyOrder(LogDB *logDB) {
+    stList *records = stHash_getValues(logDB->index);
+    stList_sort(records, logRecord_cmpByKey);
+    return records;
+}
+
+/*
+ * Rewrites the log with only the current entries, in key order.
+ */
+static void compact(LogDB *logDB) {
+    flushWriteBuffer(logDB);
+    char *compactPath = stString_print("%s.compact", logDB->logPath);
+    int fd = open(compactPath, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Opening the database file %s failed: %s", compactPath,
+                strerror(errno));
+    }
+    stList *records = getRecordsInKeyOrder(logDB);
+    int64_t *offsets = st_malloc(sizeof(int64_t) * (stList_length(records) + 1));
+    char *buffer = st_malloc(WRITE_BUFFER_SIZE);
+    int64_t bufferLength = 0, fileSize = 0;
+    memcpy(buffer, LOG_MAGIC, LOG_MAGIC_SIZE);
+    bufferLength = LOG_MAGIC_SIZE;
+    for (int64_t i = 0; i < stList_length(records); i++) {
+        LogRecord *record = stList_get(records, i);
+        offsets[i] = fileSize + bufferLength;
+        int64_t remaining = ENTRY_HEADER_SIZE + record->size, offset = record->offset;
+        while (remaining > 0) { //Copy the entry through the buffer
+            if (bufferLength == WRITE_BUFFER_SIZE) {
+                writeFully(fd, buffer, bufferLength, fileSize, compactPath);
+                fileSize += bufferLength;
+                bufferLength = 0;
+            }
+            int64_t j = remaining < WRITE_BUFFER_SIZE - bufferLength ? remaining : WRITE_BUFFER_SIZE - bufferLength;
+            readFully(logDB->fd, buffer + bufferLength, j, offset, logDB->logPath);
+            bufferLength += j;
+            offset += j;
+            remaining -= j;
+        }
+    }
+    writeFully(fd, buffer, bufferLength, fileSize, compactPath);
+    fileSize += bufferLength;
+    if (fsync(fd) != 0 || rename(compactPath, logDB->logPath) != 0) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Replacing the database file %s with %s failed: %s", logDB->logPath,
+                compactPath, strerror(errno));
+    }
+    close(logDB->fd);
+    logDB->fd = fd;
+    logDB->fileSize = fileSize;
+    for (int64_t i = 0; i < stList_length(records); i++) {
+        ((LogRecord *) stList_get(records, i))->offset = offsets[i];
+    }
+    assert(logDB->liveBytes + LOG_MAGIC_SIZE == fileSize);
+    stList_destruct(records);
+    free(offsets);
+    free(buffer);
+    free(compactPath);
+}
+
+static void compactIfWasteful(LogDB *logDB) {
+    int64_t garbage = getLogSize(logDB) - LOG_MAGIC_SIZE - logDB->liveBytes;
+    if (garbage >= MIN_COMPACTION_GARBAGE && garbage > logDB->liveBytes) {
+        compact(logDB);
+    }
+}
+
+/*
+ * Reads through the log, building the index. An incomplete entry at the end of the log, left
+ * by a write that was cut short, is removed.
+ */
+static void readIndex(LogDB *logDB) {
+    FILE *fileHandle = fopen(logDB->logPath, "rb");
+    if (fileHandle == NULL) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Opening the database file %s failed: %s", logDB->logPath,
+                strerror(errno));
+    }
+    char magic[LOG_MAGIC_SIZE];
+    if (fread(magic, LOG_MAGIC_SIZE, 1, fileHandle) != 1 || memcmp(magic, LOG_MAGIC, LOG_MAGIC_SIZE) != 0) {
+        fclose(fileHandle);
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "The file %s is not a database log", logDB->logPath);
+    }
+    fseeko(fileHandle, 0, SEEK_END);
+    int64_t fileSize = ftello(fileHandle);
+    int64_t offset = LOG_MAGIC_SIZE;
+    int64_t header[2];
+    fseeko(fileHandle, offset, SEEK_SET);
+    while (offset + ENTRY_HEADER_SIZE <= fileSize && fread(header, ENTRY_HEADER_SIZE, 1, fileHandle) == 1) {
+        int64_t key = header[0], size = header[1];
+        if (size < REMOVED_RECORD_SIZE || size > fileSize - offset - ENTRY_HEADER_SIZE) {
+            break;
+        }
+        if (size == REMOVED_RECORD_SIZE) {
+            unindexRecord(logDB, key);
+            offset += ENTRY_HEADER_SIZE;
+        } else {
+            indexRecord(logDB, key, offset, size);
+            offset += ENTRY_HEADER_SIZE + size;
+            fseeko(fileHandle, offset, SEEK_SET);
+        }
+    }
+    fclose(fileHandle);
+    if (offset < fileSize && ftruncate(logDB->fd, offset) != 0) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Truncating the database file %s failed: %s", logDB->logPath,
+                strerror(errno));
+    }
+    logDB->fileSize = offset;
+}
+
+static LogDB *constructDB(stKVDatabaseConf *conf, bool create) {
+    const char *dbDir = stKVDatabaseConf_getDir(conf);
+    mkdir(dbDir, S_IRWXU);
+    LogDB *logDB = st_calloc(1, sizeof(LogDB));
+    logDB->logPath = stString_print("%s/%s", dbDir, LOG_FILE_NAME);
+    char *compactPath = stString_print("%s.compact", logDB->logPath);
+    unlink(compactPath); //Left if a compaction was cut short
+    free(compactPath);
+    logDB->fd = open(logDB->logPath, O_RDWR | (create ? O_CREAT | O_TRUNC : 0), S_IRUSR | S_IWUSR);
+    if (logDB->fd < 0) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Opening the database file %s failed: %s", logDB->logPath,
+                strerror(errno));
+    }
+    logDB->index = stHash_construct4(logRecord_hashKey, logRecord_equalKey, free, NULL, stHashTypeOpenAddressing);
+    logDB->writeBuffer = st_malloc(WRITE_BUFFER_SIZE);
+    if (create) {
+        writeFully(logDB->fd, LOG_MAGIC, LOG_MAGIC_SIZE, 0, logDB->logPath);
+        logDB->fileSize = LOG_MAGIC_SIZE;
+    } else {
+        readIndex(logDB);
+    }
+    return logDB;
+}
+
+static void destructDB(stKVDatabase *database) {
+    LogDB *logDB = getLogDB(database);
+    if (logDB != NULL) {
+        flushWriteBuffer(logDB);
+        close(logDB->fd);
+        stHash_destruct(logDB->index);
+        free(logDB->writeBuffer);
+        free(logDB->logPath);
+        free(logDB);
+        database->dbImpl = NULL;
+    }
+}
+
+static void deleteDB(stKVDatabase *database) {
+    char *logPath = stString_copy(getLogDB(database)->logPath);
+    destructDB(database);
+    if (unlink(logPath) != 0) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Removing the database file %s failed: %s", logPath,
+                strerror(errno));
+    }
+    free(logPath);
+    rmdir(stKVDatabaseConf_getDir(stKVDatabase_getConf(database))); //Only removed if nothing else is in there
+}
+
+static void flush(stKVDatabase *database) {
+    LogDB *logDB = getLogDB(database);
+    flushWriteBuffer(logDB);
+    if (fsync(logDB->fd) != 0) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Syncing the database file %s failed: %s", logDB->logPath,
+                strerror(errno));
+    }
+}
+
+static bool containsRecord(stKVDatabase *database, int64_t key) {
+    return getLogRecord(getLogDB(database), key) != NULL;
+}
+
+static void writeRecord(LogDB *logDB, int64_t key, const void *value, int64_t sizeOfRecord) {
+    int64_t offset = appendEntry(logDB, key, value, sizeOfRecord);
+    indexRecord(logDB, key, offset, sizeOfRecord);
+    compactIfWasteful(logDB);
+}
+
+/*
+ * The keys written or removed by the requests of a bulk operation checked so far, as LogRecords
+ * with a size of REMOVED_RECORD_SIZE for removed keys. Each request is checked as if those before it
+ * had been made, so a bulk operation is all or nothing.
+ */
+static stHash *constructBulkKeys(void) {
+    return stHash_construct4(logRecord_hashKey, logRecord_equalKey, free, NULL, stHashTypeOpenAddressing);
+}
+
+/*
+ * Whether the key is in the database once the bulk requests checked so far are made. bulkKeys may be NULL
+ * for a single request.
+ */
+static bool containsKey(LogDB *logDB, stHash *bulkKeys, int64_t key) {
+    if (bulkKeys != NULL) {
+        LogRecord record;
+        record.key = key;
+        LogRecord *bulkRecord = stHash_search(bulkKeys, &record);
+        if (bulkRecord != NULL) {
+            return bulkRecord->size != REMOVED_RECORD_SIZE;
+        }
+    }
+    return getLogRecord(logDB, key) != NULL;
+}
+
+static void setBulkKey(stHash *bulkKeys, int64_t key, bool contained) {
+    LogRecord record;
+    record.key = key;
+    LogRecord *bulkRecord = stHash_search(bulkKeys, &record);
+    if (bulkRecord == NULL) {
+        bulkRecord = st_calloc(1, sizeof(LogRecord));
+        bulkRecord->key = key;
+        stHash_insert(bulkKeys, bulkRecord, bulkRecord);
+    }
+    bulkRecord->size = contained ? 0 : REMOVED_RECORD_SIZE;
+}
+
+static void checkInsert(LogDB *logDB, stHash *bulkKeys, int64_t key) {
+    if (containsKey(logDB, bulkKeys, key)) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Attempt to insert a key in the database that already exists: %lld",
+                (long long) key);
+    }
+}
+
+static void checkUpdate(LogDB *logDB, stHash *bulkKeys, int64_t key) {
+    if (!containsKey(logDB, bulkKeys, key)) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Attempt to update a key in the database that doesn't exists: %lld",
+                (long long) key);
+    }
+}
+
+static void checkRemove(LogDB *logDB, stHash *bulkKeys, int64_t key) {
+    if (!containsKey(logDB, bulkKeys, key)) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Removing key not found: %lld", (long long) key);
+    }
+}
+
+static void insertRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    checkInsert(getLogDB(database), NULL, key);
+    writeRecord(getLogDB(database), key, value, sizeOfRecord);
+}
+
+static void insertInt64(stKVDatabase *database, int64_t key, int64_t value) {
+    insertRecord(database, key, &value, sizeof(int64_t));
+}
+
+static void updateRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    checkUpdate(getLogDB(database), NULL, key);
+    writeRecord(getLogDB(database), key, value, sizeOfRecord);
+}
+
+static void updateInt64(stKVDatabase *database, int64_t key, int64_t value) {
+    updateRecord(database, key, &value, sizeof(int64_t));
+}
+
+static void setRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    writeRecord(getLogDB(database), key, value, sizeOfRecord);
+}
+
+static void bulkSetRecords(stKVDatabase *database, stList *records) {
+    LogDB *logDB = getLogDB(database);
+    //Check all the requests can be made before making any, so the set is all or nothing
+    stHash *bulkKeys = constructBulkKeys();
+    stTry {
+        for (int64_t i = 0; i < stList_length(records); i++) {
+            stKVDatabaseBulkRequest *request = stList_get(records, i);
+            if (request->type == INSERT) {
+                checkInsert(logDB, bulkKeys, request->key);
+            } else if (request->type == UPDATE) {
+                checkUpdate(logDB, bulkKeys, request->key);
+            }
+            setBulkKey(bulkKeys, request->key, 1);
+        }
+    } stCatch(except) {
+        stHash_destruct(bulkKeys);
+        stThrow(except);
+    } stTryEnd;
+    stHash_destruct(bulkKeys);
+    for (int64_t i = 0; i < stList_length(records); i++) {
+        stKVDatabaseBulkRequest *request = stList_get(records, i);
+        writeRecord(logDB, request->key, request->value, request->size);
+    }
+}
+
+static int64_t numberOfRecords(stKVDatabase *database) {
+    return stHash_size(getLogDB(database)->index);
+}
+
+static void *readRecord(LogDB *logDB, LogRecord *record) {
+    void *value = st_malloc(record->size);
+    readLog(logDB, value, record->size, record->offset + ENTRY_HEADER_SIZE);
+    return value;
+}
+
+static void *getRecord2(stKVDatabase *database, int64_t key, int64_t *recordSize) {
+    LogDB *logDB = getLogDB(database);
+    LogRecord *record = getLogRecord(logDB, key);
+    if (record == NULL) {
+        return NULL;
+    }
+    *recordSize = record->size;
+    return readRecord(logDB, record);
+}
+
+static void *getRecord(stKVDatabase *database, int64_t key) {
+    int64_t i;
+    return getRecord2(database, key, &i);
+}
+
+static int64_t getInt64(stKVDatabase *database, int64_t key) {
+    LogDB *logDB = getLogDB(database);
+    LogRecord *record = getLogRecord(logDB, key);
+    if (record == NULL || record->size != sizeof(int64_t)) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "The record %lld does not exist or is not an int64", (long long) key);
+    }
+    int64_t value;
+    readLog(logDB, &value, sizeof(int64_t), record->offset + ENTRY_HEADER_SIZE);
+    return value;
+}
+
+static int64_t incrementInt64(stKVDatabase *database, int64_t key, int64_t incrementAmount) {
+    int64_t value = getInt64(database, key) + incrementAmount;
+    writeRecord(getLogDB(database), key, &value, sizeof(int64_t));
+    return value;
+}
+
+static void *getPartialRecord(stKVDatabase *database, int64_t key, int64_t zeroBasedByteOffset, int64_t sizeInBytes,
+        int64_t recordSize) {
+    LogDB *logDB = getLogDB(database);
+    LogRecord *record = getLogRecord(logDB, key);
+    if (record == NULL) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "The record does not exist: %lld for partial retrieval",
+                (long long) key);
+    }
+    if (record->size != recordSize) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "The given record size is incorrect: %lld, should be %lld",
+                (long long) recordSize, (long long) record->size);
+    }
+    void *partialRecord = st_malloc(sizeInBytes);
+    readLog(logDB, partialRecord, sizeInBytes, record->offset + ENTRY_HEADER_SIZE + zeroBasedByteOffset);
+    return partialRecord;
+}
+
+static stKVDatabaseRecordView *getPartialRecordView(stKVDatabase *database, int64_t key, int64_t zeroBasedByteOffset,
+        int64_t sizeInBytes, int64_t recordSize) {
+    if (sizeInBytes < MIN_MAPPED_VIEW_SIZE) {
+        return stKVDatabaseRecordView_constructCopy(
+                getPartialRecord(database, key, zeroBasedByteOffset, sizeInBytes, recordSize), sizeInBytes);
+    }
+    LogDB *logDB = getLogDB(database);
+    LogRecord *record = getLogRecord(logDB, key);
+    if (record == NULL || record->size != recordSize) {
+        return stKVDatabaseRecordView_constructCopy(
+                getPartialRecord(database, key, zeroBasedByteOffset, sizeInBytes, recordSize), sizeInBytes); //Throws
+    }
+    if (record->offset >= logDB->fileSize) { //The entry must be in the file to be mapped
+        flushWriteBuffer(logDB);
+    }
+    return stKVDatabaseRecordView_constructMapped(logDB->fd, record->offset + ENTRY_HEADER_SIZE + zeroBasedByteOffset,
+            sizeInBytes, logDB->logPath);
+}
+
+static stKVDatabaseRecordView *getRecordView(stKVDatabase *database, int64_t key) {
+    LogRecord *record = getLogRecord(getLogDB(database), key);
+    if (record == NULL) {
+        return NULL;
+    }
+    return getPartialRecordView(database, key, 0, record->size, record->size);
+}
+
+static void removeRecord(stKVDatabase *database, int64_t key) {
+    LogDB *logDB = getLogDB(database);
+    checkRemove(logDB, NULL, key);
+    appendEntry(logDB, key, NULL, REMOVED_RECORD_SIZE);
+    unindexRecord(logDB, key);
+    compactIfWasteful(logDB);
+}
+
+static void bulkRemoveRecords(stKVDatabase *database, stList *records) {
+    LogDB *logDB = getLogDB(database);
+    //As for bulkSetRecords, a key removed twice fails before any is removed
+    stHash *bulkKeys = constructBulkKeys();
+    stTry {
+        for (int64_t i = 0; i < stList_length(records); i++) {
+            int64_t key = stIntTuple_get(stList_get(records, i), 0);
+            checkRemove(logDB, bulkKeys, key);
+            setBulkKey(bulkKeys, key, 0);
+        }
+    } stCatch(except) {
+        stHash_destruct(bulkKeys);
+        stThrow(except);
+    } stTryEnd;
+    stHash_destruct(bulkKeys);
+    for (int64_t i = 0; i < stList_length(records); i++) {
+        removeRecord(database, stIntTuple_get(stList_get(records, i), 0));
+    }
+}
+
+/*
+ * Gets the records for the keys, reading them in the order they lie in the log.
+ */
+static stList *getRecords(LogDB *logDB, int64_t *keys, int64_t numRecords) {
+    stList *results = stList_construct3(numRecords, (void (*)(void *)) stKVDatabaseBulkResult_destruct);
+    LogRecord *found = st_malloc(sizeof(LogRecord) * (numRecords + 1));
+    int64_t numFound = 0;
+    for (int64_t i = 0; i < numRecords; i++) {
+        LogRecord *record = getLogRecord(logDB, keys[i]);
+        if (record == NULL) {
+            stList_set(results, i, stKVDatabaseBulkResult_construct(NULL, 0));
+        } else {
+            found[numFound] = *record;
+            found[numFound++].key = i; //Reuse the key to hold the index of the result
+        }
+    }
+    qsort(found, numFound, sizeof(LogRecord), logRecord_cmpByOffset);
+    for (int64_t i = 0; i < numFound; i++) {
+        stList_set(results, found[i].key, stKVDatabaseBulkResult_construct(readRecord(logDB, &found[i]), found[i].size));
+    }
+    free(found);
+    return results;
+}
+
+static stList *bulkGetRecords(stKVDatabase *database, stList *keys) {
+    int64_t *keyArray = st_malloc(sizeof(int64_t) * (stList_length(keys) + 1));
+    for (int64_t i = 0; i < stList_length(keys); i++) {
+        keyArray[i] = *(int64_t *) stList_get(keys, i);
+    }
+    stList *results = getRecords(getLogDB(database), keyArray, stList_length(keys));
+    free(keyArray);
+    return results;
+}
+
+static stList *bulkGetRecordsRange(stKVDatabase *database, int64_t firstKey, int64_t numRecords) {
+    int64_t *keyArray = st_malloc(sizeof(int64_t) * (numRecords + 1));
+    for (int64_t i = 0; i < numRecords; i++) {
+        keyArray[i] = firstKey + i;
+    }
+    stList *results = getRecords(getLogDB(database), keyArray, numRecords);
+    free(keyArray);
+    return results;
+}
+
+void stKVDatabase_initialise_logStructured(stKVDatabase *database, stKVDatabaseConf *conf, bool create) {
+    database->dbImpl = constructDB(stKVDatabase_getConf(database), create);
+    database->secondaryDB = NULL;
+    database->destruct = destructDB;
+    database->deleteDatabase = deleteDB;
+    database->flush = flush;
+    database->containsRecord = containsRecord;
+    database->insertRecord = insertRecord;
+    database->insertInt64 = insertInt64;
+    database->updateRecord = updateRecord;
+    database->updateInt64 = updateInt64;
+    database->setRecord = setRecord;
+    database->incrementInt64 = incrementInt64;
+    database->bulkSetRecords = bulkSetRecords;
+    database->bulkRemoveRecords = bulkRemoveRecords;
+    database->numberOfRecords = numberOfRecords;
+    database->getRecord = getRecord;
+    database->getInt64 = getInt64;
+    database->getRecord2 = getRecord2;
+    database->getPartialRecord = getPartialRecord;
+    database->bulkGetRecords = bulkGetRecords;
+    database->bulkGetRecordsRange = bulkGetRecordsRange;
+    database->removeRecord = removeRecord;
+    database->getRecordView = getRecordView;
+    database->getPartialRecordView = getPartialRecordView;
+}
@@ -307,12 +307,45 @@ void stList_shuffle(stList *list) {
     }
 }
 
+static int st_list_pointerCmpFn(const void *a, const void *b) {
+    return a > b ? 1 : a < b ? -1 : 0;
+}
+
+struct _stList_getSortedSetOrder {
+    void **elements;
+    int (*cmpFn)(const void *, const void *);
+};
+
+static int st_list_getSortedSetP(const void *a, const void *b, void *extra) {
+    struct _stList_getSortedSetOrder *order = extra;
+    int64_t i = *(int64_t *)a, j = *(int64_t *)b;
+    int c = order->cmpFn(order->elements[i], order->elements[j]);
+    return c != 0 ? c : i > j ? 1 : i < j ? -1 : 0;
+}
+
 stSortedSet *stList_getSortedSet(stList *list, int (*cmpFn)(const void *a, const void *b)) {
-    stSortedSet *sortedSet = stSortedSet_construct3(cmpFn, NULL);
-    int64_t i;
-    for(i=0; i<stList_length(list); i++) {
-        stSortedSet_insert(sortedSet, stList_get(list, i));
+    struct _stList_getSortedSetOrder order = { list->list, cmpFn == NULL ? st_list_pointerCmpFn : cmpFn };
+    int64_t i = 1;
+    while(i < list->length && order.cmpFn(list->list[i-1], list->list[i]) <= 0) {
+        i++;
+    }
+    if(i >= list->length) {
+        return stSortedSet_constructFromSortedList(list, cmpFn, NULL);
+    }
+    // Sort the positions of the elements, breaking ties by position, so of equal elements
+    // the last is kept, as it would be if the elements were inserted in turn.
+    int64_t *positions = st_malloc(list->length * sizeof(int64_t));
+    for(i=0; i<list->length; i++) {
+        positions[i] = i;
+    }
+    sort_r(positions, list->length, sizeof(int64_t), st_list_getSortedSetP, &order);
+    stList *sortedList = stList_construct2(list->length);
+    for(i=0; i<list->length; i++) {
+        sortedList->list[i] = list->list[positions[i]];
     }
+    free(positions);
+    stSortedSet *sortedSet = stSortedSet_constructFromSortedList(sortedList, cmpFn, NULL);
+    stList_destruct(sortedList);
     return sortedSet;
 }
 
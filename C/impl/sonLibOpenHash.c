@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * sonLibOpenHash.c
+ *
+ * Robin Hood open addressing hash table, see sonLibOpenHashPrivate.h.
+ */
+
+#include "sonLibGlobalsInternal.h"
+#include "sonLibOpenHashPrivate.h"
+
+#define OPEN_HASH_INITIAL_CAPACITY 16
+#define OPEN_HASH_MAX_DISTANCE 0xff // Largest value of the distance byte of a control word.
+
+/*
+ * Hash functions such as stSet_pointer leave the low bits poorly distributed, which would be
+ * fatal with a power of two table, so every hash is passed through a finalizer first.
+ */
+static inline uint64_t mixHash(uint64_t h) {
+    h = (h ^ (h >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    h = (h ^ (h >> 27)) * UINT64_C(0x94d049bb133111eb);
+    return h ^ (h >> 31);
+}
+
+static inline uint16_t initialControl(uint64_t h) {
+    return (uint16_t) (((h >> 56) << 8) | 1);
+}
+
+static void allocateTable(stOpenHash *hash, uint64_t capacity) {
+    hash->capacity = capacity;
+    hash->maxCount = capacity - capacity / 8; // Max load of 7/8
+    hash->control = st_calloc(capacity, sizeof(uint16_t));
+    hash->slots = st_malloc(capacity * sizeof(struct _stOpenHashSlot));
+}
+
+stOpenHash *stOpenHash_construct(uint64_t (*hashFn)(const void *), int (*equalsFn)(const void *, const void *)) {
+    stOpenHash *hash = st_malloc(sizeof(stOpenHash));
+    hash->count = 0;
+    hash->hashFn = hashFn;
+    hash->equalsFn = equalsFn;
+    allocateTable(hash, OPEN_HASH_INITIAL_CAPACITY);
+    return hash;
+}
+
+void stOpenHash_destruct(stOpenHash *hash, void (*keyFree)(void *), void (*valueFree)(void *)) {
+    if (keyFree != NULL || valueFree != NULL) {
+        for (uint64_t i = 0; i < hash->capacity; i++) {
+            if (hash->control[i] != 0) {
+                if (keyFree != NULL) {
+                    keyFree(hash->slots[i].key);
+                }
+                if (valueFree != NULL) {
+                    valueFree(hash->slots[i].value);
+                }
+            }
+        }
+    }
+    free(hash->control);
+    free(hash->slots);
+    free(hash);
+}
+
+static void grow(stOpenHash *hash);
+
+/*
+ * Inserts a key known not to be present, displacing entries nearer their home slot.
+ */
+static void insertAbsent(stOpenHash *hash, void *key, void *value) {
+    uint64_t h = mixHash(hash->hashFn(key));
+    uint64_t mask = hash->capacity - 1;
+    uint64_t i = h & mask;
+    uint16_t control = initialControl(h);
+    while (1) {
+        uint16_t c = hash->control[i];
+        if (c == 0) {
+            hash->control[i] = control;
+            hash->slots[i].key = key;
+            hash->slots[i].value = value;
+            hash->count++;
+            return;
+        }
+        if ((c & 0xff) < (control & 0xff)) { // Take from the rich
+            struct _stOpenHashSlot displaced = hash->slots[i];
+            hash->control[i] = control;
+            hash->slots[i].key = key;
+            hash->slots[i].value = value;
+            control = c;
+            key = displaced.key;
+            value = displaced.value;
+        }
+        if ((control & 0xff) == OPEN_HASH_MAX_DISTANCE) {
+            // The carried entry can not be displaced any further, so make room and start again.
+            grow(hash);
+            insertAbsent(hash, key, value);
+            return;
+        }
+        control++;
+        i = (i + 1) & mask;
+    }
+}
+
+static void grow(stOpenHash *hash) {
+    uint64_t oldCapacity = hash->capacity;
+    uint16_t *oldControl = hash->control;
+    struct _stOpenHashSlot *oldSlots = hash->slots;
+    allocateTable(hash, oldCapacity * 2);
+    hash->count = 0;
+    for (uint64_t i = 0; i < oldCapacity; i++) {
+        if (oldControl[i] != 0) {
+            insertAbsent(hash, oldSlots[i].key, oldSlots[i].value);
+        }
+    }
+    free(oldControl);
+    free(oldSlots);
+}
+
+/*
+ * Returns the slot index holding the key, or -1 if absent.
+ */
+static int64_t find(stOpenHash *hash, uint64_t h, const void *key) {
+    uint64_t mask = hash->capacity - 1;
+    uint64_t i = h & mask;
+    uint16_t control = initialControl(h);
+    while (1) {
+        uint16_t c = hash->control[i];
+        if ((c & 0xff) < (control & 0xff)) { // Empty, or an entry closer to home than we would be.
+            return -1;
+        }
+        if (c == control && hash->equalsFn(key, hash->slots[i].key)) {
+            return i;
+        }
+        if ((control & 0xff) == OPEN_HASH_MAX_DISTANCE) {
+            return -1;
+        }
+        control++;
+        i = (i + 1) & mask;
+    }
+}
+
+void *stOpenHash_insert(stOpenHash *hash, void *key, void *value) {
+    if (hash->count >= hash->maxCount) {
+        grow(hash);
+    }
+    uint64_t h = mixHash(hash->hashFn(key));
+    uint64_t mask = hash->capacity - 1;
+    uint64_t i = h & mask;
+    uint16_t control = initialControl(h);
+    // Walk the probe sequence once: either we hit the key, or the point at which it would be found,
+    // which is exactly where the Robin Hood insert has to start.
+    while (1) {
+        uint16_t c = hash->control[i];
+        if ((c & 0xff) < (control & 0xff)) {
+            break;
+        }
+        if (c == control && hash->equalsFn(key, hash->slots[i].key)) {
+            void *oldValue = hash->slots[i].value;
+            hash->slots[i].key = key;
+            hash->slots[i].value = value;
+            return oldValue;
+        }
+        if ((control & 0xff) == OPEN_HASH_MAX_DISTANCE) {
+            grow(hash);
+            insertAbsent(hash, key, value);
+            return NULL;
+        }
+        control++;
+        i = (i + 1) & mask;
+    }
+    while (1) {
+        uint16_t c = hash->control[i];
+        if (c == 0) {
+            hash->control[i] = control;
+            hash->slots[i].key = key;
+            hash->slots[i].value = value;
+            hash->count++;
+            return NULL;
+        }
+        if ((c & 0xff) < (control & 0xff)) {
+            struct _stOpenHashSlot displaced = hash->slots[i];
+            hash->control[i] = control;
+            hash->slots[i].key = key;
+            hash->slots[i].value = value;
+            control = c;
+            key = displaced.key;
+            value = displaced.value;
+        }
+        if ((control & 0xff) == OPEN_HASH_MAX_DISTANCE) {
+            grow(hash);
+            insertAbsent(hash, key, value);
+            return NULL;
+        }
+        control++;
+        i = (i + 1) & mask;
+    }
+}
+
+void *stOpenHash_search(stOpenHash *hash, void *key) {
+    int64_t i = find(hash, mixHash(hash->hashFn(key)), key);
+    return i == -1 ? NULL : hash->slots[i].value;
+}
+
+void *stOpenHash_remove(stOpenHash *hash, void *key, void **removedKey) {
+    int64_t i = find(hash, mixHash(hash->hashFn(key)), key);
+    if (i == -1) {
+        return NULL;
+    }
+    void *value = hash->slots[i].value;
+    if (removedKey != NULL) {
+        *removedKey = hash->slots[i].key;
+    }
+    // Backward shift deletion: pull following displaced entries one slot nearer home.
+    uint64_t mask = hash->capacity - 1;
+    uint64_t j = (i + 1) & mask;
+    while ((hash->control[j] & 0xff) > 1) {
+        hash->control[i] = hash->control[j] - 1;
+        hash->slots[i] = hash->slots[j];
+        i = j;
+        j = (j + 1) & mask;
+    }
+    hash->control[i] = 0;
+    hash->count--;
+    return value;
+}
+
+void *stOpenHash_getNext(stOpenHash *hash, uint64_t *index) {
+    for (uint64_t i = *index; i < hash->capacity; i++) {
+        if (hash->control[i] != 0) {
+            *index = i + 1;
+            return hash->slots[i].key;
+        }
+    }
+    *index = hash->capacity;
+    return NULL;
+}
+
+void stOpenHash_printDiagnostics(stOpenHash *hash) {
+    uint64_t totalDistance = 0, maxDistance = 0;
+    for (uint64_t i = 0; i < hash->capacity; i++) {
+        if (hash->control[i] != 0) {
+            uint64_t distance = (hash->control[i] & 0xff) - 1;
+            totalDistance += distance;
+            if (distance > maxDistance) {
+                maxDistance = distance;
+            }
+        }
+    }
+    printf("Load: %" PRIu64 " / %" PRIu64 " (%lf%%)\n", hash->count, hash->capacity,
+           ((double) hash->count) / hash->capacity * 100);
+    printf("avg probe distance: %lf, max probe distance: %" PRIu64 "\n",
+           hash->count > 0 ? ((double) totalDistance) / hash->count : 0.0, maxDistance);
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * sonLibOpenHashPrivate.h
+ *
+ * Open addressing (Robin Hood) hash table used as an alternative backend
+ * for stHash. Entries are stored inline in a flat slot array, with a parallel
+ * array of 16 bit control words. The low byte of a control word is one plus the
+ * distance of the entry from its home slot (zero means empty), the high byte
+ * is a tag taken from the top bits of the hash, so most non-matching slots are
+ * rejected without calling the equality function.
+ */
+
+#ifndef SONLIB_OPEN_HASH_PRIVATE_H_
+#define SONLIB_OPEN_HASH_PRIVATE_H_
+
+typedef struct _stOpenHash stOpenHash;
+
+struct _stOpenHashSlot {
+    void *key;
+    void *value;
+};
+
+struct _stOpenHash {
+    uint64_t capacity; // Always a power of two.
+    uint64_t count;
+    uint64_t maxCount; // Count at which the table is grown.
+    uint16_t *control;
+    struct _stOpenHashSlot *slots;
+    uint64_t (*hashFn)(const void *);
+    int (*equalsFn)(const void *, const void *);
+};
+
+stOpenHash *stOpenHash_construct(uint64_t (*hashFn)(const void *), int (*equalsFn)(const void *, const void *));
+
+/*
+ * Frees the table, calling the given destructors (if non-null) on each key/value.
+ */
+void stOpenHash_destruct(stOpenHash *hash, void (*keyFree)(void *), void (*valueFree)(void *));
+
+/*
+ * Inserts the key/value, replacing both the key and value of any existing equal key, in a
+ * single probe sequence. Returns the previous value, or NULL if the key was not present.
+ */
+void *stOpenHash_insert(stOpenHash *hash, void *key, void *value);
+
+void *stOpenHash_search(stOpenHash *hash, void *key);
+
+/*
+ * Removes the key, returning its value (or NULL if absent). If removedKey is non-null it is
+ * set to the key that was stored in the table, so that the caller may free it.
+ */
+void *stOpenHash_remove(stOpenHash *hash, void *key, void **removedKey);
+
+/*
+ * Returns the next key at or after *index, advancing *index past it, or NULL when
+ * the table is exhausted. Removing entries while iterating may cause entries to be skipped.
+ */
+void *stOpenHash_getNext(stOpenHash *hash, uint64_t *index);
+
+void stOpenHash_printDiagnostics(stOpenHash *hash);
+
+#endif /* SONLIB_OPEN_HASH_PRIVATE_H_ */
@@ -36,8 +36,12 @@ stSet *stSet_construct2(void(*destructKeys)(void *)) {
     return stSet_construct3(stSet_pointer, stSet_equalKey, destructKeys);
 }
 stSet *stSet_construct3(uint64_t(*hashKey)(const void *), int(*hashEqualsKey)(const void *, const void *), void(*destructKeys)(void *)) {
+    return stSet_construct4(hashKey, hashEqualsKey, destructKeys, stHashTypeChained);
+}
+stSet *stSet_construct4(uint64_t(*hashKey)(const void *), int(*hashEqualsKey)(const void *, const void *), void(*destructKeys)(void *),
+                        stHashType type) {
     stSet *set = st_malloc(sizeof(*set));
-    set->hash = stHash_construct3(hashKey, hashEqualsKey, destructKeys, NULL);
+    set->hash = stHash_construct4(hashKey, hashEqualsKey, destructKeys, NULL, type);
     return set;
 }
 void stSet_destruct(stSet *set) {
@@ -50,10 +54,7 @@ void stSet_setDestructor(stSet *set, void(*destructor)(void *)) {
 }
 
 void stSet_insert(stSet *set, void *key) {
-    if (stSet_search(set, key) != NULL) { // This will ensure we don't end up with duplicate keys..
-        stSet_remove(set, key);
-    }
-    stHash_insert(set->hash, key, key);
+    stHash_insert(set->hash, key, key); // stHash_insert ensures we don't end up with duplicate keys..
 }
 void stSet_insertAll(stSet *set, stSet *setToAdd) {
     stSetIterator *setIt = stSet_getIterator(setToAdd);
@@ -152,9 +153,9 @@ static void stSet_verifySetsHaveSameFunctions(stSet *set1, stSet *set2) {
 }
 stSet *stSet_getUnion(stSet *set1, stSet *set2) {
     stSet_verifySetsHaveSameFunctions(set1, set2);
-    stSet *set3 = stSet_construct3(stSet_getHashFunction(set1), 
+    stSet *set3 = stSet_construct4(stSet_getHashFunction(set1),
                                    stSet_getEqualityFunction(set1),
-                                   NULL);
+                                   NULL, stHash_getType(set1->hash));
     // Add everything
     stSetIterator *sit= stSet_getIterator(set1);
     void *o;
@@ -179,9 +180,9 @@ int64_t stSet_sizeOfIntersection(stSet *set1, stSet *set2) {
 
 stSet *stSet_getIntersection(stSet *set1, stSet *set2) {
     stSet_verifySetsHaveSameFunctions(set1, set2);
-    stSet *set3 = stSet_construct3(stSet_getHashFunction(set1), 
+    stSet *set3 = stSet_construct4(stSet_getHashFunction(set1),
                                    stSet_getEqualityFunction(set1),
-                                   NULL);
+                                   NULL, stHash_getType(set1->hash));
     // Add those from set1 only if they are also in set2
     stSetIterator *sit= stSet_getIterator(set1);
     void *o;
@@ -195,9 +196,9 @@ stSet *stSet_getIntersection(stSet *set1, stSet *set2) {
 }
 stSet *stSet_getDifference(stSet *set1, stSet *set2) {
     stSet_verifySetsHaveSameFunctions(set1, set2);
-    stSet *set3 = stSet_construct3(stSet_getHashFunction(set1), 
+    stSet *set3 = stSet_construct4(stSet_getHashFunction(set1),
                                    stSet_getEqualityFunction(set1),
-                                   NULL);
+                                   NULL, stHash_getType(set1->hash));
     // Add those from set1 only if they are not in set2
     stSetIterator *sit= stSet_getIterator(set1);
     void *o;
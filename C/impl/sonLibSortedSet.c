@@ -6,6 +6,7 @@
 
 #include "sonLibGlobalsInternal.h"
 #include "avl.h"
+#include "sonLibBTreePrivate.h"
 
 const char *SORTED_SET_EXCEPTION_ID = "SORTED_SET_EXCEPTION";
 
@@ -18,7 +19,10 @@ const char *SORTED_SET_EXCEPTION_ID = "SORTED_SET_EXCEPTION";
 ////////////////////////////////////////////////
 
 struct _stSortedSet {
-    struct avl_table *sortedSet;
+    stSortedSetType type;
+    struct avl_table *sortedSet; // Used if type == stSortedSetTypeAVL or stSortedSetTypeAVLSlab
+    stBTree *bTree; // Used if type == stSortedSetTypeBTree
+    int (*compareFn)(const void *, const void *);
     void (*destructElementFn)(void *);
     int numberOfLiveIterators;  // number of currently allocated iterators
 };
@@ -26,6 +30,7 @@ struct _stSortedSet {
 struct _stSortedSetIterator {
     stSortedSet *sortedSet;
     struct avl_traverser traverser;
+    stBTreePosition position;
 };
 
 static int st_sortedSet_cmpFn( const void *key1, const void *key2 ) {
@@ -58,25 +63,71 @@ static int st_sortedSet_construct3P(const void *a, const void *b, struct _stSort
 
 stSortedSet *stSortedSet_construct3(int (*compareFn)(const void *, const void *),
                                       void (*destructElementFn)(void *)) {
+    return stSortedSet_construct4(compareFn, destructElementFn, stSortedSetTypeAVL);
+}
+
+static stSortedSet *stSortedSet_constructEmpty(int (*compareFn)(const void *, const void *),
+                                               void (*destructElementFn)(void *), stSortedSetType type) {
     stSortedSet *sortedSet = st_malloc(sizeof(stSortedSet));
-    struct _stSortedSet_construct3Fn *i = st_malloc(sizeof(struct _stSortedSet_construct3Fn));
-    i->compareFn = compareFn == NULL ? st_sortedSet_cmpFn : compareFn; //this is a total hack to make the function pass ISO C compatible.
-    sortedSet->sortedSet = avl_create((int (*)(const void *, const void *, void *))st_sortedSet_construct3P, i, NULL);
+    sortedSet->type = type;
+    sortedSet->sortedSet = NULL;
+    sortedSet->bTree = NULL;
+    sortedSet->compareFn = compareFn == NULL ? st_sortedSet_cmpFn : compareFn;
     sortedSet->destructElementFn = destructElementFn;
     sortedSet->numberOfLiveIterators = 0;
     return sortedSet;
 }
 
-void stSortedSet_setDestructor(stSortedSet *set, void (*destructElement)(void *)) {
-    set->destructElementFn = destructElement;
+stSortedSet *stSortedSet_construct4(int (*compareFn)(const void *, const void *),
+                                      void (*destructElementFn)(void *), stSortedSetType type) {
+    stSortedSet *sortedSet = stSortedSet_constructEmpty(compareFn, destructElementFn, type);
+    if (type == stSortedSetTypeBTree) {
+        sortedSet->bTree = stBTree_construct(sortedSet->compareFn);
+    } else {
+        struct _stSortedSet_construct3Fn *i = st_malloc(sizeof(struct _stSortedSet_construct3Fn));
+        i->compareFn = sortedSet->compareFn; //this is a total hack to make the function pass ISO C compatible.
+        sortedSet->sortedSet = avl_create((int (*)(const void *, const void *, void *))st_sortedSet_construct3P, i,
+                type == stSortedSetTypeAVLSlab ? &avl_allocator_slab : NULL);
+    }
+    return sortedSet;
+}
+
+stSortedSet *stSortedSet_constructFromSortedList(stList *list, int (*compareFn)(const void *, const void *),
+                                                   void (*destructElementFn)(void *)) {
+    stSortedSet *sortedSet = stSortedSet_constructEmpty(compareFn, destructElementFn, stSortedSetTypeBTree);
+    void **elements = st_malloc((stList_length(list) + 1) * sizeof(void *));
+    int64_t length = 0;
+    for (int64_t i = 0; i < stList_length(list); i++) {
+        void *o = stList_get(list, i);
+        int c = length == 0 ? -1 : sortedSet->compareFn(elements[length - 1], o);
+        if (c > 0) {
+            free(elements);
+            free(sortedSet);
+            stThrowNew(SORTED_SET_EXCEPTION_ID, "Tried to construct a sorted set from a list that is not sorted");
+        }
+        elements[c == 0 ? length - 1 : length++] = o;
+    }
+    sortedSet->bTree = stBTree_constructFromSortedArray(sortedSet->compareFn, elements, length);
+    free(elements);
+    return sortedSet;
 }
 
-static struct _stSortedSet_construct3Fn *stSortedSet_getComparator(stSortedSet *sortedSet) {
-    return (struct _stSortedSet_construct3Fn *)sortedSet->sortedSet->avl_param;
+stSortedSetType stSortedSet_getType(stSortedSet *sortedSet) {
+    return sortedSet->type;
+}
+
+void stSortedSet_setDestructor(stSortedSet *set, void (*destructElement)(void *)) {
+    set->destructElementFn = destructElement;
 }
 
 stSortedSet *stSortedSet_copyConstruct(stSortedSet *sortedSet, void (*destructElementFn)(void *)) {
-    stSortedSet *sortedSet2 = stSortedSet_construct3(stSortedSet_getComparator(sortedSet)->compareFn, destructElementFn);
+    if (sortedSet->type == stSortedSetTypeBTree) {
+        stList *list = stSortedSet_getList(sortedSet);
+        stSortedSet *sortedSet2 = stSortedSet_constructFromSortedList(list, sortedSet->compareFn, destructElementFn);
+        stList_destruct(list);
+        return sortedSet2;
+    }
+    stSortedSet *sortedSet2 = stSortedSet_construct4(sortedSet->compareFn, destructElementFn, sortedSet->type);
     stSortedSetIterator *it = stSortedSet_getIterator(sortedSet);
     void *o;
     while((o = stSortedSet_getNext(it)) != NULL) {
@@ -99,6 +150,11 @@ void stSortedSet_destruct(stSortedSet *sortedSet) {
     // this is for an urgent bug.
     checkModifiable(sortedSet);
 #endif
+    if (sortedSet->type == stSortedSetTypeBTree) {
+        stBTree_destruct(sortedSet->bTree, sortedSet->destructElementFn);
+        free(sortedSet);
+        return;
+    }
     void *a = sortedSet->sortedSet->avl_param;
     if(sortedSet->destructElementFn != NULL) {
         st_sortedSet_destruct_destructElementFn = sortedSet->destructElementFn;
@@ -113,6 +169,10 @@ void stSortedSet_destruct(stSortedSet *sortedSet) {
 
 void stSortedSet_insert(stSortedSet *sortedSet, void *object) {
     checkModifiable(sortedSet);
+    if (sortedSet->type == stSortedSetTypeBTree) {
+        stBTree_insert(sortedSet->bTree, object);
+        return;
+    }
     // FIXME: two passes, modify avl code.
     if(stSortedSet_search(sortedSet, object) != NULL) {
         avl_replace(sortedSet->sortedSet, object);
@@ -123,41 +183,68 @@ void stSortedSet_insert(stSortedSet *sortedSet, void *object) {
 }
 
 void *stSortedSet_search(stSortedSet *sortedSet, void *object) {
+    if (sortedSet->type == stSortedSetTypeBTree) {
+        return stBTree_search(sortedSet->bTree, object);
+    }
     return avl_find(sortedSet->sortedSet, object);
 }
 
 void *stSortedSet_searchLessThanOrEqual(stSortedSet *sortedSet, void *object) {
+    if (sortedSet->type == stSortedSetTypeBTree) {
+        return stBTree_searchLessThanOrEqual(sortedSet->bTree, object);
+    }
     return avl_find_lessThanOrEqual(sortedSet->sortedSet, object);
 }
 
 void *stSortedSet_searchLessThan(stSortedSet *sortedSet, void *object) {
+    if (sortedSet->type == stSortedSetTypeBTree) {
+        return stBTree_searchLessThan(sortedSet->bTree, object);
+    }
     return avl_find_lessThan(sortedSet->sortedSet, object);
 }
 
 void *stSortedSet_searchGreaterThanOrEqual(stSortedSet *sortedSet, void *object) {
+    if (sortedSet->type == stSortedSetTypeBTree) {
+        return stBTree_searchGreaterThanOrEqual(sortedSet->bTree, object);
+    }
     return avl_find_greaterThanOrEqual(sortedSet->sortedSet, object);
 }
 
 void *stSortedSet_searchGreaterThan(stSortedSet *sortedSet, void *object) {
+    if (sortedSet->type == stSortedSetTypeBTree) {
+        return stBTree_searchGreaterThan(sortedSet->bTree, object);
+    }
     return avl_find_greaterThan(sortedSet->sortedSet, object);
 }
 
 void *stSortedSet_remove(stSortedSet *sortedSet, void *object) {
     checkModifiable(sortedSet);
+    if (sortedSet->type == stSortedSetTypeBTree) {
+        return stBTree_remove(sortedSet->bTree, object);
+    }
     return avl_delete(sortedSet->sortedSet, object);
 }
 
 int64_t stSortedSet_size(stSortedSet *sortedSet) {
+    if (sortedSet->type == stSortedSetTypeBTree) {
+        return sortedSet->bTree->size;
+    }
     return avl_count(sortedSet->sortedSet);
 }
 
 void *stSortedSet_getFirst(stSortedSet *items) {
+    if (items->type == stSortedSetTypeBTree) {
+        return stBTree_getFirst(items->bTree);
+    }
     struct avl_traverser traverser;
     avl_t_init(&traverser, items->sortedSet);
     return avl_t_first(&traverser, items->sortedSet);
 }
 
 void *stSortedSet_getLast(stSortedSet *items) {
+    if (items->type == stSortedSetTypeBTree) {
+        return stBTree_getLast(items->bTree);
+    }
     struct avl_traverser traverser;
     avl_t_init(&traverser, items->sortedSet);
     return avl_t_last(&traverser, items->sortedSet);
@@ -167,14 +254,19 @@ stSortedSetIterator *stSortedSet_getIterator(stSortedSet *items) {
     stSortedSetIterator *iterator;
     iterator = st_malloc(sizeof(stSortedSetIterator));
     iterator->sortedSet = items;
-    avl_t_init(&iterator->traverser, items->sortedSet);
+    if (items->type == stSortedSetTypeBTree) {
+        iterator->position.leaf = NULL;
+    } else {
+        avl_t_init(&iterator->traverser, items->sortedSet);
+    }
     items->numberOfLiveIterators++;
     return iterator;
 }
 
 stSortedSetIterator *stSortedSet_getIteratorFrom(stSortedSet *items, void *item) {
     stSortedSetIterator *iterator = stSortedSet_getIterator(items);
-    if(avl_t_find(&iterator->traverser, items->sortedSet, item) == NULL) {
+    if((items->type == stSortedSetTypeBTree ? stBTree_find(items->bTree, item, &iterator->position)
+                                            : avl_t_find(&iterator->traverser, items->sortedSet, item)) == NULL) {
         stSortedSet_destructIterator(iterator);
         stThrowNew(SORTED_SET_EXCEPTION_ID, "Tried to create an iterator with an item that is not in the list of items");
     }
@@ -196,6 +288,9 @@ void stSortedSet_destructIterator(stSortedSetIterator *iterator) {
 }
 
 void *stSortedSet_getNext(stSortedSetIterator *iterator) {
+    if (iterator->sortedSet->type == stSortedSetTypeBTree) {
+        return stBTree_getNext(iterator->sortedSet->bTree, &iterator->position);
+    }
     return avl_t_next(&iterator->traverser);
 }
 
@@ -204,16 +299,23 @@ stSortedSetIterator *stSortedSet_copyIterator(stSortedSetIterator *iterator) {
     copyIterator = st_malloc(sizeof(stSortedSetIterator));
     copyIterator->sortedSet = iterator->sortedSet;
     copyIterator->sortedSet->numberOfLiveIterators++;
-    avl_t_copy(&copyIterator->traverser, &iterator->traverser);
+    if (iterator->sortedSet->type == stSortedSetTypeBTree) {
+        copyIterator->position = iterator->position;
+    } else {
+        avl_t_copy(&copyIterator->traverser, &iterator->traverser);
+    }
     return copyIterator;
 }
 
 void *stSortedSet_getPrevious(stSortedSetIterator *iterator) {
+    if (iterator->sortedSet->type == stSortedSetTypeBTree) {
+        return stBTree_getPrevious(iterator->sortedSet->bTree, &iterator->position);
+    }
     return avl_t_prev(&iterator->traverser);
 }
 
 static int stSortedSet_comparatorsEqual(stSortedSet *sortedSet1, stSortedSet *sortedSet2) {
-    return stSortedSet_getComparator(sortedSet1)->compareFn == stSortedSet_getComparator(sortedSet2)->compareFn;
+    return sortedSet1->compareFn == sortedSet2->compareFn;
 }
 
 int stSortedSet_equals(stSortedSet *sortedSet1, stSortedSet *sortedSet2) {
@@ -223,7 +325,7 @@ int stSortedSet_equals(stSortedSet *sortedSet1, stSortedSet *sortedSet2) {
     if(!stSortedSet_comparatorsEqual(sortedSet1, sortedSet2)) {
         return 0;
     }
-    int (*cmpFn)(const void *, const void *) = stSortedSet_getComparator(sortedSet1)->compareFn;
+    int (*cmpFn)(const void *, const void *) = sortedSet1->compareFn;
 
     stSortedSetIterator *it1 = stSortedSet_getIterator(sortedSet1);
     stSortedSetIterator *it2 = stSortedSet_getIterator(sortedSet2);
@@ -259,7 +361,7 @@ stSortedSet *stSortedSet_getUnion(stSortedSet *sortedSet1, stSortedSet *sortedSe
     if(!stSortedSet_comparatorsEqual(sortedSet1, sortedSet2)) {
         stThrowNew(SORTED_SET_EXCEPTION_ID, "Comparators are not equal for creating the union of two sorted sets");
     }
-    stSortedSet *sortedSet3 = stSortedSet_construct3(stSortedSet_getComparator(sortedSet1)->compareFn, NULL);
+    stSortedSet *sortedSet3 = stSortedSet_construct4(sortedSet1->compareFn, NULL, sortedSet1->type);
 
     //Add those from sortedSet1
     stSortedSetIterator *it= stSortedSet_getIterator(sortedSet1);
@@ -283,7 +385,7 @@ stSortedSet *stSortedSet_getIntersection(stSortedSet *sortedSet1, stSortedSet *s
     if(!stSortedSet_comparatorsEqual(sortedSet1, sortedSet2)) {
         stThrowNew(SORTED_SET_EXCEPTION_ID, "Comparators are not equal for creating an intersection of two sorted sets");
     }
-    stSortedSet *sortedSet3 = stSortedSet_construct3(stSortedSet_getComparator(sortedSet1)->compareFn, NULL);
+    stSortedSet *sortedSet3 = stSortedSet_construct4(sortedSet1->compareFn, NULL, sortedSet1->type);
 
     //Add those from sortedSet1 only if they are also in sortedSet2
     stSortedSetIterator *it= stSortedSet_getIterator(sortedSet1);
@@ -302,7 +404,7 @@ stSortedSet *stSortedSet_getDifference(stSortedSet *sortedSet1, stSortedSet *sor
     if(!stSortedSet_comparatorsEqual(sortedSet1, sortedSet2)) {
         stThrowNew(SORTED_SET_EXCEPTION_ID, "Comparators are not equal for creating the sorted set difference");
     }
-    stSortedSet *sortedSet3 = stSortedSet_construct3(stSortedSet_getComparator(sortedSet1)->compareFn, NULL);
+    stSortedSet *sortedSet3 = stSortedSet_construct4(sortedSet1->compareFn, NULL, sortedSet1->type);
 
     //Add those from sortedSet1 only if they are not in sortedSet2
     stSortedSetIterator *it= stSortedSet_getIterator(sortedSet1);
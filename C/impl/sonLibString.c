@@ -181,76 +181,125 @@ char *stString_getSubString(const char *cA, int64_t start, int64_t length) {
     return cA2;
 }
 
-static char correctCase(char newChar, char oldChar) {
-    return toupper(oldChar) == oldChar ? toupper(newChar) : tolower(newChar);
-}
+/*
+ * The complement of each character, xor'd with the character, so that
+ * characters that are their own complement (N, S, W, and anything that
+ * is not an iupac character) are zero. Complementing a letter only changes
+ * its low five bits, so case is preserved.
+ */
+static const unsigned char complementXor[256] = {
+        ['A'] = 'A' ^ 'T', ['C'] = 'C' ^ 'G', ['G'] = 'G' ^ 'C', ['T'] = 'T' ^ 'A',
+        ['M'] = 'M' ^ 'K', ['K'] = 'K' ^ 'M', ['R'] = 'R' ^ 'Y', ['Y'] = 'Y' ^ 'R',
+        ['B'] = 'B' ^ 'V', ['V'] = 'V' ^ 'B', ['D'] = 'D' ^ 'H', ['H'] = 'H' ^ 'D',
+        ['a'] = 'a' ^ 't', ['c'] = 'c' ^ 'g', ['g'] = 'g' ^ 'c', ['t'] = 't' ^ 'a',
+        ['m'] = 'm' ^ 'k', ['k'] = 'k' ^ 'm', ['r'] = 'r' ^ 'y', ['y'] = 'y' ^ 'r',
+        ['b'] = 'b' ^ 'v', ['v'] = 'v' ^ 'b', ['d'] = 'd' ^ 'h', ['h'] = 'h' ^ 'd' };
 
 char stString_reverseComplementChar(char c) {
-    switch (c) {
-        case 'a':
-        case 'A':
-            return correctCase('t', c);
-        case 'c':
-        case 'C':
-            return correctCase('g', c);
-        case 'g':
-        case 'G':
-            return correctCase('c', c);
-        case 't':
-        case 'T':
-            return correctCase('a', c);
-
-            //Two redundant characters
-        case 'w':
-        case 'W':
-        case 's':
-        case 'S':
-            return c; //Complement is the same for S and W
-
-        case 'M':
-        case 'm':
-            return correctCase('k', c); //Complement is k
-        case 'k':
-        case 'K':
-            return correctCase('m', c); //Complement is m
+    return c ^ complementXor[(unsigned char) c];
+}
 
-        case 'r':
-        case 'R':
-            return correctCase('y', c); //Complement is y
-        case 'y':
-        case 'Y':
-            return correctCase('r', c); //Complement is r
+/*
+ * Reverse complements string[i, j) into reverseComplement, which may be the
+ * same string. Works in from both ends, reading from each end before writing
+ * either, so the in place case needs no buffer.
+ */
+static void reverseComplementScalar(const char *string, char *reverseComplement, int64_t i, int64_t j) {
+    while (i < j) {
+        char c = string[i], d = string[--j];
+        reverseComplement[i++] = stString_reverseComplementChar(d);
+        reverseComplement[j] = stString_reverseComplementChar(c);
+    }
+}
 
-            //Three redundant characters
-        case 'b':
-        case 'B':
-            return correctCase('v', c); //Complement is v
-        case 'v':
-        case 'V':
-            return correctCase('b', c); //Complement is b
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
 
-        case 'd':
-        case 'D':
-            return correctCase('h', c); //Complement is h
-        case 'h':
-        case 'H':
-            return correctCase('d', c); //Complement is d
+/*
+ * The vector versions look up the complementXor of the low five bits of
+ * each byte with two 16 entry shuffles. These are the entries for '@' to
+ * 'O' and 'P' to '_', which are the same as for '`' to 'o' and 'p' to DEL,
+ * and are applied only to bytes in that range.
+ */
+__attribute__((target("ssse3")))
+static inline __m128i reverseComplement16(__m128i v) {
+    const __m128i lowTable = _mm_loadu_si128((const __m128i *) (complementXor + 0x40));
+    const __m128i highTable = _mm_loadu_si128((const __m128i *) (complementXor + 0x50));
+    const __m128i reverse = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    __m128i index = _mm_and_si128(v, _mm_set1_epi8(0x0F));
+    __m128i isHigh = _mm_cmpeq_epi8(_mm_and_si128(v, _mm_set1_epi8(0x10)), _mm_set1_epi8(0x10));
+    __m128i x = _mm_or_si128(_mm_andnot_si128(isHigh, _mm_shuffle_epi8(lowTable, index)),
+            _mm_and_si128(isHigh, _mm_shuffle_epi8(highTable, index)));
+    __m128i isLetter = _mm_cmpeq_epi8(_mm_and_si128(v, _mm_set1_epi8((char) 0xC0)), _mm_set1_epi8(0x40));
+    return _mm_shuffle_epi8(_mm_xor_si128(v, _mm_and_si128(x, isLetter)), reverse);
+}
 
-        default: //Includes N, but also any other character.
-            return c;
+__attribute__((target("ssse3")))
+static void reverseComplementSSSE3(const char *string, char *reverseComplement, int64_t i, int64_t j) {
+    while (j - i >= 32) {
+        __m128i front = _mm_loadu_si128((const __m128i *) (string + i));
+        __m128i back = _mm_loadu_si128((const __m128i *) (string + j - 16));
+        _mm_storeu_si128((__m128i *) (reverseComplement + i), reverseComplement16(back));
+        _mm_storeu_si128((__m128i *) (reverseComplement + j - 16), reverseComplement16(front));
+        i += 16;
+        j -= 16;
     }
+    reverseComplementScalar(string, reverseComplement, i, j);
 }
 
-char *stString_reverseComplementString(const char *string) {
-    int64_t i, j;
+__attribute__((target("avx2")))
+static inline __m256i reverseComplement32(__m256i v) {
+    const __m256i lowTable = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) (complementXor + 0x40)));
+    const __m256i highTable = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) (complementXor + 0x50)));
+    const __m256i reverse = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+            15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    __m256i index = _mm256_and_si256(v, _mm256_set1_epi8(0x0F));
+    __m256i isHigh = _mm256_cmpeq_epi8(_mm256_and_si256(v, _mm256_set1_epi8(0x10)), _mm256_set1_epi8(0x10));
+    __m256i x = _mm256_blendv_epi8(_mm256_shuffle_epi8(lowTable, index), _mm256_shuffle_epi8(highTable, index),
+            isHigh);
+    __m256i isLetter = _mm256_cmpeq_epi8(_mm256_and_si256(v, _mm256_set1_epi8((char) 0xC0)),
+            _mm256_set1_epi8(0x40));
+    // The shuffle reverses each 16 byte lane, the permute swaps the lanes.
+    return _mm256_permute4x64_epi64(_mm256_shuffle_epi8(_mm256_xor_si256(v, _mm256_and_si256(x, isLetter)), reverse),
+            0x4E);
+}
 
-    j = strlen(string);
-    char *cA;
+__attribute__((target("avx2")))
+static void reverseComplementAVX2(const char *string, char *reverseComplement, int64_t i, int64_t j) {
+    while (j - i >= 64) {
+        __m256i front = _mm256_loadu_si256((const __m256i *) (string + i));
+        __m256i back = _mm256_loadu_si256((const __m256i *) (string + j - 32));
+        _mm256_storeu_si256((__m256i *) (reverseComplement + i), reverseComplement32(back));
+        _mm256_storeu_si256((__m256i *) (reverseComplement + j - 32), reverseComplement32(front));
+        i += 32;
+        j -= 32;
+    }
+    reverseComplementSSSE3(string, reverseComplement, i, j);
+}
+#endif
 
-    cA = st_malloc(sizeof(char) * (j + 1));
-    for (i = 0; i < j; i++) {
-        cA[i] = stString_reverseComplementChar(string[j - 1 - i]);
+static void reverseComplement(const char *string, char *reverseComplement, int64_t length) {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    if (__builtin_cpu_supports("avx2")) {
+        reverseComplementAVX2(string, reverseComplement, 0, length);
+        return;
     }
-    cA[j] = '\0';
+    if (__builtin_cpu_supports("ssse3")) {
+        reverseComplementSSSE3(string, reverseComplement, 0, length);
+        return;
+    }
+#endif
+    reverseComplementScalar(string, reverseComplement, 0, length);
+}
+
+char *stString_reverseComplementString(const char *string) {
+    int64_t length = strlen(string);
+    char *cA = st_malloc(sizeof(char) * (length + 1));
+    reverseComplement(string, cA, length);
+    cA[length] = '\0';
     return cA;
 }
+
+void stString_reverseComplementStringInPlace(char *string, int64_t length) {
+    reverseComplement(string, string, length);
+}
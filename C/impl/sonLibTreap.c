@@ -326,9 +326,9 @@ int stTreap_remove(long key, stTreap *tree) {
 			rmnode->parent->right = NULL;
 		}
 	}
-	free(rmnode);
 	//update parent counts
 	stTreap *p = rmnode->parent;
+	free(rmnode);
 	while(p) {
 		p->count -= 1;
 		p = p->parent;
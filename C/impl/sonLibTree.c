@@ -423,3 +423,130 @@ stTree *stTree_getMRCA(stTree *node1, stTree *node2) {
     stSet_destruct(parents);
     return ret;
 }
+
+/*
+ * The index numbers the nodes in preorder. For two nodes numbered
+ * u < v, their MRCA is u if u is an ancestor of v, and otherwise the
+ * parent of the shallowest node numbered in (u, v]; in either case it
+ * is the parent of the shallowest node numbered in (u, v], which is
+ * found with a sparse table of range minima.
+ */
+
+struct _stTreeLCAIndex {
+    int64_t numNodes;
+    stTree **nodes; // In preorder.
+    int64_t *parents; // -1 for the root.
+    int64_t *depths;
+    double *rootDistances;
+    stHash *nodesToNumbers; // Each node to its entry in nodes.
+    int64_t numLevels;
+    int32_t **shallowest; // shallowest[k][i] is the shallowest node numbered in [i, i + 2^k).
+};
+
+stTreeLCAIndex *stTreeLCAIndex_construct(stTree *root) {
+    stTreeLCAIndex *index = st_malloc(sizeof(stTreeLCAIndex));
+    int64_t numNodes = stTree_getNumNodes(root);
+    assert(numNodes <= INT32_MAX);
+    index->numNodes = numNodes;
+    index->nodes = st_malloc(numNodes * sizeof(stTree *));
+    index->parents = st_malloc(numNodes * sizeof(int64_t));
+    index->depths = st_malloc(numNodes * sizeof(int64_t));
+    index->rootDistances = st_malloc(numNodes * sizeof(double));
+    index->nodesToNumbers = stHash_construct();
+
+    // Number the nodes in preorder with a stack, rather than
+    // recursing, so deep trees are fine. Each node on the stack is
+    // paired with the number of its parent.
+    stTree **stack = st_malloc(numNodes * sizeof(stTree *));
+    int64_t *stackParents = st_malloc(numNodes * sizeof(int64_t));
+    int64_t stackLength = 0, numNumbered = 0;
+    stack[stackLength] = root;
+    stackParents[stackLength++] = -1;
+    while (stackLength > 0) {
+        stTree *node = stack[--stackLength];
+        int64_t parent = stackParents[stackLength];
+        int64_t i = numNumbered++;
+        index->nodes[i] = node;
+        index->parents[i] = parent;
+        index->depths[i] = parent == -1 ? 0 : index->depths[parent] + 1;
+        index->rootDistances[i] = parent == -1 ? 0.0 : index->rootDistances[parent] + stTree_getBranchLength(node);
+        stHash_insert(index->nodesToNumbers, node, &index->nodes[i]);
+        for (int64_t j = stTree_getChildNumber(node) - 1; j >= 0; j--) {
+            stack[stackLength] = stTree_getChild(node, j);
+            stackParents[stackLength++] = i;
+        }
+    }
+    assert(numNumbered == numNodes);
+    free(stack);
+    free(stackParents);
+
+    index->numLevels = 1;
+    while ((((int64_t) 1) << index->numLevels) <= numNodes) {
+        index->numLevels++;
+    }
+    index->shallowest = st_malloc(index->numLevels * sizeof(int32_t *));
+    index->shallowest[0] = st_malloc(numNodes * sizeof(int32_t));
+    for (int64_t i = 0; i < numNodes; i++) {
+        index->shallowest[0][i] = i;
+    }
+    for (int64_t k = 1; k < index->numLevels; k++) {
+        int64_t half = ((int64_t) 1) << (k - 1), length = numNodes - 2 * half + 1;
+        index->shallowest[k] = st_malloc(length * sizeof(int32_t));
+        for (int64_t i = 0; i < length; i++) {
+            int32_t left = index->shallowest[k - 1][i], right = index->shallowest[k - 1][i + half];
+            index->shallowest[k][i] = index->depths[right] < index->depths[left] ? right : left;
+        }
+    }
+    return index;
+}
+
+void stTreeLCAIndex_destruct(stTreeLCAIndex *index) {
+    for (int64_t k = 0; k < index->numLevels; k++) {
+        free(index->shallowest[k]);
+    }
+    free(index->shallowest);
+    stHash_destruct(index->nodesToNumbers);
+    free(index->rootDistances);
+    free(index->depths);
+    free(index->parents);
+    free(index->nodes);
+    free(index);
+}
+
+// Returns the preorder number of the node, or -1 if it isn't indexed.
+static int64_t stTreeLCAIndex_getNumber(stTreeLCAIndex *index, stTree *node) {
+    stTree **entry = stHash_search(index->nodesToNumbers, node);
+    return entry == NULL ? -1 : entry - index->nodes;
+}
+
+// Returns the number of the MRCA of the nodes with the given numbers.
+static int64_t stTreeLCAIndex_getMRCANumber(stTreeLCAIndex *index, int64_t i, int64_t j) {
+    if (i == j) {
+        return i;
+    }
+    if (i > j) {
+        int64_t k = i;
+        i = j;
+        j = k;
+    }
+    // The shallowest node numbered in (i, j] is a child of the MRCA.
+    int64_t start = i + 1, length = j - i;
+    int64_t k = 63 - __builtin_clzll((uint64_t) length);
+    int32_t left = index->shallowest[k][start], right = index->shallowest[k][j + 1 - (((int64_t) 1) << k)];
+    return index->parents[index->depths[right] < index->depths[left] ? right : left];
+}
+
+stTree *stTreeLCAIndex_getMRCA(stTreeLCAIndex *index, stTree *node1, stTree *node2) {
+    int64_t i = stTreeLCAIndex_getNumber(index, node1), j = stTreeLCAIndex_getNumber(index, node2);
+    if (i == -1 || j == -1) {
+        return NULL;
+    }
+    return index->nodes[stTreeLCAIndex_getMRCANumber(index, i, j)];
+}
+
+double stTreeLCAIndex_getDistance(stTreeLCAIndex *index, stTree *node1, stTree *node2) {
+    int64_t i = stTreeLCAIndex_getNumber(index, node1), j = stTreeLCAIndex_getNumber(index, node2);
+    assert(i != -1 && j != -1);
+    int64_t mrca = stTreeLCAIndex_getMRCANumber(index, i, j);
+    return index->rootDistances[i] + index->rootDistances[j] - 2 * index->rootDistances[mrca];
+}
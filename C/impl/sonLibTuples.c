@@ -74,24 +74,181 @@ stIntTuple *stIntTuple_constructN(int64_t length, const int64_t iA[]) {
     return intTuple;
 }
 
+/*
+ * Inline tuples are held in the bits of the pointer itself, marked by its low bit, which
+ * is clear in any allocated tuple. Bit 1 is set for a pair, whose values are held in bits
+ * 2 to 32 and 33 to 63; a single value is held in bits 2 to 63. Equal inline tuples are
+ * the same pointer.
+ */
+#define INLINE_TUPLE_TAG 1
+#define INLINE_TUPLE_PAIR 2
+
+static inline bool isInline(stIntTuple *intTuple) {
+    return ((uintptr_t) intTuple & INLINE_TUPLE_TAG) != 0;
+}
+
+static inline bool fitsInBits(int64_t value, int bits) {
+    return value >= -(INT64_C(1) << (bits - 1)) && value < (INT64_C(1) << (bits - 1));
+}
+
+stIntTuple *stIntTuple_constructInline1(int64_t value) {
+#if UINTPTR_MAX == UINT64_MAX
+    if (fitsInBits(value, 62)) {
+        return (stIntTuple *) (uintptr_t) (((uint64_t) value << 2) | INLINE_TUPLE_TAG);
+    }
+#endif
+    return stIntTuple_construct1(value);
+}
+
+stIntTuple *stIntTuple_constructInline2(int64_t value1, int64_t value2) {
+#if UINTPTR_MAX == UINT64_MAX
+    if (fitsInBits(value1, 31) && fitsInBits(value2, 31)) {
+        return (stIntTuple *) (uintptr_t) (((uint64_t) value2 << 33) | (((uint64_t) value1 & 0x7FFFFFFF) << 2)
+                                           | INLINE_TUPLE_PAIR | INLINE_TUPLE_TAG);
+    }
+#endif
+    return stIntTuple_construct2(value1, value2);
+}
+
+bool stIntTuple_isInline(stIntTuple *intTuple) {
+    return isInline(intTuple);
+}
+
+/*
+ * Returns the values of the tuple and sets its length. The values of an inline
+ * tuple are unpacked into the buffer.
+ */
+static inline const int64_t *getValues(stIntTuple *intTuple, int64_t *length, int64_t buffer[2]) {
+    if (!isInline(intTuple)) {
+        *length = intTuple[0];
+        return intTuple + 1;
+    }
+    int64_t bits = (int64_t) (uintptr_t) intTuple;
+    if (bits & INLINE_TUPLE_PAIR) {
+        buffer[0] = ((int64_t) ((uint64_t) bits << 31)) >> 33;
+        buffer[1] = bits >> 33;
+        *length = 2;
+    } else {
+        buffer[0] = bits >> 2;
+        *length = 1;
+    }
+    return buffer;
+}
+
 void stIntTuple_destruct(stIntTuple *intTuple) {
-    free(intTuple);
+    if (!isInline(intTuple)) {
+        free(intTuple);
+    }
 }
 
-uint64_t stIntTuple_hashKey(stIntTuple *intTuple) {
-    int64_t i;
-    uint64_t j = 0;
+/*
+ * The hash of a tuple of four or more values first accumulates the values in four
+ * independent lanes, each adding the value and the product of the two halves of the
+ * value xored with a lane key, as in xxHash3, which maps onto 32x32->64 bit vector
+ * multiplies. The vector and scalar versions give the same hash.
+ */
+#define TUPLE_HASH_MULTIPLIER UINT64_C(0x9E3779B97F4A7C15)
 
-    for (i = 0; i < stIntTuple_length(intTuple); i++) {
-        //j += stIntTuple_getPosition(intTuple, i);
+static const uint64_t tupleHashLaneKeys[4] = { UINT64_C(0xBE4BA423396CFEB8), UINT64_C(0x1CAD21F72C81017C),
+        UINT64_C(0xDB979083E96DD4DE), UINT64_C(0x1F67B3B7A4A44072) };
 
-        // djb2
-        // This algorithm was first reported by Dan Bernstein
-        // many years ago in comp.lang.c
-        //
-        j = stIntTuple_get(intTuple, i) + (j << 6) + (j << 16) - j;
+static inline uint64_t mixHash(uint64_t h) {
+    h = (h ^ (h >> 33)) * UINT64_C(0xFF51AFD7ED558CCD);
+    h = (h ^ (h >> 33)) * UINT64_C(0xC4CEB9FE1A85EC53);
+    return h ^ (h >> 33);
+}
+
+static void accumulateScalar(uint64_t lanes[4], const int64_t *values, int64_t blocks) {
+    for (int64_t i = 0; i < blocks * 4; i += 4) {
+        for (int64_t j = 0; j < 4; j++) {
+            uint64_t v = (uint64_t) values[i + j], k = v ^ tupleHashLaneKeys[j];
+            lanes[j] += v + (k & 0xFFFFFFFF) * (k >> 32);
+        }
     }
-    return j;
+}
+
+/*
+ * Returns the index of the first position at which the values differ, or length.
+ */
+static int64_t firstMismatchScalar(const int64_t *values1, const int64_t *values2, int64_t length) {
+    int64_t i = 0;
+    while (i < length && values1[i] == values2[i]) {
+        i++;
+    }
+    return i;
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+
+__attribute__((target("avx2")))
+static void accumulateAVX2(uint64_t lanes[4], const int64_t *values, int64_t blocks) {
+    __m256i accumulator = _mm256_loadu_si256((const __m256i *) lanes);
+    const __m256i keys = _mm256_loadu_si256((const __m256i *) tupleHashLaneKeys);
+    for (int64_t i = 0; i < blocks * 4; i += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (values + i));
+        __m256i k = _mm256_xor_si256(v, keys);
+        __m256i product = _mm256_mul_epu32(k, _mm256_srli_epi64(k, 32));
+        accumulator = _mm256_add_epi64(accumulator, _mm256_add_epi64(v, product));
+    }
+    _mm256_storeu_si256((__m256i *) lanes, accumulator);
+}
+
+__attribute__((target("avx2")))
+static int64_t firstMismatchAVX2(const int64_t *values1, const int64_t *values2, int64_t length) {
+    int64_t i = 0;
+    for (; i + 4 <= length; i += 4) {
+        __m256i equal = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *) (values1 + i)),
+                                           _mm256_loadu_si256((const __m256i *) (values2 + i)));
+        int mask = _mm256_movemask_pd(_mm256_castsi256_pd(equal));
+        if (mask != 0xF) {
+            return i + __builtin_ctz(~mask);
+        }
+    }
+    return i + firstMismatchScalar(values1 + i, values2 + i, length - i);
+}
+#endif
+
+// Tuples shorter than this are hashed and compared without the vector code.
+#define TUPLE_VECTOR_LENGTH 8
+
+static void accumulate(uint64_t lanes[4], const int64_t *values, int64_t blocks) {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    if (__builtin_cpu_supports("avx2")) {
+        accumulateAVX2(lanes, values, blocks);
+        return;
+    }
+#endif
+    accumulateScalar(lanes, values, blocks);
+}
+
+static int64_t firstMismatch(const int64_t *values1, const int64_t *values2, int64_t length) {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    if (length >= TUPLE_VECTOR_LENGTH && __builtin_cpu_supports("avx2")) {
+        return firstMismatchAVX2(values1, values2, length);
+    }
+#endif
+    return firstMismatchScalar(values1, values2, length);
+}
+
+uint64_t stIntTuple_hashKey(stIntTuple *intTuple) {
+    int64_t length, buffer[2];
+    const int64_t *values = getValues(intTuple, &length, buffer);
+    uint64_t h = (uint64_t) length * TUPLE_HASH_MULTIPLIER;
+    int64_t i = 0;
+    if (length >= TUPLE_VECTOR_LENGTH) {
+        uint64_t lanes[4] = { tupleHashLaneKeys[0], tupleHashLaneKeys[1], tupleHashLaneKeys[2],
+                tupleHashLaneKeys[3] };
+        accumulate(lanes, values, length / 4);
+        for (int64_t j = 0; j < 4; j++) {
+            h = (h ^ mixHash(lanes[j])) * TUPLE_HASH_MULTIPLIER;
+        }
+        i = length / 4 * 4;
+    }
+    for (; i < length; i++) {
+        h = (h ^ (uint64_t) values[i]) * TUPLE_HASH_MULTIPLIER;
+    }
+    return mixHash(h);
 }
 
 static int intCmp(int64_t i, int64_t j) {
@@ -99,36 +256,102 @@ static int intCmp(int64_t i, int64_t j) {
 }
 
 int stIntTuple_cmpFn(stIntTuple *intTuple1, stIntTuple *intTuple2) {
-    int64_t
-            i,
-            j =
-                    stIntTuple_length(intTuple1) < stIntTuple_length(intTuple2) ? stIntTuple_length(
-                            intTuple1)
-                            : stIntTuple_length(intTuple2);
-    for (i = 0; i < j; i++) {
-        int64_t k = intCmp(stIntTuple_get(intTuple1, i)
-                ,stIntTuple_get(intTuple2, i));
-        if (k != 0) {
-            return k;
-        }
+    int64_t length1, length2, buffer1[2], buffer2[2];
+    const int64_t *values1 = getValues(intTuple1, &length1, buffer1);
+    const int64_t *values2 = getValues(intTuple2, &length2, buffer2);
+    int64_t i = firstMismatch(values1, values2, length1 < length2 ? length1 : length2);
+    if (i < length1 && i < length2) {
+        return intCmp(values1[i], values2[i]);
     }
-    return intCmp(stIntTuple_length(intTuple1), stIntTuple_length(intTuple2));
+    return intCmp(length1, length2);
 }
 
 int stIntTuple_equalsFn(stIntTuple *intTuple1, stIntTuple *intTuple2) {
-    return stIntTuple_cmpFn(intTuple1, intTuple2) == 0;
+    if (intTuple1 == intTuple2) {
+        return 1;
+    }
+    int64_t length1, length2, buffer1[2], buffer2[2];
+    const int64_t *values1 = getValues(intTuple1, &length1, buffer1);
+    const int64_t *values2 = getValues(intTuple2, &length2, buffer2);
+    return length1 == length2 && firstMismatch(values1, values2, length1) == length1;
 }
 
 int64_t stIntTuple_length(stIntTuple *intTuple) {
+    if (isInline(intTuple)) {
+        return ((uintptr_t) intTuple & INLINE_TUPLE_PAIR) ? 2 : 1;
+    }
     return intTuple[0];
 }
 
 int64_t stIntTuple_get(stIntTuple *intTuple, int64_t index) {
     assert(index < stIntTuple_length(intTuple));
     assert(index >= 0);
+    if (isInline(intTuple)) {
+        int64_t length, buffer[2];
+        return getValues(intTuple, &length, buffer)[index];
+    }
     return intTuple[index + 1];
 }
 
+/*
+ * Interned tuples are kept in an open addressing set and allocated from an arena, as
+ * they are all freed together.
+ */
+struct _stIntTupleInterner {
+    stSet *tuples;
+    stArena *arena;
+};
+
+stIntTupleInterner *stIntTupleInterner_construct(void) {
+    stIntTupleInterner *interner = st_malloc(sizeof(stIntTupleInterner));
+    interner->tuples = stSet_construct4((uint64_t (*)(const void *)) stIntTuple_hashKey,
+                                        (int (*)(const void *, const void *)) stIntTuple_equalsFn, NULL,
+                                        stHashTypeOpenAddressing);
+    interner->arena = stArena_construct();
+    return interner;
+}
+
+void stIntTupleInterner_destruct(stIntTupleInterner *interner) {
+    stSet_destruct(interner->tuples);
+    stArena_destruct(interner->arena);
+    free(interner);
+}
+
+stIntTuple *stIntTupleInterner_intern(stIntTupleInterner *interner, int64_t length, const int64_t values[]) {
+    assert(length >= 0);
+    if (length == 1 && fitsInBits(values[0], 62)) {
+        return stIntTuple_constructInline1(values[0]);
+    }
+    if (length == 2 && fitsInBits(values[0], 31) && fitsInBits(values[1], 31)) {
+        return stIntTuple_constructInline2(values[0], values[1]);
+    }
+    // Look the values up as a tuple built on the stack, if it is short enough.
+    int64_t buffer[17];
+    stIntTuple *query = length < 17 ? buffer : st_malloc(sizeof(int64_t) * (length + 1));
+    query[0] = length;
+    memcpy(query + 1, values, sizeof(int64_t) * length);
+    stIntTuple *intTuple = stSet_search(interner->tuples, query);
+    if (intTuple == NULL) {
+        intTuple = stArena_malloc(interner->arena, sizeof(int64_t) * (length + 1));
+        memcpy(intTuple, query, sizeof(int64_t) * (length + 1));
+        stSet_insert(interner->tuples, intTuple);
+    }
+    if (query != buffer) {
+        free(query);
+    }
+    return intTuple;
+}
+
+stIntTuple *stIntTupleInterner_internTuple(stIntTupleInterner *interner, stIntTuple *intTuple) {
+    int64_t length, buffer[2];
+    const int64_t *values = getValues(intTuple, &length, buffer);
+    return stIntTupleInterner_intern(interner, length, values);
+}
+
+int64_t stIntTupleInterner_size(stIntTupleInterner *interner) {
+    return stSet_size(interner->tuples);
+}
+
 /*
  * The following are double variants of the above functions.
  */
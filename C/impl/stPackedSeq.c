@@ -0,0 +1,384 @@
+// Base i of a sequence is held in bits 2 * (i % 32) and up of word
+// i / 32, so strings are packed and unpacked a word at a time. The
+// bases of characters other than A, C, G and T are packed as A or T,
+// which keeps them out of the G and C count, and the characters are
+// kept, upper cased, in a sorted array of runs. Lower case letters are
+// kept in a second sorted array of runs. The words past the end of
+// the sequence are always zero.
+#include "sonLibGlobalsInternal.h"
+
+const char *ST_PACKED_SEQ_EXCEPTION = "ST_PACKED_SEQ_EXCEPTION";
+
+#define BASES_PER_WORD 32
+
+typedef struct _run {
+    int64_t start;
+    int64_t length;
+    char base; // The character of a run of other characters.
+} run;
+
+typedef struct _runArray {
+    run *runs;
+    int64_t length;
+    int64_t maxLength;
+} runArray;
+
+struct _stPackedSeq {
+    int64_t length;
+    uint64_t *words;
+    int64_t maxWords;
+    runArray otherRuns;
+    runArray lowerCaseRuns;
+};
+
+struct _stPackedSeqKmerIterator {
+    stPackedSeq *seq;
+    uint64_t mask;
+    int64_t k;
+    int64_t i; // The next base to add to the k-mer.
+    int64_t otherRun; // The first run of other characters not before i.
+    uint64_t kmer;
+    int64_t kmerLength; // The number of bases in kmer, up to k.
+};
+
+static inline int64_t getWordNumber(int64_t length) {
+    return (length + BASES_PER_WORD - 1) / BASES_PER_WORD;
+}
+
+// Add a run, merging it into the last run if it carries on from it.
+static void runArray_append(runArray *runs, int64_t start, int64_t length, char base) {
+    if (runs->length > 0) {
+        run *last = &runs->runs[runs->length - 1];
+        if (last->start + last->length == start && last->base == base) {
+            last->length += length;
+            return;
+        }
+    }
+    if (runs->length == runs->maxLength) {
+        runs->maxLength = runs->maxLength * 2 + 4;
+        runs->runs = st_realloc(runs->runs, runs->maxLength * sizeof(run));
+    }
+    run *r = &runs->runs[runs->length++];
+    r->start = start;
+    r->length = length;
+    r->base = base;
+}
+
+// Returns the index of the first run that ends after position.
+static int64_t runArray_find(runArray *runs, int64_t position) {
+    int64_t low = 0, high = runs->length;
+    while (low < high) {
+        int64_t middle = (low + high) / 2;
+        if (runs->runs[middle].start + runs->runs[middle].length <= position) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// Add the runs of the interval [start, start + length), less start.
+static void runArray_appendInterval(runArray *runs, runArray *runsToAppend, int64_t start, int64_t length) {
+    for (int64_t i = runArray_find(runsToAppend, start); i < runsToAppend->length; i++) {
+        run *r = &runsToAppend->runs[i];
+        if (r->start >= start + length) {
+            break;
+        }
+        int64_t runStart = r->start > start ? r->start : start;
+        int64_t runEnd = r->start + r->length < start + length ? r->start + r->length : start + length;
+        runArray_append(runs, runStart - start, runEnd - runStart, r->base);
+    }
+}
+
+// Add a run for each stretch of set bits in the mask of a block
+// starting at position.
+static void runArray_appendMask(runArray *runs, int64_t position, uint64_t mask) {
+    while (mask != 0) {
+        int64_t start = __builtin_ctzll(mask);
+        int64_t length = __builtin_ctzll(~(mask >> start)); // The mask has at most 32 bits set.
+        runArray_append(runs, position + start, length, 0);
+        mask &= ~(((UINT64_C(1) << length) - 1) << start);
+    }
+}
+
+static stPackedSeq *stPackedSeq_constructEmpty(int64_t maxLength) {
+    stPackedSeq *seq = st_calloc(1, sizeof(stPackedSeq));
+    seq->maxWords = getWordNumber(maxLength) > 0 ? getWordNumber(maxLength) : 1;
+    seq->words = st_calloc(seq->maxWords, sizeof(uint64_t));
+    return seq;
+}
+
+stPackedSeq *stPackedSeq_construct(const char *string) {
+    return stPackedSeq_construct2(string, strlen(string));
+}
+
+stPackedSeq *stPackedSeq_construct2(const char *string, int64_t length) {
+    stPackedSeq *seq = stPackedSeq_constructEmpty(length);
+    stPackedSeq_append(seq, string, length);
+    return seq;
+}
+
+void stPackedSeq_destruct(stPackedSeq *seq) {
+    free(seq->words);
+    free(seq->otherRuns.runs);
+    free(seq->lowerCaseRuns.runs);
+    free(seq);
+}
+
+// Packs up to 32 characters, setting the bits of the masks for the
+// characters other than A, C, G and T and for lower case letters.
+static inline uint64_t packBlock(const char *string, int64_t length, uint64_t *otherMask, uint64_t *lowerCaseMask) {
+    uint64_t packed = 0, other = 0, lowerCase = 0;
+    for (int64_t i = 0; i < length; i++) {
+        uint64_t c = (unsigned char) string[i];
+        uint64_t upperCase = c & ~UINT64_C(0x20);
+        uint64_t isBase = (upperCase == 'A') | (upperCase == 'C') | (upperCase == 'G') | (upperCase == 'T');
+        // Maps A, C, G and T, in either case, to 0, 1, 2 and 3.
+        packed |= (((c >> 1) ^ (c >> 2)) & 3 & -isBase) << (2 * i);
+        other |= (isBase ^ 1) << i;
+        lowerCase |= (uint64_t) (c - 'a' < 26) << i;
+    }
+    *otherMask = other;
+    *lowerCaseMask = lowerCase;
+    return packed;
+}
+
+// As packBlock, for a whole word of 32 characters. The characters are
+// first coded a byte each, in a loop the compiler vectorises, then
+// packed with fixed shifts. The masks are only built if needed.
+static inline uint64_t packWord(const char *string, uint64_t *otherMask, uint64_t *lowerCaseMask) {
+    unsigned char codes[BASES_PER_WORD], others[BASES_PER_WORD], lowerCases[BASES_PER_WORD];
+    unsigned char anyOther = 0, anyLowerCase = 0;
+    for (int i = 0; i < BASES_PER_WORD; i++) {
+        unsigned char c = (unsigned char) string[i];
+        unsigned char upperCase = c & 0xDF;
+        unsigned char isBase = (unsigned char) (upperCase == 'A') + (unsigned char) (upperCase == 'C')
+                + (unsigned char) (upperCase == 'G') + (unsigned char) (upperCase == 'T');
+        codes[i] = (unsigned char) ((c >> 1) ^ (c >> 2)) & 3 & (unsigned char) -isBase;
+        others[i] = isBase ^ 1;
+        lowerCases[i] = (unsigned char) (c - 'a') < 26;
+        anyOther |= others[i];
+        anyLowerCase |= lowerCases[i];
+    }
+    uint64_t packed = 0, other = 0, lowerCase = 0;
+    for (int64_t i = 0; i < BASES_PER_WORD; i += 4) {
+        packed |= (uint64_t) (codes[i] | codes[i + 1] << 2 | codes[i + 2] << 4 | codes[i + 3] << 6) << (2 * i);
+    }
+    if (anyOther) {
+        for (int64_t i = 0; i < BASES_PER_WORD; i++) {
+            other |= (uint64_t) others[i] << i;
+        }
+    }
+    if (anyLowerCase) {
+        for (int64_t i = 0; i < BASES_PER_WORD; i++) {
+            lowerCase |= (uint64_t) lowerCases[i] << i;
+        }
+    }
+    *otherMask = other;
+    *lowerCaseMask = lowerCase;
+    return packed;
+}
+
+void stPackedSeq_append(stPackedSeq *seq, const char *string, int64_t length) {
+    if (getWordNumber(seq->length + length) > seq->maxWords) {
+        int64_t maxWords = 2 * getWordNumber(seq->length + length);
+        seq->words = st_realloc(seq->words, maxWords * sizeof(uint64_t));
+        memset(seq->words + seq->maxWords, 0, (maxWords - seq->maxWords) * sizeof(uint64_t));
+        seq->maxWords = maxWords;
+    }
+    int64_t i = 0;
+    while (i < length) { // A block at a time, each filling the rest of a word.
+        int64_t offset = seq->length % BASES_PER_WORD;
+        int64_t blockLength = BASES_PER_WORD - offset < length - i ? BASES_PER_WORD - offset : length - i;
+        uint64_t otherMask, lowerCaseMask;
+        seq->words[seq->length / BASES_PER_WORD] |= (blockLength == BASES_PER_WORD
+                ? packWord(string + i, &otherMask, &lowerCaseMask)
+                : packBlock(string + i, blockLength, &otherMask, &lowerCaseMask)) << (2 * offset);
+        while (otherMask != 0) {
+            int64_t j = __builtin_ctzll(otherMask);
+            runArray_append(&seq->otherRuns, seq->length + j, 1, toupper((unsigned char) string[i + j]));
+            otherMask &= otherMask - 1;
+        }
+        if (lowerCaseMask != 0) {
+            runArray_appendMask(&seq->lowerCaseRuns, seq->length, lowerCaseMask);
+        }
+        seq->length += blockLength;
+        i += blockLength;
+    }
+}
+
+int64_t stPackedSeq_getLength(stPackedSeq *seq) {
+    return seq->length;
+}
+
+static void checkInterval(stPackedSeq *seq, int64_t start, int64_t length) {
+    if (start < 0 || length < 0 || start + length > seq->length) {
+        stThrowNew(ST_PACKED_SEQ_EXCEPTION,
+                   "Interval %" PRIi64 "-%" PRIi64 " is not within packed sequence of length %" PRIi64,
+                   start, start + length, seq->length);
+    }
+}
+
+// Unpack the interval [start, start + length) into string.
+static void unpack(stPackedSeq *seq, int64_t start, int64_t length, char *string) {
+    static const char bases[] = "ACGT";
+    int64_t i = 0;
+    while (i < length) {
+        int64_t offset = (start + i) % BASES_PER_WORD;
+        int64_t blockLength = BASES_PER_WORD - offset < length - i ? BASES_PER_WORD - offset : length - i;
+        uint64_t word = seq->words[(start + i) / BASES_PER_WORD] >> (2 * offset);
+        for (int64_t j = 0; j < blockLength; j++) {
+            string[i + j] = bases[(word >> (2 * j)) & 3];
+        }
+        i += blockLength;
+    }
+    for (int64_t j = runArray_find(&seq->otherRuns, start); j < seq->otherRuns.length; j++) {
+        run *r = &seq->otherRuns.runs[j];
+        if (r->start >= start + length) {
+            break;
+        }
+        int64_t runStart = r->start > start ? r->start : start;
+        int64_t runEnd = r->start + r->length < start + length ? r->start + r->length : start + length;
+        memset(string + runStart - start, r->base, runEnd - runStart);
+    }
+    for (int64_t j = runArray_find(&seq->lowerCaseRuns, start); j < seq->lowerCaseRuns.length; j++) {
+        run *r = &seq->lowerCaseRuns.runs[j];
+        if (r->start >= start + length) {
+            break;
+        }
+        int64_t runStart = r->start > start ? r->start : start;
+        int64_t runEnd = r->start + r->length < start + length ? r->start + r->length : start + length;
+        for (int64_t k = runStart; k < runEnd; k++) {
+            string[k - start] |= 0x20;
+        }
+    }
+}
+
+char stPackedSeq_getBase(stPackedSeq *seq, int64_t i) {
+    checkInterval(seq, i, 1);
+    char base;
+    unpack(seq, i, 1, &base);
+    return base;
+}
+
+char *stPackedSeq_getString(stPackedSeq *seq) {
+    return stPackedSeq_getSubstring(seq, 0, seq->length);
+}
+
+char *stPackedSeq_getSubstring(stPackedSeq *seq, int64_t start, int64_t length) {
+    checkInterval(seq, start, length);
+    char *string = st_malloc(length + 1);
+    unpack(seq, start, length, string);
+    string[length] = '\0';
+    return string;
+}
+
+stPackedSeq *stPackedSeq_getSubsequence(stPackedSeq *seq, int64_t start, int64_t length) {
+    checkInterval(seq, start, length);
+    stPackedSeq *subsequence = stPackedSeq_constructEmpty(length);
+    int64_t wordNumber = getWordNumber(length), seqWordNumber = getWordNumber(seq->length);
+    int64_t firstWord = start / BASES_PER_WORD, shift = 2 * (start % BASES_PER_WORD);
+    for (int64_t i = 0; i < wordNumber; i++) {
+        uint64_t word = seq->words[firstWord + i] >> shift;
+        if (shift > 0 && firstWord + i + 1 < seqWordNumber) {
+            word |= seq->words[firstWord + i + 1] << (64 - shift);
+        }
+        subsequence->words[i] = word;
+    }
+    if (length % BASES_PER_WORD != 0) { // Clear the bases past the end.
+        subsequence->words[wordNumber - 1] &= (UINT64_C(1) << (2 * (length % BASES_PER_WORD))) - 1;
+    }
+    subsequence->length = length;
+    runArray_appendInterval(&subsequence->otherRuns, &seq->otherRuns, start, length);
+    runArray_appendInterval(&subsequence->lowerCaseRuns, &seq->lowerCaseRuns, start, length);
+    return subsequence;
+}
+
+// Reverses the order of the 32 bases in the word.
+static inline uint64_t reverseWord(uint64_t word) {
+    word = ((word >> 2) & UINT64_C(0x3333333333333333)) | ((word & UINT64_C(0x3333333333333333)) << 2);
+    word = ((word >> 4) & UINT64_C(0x0F0F0F0F0F0F0F0F)) | ((word & UINT64_C(0x0F0F0F0F0F0F0F0F)) << 4);
+    return __builtin_bswap64(word);
+}
+
+stPackedSeq *stPackedSeq_reverseComplement(stPackedSeq *seq) {
+    stPackedSeq *reverseComplement = stPackedSeq_constructEmpty(seq->length);
+    int64_t wordNumber = getWordNumber(seq->length);
+    uint64_t *words = reverseComplement->words;
+    // Complementing a base is flipping its bits, as A, C, G and T are 0, 1, 2 and 3.
+    for (int64_t i = 0; i < wordNumber; i++) {
+        words[i] = ~reverseWord(seq->words[wordNumber - 1 - i]);
+    }
+    // The reversed padding at the end of the last word is now at the
+    // start of the first, so move the bases down over it.
+    int64_t shift = 2 * (wordNumber * BASES_PER_WORD - seq->length);
+    if (shift > 0) {
+        for (int64_t i = 0; i < wordNumber; i++) {
+            words[i] = (words[i] >> shift) | (i + 1 < wordNumber ? words[i + 1] << (64 - shift) : 0);
+        }
+    }
+    reverseComplement->length = seq->length;
+    for (int64_t i = seq->otherRuns.length - 1; i >= 0; i--) {
+        run *r = &seq->otherRuns.runs[i];
+        runArray_append(&reverseComplement->otherRuns, seq->length - r->start - r->length, r->length,
+                        stString_reverseComplementChar(r->base));
+    }
+    for (int64_t i = seq->lowerCaseRuns.length - 1; i >= 0; i--) {
+        run *r = &seq->lowerCaseRuns.runs[i];
+        runArray_append(&reverseComplement->lowerCaseRuns, seq->length - r->start - r->length, r->length, 0);
+    }
+    return reverseComplement;
+}
+
+int64_t stPackedSeq_getGCCount(stPackedSeq *seq) {
+    int64_t gcCount = 0, wordNumber = getWordNumber(seq->length);
+    for (int64_t i = 0; i < wordNumber; i++) {
+        // C and G, 1 and 2, are the bases whose two bits differ.
+        uint64_t word = seq->words[i];
+        gcCount += __builtin_popcountll((word ^ (word >> 1)) & UINT64_C(0x5555555555555555));
+    }
+    return gcCount;
+}
+
+int64_t stPackedSeq_getMemoryUsage(stPackedSeq *seq) {
+    return sizeof(stPackedSeq) + seq->maxWords * sizeof(uint64_t)
+            + (seq->otherRuns.maxLength + seq->lowerCaseRuns.maxLength) * sizeof(run);
+}
+
+stPackedSeqKmerIterator *stPackedSeq_getKmerIterator(stPackedSeq *seq, int64_t k) {
+    if (k < 1 || k > BASES_PER_WORD) {
+        stThrowNew(ST_PACKED_SEQ_EXCEPTION, "K-mers must be between 1 and 32 bases long, not %" PRIi64, k);
+    }
+    stPackedSeqKmerIterator *it = st_calloc(1, sizeof(stPackedSeqKmerIterator));
+    it->seq = seq;
+    it->k = k;
+    it->mask = k == BASES_PER_WORD ? ~UINT64_C(0) : (UINT64_C(1) << (2 * k)) - 1;
+    return it;
+}
+
+bool stPackedSeqKmerIterator_getNext(stPackedSeqKmerIterator *it, uint64_t *kmer, int64_t *position) {
+    stPackedSeq *seq = it->seq;
+    while (it->i < seq->length) {
+        if (it->otherRun < seq->otherRuns.length && seq->otherRuns.runs[it->otherRun].start <= it->i) {
+            // Start again after the run.
+            run *r = &seq->otherRuns.runs[it->otherRun++];
+            it->i = r->start + r->length;
+            it->kmerLength = 0;
+            continue;
+        }
+        uint64_t base = (seq->words[it->i / BASES_PER_WORD] >> (2 * (it->i % BASES_PER_WORD))) & 3;
+        it->kmer = ((it->kmer << 2) | base) & it->mask;
+        it->i++;
+        if (++it->kmerLength >= it->k) {
+            *kmer = it->kmer;
+            *position = it->i - it->k;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void stPackedSeq_destructKmerIterator(stPackedSeqKmerIterator *it) {
+    free(it);
+}
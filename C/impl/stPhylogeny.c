@@ -1,4 +1,6 @@
 #include <stdlib.h>
+#include <float.h>
+#include <math.h>
 #include "sonLib.h"
 #include "stPhylogeny.h"
 // QuickTree includes
@@ -156,48 +158,50 @@ void stPhylogeny_setLeavesBelow(stTree *tree, int64_t totalNumLeaves)
     }
 }
 
-static stTree *quickTreeToStTreeR(struct Tnode *tNode) {
+// Makes a node of a neighbor-joined tree, with the given children (either
+// may be NULL). Nodes are labeled by their number, which for leaves is
+// their index in the distance matrix.
+static stTree *neighborJoinNode_construct(int64_t nodeNumber, stTree *left, stTree *right,
+                                          double branchLength) {
     stTree *ret = stTree_construct();
-    bool hasChild = false;
-    if (tNode->left != NULL) {
-        stTree *left = quickTreeToStTreeR(tNode->left);
+    if (left != NULL) {
         stTree_setParent(left, ret);
-        hasChild = true;
     }
-    if (tNode->right != NULL) {
-        stTree *right = quickTreeToStTreeR(tNode->right);
+    if (right != NULL) {
         stTree_setParent(right, ret);
-        hasChild = true;
     }
 
     // Allocate the phylogenyInfo for this node.
     stPhylogenyInfo *info = st_calloc(1, sizeof(stPhylogenyInfo));
     stIndexedTreeInfo *indexInfo = st_calloc(1, sizeof(stIndexedTreeInfo));
     info->index = indexInfo;
-    if (!hasChild) {
-        indexInfo->matrixIndex = tNode->nodenumber;
+    if (left == NULL && right == NULL) {
+        indexInfo->matrixIndex = nodeNumber;
     } else {
         indexInfo->matrixIndex = -1;
     }
     stTree_setClientData(ret, info);
 
-    stTree_setBranchLength(ret, tNode->distance);
+    stTree_setBranchLength(ret, branchLength);
 
     // Can remove if needed, probably not useful except for testing.
-    char *label = stString_print_r("%u", tNode->nodenumber);
+    char *label = stString_print_r("%" PRIi64, nodeNumber);
     stTree_setLabel(ret, label);
     free(label);
 
     return ret;
 }
 
-// Helper function for converting an unrooted QuickTree Tree into an
-// stTree. The tree is rooted halfway along the longest branch if
-// outgroups is NULL, otherwise it's rooted halfway along the longest
-// branch to an outgroup.
-static stTree *quickTreeToStTree(struct Tree *tree, stList *outgroups) {
-    struct Tree *rootedTree = get_root_Tnode(tree);
-    stTree *ret = quickTreeToStTreeR(rootedTree->child[0]);
+static stTree *quickTreeToStTreeR(struct Tnode *tNode) {
+    stTree *left = tNode->left == NULL ? NULL : quickTreeToStTreeR(tNode->left);
+    stTree *right = tNode->right == NULL ? NULL : quickTreeToStTreeR(tNode->right);
+    return neighborJoinNode_construct(tNode->nodenumber, left, right, tNode->distance);
+}
+
+// Fills in the leavesBelow of a neighbor-joined tree and, if there are
+// outgroups, re-roots it halfway along the longest branch to an
+// outgroup.
+static stTree *finishNeighborJoinTree(stTree *ret, stList *outgroups) {
     stPhylogeny_setLeavesBelow(ret, (stTree_getNumNodes(ret) + 1) / 2);
     if(outgroups != NULL && stList_length(outgroups) != 0) {
         // Find the longest branch to an outgroup and root the tree
@@ -224,98 +228,203 @@ static stTree *quickTreeToStTree(struct Tree *tree, stList *outgroups) {
         stPhylogeny_addStIndexedTreeInfo(reRooted);
         ret = reRooted;
     }
+    return ret;
+}
+
+// Helper function for converting an unrooted QuickTree Tree into an
+// stTree. The tree is rooted halfway along the longest branch if
+// outgroups is NULL, otherwise it's rooted halfway along the longest
+// branch to an outgroup.
+static stTree *quickTreeToStTree(struct Tree *tree, stList *outgroups) {
+    struct Tree *rootedTree = get_root_Tnode(tree);
+    stTree *ret = finishNeighborJoinTree(quickTreeToStTreeR(rootedTree->child[0]), outgroups);
     free_Tree(tree);
     free_Tree(rootedTree);
     return ret;
 }
 
-// Compare a single partition to a single bootstrap partition and
-// update its support if they are identical.
-static void updatePartitionSupportFromPartition(stTree *partitionToScore,
-                                                stTree *originalPartition,
-                                                stTree *bootstrap) {
-    stPhylogenyInfo *partitionInfo, *bootstrapInfo;
-
-    partitionInfo = stTree_getClientData(partitionToScore);
-    bootstrapInfo = stTree_getClientData(bootstrap);
-    assert(partitionInfo != NULL && partitionInfo->index != NULL);
-    assert(partitionInfo != NULL && bootstrapInfo->index != NULL);
-    assert(partitionInfo->index->totalNumLeaves == bootstrapInfo->index->totalNumLeaves);
-    // Check if the set of leaves is equal in both partitions. If not,
-    // the partitions can't be equal.
-    if (memcmp(partitionInfo->index->leavesBelow, bootstrapInfo->index->leavesBelow,
-            partitionInfo->index->totalNumLeaves * sizeof(char))) {
-        return;
+// Bootstrap support is counted by hashing the leaf set below each node
+// (its partition) as a bitset. A node of the tree being scored is
+// supported by a bootstrap if some node of the bootstrap has the same
+// leaf set, and, when scoring reconciliations, the deepest such node
+// has a parent reconciled as the node's parent is (or both are roots).
+// The bootstraps are hashed and looked up in parallel.
+
+typedef struct _partition {
+    uint64_t hash;
+    int64_t numWords;
+    uint64_t *leaves; // Bitset of the leaves below the node.
+    stTree *node;
+} partition;
+
+static uint64_t partition_hashKey(const void *key) {
+    return ((partition *) key)->hash;
+}
+
+static int partition_equals(const void *key1, const void *key2) {
+    const partition *partition1 = key1, *partition2 = key2;
+    return partition1->hash == partition2->hash
+           && memcmp(partition1->leaves, partition2->leaves, partition1->numWords * sizeof(uint64_t)) == 0;
+}
+
+// A hash of a single leaf, which is xor-ed over the leaves of a
+// partition, so that partitions hash bottom up.
+static uint64_t partition_leafHash(int64_t leaf) {
+    uint64_t h = (uint64_t) leaf + 0x9e3779b97f4a7c15ULL;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+// Fills in the partitions of the nodes below and including the given
+// node, in preorder, from the matrix indices of the leaves. Returns
+// the partition of the node.
+static partition *getPartitionsR(stTree *tree, int64_t numWords, partition *partitions,
+                                 uint64_t *leaves, int64_t *numPartitions) {
+    partition *ret = &partitions[*numPartitions];
+    ret->leaves = leaves + *numPartitions * numWords;
+    ret->numWords = numWords;
+    ret->node = tree;
+    (*numPartitions)++;
+    memset(ret->leaves, 0, numWords * sizeof(uint64_t));
+    if (stTree_getChildNumber(tree) == 0) {
+        stPhylogenyInfo *info = stTree_getClientData(tree);
+        assert(info != NULL && info->index != NULL);
+        int64_t leaf = info->index->matrixIndex;
+        assert(leaf >= 0 && leaf < numWords * 64);
+        ret->leaves[leaf / 64] = ((uint64_t) 1) << (leaf % 64);
+        ret->hash = partition_leafHash(leaf);
+        return ret;
+    }
+    ret->hash = 0;
+    for (int64_t i = 0; i < stTree_getChildNumber(tree); i++) {
+        partition *child = getPartitionsR(stTree_getChild(tree, i), numWords, partitions, leaves, numPartitions);
+        for (int64_t j = 0; j < numWords; j++) {
+            ret->leaves[j] |= child->leaves[j];
+        }
+        ret->hash ^= child->hash;
     }
-    // The partitions are equal, increase the support 
-    partitionInfo->index->numBootstraps++;
+    return ret;
 }
 
-// Increase a partition's bootstrap support by supplying the given
-// function with the closest possible bootstrap candidate from this
-// tree (i.e. it may not be exactly the same branch, if that branch is
-// not in the bootstrap).
-static void updateSupportFromTree(stTree *partitionToScore,
-                                  stTree *originalPartition,
-                                  stTree *bootstrapTree,
-                                  void (*updateAgainstBootstrapCandidate)(stTree *, stTree *, stTree *))
-{
-    stPhylogenyInfo *partitionInfo = stTree_getClientData(partitionToScore);
-    stPhylogenyInfo *bootstrapInfo = stTree_getClientData(bootstrapTree);
-    assert(partitionInfo != NULL);
-    assert(bootstrapInfo != NULL);
-    stIndexedTreeInfo *partitionIndex = partitionInfo->index;
-    stIndexedTreeInfo *bootstrapIndex = bootstrapInfo->index;
-    assert(partitionIndex != NULL);
-    assert(bootstrapIndex != NULL);
-    // This partition should be updated against the bootstrap
-    // partition only if none of the bootstrap's children have a leaf
-    // set that is a superset of the partition's leaf set.
-    bool checkThisPartition = TRUE;
-
-    (void) bootstrapIndex;
-    assert(partitionIndex->totalNumLeaves == bootstrapIndex->totalNumLeaves);
-    // Check that the leaves under the partition are a subset of the
-    // leaves under the current bootstrap node. This should always be
-    // true, since that's checked before running this function
-    for (int64_t i = 0; i < partitionIndex->totalNumLeaves; i++) {
-        if (partitionIndex->leavesBelow[i]) {
-            assert(bootstrapIndex->leavesBelow[i]);
-        }
-    }
-    
-    for(int64_t i = 0; i < stTree_getChildNumber(bootstrapTree); i++) {
-        stTree *bootstrapChild = stTree_getChild(bootstrapTree, i);
-        stPhylogenyInfo *bootstrapChildInfo = stTree_getClientData(bootstrapChild);
-        assert(bootstrapChildInfo != NULL);
-        stIndexedTreeInfo *bootstrapChildIndex = bootstrapChildInfo->index;
-        // If any of the bootstrap's children has a leaf set that is a
-        // superset of the partition's leaf set, we should update
-        // against that child instead.
-        bool isSuperset = TRUE;
-        for (int64_t j = 0; j < partitionIndex->totalNumLeaves; j++) {
-            if (partitionIndex->leavesBelow[j]) {
-                if (!bootstrapChildIndex->leavesBelow[j]) {
-                    isSuperset = FALSE;
-                    break;
-                }
+// Gets the partitions of all the nodes of the tree, in preorder.
+static partition *getPartitions(stTree *tree, int64_t totalNumLeaves, int64_t *numPartitions) {
+    int64_t numNodes = stTree_getNumNodes(tree), numWords = (totalNumLeaves + 63) / 64;
+    partition *partitions = st_malloc(numNodes * sizeof(partition) + numNodes * numWords * sizeof(uint64_t));
+    *numPartitions = 0;
+    getPartitionsR(tree, numWords, partitions, (uint64_t *) (partitions + numNodes), numPartitions);
+    assert(*numPartitions == numNodes);
+    return partitions;
+}
+
+typedef struct _bootstrapScorer {
+    stList *bootstraps;
+    partition *partitions; // The partitions of the tree being scored.
+    int64_t numPartitions;
+    int64_t totalNumLeaves;
+    bool reconciliation; // Whether the parents' reconciliations must match too.
+} bootstrapScorer;
+
+static void *bootstrapScorer_constructSupport(void *arg) {
+    return st_calloc(((bootstrapScorer *) arg)->numPartitions, sizeof(int64_t));
+}
+
+static void bootstrapScorer_mergeSupport(void *accumulator, void *accumulatorToMerge, void *arg) {
+    int64_t *support = accumulator, *supportToMerge = accumulatorToMerge;
+    for (int64_t i = 0; i < ((bootstrapScorer *) arg)->numPartitions; i++) {
+        support[i] += supportToMerge[i];
+    }
+    free(supportToMerge);
+}
+
+// Whether the parents of two nodes with the same leaves have the same
+// reconciliation. Two roots count as having the same reconciliation.
+static bool hasSameParentReconciliation(stTree *node, stTree *bootstrapNode) {
+    stTree *parent = stTree_getParent(node);
+    stTree *bootstrapParent = stTree_getParent(bootstrapNode);
+    if (parent == NULL || bootstrapParent == NULL) {
+        return parent == NULL && bootstrapParent == NULL;
+    }
+    stPhylogenyInfo *parentInfo = stTree_getClientData(parent);
+    stPhylogenyInfo *bootstrapParentInfo = stTree_getClientData(bootstrapParent);
+    assert(parentInfo != NULL && parentInfo->recon != NULL);
+    assert(bootstrapParentInfo != NULL && bootstrapParentInfo->recon != NULL);
+    return parentInfo->recon->event == bootstrapParentInfo->recon->event
+           && parentInfo->recon->species == bootstrapParentInfo->recon->species;
+}
+
+// Adds the support each of a range of bootstraps gives to the
+// partitions of the tree.
+static void bootstrapScorer_scoreBootstraps(int64_t start, int64_t end, void *accumulator, void *arg) {
+    bootstrapScorer *scorer = arg;
+    int64_t *support = accumulator;
+    for (int64_t i = start; i < end; i++) {
+        stTree *bootstrap = stList_get(scorer->bootstraps, i);
+        assert(((stPhylogenyInfo *) stTree_getClientData(bootstrap))->index->totalNumLeaves
+               == scorer->totalNumLeaves);
+        int64_t numBootstrapPartitions;
+        partition *bootstrapPartitions = getPartitions(bootstrap, scorer->totalNumLeaves, &numBootstrapPartitions);
+        stHash *bootstrapPartitionSet = stHash_construct4(partition_hashKey, partition_equals, NULL, NULL,
+                                                          stHashTypeOpenAddressing);
+        // Descendants come after their ancestors in preorder, so
+        // inserting in reverse keeps the deepest node with each leaf set.
+        for (int64_t j = numBootstrapPartitions - 1; j >= 0; j--) {
+            if (stHash_search(bootstrapPartitionSet, &bootstrapPartitions[j]) == NULL) {
+                stHash_insert(bootstrapPartitionSet, &bootstrapPartitions[j], &bootstrapPartitions[j]);
             }
         }
-        if (isSuperset) {
-            updateSupportFromTree(partitionToScore, originalPartition,
-                                  bootstrapChild,
-                                  updateAgainstBootstrapCandidate);
-            checkThisPartition = FALSE;
-            break;
+        for (int64_t j = 0; j < scorer->numPartitions; j++) {
+            partition *bootstrapPartition = stHash_search(bootstrapPartitionSet, &scorer->partitions[j]);
+            if (bootstrapPartition != NULL
+                && (!scorer->reconciliation
+                    || hasSameParentReconciliation(scorer->partitions[j].node, bootstrapPartition->node))) {
+                support[j]++;
+            }
         }
+        stHash_destruct(bootstrapPartitionSet);
+        free(bootstrapPartitions);
     }
+}
 
-    if (checkThisPartition) {
-        // This bootstrap partition is the closest candidate. Check
-        // the partition against this node.
-        updateAgainstBootstrapCandidate(partitionToScore, originalPartition,
-                                        bootstrapTree);
+// Clones the tree and its stPhylogenyInfo, adding the support from the
+// next of the given counts, in preorder, to each node.
+static stTree *cloneWithSupportR(stTree *tree, int64_t *support, int64_t *nodeNumber,
+                                 int64_t numBootstraps) {
+    stTree *ret = stTree_cloneNode(tree);
+    stPhylogenyInfo *info = stPhylogenyInfo_clone(stTree_getClientData(tree));
+    stTree_setClientData(ret, info);
+    info->index->numBootstraps += support[(*nodeNumber)++];
+    info->index->bootstrapSupport = ((double) info->index->numBootstraps) / numBootstraps;
+    for (int64_t i = 0; i < stTree_getChildNumber(tree); i++) {
+        stTree_setParent(cloneWithSupportR(stTree_getChild(tree, i), support, nodeNumber, numBootstraps), ret);
     }
+    return ret;
+}
+
+static stTree *scoreFromBootstraps(stTree *tree, stList *bootstraps, bool reconciliation, int64_t numThreads) {
+    stPhylogenyInfo *info = stTree_getClientData(tree);
+    assert(info != NULL && info->index != NULL);
+    bootstrapScorer scorer;
+    scorer.bootstraps = bootstraps;
+    scorer.totalNumLeaves = info->index->totalNumLeaves;
+    scorer.reconciliation = reconciliation;
+    scorer.partitions = getPartitions(tree, scorer.totalNumLeaves, &scorer.numPartitions);
+    int64_t *support;
+    if (numThreads > 1) {
+        stThreadPool *threadPool = stThreadPool_construct(numThreads - 1, NULL, NULL);
+        support = stThreadPool_parallelReduce(threadPool, stList_length(bootstraps), 1,
+                                              bootstrapScorer_constructSupport, bootstrapScorer_scoreBootstraps,
+                                              bootstrapScorer_mergeSupport, &scorer);
+        stThreadPool_destruct(threadPool);
+    } else {
+        support = bootstrapScorer_constructSupport(&scorer);
+        bootstrapScorer_scoreBootstraps(0, stList_length(bootstraps), support, &scorer);
+    }
+    int64_t nodeNumber = 0;
+    stTree *ret = cloneWithSupportR(tree, support, &nodeNumber, stList_length(bootstraps));
+    free(support);
+    free(scorer.partitions);
+    return ret;
 }
 
 // Return a new tree which has its partitions scored by how often they
@@ -337,75 +446,12 @@ stTree *stPhylogeny_scoreFromBootstrap(stTree *tree, stTree *bootstrap)
 // stPhylogenyInfo.
 stTree *stPhylogeny_scoreFromBootstraps(stTree *tree, stList *bootstraps)
 {
-    int64_t i;
-    stTree *ret = stTree_cloneNode(tree);
-    stPhylogenyInfo *info = stPhylogenyInfo_clone(stTree_getClientData(tree));
-    stTree_setClientData(ret, info);
-    // Update child partitions (if any)
-    for(i = 0; i < stTree_getChildNumber(tree); i++) {
-        stTree_setParent(stPhylogeny_scoreFromBootstraps(stTree_getChild(tree, i), bootstraps), ret);
-    }
-
-    // Check the current partition against all bootstraps
-    for(i = 0; i < stList_length(bootstraps); i++) {
-        updateSupportFromTree(ret, tree, stList_get(bootstraps, i),
-                              updatePartitionSupportFromPartition);
-    }
-
-    info->index->bootstrapSupport = ((double) info->index->numBootstraps) / stList_length(bootstraps);
-    return ret;
+    return stPhylogeny_scoreFromBootstraps2(tree, bootstraps, 1);
 }
 
-void updateReconciliationSupportFromPartition(stTree *partitionToScore,
-                                              stTree *originalPartition,
-                                              stTree *bootstrapPartition) {
-    stPhylogenyInfo *partitionInfo, *bootstrapInfo;
-
-    // First, check that the branches are identical.
-    partitionInfo = stTree_getClientData(partitionToScore);
-    bootstrapInfo = stTree_getClientData(bootstrapPartition);
-    assert(partitionInfo != NULL);
-    assert(bootstrapInfo != NULL);
-    stIndexedTreeInfo *partitionIndex = partitionInfo->index;
-    stIndexedTreeInfo *bootstrapIndex = bootstrapInfo->index;
-    assert(partitionIndex != NULL);
-    assert(bootstrapIndex != NULL);
-    assert(partitionIndex->totalNumLeaves == bootstrapIndex->totalNumLeaves);
-    // Check if the set of leaves is equal in both partitions. If not,
-    // the partitions can't be equal.
-    if (memcmp(partitionIndex->leavesBelow, bootstrapIndex->leavesBelow,
-            partitionIndex->totalNumLeaves * sizeof(char))) {
-        return;
-    }
-
-    // Now check the reconciliation of the parents.
-    stTree *partitionParent = stTree_getParent(originalPartition);
-    stTree *bootstrapParent = stTree_getParent(bootstrapPartition);
-    if (partitionParent == NULL && bootstrapParent == NULL) {
-        // We count this case as having identical reconciliation.
-        partitionIndex->numBootstraps++;
-        return;
-    } else if (partitionParent == NULL || bootstrapParent == NULL) {
-        // If only one is the root, we don't consider them to have the
-        // same reconciliation.
-        return;
-    }
-    stPhylogenyInfo *partitionParentInfo = stTree_getClientData(partitionParent);
-    stPhylogenyInfo *bootstrapParentInfo = stTree_getClientData(bootstrapParent);
-    assert(partitionParentInfo != NULL);
-    assert(bootstrapParentInfo != NULL);
-    stReconciliationInfo *partitionParentRecon = partitionParentInfo->recon;
-    stReconciliationInfo *bootstrapParentRecon = bootstrapParentInfo->recon;
-    assert(partitionParentRecon != NULL);
-    assert(bootstrapParentRecon != NULL);
-    if (partitionParentRecon->event != bootstrapParentRecon->event ||
-        partitionParentRecon->species != bootstrapParentRecon->species) {
-        // Not the same reconciliation / duplication labeling.
-        return;
-    }
-    // The partitions are equal and they have the same reconciliation,
-    // increase the support
-    partitionIndex->numBootstraps++;
+stTree *stPhylogeny_scoreFromBootstraps2(stTree *tree, stList *bootstraps, int64_t numThreads)
+{
+    return scoreFromBootstraps(tree, bootstraps, false, numThreads);
 }
 
 stTree *stPhylogeny_scoreReconciliationFromBootstrap(stTree *tree,
@@ -425,30 +471,17 @@ stTree *stPhylogeny_scoreReconciliationFromBootstrap(stTree *tree,
 stTree *stPhylogeny_scoreReconciliationFromBootstraps(stTree *tree,
                                                       stList *bootstraps)
 {
-    int64_t i;
-    stTree *ret = stTree_cloneNode(tree);
-    stPhylogenyInfo *info = stPhylogenyInfo_clone(stTree_getClientData(tree));
-    stTree_setClientData(ret, info);
-    // Update child partitions (if any)
-    for(i = 0; i < stTree_getChildNumber(tree); i++) {
-        stTree_setParent(stPhylogeny_scoreReconciliationFromBootstraps(stTree_getChild(tree, i), bootstraps), ret);
-    }
-    // Check the current partition against all bootstraps
-    for(i = 0; i < stList_length(bootstraps); i++) {
-        updateSupportFromTree(ret, tree, stList_get(bootstraps, i),
-                              updateReconciliationSupportFromPartition);
-    }
+    return stPhylogeny_scoreReconciliationFromBootstraps2(tree, bootstraps, 1);
+}
 
-    info->index->bootstrapSupport = ((double) info->index->numBootstraps) / stList_length(bootstraps);
-    return ret;
+stTree *stPhylogeny_scoreReconciliationFromBootstraps2(stTree *tree, stList *bootstraps, int64_t numThreads)
+{
+    return scoreFromBootstraps(tree, bootstraps, true, numThreads);
 }
 
-// Only one half of the distanceMatrix is used, distances[i][j] for which i > j
-// Tree returned is labeled by the indices of the distance matrix. The
-// tree is rooted halfway along the longest branch if outgroups is
-// NULL; otherwise, it's rooted halfway along the longest outgroup
-// branch.
-stTree *stPhylogeny_neighborJoin(stMatrix *distances, stList *outgroups) {
+// Runs QuickTree's neighbor-joining on the matrix. Kept to check the
+// native implementation against.
+stTree *stPhylogeny_neighborJoinQuickTree(stMatrix *distances, stList *outgroups) {
     struct DistanceMatrix *distanceMatrix;
     struct Tree *tree;
     int64_t i, j;
@@ -483,6 +516,446 @@ stTree *stPhylogeny_neighborJoin(stMatrix *distances, stList *outgroups) {
     return quickTreeToStTree(tree, outgroups);
 }
 
+/*
+ * Native neighbor-joining, in the manner of RapidNJ (Simonsen,
+ * Mailund and Pedersen 2008). It follows QuickTree's arithmetic
+ * exactly, single precision distances and r values included, and
+ * breaks ties between equal Q values in the same order as QuickTree's
+ * scan, so it builds the same trees.
+ *
+ * The distances are held as a packed lower triangle, indexed by slot.
+ * Joining the nodes in slots i > j puts the new node in slot i and
+ * kills slot j. Each slot also has a row: the distances from its node
+ * to every node that was created before it and was alive when it was
+ * created, sorted by distance. Every pair of live nodes is in exactly
+ * one row (that of the newer node), and the distance of a pair never
+ * changes while both are alive. As Q(i, j) = d(i, j) - (r(i) + r(j))
+ * is at least d(i, j) - (r(i) + max r), a row can be abandoned at the
+ * first entry whose bound exceeds the best Q found so far, which is
+ * usually a small prefix of it. Rows are searched in parallel,
+ * sharing the best Q found.
+ */
+
+typedef struct _njEntry {
+    float distance;
+    int32_t slot;
+} njEntry;
+
+typedef struct _njRow {
+    njEntry *entries;
+    int64_t length;
+} njRow;
+
+typedef struct _njCandidate {
+    float q;
+    int64_t i, j; // i > j
+    bool found;
+} njCandidate;
+
+typedef struct _neighborJoiner {
+    int64_t n;
+    float *distances; // Packed lower triangle, including the diagonal.
+    float *r;
+    float maxR; // The greatest r of a live node.
+    stTree **nodes; // The node in each slot, NULL if the slot is dead.
+    int64_t *nodeNumbers; // The number of the node in each slot, in order of creation.
+    njRow *rows;
+    int64_t *liveSlots; // The live slots, in no particular order.
+    int64_t *liveSlotPositions; // The position of each live slot in liveSlots.
+    int64_t numLiveSlots;
+    float bestQ; // The least Q found so far in the current search, shared between threads.
+} neighborJoiner;
+
+static inline float *njDistance(neighborJoiner *nj, int64_t i, int64_t j) {
+    return i >= j ? nj->distances + i * (i + 1) / 2 + j : nj->distances + j * (j + 1) / 2 + i;
+}
+
+// Maps a float to an unsigned key with the same order.
+static inline uint32_t njEntry_key(float distance) {
+    uint32_t bits;
+    memcpy(&bits, &distance, sizeof(bits));
+    return bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+}
+
+// Sorts the entries of a row by distance, with a least significant
+// digit radix sort of the keys, which is several times faster than
+// qsort on rows of a few thousand entries.
+static void njRow_sort(njRow *row) {
+    if (row->length < 64) {
+        for (int64_t i = 1; i < row->length; i++) {
+            njEntry entry = row->entries[i];
+            int64_t j = i;
+            for (; j > 0 && row->entries[j - 1].distance > entry.distance; j--) {
+                row->entries[j] = row->entries[j - 1];
+            }
+            row->entries[j] = entry;
+        }
+        return;
+    }
+    njEntry *entries = row->entries, *scratch = st_malloc(row->length * sizeof(njEntry));
+    for (int64_t shift = 0; shift < 32; shift += 11) {
+        int64_t counts[2048] = { 0 };
+        for (int64_t i = 0; i < row->length; i++) {
+            counts[(njEntry_key(entries[i].distance) >> shift) & 2047]++;
+        }
+        for (int64_t i = 0, total = 0; i < 2048; i++) {
+            int64_t count = counts[i];
+            counts[i] = total;
+            total += count;
+        }
+        for (int64_t i = 0; i < row->length; i++) {
+            scratch[counts[(njEntry_key(entries[i].distance) >> shift) & 2047]++] = entries[i];
+        }
+        njEntry *swap = entries;
+        entries = scratch;
+        scratch = swap;
+    }
+    // Three passes leave the sorted entries in the scratch array.
+    free(row->entries);
+    row->entries = entries;
+}
+
+// Fills in the row of the node in slot i, from the live slots given.
+static void njRow_fill(neighborJoiner *nj, int64_t i, int64_t *slots, int64_t numSlots) {
+    njRow *row = &nj->rows[i];
+    row->entries = st_realloc(row->entries, (numSlots > 0 ? numSlots : 1) * sizeof(njEntry));
+    row->length = 0;
+    for (int64_t k = 0; k < numSlots; k++) {
+        if (slots[k] != i) {
+            row->entries[row->length].distance = *njDistance(nj, i, slots[k]);
+            row->entries[row->length++].slot = (int32_t) slots[k];
+        }
+    }
+    njRow_sort(row);
+}
+
+static void njRow_fillLeafRows(int64_t start, int64_t end, void *arg) {
+    neighborJoiner *nj = arg;
+    for (int64_t i = start; i < end; i++) {
+        // The leaf in slot i is older than those in the higher slots.
+        njRow_fill(nj, i, nj->liveSlots, i);
+    }
+}
+
+// Returns true if the pair (i, j), with q, comes before the candidate
+// in QuickTree's scan order, which takes the first least Q scanning
+// pairs (i, j), i > j, by i and then by j.
+static inline bool njCandidate_isBeatenBy(njCandidate *candidate, float q, int64_t i, int64_t j) {
+    if (!candidate->found) {
+        return q < candidate->q;
+    }
+    return q < candidate->q || (q == candidate->q && (i < candidate->i || (i == candidate->i && j < candidate->j)));
+}
+
+static void njCandidate_set(njCandidate *candidate, float q, int64_t i, int64_t j) {
+    candidate->q = q;
+    candidate->i = i;
+    candidate->j = j;
+    candidate->found = 1;
+}
+
+static void *njCandidate_construct(void *arg) {
+    njCandidate *candidate = st_malloc(sizeof(njCandidate));
+    candidate->q = FLT_MAX;
+    candidate->i = candidate->j = -1;
+    candidate->found = 0;
+    return candidate;
+}
+
+static void njCandidate_merge(void *accumulator, void *accumulatorToMerge, void *arg) {
+    njCandidate *candidate = accumulator, *candidateToMerge = accumulatorToMerge;
+    if (candidateToMerge->found
+            && njCandidate_isBeatenBy(candidate, candidateToMerge->q, candidateToMerge->i, candidateToMerge->j)) {
+        *candidate = *candidateToMerge;
+    }
+    free(candidateToMerge);
+}
+
+static void njLowerBestQ(neighborJoiner *nj, float q) {
+    float bestQ;
+    __atomic_load(&nj->bestQ, &bestQ, __ATOMIC_RELAXED);
+    while (q < bestQ && !__atomic_compare_exchange(&nj->bestQ, &bestQ, &q, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+// Searches the rows of the given live slots for the least Q.
+static void njSearchRows(int64_t start, int64_t end, void *accumulator, void *arg) {
+    neighborJoiner *nj = arg;
+    njCandidate *candidate = accumulator;
+    for (int64_t k = start; k < end; k++) {
+        int64_t i = nj->liveSlots[k];
+        njRow *row = &nj->rows[i];
+        int64_t nodeNumber = nj->nodeNumbers[i];
+        if (row->length > 2 * nj->numLiveSlots) {
+            // Drop the entries of dead nodes, keeping the order.
+            int64_t length = 0;
+            for (int64_t l = 0; l < row->length; l++) {
+                int64_t j = row->entries[l].slot;
+                if (nj->nodes[j] != NULL && nj->nodeNumbers[j] < nodeNumber) {
+                    row->entries[length++] = row->entries[l];
+                }
+            }
+            row->length = length;
+        }
+        float ri = nj->r[i];
+        // Rounding is monotonic, so d - (ri + maxR) computed in single
+        // precision is a lower bound on each Q below computed the same way.
+        float rBound = ri + nj->maxR;
+        for (int64_t l = 0; l < row->length; l++) {
+            float distance = row->entries[l].distance;
+            float bound = distance - rBound;
+            if (bound > candidate->q) {
+                break;
+            }
+            float bestQ;
+            __atomic_load(&nj->bestQ, &bestQ, __ATOMIC_RELAXED);
+            if (bound > bestQ) {
+                break;
+            }
+            int64_t j = row->entries[l].slot;
+            if (nj->nodes[j] == NULL || nj->nodeNumbers[j] > nodeNumber) {
+                continue; // The node is dead, or is a newer node in slot j.
+            }
+            float rSum = ri + nj->r[j];
+            float q = distance - rSum;
+            int64_t maxSlot = i > j ? i : j, minSlot = i > j ? j : i;
+            if (njCandidate_isBeatenBy(candidate, q, maxSlot, minSlot)) {
+                njCandidate_set(candidate, q, maxSlot, minSlot);
+                njLowerBestQ(nj, q);
+            }
+        }
+    }
+}
+
+static njCandidate *njFindJoin(neighborJoiner *nj, stThreadPool *threadPool) {
+    nj->bestQ = FLT_MAX;
+    njCandidate *candidate;
+    if (threadPool != NULL) {
+        candidate = stThreadPool_parallelReduce(threadPool, nj->numLiveSlots, 16, njCandidate_construct,
+                                                njSearchRows, njCandidate_merge, nj);
+    } else {
+        candidate = njCandidate_construct(nj);
+        njSearchRows(0, nj->numLiveSlots, candidate, nj);
+    }
+    if (!candidate->found) {
+        // Only possible if every Q is infinite or not a number; join
+        // the first pair in scan order.
+        int64_t j = 0;
+        while (nj->nodes[j] == NULL) {
+            j++;
+        }
+        int64_t i = j + 1;
+        while (nj->nodes[i] == NULL) {
+            i++;
+        }
+        njCandidate_set(candidate, FLT_MAX, i, j);
+    }
+    return candidate;
+}
+
+// Joins the nodes in slots i > j, putting the new node in slot i.
+static void njJoin(neighborJoiner *nj, int64_t i, int64_t j, int64_t nodeNumber, double numNodes) {
+    // Branch lengths, adjusted to avoid negative lengths as QuickTree does.
+    double dij = *njDistance(nj, i, j);
+    double distI = (dij + nj->r[i] - nj->r[j]) * 0.5;
+    double distJ = dij - distI;
+    if (distI < 0.0) {
+        distI = 0.0;
+        distJ = dij < 0.0 ? 0.0 : dij;
+    } else if (distJ < 0.0) {
+        distJ = 0.0;
+        distI = dij < 0.0 ? 0.0 : dij;
+    }
+    stTree_setBranchLength(nj->nodes[i], distI);
+    stTree_setBranchLength(nj->nodes[j], distJ);
+    nj->nodes[i] = neighborJoinNode_construct(nodeNumber, nj->nodes[i], nj->nodes[j], 0.0);
+    nj->nodes[j] = NULL;
+    nj->nodeNumbers[i] = nodeNumber;
+    int64_t position = nj->liveSlotPositions[j];
+    nj->liveSlots[position] = nj->liveSlots[--nj->numLiveSlots];
+    nj->liveSlotPositions[nj->liveSlots[position]] = position;
+
+    // Update the distances and r values.
+    nj->r[i] = 0.0;
+    for (int64_t m = 0; m < nj->n; m++) {
+        if (nj->nodes[m] == NULL || m == i) {
+            continue;
+        }
+        double dmj = *njDistance(nj, m, j);
+        float *dm = njDistance(nj, m, i);
+        double dmi = *dm;
+        *dm = (dmi + dmj - dij) * 0.5;
+        nj->r[m] = ((nj->r[m] * (numNodes - 2.0)) - dmi - dmj + *dm) / (numNodes - 3.0);
+        nj->r[i] += *dm;
+    }
+    nj->r[i] /= numNodes - 3.0;
+    nj->maxR = -FLT_MAX;
+    for (int64_t k = 0; k < nj->numLiveSlots; k++) {
+        float r = nj->r[nj->liveSlots[k]];
+        if (r > nj->maxR) {
+            nj->maxR = r;
+        }
+    }
+
+    // The new node is newer than every other live node.
+    free(nj->rows[j].entries);
+    nj->rows[j].entries = NULL;
+    nj->rows[j].length = 0;
+    njRow_fill(nj, i, nj->liveSlots, nj->numLiveSlots);
+}
+
+// Sets the branch lengths of the last three nodes, which are in the
+// given slots in increasing order, adjusted as QuickTree does.
+static void njSetLastBranchLengths(neighborJoiner *nj, int64_t *slots) {
+    // As in QuickTree, the sums of distances are in single precision.
+    float d10 = *njDistance(nj, slots[1], slots[0]);
+    float d20 = *njDistance(nj, slots[2], slots[0]);
+    float d21 = *njDistance(nj, slots[2], slots[1]);
+    double distI = (d10 + d20 - d21) * 0.5;
+    double distJ = d10 - distI;
+    double distK = d20 - distI;
+    if (distI < 0.0) {
+        distI = 0.0;
+        distJ = d10;
+        distK = d20;
+        if (distJ < 0.0) {
+            distJ = 0.0;
+            distK = (d20 + d21) * 0.5;
+            distK = distK < 0.0 ? 0.0 : distK;
+        } else if (distK < 0.0) {
+            distK = 0.0;
+            distJ = (d10 + d21) * 0.5;
+            distJ = distJ < 0.0 ? 0.0 : distJ;
+        }
+    } else if (distJ < 0.0) {
+        distJ = 0.0;
+        distI = d10;
+        distK = d21;
+        if (distI < 0.0) {
+            distI = 0.0;
+            distK = (d20 + d21) * 0.5;
+            distK = distK < 0.0 ? 0.0 : distK;
+        } else if (distK < 0.0) {
+            distK = 0.0;
+            distI = (d10 + d20) * 0.5;
+            distI = distI < 0.0 ? 0.0 : distI;
+        }
+    } else if (distK < 0.0) {
+        distK = 0.0;
+        distI = d20;
+        distJ = d21;
+        if (distI < 0.0) {
+            distI = 0.0;
+            distJ = (d10 + d21) * 0.5;
+            distJ = distJ < 0.0 ? 0.0 : distJ;
+        } else if (distJ < 0.0) {
+            distJ = 0.0;
+            distI = (d10 + d20) * 0.5;
+            distI = distI < 0.0 ? 0.0 : distI;
+        }
+    }
+    stTree_setBranchLength(nj->nodes[slots[0]], distI);
+    stTree_setBranchLength(nj->nodes[slots[1]], distJ);
+    stTree_setBranchLength(nj->nodes[slots[2]], distK);
+}
+
+stTree *stPhylogeny_neighborJoin2(stMatrix *distances, stList *outgroups, int64_t numThreads) {
+    assert(distances != NULL);
+    assert(stMatrix_n(distances) == stMatrix_m(distances));
+    int64_t n = stMatrix_n(distances);
+    assert(n > 2);
+    neighborJoiner nj;
+    nj.n = n;
+    nj.distances = st_malloc(n * (n + 1) / 2 * sizeof(float));
+    nj.r = st_malloc(n * sizeof(float));
+    nj.nodes = st_malloc(n * sizeof(stTree *));
+    nj.nodeNumbers = st_malloc(n * sizeof(int64_t));
+    nj.rows = st_calloc(n, sizeof(njRow));
+    nj.liveSlots = st_malloc(n * sizeof(int64_t));
+    nj.liveSlotPositions = st_malloc(n * sizeof(int64_t));
+    nj.numLiveSlots = n;
+    for (int64_t i = 0; i < n; i++) {
+        for (int64_t j = 0; j <= i; j++) {
+            *njDistance(&nj, i, j) = *stMatrix_getCell(distances, i, j);
+        }
+    }
+    nj.maxR = -FLT_MAX;
+    for (int64_t i = 0; i < n; i++) {
+        double ri = 0.0;
+        for (int64_t k = 0; k < n; k++) {
+            ri += *njDistance(&nj, i, k);
+        }
+        nj.r[i] = ri / (n - 2.0);
+        nj.maxR = nj.r[i] > nj.maxR ? nj.r[i] : nj.maxR;
+        nj.nodes[i] = neighborJoinNode_construct(i, NULL, NULL, 0.0);
+        nj.nodeNumbers[i] = i;
+        nj.liveSlots[i] = i;
+        nj.liveSlotPositions[i] = i;
+    }
+
+    stThreadPool *threadPool = numThreads > 1 ? stThreadPool_construct(numThreads - 1, NULL, NULL) : NULL;
+    if (threadPool != NULL) {
+        stThreadPool_parallelFor(threadPool, n, 64, njRow_fillLeafRows, &nj);
+    } else {
+        njRow_fillLeafRows(0, n, &nj);
+    }
+
+    // Join until there are three nodes left.
+    int64_t nodeNumber = n;
+    for (int64_t numNodes = n; numNodes > 3; numNodes--) {
+        njCandidate *candidate = njFindJoin(&nj, threadPool);
+        njJoin(&nj, candidate->i, candidate->j, nodeNumber++, numNodes);
+        free(candidate);
+    }
+    if (threadPool != NULL) {
+        stThreadPool_destruct(threadPool);
+    }
+
+    int64_t slots[3];
+    for (int64_t i = 0, k = 0; i < n; i++) {
+        if (nj.nodes[i] != NULL) {
+            slots[k++] = i;
+        }
+    }
+    njSetLastBranchLengths(&nj, slots);
+
+    // Root halfway along the longest of the last three branches (which,
+    // as in QuickTree, is found by comparing each branch to the first).
+    stTree *children[3] = { nj.nodes[slots[0]], nj.nodes[slots[1]], nj.nodes[slots[2]] };
+    int64_t rootLeft = 0, focalLeft = 1, focalRight = 2;
+    double maxDistance = stTree_getBranchLength(children[0]);
+    if (stTree_getBranchLength(children[1]) > maxDistance) {
+        rootLeft = 1;
+        focalLeft = 0;
+        focalRight = 2;
+    }
+    if (stTree_getBranchLength(children[2]) > maxDistance) {
+        rootLeft = 2;
+        focalLeft = 0;
+        focalRight = 1;
+    }
+    stTree_setBranchLength(children[rootLeft], stTree_getBranchLength(children[rootLeft]) * 0.5);
+    stTree *focal = neighborJoinNode_construct(nodeNumber, children[focalLeft], children[focalRight],
+                                               stTree_getBranchLength(children[rootLeft]));
+    stTree *root = neighborJoinNode_construct(nodeNumber + 1, children[rootLeft], focal, 0.0);
+
+    for (int64_t i = 0; i < n; i++) {
+        free(nj.rows[i].entries);
+    }
+    free(nj.rows);
+    free(nj.liveSlots);
+    free(nj.liveSlotPositions);
+    free(nj.nodeNumbers);
+    free(nj.nodes);
+    free(nj.r);
+    free(nj.distances);
+    return finishNeighborJoinTree(root, outgroups);
+}
+
+stTree *stPhylogeny_neighborJoin(stMatrix *distances, stList *outgroups) {
+    return stPhylogeny_neighborJoin2(distances, outgroups, 1);
+}
+
 // Get the distance to a leaf from an internal node
 static double stPhylogeny_distToLeaf(stTree *tree, int64_t leafIndex) {
     int64_t i;
@@ -686,6 +1159,21 @@ static void populateSpeciesToIndex(stTree *speciesTree, stHash *speciesToIndex)
     stList_destruct(bfQueue);
 }
 
+// Returns an array of the species nodes, indexed by their indices in
+// speciesToIndex.
+static stTree **getIndexToSpecies(stHash *speciesToIndex, int64_t numSpecies) {
+    stTree **indexToSpecies = st_calloc(numSpecies, sizeof(stTree *));
+    stHashIterator *it = stHash_getIterator(speciesToIndex);
+    stTree *species;
+    while ((species = stHash_getNext(it)) != NULL) {
+        int64_t index = stIntTuple_get(stHash_search(speciesToIndex, species), 0);
+        assert(index >= 0 && index < numSpecies);
+        indexToSpecies[index] = species;
+    }
+    stHash_destructIterator(it);
+    return indexToSpecies;
+}
+
 // Get the number of nodes between a descendant and its ancestor that
 // could cause losses, i.e. that have more than one child. (Exclusive
 // of both the ancestor and its descendant, so if the descendant is a
@@ -739,23 +1227,17 @@ stMatrix *stPhylogeny_computeJoinCosts(stTree *speciesTree, stHash *speciesToInd
 
     // Fill in the join cost matrix.
     stMatrix *ret = stMatrix_construct(numSpecies, numSpecies);
-    stHash *indexToSpecies = stHash_invert(speciesToIndex, (uint64_t (*)(const void *)) stIntTuple_hashKey,
-                                           (int (*)(const void *, const void *)) stIntTuple_equalsFn, NULL, NULL);
+    stTree **indexToSpecies = getIndexToSpecies(speciesToIndex, numSpecies);
+    stTreeLCAIndex *lcaIndex = stTreeLCAIndex_construct(speciesTree);
     for (int64_t i = 0; i < numSpecies; i++) {
-        // get the species node for this index (the intTuple is
-        // necessary to query the hash properly)
-        stIntTuple *query_i = stIntTuple_construct1(i);
-        stTree *species_i = stHash_search(indexToSpecies, query_i);
+        stTree *species_i = indexToSpecies[i];
         assert(species_i != NULL);
         for (int64_t j = i; j < numSpecies; j++) {
-            // get the species node for this index (the intTuple is
-            // necessary to query the hash properly)
-            stIntTuple *query_j = stIntTuple_construct1(j);
-            stTree *species_j = stHash_search(indexToSpecies, query_j);
+            stTree *species_j = indexToSpecies[j];
             assert(species_j != NULL);
 
             // Can't use stPhylogeny_getMRCA as that is only defined for leaves.
-            stTree *mrca = stTree_getMRCA(species_i, species_j);
+            stTree *mrca = stTreeLCAIndex_getMRCA(lcaIndex, species_i, species_j);
 
             // Calculate the number of dups implied when joining species i and j.
             if (species_i == mrca || species_j == mrca) {
@@ -774,13 +1256,11 @@ stMatrix *stPhylogeny_computeJoinCosts(stTree *speciesTree, stHash *speciesToInd
             if (j != i) {
                 *stMatrix_getCell(ret, j, i) += costPerLoss * numLosses;
             }
-
-            stIntTuple_destruct(query_j);
         }
-        stIntTuple_destruct(query_i);
     }
 
-    stHash_destruct(indexToSpecies);
+    stTreeLCAIndex_destruct(lcaIndex);
+    free(indexToSpecies);
     return ret;
 }
 
@@ -790,279 +1270,417 @@ int64_t **stPhylogeny_getMRCAMatrix(stTree *speciesTree, stHash *speciesToIndex)
     for (int64_t i = 0; i < numSpecies; i++) {
         ret[i] = st_calloc(numSpecies, sizeof(int64_t));
     }
-    stHash *indexToSpecies = stHash_invert(speciesToIndex, (uint64_t (*)(const void *)) stIntTuple_hashKey,
-                                           (int (*)(const void *, const void *)) stIntTuple_equalsFn, NULL, NULL);
+    stTree **indexToSpecies = getIndexToSpecies(speciesToIndex, numSpecies);
+    stTreeLCAIndex *lcaIndex = stTreeLCAIndex_construct(speciesTree);
     for (int64_t i = 0; i < numSpecies; i++) {
-        stIntTuple *query_i = stIntTuple_construct1(i);
+        stTree *node_i = indexToSpecies[i];
+        assert(node_i != NULL);
         for (int64_t j = i; j < numSpecies; j++) {
-            stTree *node_i = stHash_search(indexToSpecies, query_i);
-            assert(node_i != NULL);
-            stIntTuple *query_j = stIntTuple_construct1(j);
-            stTree *node_j = stHash_search(indexToSpecies, query_j);
+            stTree *node_j = indexToSpecies[j];
             assert(node_j != NULL);
-            stTree *mrca = stTree_getMRCA(node_i, node_j);
+            stTree *mrca = stTreeLCAIndex_getMRCA(lcaIndex, node_i, node_j);
             stIntTuple *mrcaIndex = stHash_search(speciesToIndex, mrca);
             assert(mrcaIndex != NULL);
             ret[i][j] = stIntTuple_get(mrcaIndex, 0);
             ret[j][i] = ret[i][j];
-            stIntTuple_destruct(query_j);
         }
-        stIntTuple_destruct(query_i);
     }
-    stHash_destruct(indexToSpecies);
+    stTreeLCAIndex_destruct(lcaIndex);
+    free(indexToSpecies);
     return ret;
 }
 
-stTree *stPhylogeny_guidedNeighborJoining(stMatrix *distanceMatrix,
-                                          stMatrix *similarityMatrix,
-                                          stMatrix *joinCosts,
-                                          stHash *matrixIndexToJoinCostIndex,
-                                          stHash *speciesToJoinCostIndex,
-                                          int64_t **speciesMRCAMatrix,
-                                          stTree *speciesTree) {
-    int64_t numLeaves = stMatrix_n(similarityMatrix);
-    assert(numLeaves == stMatrix_m(similarityMatrix));
-    assert(numLeaves >= 3);
-
-    // Stores the reconciliation (in join cost matrix indices) for
-    // each leaf/node.
-    int64_t *recon = st_calloc(numLeaves, sizeof(int64_t));
+/*
+ * Guided neighbor-joining joins the pair (i, j), i < j, with the least
+ * Q(i, j) = d(i, j) + c(i, j) - r(i) - r(j), where c is the join cost
+ * of the reconciliations of i and j. It is searched for in the same
+ * way as the least Q of plain neighbor-joining (see above): each slot
+ * has a row of its nodes's older live neighbours sorted by d + c, and
+ * each row is searched, in parallel, only as far as its bound allows.
+ * The rows hold d + c rounded down to single precision, to halve
+ * their size. The bound is computed from that, and Q from the exact
+ * distance and join cost, in the same order as before, so the joins
+ * and the tree are exactly those of the full search.
+ */
+
+typedef struct _guidedJoiner {
+    int64_t n;
+    double *distances; // Packed lower triangle; the diagonal is zero.
+    double *r;
+    double maxR;
+    stTree **nodes;
+    int64_t *nodeNumbers;
+    int64_t *recon; // The join cost index of the reconciliation of each slot, -1 if dead.
+    double *joinCosts; // Dense copy of the join cost matrix.
+    int64_t numSpecies;
+    int64_t **speciesMRCAMatrix; // NULL if the species tree's LCA index is used instead.
+    stTreeLCAIndex *speciesLCAIndex;
+    stTree **indexToSpecies;
+    stHash *speciesToJoinCostIndex;
+    njRow *rows;
+    int64_t *liveSlots;
+    int64_t *liveSlotPositions;
+    int64_t numLiveSlots;
+    double bestQ;
+} guidedJoiner;
+
+typedef struct _gnjCandidate {
+    double q;
+    int64_t i, j; // i < j
+    bool found;
+} gnjCandidate;
+
+static inline double *gnjDistance(guidedJoiner *gnj, int64_t i, int64_t j) {
+    return i >= j ? gnj->distances + i * (i + 1) / 2 + j : gnj->distances + j * (j + 1) / 2 + i;
+}
 
-    // Fill in the initial reconciliation array.
-    stHashIterator *hashIt = stHash_getIterator(matrixIndexToJoinCostIndex);
-    stIntTuple *matrixIndex;
-    while ((matrixIndex = stHash_getNext(hashIt)) != NULL) {
-        int64_t i = stIntTuple_get(matrixIndex, 0);
-        stIntTuple *joinCostIndex = stHash_search(matrixIndexToJoinCostIndex, matrixIndex);
-        assert(joinCostIndex != NULL);
-        recon[i] = stIntTuple_get(joinCostIndex, 0);
+// Returns d + c for the nodes in slots i and j, where i holds the newer
+// node. The join cost of two leaves is looked up with the lower slot
+// first, that of a new node and another with the new node first.
+static inline double gnjDistancePlusJoinCost(guidedJoiner *gnj, int64_t i, int64_t j) {
+    int64_t first = i, second = j;
+    if (gnj->nodeNumbers[i] < gnj->n && j < i) {
+        first = j;
+        second = i;
     }
-    stHash_destructIterator(hashIt);
+    return *gnjDistance(gnj, i, j) + gnj->joinCosts[gnj->recon[first] * gnj->numSpecies + gnj->recon[second]];
+}
 
-    // Distance matrix. We clone the one fed to us since we need to
-    // modify it during the process. Note: only valid for i < j.
-    double **distances = st_calloc(numLeaves, sizeof(double *));
-    for (int64_t i = 0; i < numLeaves; i++) {
-        distances[i] = st_calloc(numLeaves, sizeof(double));
+// Fills in the row of the node in slot i, from the live slots given.
+static void gnjRow_fill(guidedJoiner *gnj, int64_t i, int64_t *slots, int64_t numSlots) {
+    njRow *row = &gnj->rows[i];
+    row->entries = st_realloc(row->entries, (numSlots > 0 ? numSlots : 1) * sizeof(njEntry));
+    row->length = 0;
+    for (int64_t k = 0; k < numSlots; k++) {
+        if (slots[k] != i) {
+            double score = gnjDistancePlusJoinCost(gnj, i, slots[k]);
+            float bound = score;
+            if (bound > score) {
+                bound = nextafterf(bound, -INFINITY);
+            }
+            row->entries[row->length].distance = bound;
+            row->entries[row->length++].slot = (int32_t) slots[k];
+        }
     }
+    njRow_sort(row);
+}
 
-    // Confidence matrix (i.e. count of similarities + differences for
-    // i,j). Note: only valid for i < j.
-    double **confidences = st_calloc(numLeaves, sizeof(double *));
-    for (int64_t i = 0; i < numLeaves; i++) {
-        confidences[i] = st_calloc(numLeaves, sizeof(double));
+static void gnjRow_fillLeafRows(int64_t start, int64_t end, void *arg) {
+    guidedJoiner *gnj = arg;
+    for (int64_t i = start; i < end; i++) {
+        gnjRow_fill(gnj, i, gnj->liveSlots, i);
     }
+}
 
-    // Fill in our copy of the distance matrix.
-    for (int64_t i = 0; i < numLeaves; i++) {
-        for (int64_t j = i + 1; j < numLeaves; j++) {
-            distances[i][j] = *stMatrix_getCell(distanceMatrix, i, j);
-        }
+// Returns true if the pair (i, j), with q, comes before the candidate
+// in the order of the full search, which takes the first least Q
+// scanning pairs (i, j), i < j, by i and then by j.
+static inline bool gnjCandidate_isBeatenBy(gnjCandidate *candidate, double q, int64_t i, int64_t j) {
+    if (!candidate->found) {
+        return q < candidate->q;
     }
+    return q < candidate->q || (q == candidate->q && (i < candidate->i || (i == candidate->i && j < candidate->j)));
+}
 
-    // Initial "r" cost (the average of the distances from each node
-    // to all others) to weight with.
-    double *r = st_calloc(numLeaves, sizeof(double));
-    for (int64_t i = 0; i < numLeaves; i++) {
-        assert(r[i] == 0.0);
-        for (int64_t j = 0; j < numLeaves; j++) {
-            if (i == j) {
-                continue;
-            }
-            if (i < j) {
-                r[i] += distances[i][j];
-            } else {
-                r[i] += distances[j][i];
-            }
-        }
-        r[i] /= numLeaves - 2;
-    }
+static void gnjCandidate_set(gnjCandidate *candidate, double q, int64_t i, int64_t j) {
+    candidate->q = q;
+    candidate->i = i;
+    candidate->j = j;
+    candidate->found = 1;
+}
 
-    // Initialize the join distances (i.e. distance-relative rather
-    // than the similarity/difference-relative join costs.) Only
-    // defined for row < col.
-    double **joinDistances = st_calloc(numLeaves, sizeof(double *));
-    for (int64_t i = 0; i < numLeaves; i++) {
-        joinDistances[i] = st_calloc(numLeaves, sizeof(double));
-        for (int64_t j = i + 1; j < numLeaves; j++) {
-            if (confidences[i][j] != 0) {
-                joinDistances[i][j] = *stMatrix_getCell(joinCosts, recon[i], recon[j]) / confidences[i][j];
-            } else {
-                // the distance will already be INT64_MAX, just try to
-                // bias it toward the species tree (although we may
-                // run into floating-point resolution errors here)
-                joinDistances[i][j] = *stMatrix_getCell(joinCosts, recon[i], recon[j]);
-            }
-        }
+static void *gnjCandidate_construct(void *arg) {
+    gnjCandidate *candidate = st_malloc(sizeof(gnjCandidate));
+    candidate->q = DBL_MAX;
+    candidate->i = candidate->j = -1;
+    candidate->found = 0;
+    return candidate;
+}
+
+static void gnjCandidate_merge(void *accumulator, void *accumulatorToMerge, void *arg) {
+    gnjCandidate *candidate = accumulator, *candidateToMerge = accumulatorToMerge;
+    if (candidateToMerge->found
+            && gnjCandidate_isBeatenBy(candidate, candidateToMerge->q, candidateToMerge->i, candidateToMerge->j)) {
+        *candidate = *candidateToMerge;
     }
+    free(candidateToMerge);
+}
 
-    // The actual neighbor-joining process.
-    stTree **nodes = st_calloc(numLeaves, sizeof(stTree *));
-    for (int64_t i = 0; i < numLeaves; i++) {
-        // Initialize nodes.
-        nodes[i] = stTree_construct();
-        char *name = stString_print_r("%" PRIi64, i);
-        stTree_setLabel(nodes[i], name);
-        free(name);
+static void gnjLowerBestQ(guidedJoiner *gnj, double q) {
+    double bestQ;
+    __atomic_load(&gnj->bestQ, &bestQ, __ATOMIC_RELAXED);
+    while (q < bestQ && !__atomic_compare_exchange(&gnj->bestQ, &bestQ, &q, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
     }
-    int64_t numJoinsLeft = numLeaves - 1;
-    while (numJoinsLeft > 0) {
-        // Find the lowest distance between any two roots in the
-        // forest.
-        double minDist = DBL_MAX;
-        int64_t mini = -1, minj = -1;
-        for (int64_t i = 0; i < numLeaves; i++) {
-            if (recon[i] == -1) {
-                // Signals that this node has been joined and its
-                // index is abandoned.
-                continue;
-            }
-            for (int64_t j = i + 1; j < numLeaves; j++) {
-                if (recon[j] == -1) {
-                    // Signals that this node has been joined and its
-                    // index is abandoned.
-                    continue;
-                }
-                double dist = distances[i][j] + joinDistances[i][j] - r[i] - r[j];
-                if (dist < minDist) {
-                    mini = i;
-                    minj = j;
-                    minDist = dist;
+}
+
+// Finds the best candidate of the rows of the given live slots.
+static void gnjSearchRows(int64_t start, int64_t end, void *accumulator, void *arg) {
+    guidedJoiner *gnj = arg;
+    gnjCandidate *candidate = accumulator;
+    for (int64_t k = start; k < end; k++) {
+        int64_t i = gnj->liveSlots[k];
+        njRow *row = &gnj->rows[i];
+        int64_t nodeNumber = gnj->nodeNumbers[i];
+        if (row->length > 2 * gnj->numLiveSlots) {
+            int64_t length = 0;
+            for (int64_t l = 0; l < row->length; l++) {
+                int64_t j = row->entries[l].slot;
+                if (gnj->nodes[j] != NULL && gnj->nodeNumbers[j] < nodeNumber) {
+                    row->entries[length++] = row->entries[l];
                 }
             }
-        }
-        assert(mini != -1);
-        assert(minj != -1);
-
-        double dist_mini_minj = distances[mini][minj];
-
-        // Get the branch lengths for the children of the new node.
-        double branchLength_mini = (dist_mini_minj + r[mini] - r[minj]) / 2;
-        double branchLength_minj = dist_mini_minj - branchLength_mini;
-        // Fix the distances in case of negative branch length.
-        if ((branchLength_mini <= 0 || branchLength_minj <= 0) && dist_mini_minj < 0) {
-            branchLength_mini = 0;
-            branchLength_minj = 0;
-        } else if (branchLength_mini < 0) {
-            branchLength_mini = 0;
-            branchLength_minj = dist_mini_minj;
-        } else if (branchLength_minj < 0) {
-            branchLength_mini = dist_mini_minj;
-            branchLength_minj = 0;
-        }
-
-        // Join the nodes.
-        stTree *nodei = nodes[mini];
-        assert(nodei != NULL);
-        stTree *nodej = nodes[minj];
-        assert(nodej != NULL);
-        stTree *joined = stTree_construct();
-        stTree_setParent(nodei, joined);
-        stTree_setParent(nodej, joined);
-        stTree_setBranchLength(nodei, branchLength_mini);
-        stTree_setBranchLength(nodej, branchLength_minj);
-        nodes[mini] = joined;
-        // Not strictly necessary.
-        nodes[minj] = NULL;
-
-        // Update the reconciliation of our new joined node to be the
-        // MRCA of its children's reconciliations.
-        int64_t recon_i = recon[mini];
-        int64_t recon_j = recon[minj];
-        recon[mini] = speciesMRCAMatrix[recon_i][recon_j];
-        recon[minj] = -1;
-
-        // Update the new row of the distance matrix.
-        for (int64_t k = 0; k < numLeaves; k++) {
-            if (recon[k] == -1) {
-                // Node is gone, don't need to update.
-                continue;
-            }
-            if (k == mini) {
-                // Skip distance calculation with self
-                continue;
+            row->length = length;
+        }
+        double ri = gnj->r[i];
+        for (int64_t l = 0; l < row->length; l++) {
+            // Q is (d + c - r(lower slot)) - r(higher slot); bound it
+            // for i being either.
+            double score = row->entries[l].distance;
+            double bound1 = score - ri - gnj->maxR, bound2 = score - gnj->maxR - ri;
+            double bound = bound1 < bound2 ? bound1 : bound2;
+            if (bound > candidate->q) {
+                break;
             }
-
-            // calculate the proper indices for accessing i<->k and
-            // j<->k distances and confidences (the matrix is
-            // symmetric, so only one half is stored)
-            int64_t mini_kRow = mini;
-            int64_t mini_kCol = k;
-            int64_t minj_kRow = minj;
-            int64_t minj_kCol = k;
-            if (mini > k) {
-                mini_kRow = k;
-                mini_kCol = mini;
+            double bestQ;
+            __atomic_load(&gnj->bestQ, &bestQ, __ATOMIC_RELAXED);
+            if (bound > bestQ) {
+                break;
             }
-            if (minj > k) {
-                minj_kRow = k;
-                minj_kCol = minj;
+            int64_t j = row->entries[l].slot;
+            if (gnj->nodes[j] == NULL || gnj->nodeNumbers[j] > nodeNumber) {
+                continue;
             }
-
-            confidences[mini_kRow][mini_kCol] = (confidences[mini_kRow][mini_kCol] + confidences[minj_kRow][minj_kCol]) / 2;
-
-            // Update the distances.
-            double dist_mini_k = distances[mini_kRow][mini_kCol];
-            double dist_minj_k = distances[minj_kRow][minj_kCol];
-            distances[mini_kRow][mini_kCol] = (dist_mini_k + dist_minj_k - dist_mini_minj) / 2;
-
-            // Update the join distance.
-            if (confidences[mini_kRow][mini_kCol] != 0) {
-                joinDistances[mini_kRow][mini_kCol] = *stMatrix_getCell(joinCosts, recon[mini], recon[k]) / confidences[mini_kRow][mini_kCol];
-            } else {
-                joinDistances[mini_kRow][mini_kCol] = *stMatrix_getCell(joinCosts, recon[mini], recon[k]);
+            int64_t minSlot = i < j ? i : j, maxSlot = i < j ? j : i;
+            double q = gnjDistancePlusJoinCost(gnj, i, j) - gnj->r[minSlot] - gnj->r[maxSlot];
+            if (gnjCandidate_isBeatenBy(candidate, q, minSlot, maxSlot)) {
+                gnjCandidate_set(candidate, q, minSlot, maxSlot);
+                gnjLowerBestQ(gnj, q);
             }
+        }
+    }
+}
 
-            // Update r[k].
-            if (numJoinsLeft > 2) {
-                r[k] = ((r[k] * (numJoinsLeft - 1)) - dist_mini_k - dist_minj_k + distances[mini_kRow][mini_kCol]) / (numJoinsLeft - 2);
-            } else {
-                r[k] = 0.0;
-            }
+static gnjCandidate *gnjFindJoin(guidedJoiner *gnj, stThreadPool *threadPool) {
+    gnj->bestQ = DBL_MAX;
+    gnjCandidate *candidate;
+    if (threadPool != NULL) {
+        candidate = stThreadPool_parallelReduce(threadPool, gnj->numLiveSlots, 16, gnjCandidate_construct,
+                                                gnjSearchRows, gnjCandidate_merge, gnj);
+    } else {
+        candidate = gnjCandidate_construct(gnj);
+        gnjSearchRows(0, gnj->numLiveSlots, candidate, gnj);
+    }
+    if (!candidate->found) {
+        // Only possible if every Q is infinite or not a number.
+        int64_t i = 0;
+        while (gnj->nodes[i] == NULL) {
+            i++;
+        }
+        int64_t j = i + 1;
+        while (gnj->nodes[j] == NULL) {
+            j++;
         }
+        gnjCandidate_set(candidate, DBL_MAX, i, j);
+    }
+    return candidate;
+}
 
-        // Set r for the new column.
-        r[mini] = 0.0;
+// Joins the nodes in slots mini < minj, putting the new node in slot mini.
+static void gnjJoin(guidedJoiner *gnj, int64_t mini, int64_t minj, int64_t nodeNumber, int64_t numJoinsLeft) {
+    double dist_mini_minj = *gnjDistance(gnj, mini, minj);
+
+    // Get the branch lengths for the children of the new node.
+    double branchLength_mini = (dist_mini_minj + gnj->r[mini] - gnj->r[minj]) / 2;
+    double branchLength_minj = dist_mini_minj - branchLength_mini;
+    // Fix the distances in case of negative branch length.
+    if ((branchLength_mini <= 0 || branchLength_minj <= 0) && dist_mini_minj < 0) {
+        branchLength_mini = 0;
+        branchLength_minj = 0;
+    } else if (branchLength_mini < 0) {
+        branchLength_mini = 0;
+        branchLength_minj = dist_mini_minj;
+    } else if (branchLength_minj < 0) {
+        branchLength_mini = dist_mini_minj;
+        branchLength_minj = 0;
+    }
+
+    // Join the nodes.
+    stTree *joined = stTree_construct();
+    stTree_setParent(gnj->nodes[mini], joined);
+    stTree_setParent(gnj->nodes[minj], joined);
+    stTree_setBranchLength(gnj->nodes[mini], branchLength_mini);
+    stTree_setBranchLength(gnj->nodes[minj], branchLength_minj);
+    gnj->nodes[mini] = joined;
+    gnj->nodes[minj] = NULL;
+    gnj->nodeNumbers[mini] = nodeNumber;
+    int64_t position = gnj->liveSlotPositions[minj];
+    gnj->liveSlots[position] = gnj->liveSlots[--gnj->numLiveSlots];
+    gnj->liveSlotPositions[gnj->liveSlots[position]] = position;
+
+    // The reconciliation of the new node is the MRCA of its children's
+    // reconciliations.
+    if (gnj->speciesMRCAMatrix != NULL) {
+        gnj->recon[mini] = gnj->speciesMRCAMatrix[gnj->recon[mini]][gnj->recon[minj]];
+    } else {
+        stTree *mrca = stTreeLCAIndex_getMRCA(gnj->speciesLCAIndex, gnj->indexToSpecies[gnj->recon[mini]],
+                                              gnj->indexToSpecies[gnj->recon[minj]]);
+        stIntTuple *mrcaIndex = stHash_search(gnj->speciesToJoinCostIndex, mrca);
+        assert(mrcaIndex != NULL);
+        gnj->recon[mini] = stIntTuple_get(mrcaIndex, 0);
+    }
+    gnj->recon[minj] = -1;
+
+    // Update the distances and r values.
+    for (int64_t k = 0; k < gnj->n; k++) {
+        if (gnj->nodes[k] == NULL || k == mini) {
+            continue;
+        }
+        double *dist_mini_k = gnjDistance(gnj, mini, k);
+        double dist_minj_k = *gnjDistance(gnj, minj, k);
+        double oldDist_mini_k = *dist_mini_k;
+        *dist_mini_k = (oldDist_mini_k + dist_minj_k - dist_mini_minj) / 2;
         if (numJoinsLeft > 2) {
-            for (int64_t k = 0; k < numLeaves; k++) {
-                if (recon[k] == -1) {
-                    continue;
-                }
-                if (k < mini) {
-                    r[mini] += distances[k][mini];
-                } else {
-                    r[mini] += distances[mini][k];
-                }
-            }
-            r[mini] /= numJoinsLeft - 2;
+            gnj->r[k] = ((gnj->r[k] * (numJoinsLeft - 1)) - oldDist_mini_k - dist_minj_k + *dist_mini_k) / (numJoinsLeft - 2);
         } else {
-            r[mini] = 0.0;
+            gnj->r[k] = 0.0;
         }
-        numJoinsLeft--;
+    }
+    gnj->r[mini] = 0.0;
+    if (numJoinsLeft > 2) {
+        for (int64_t k = 0; k < gnj->n; k++) {
+            if (gnj->nodes[k] != NULL) {
+                gnj->r[mini] += *gnjDistance(gnj, k, mini);
+            }
+        }
+        gnj->r[mini] /= numJoinsLeft - 2;
+    }
+    gnj->maxR = -DBL_MAX;
+    for (int64_t k = 0; k < gnj->numLiveSlots; k++) {
+        double r = gnj->r[gnj->liveSlots[k]];
+        gnj->maxR = r > gnj->maxR ? r : gnj->maxR;
     }
 
-    stTree *ret = nodes[0];
-    assert(ret != NULL);
+    free(gnj->rows[minj].entries);
+    gnj->rows[minj].entries = NULL;
+    gnj->rows[minj].length = 0;
+    gnjRow_fill(gnj, mini, gnj->liveSlots, gnj->numLiveSlots);
+}
 
-    // Clean up.
-    free(recon);
-    free(r);
-    free(nodes);
+stTree *stPhylogeny_guidedNeighborJoining2(stMatrix *distanceMatrix,
+                                           stMatrix *similarityMatrix,
+                                           stMatrix *joinCosts,
+                                           stHash *matrixIndexToJoinCostIndex,
+                                           stHash *speciesToJoinCostIndex,
+                                           int64_t **speciesMRCAMatrix,
+                                           stTree *speciesTree,
+                                           int64_t numThreads) {
+    int64_t numLeaves = stMatrix_n(similarityMatrix);
+    assert(numLeaves == stMatrix_m(similarityMatrix));
+    assert(numLeaves >= 3);
+    guidedJoiner gnj;
+    gnj.n = numLeaves;
+    gnj.numSpecies = stMatrix_n(joinCosts);
+    gnj.speciesMRCAMatrix = speciesMRCAMatrix;
+    gnj.speciesLCAIndex = NULL;
+    gnj.indexToSpecies = NULL;
+    gnj.speciesToJoinCostIndex = speciesToJoinCostIndex;
+    if (speciesMRCAMatrix == NULL) {
+        gnj.speciesLCAIndex = stTreeLCAIndex_construct(speciesTree);
+        gnj.indexToSpecies = getIndexToSpecies(speciesToJoinCostIndex, gnj.numSpecies);
+    }
+
+    // Dense copies of the reconciliations (in join cost matrix
+    // indices) and the join costs.
+    gnj.recon = st_calloc(numLeaves, sizeof(int64_t));
+    stHashIterator *hashIt = stHash_getIterator(matrixIndexToJoinCostIndex);
+    stIntTuple *matrixIndex;
+    while ((matrixIndex = stHash_getNext(hashIt)) != NULL) {
+        stIntTuple *joinCostIndex = stHash_search(matrixIndexToJoinCostIndex, matrixIndex);
+        assert(joinCostIndex != NULL);
+        gnj.recon[stIntTuple_get(matrixIndex, 0)] = stIntTuple_get(joinCostIndex, 0);
+    }
+    stHash_destructIterator(hashIt);
+    gnj.joinCosts = st_malloc(gnj.numSpecies * gnj.numSpecies * sizeof(double));
+    for (int64_t i = 0; i < gnj.numSpecies; i++) {
+        for (int64_t j = 0; j < gnj.numSpecies; j++) {
+            gnj.joinCosts[i * gnj.numSpecies + j] = *stMatrix_getCell(joinCosts, i, j);
+        }
+    }
 
+    // Only the upper half of the distance matrix is used.
+    gnj.distances = st_calloc(numLeaves * (numLeaves + 1) / 2, sizeof(double));
     for (int64_t i = 0; i < numLeaves; i++) {
-        free(distances[i]);
+        for (int64_t j = i + 1; j < numLeaves; j++) {
+            *gnjDistance(&gnj, i, j) = *stMatrix_getCell(distanceMatrix, i, j);
+        }
     }
-    free(distances);
 
+    // Initial "r" cost (the average of the distances from each node
+    // to all others) to weight with.
+    gnj.r = st_calloc(numLeaves, sizeof(double));
+    gnj.maxR = -DBL_MAX;
+    gnj.nodes = st_malloc(numLeaves * sizeof(stTree *));
+    gnj.nodeNumbers = st_malloc(numLeaves * sizeof(int64_t));
+    gnj.liveSlots = st_malloc(numLeaves * sizeof(int64_t));
+    gnj.liveSlotPositions = st_malloc(numLeaves * sizeof(int64_t));
+    gnj.numLiveSlots = numLeaves;
+    gnj.rows = st_calloc(numLeaves, sizeof(njRow));
     for (int64_t i = 0; i < numLeaves; i++) {
-        free(confidences[i]);
+        for (int64_t j = 0; j < numLeaves; j++) {
+            if (i != j) {
+                gnj.r[i] += *gnjDistance(&gnj, i, j);
+            }
+        }
+        gnj.r[i] /= numLeaves - 2;
+        gnj.maxR = gnj.r[i] > gnj.maxR ? gnj.r[i] : gnj.maxR;
+        gnj.nodes[i] = stTree_construct();
+        char *name = stString_print_r("%" PRIi64, i);
+        stTree_setLabel(gnj.nodes[i], name);
+        free(name);
+        gnj.nodeNumbers[i] = i;
+        gnj.liveSlots[i] = i;
+        gnj.liveSlotPositions[i] = i;
     }
-    free(confidences);
 
+    stThreadPool *threadPool = numThreads > 1 ? stThreadPool_construct(numThreads - 1, NULL, NULL) : NULL;
+    if (threadPool != NULL) {
+        stThreadPool_parallelFor(threadPool, numLeaves, 64, gnjRow_fillLeafRows, &gnj);
+    } else {
+        gnjRow_fillLeafRows(0, numLeaves, &gnj);
+    }
+
+    // The actual neighbor-joining process.
+    int64_t nodeNumber = numLeaves;
+    for (int64_t numJoinsLeft = numLeaves - 1; numJoinsLeft > 0; numJoinsLeft--) {
+        gnjCandidate *candidate = gnjFindJoin(&gnj, threadPool);
+        gnjJoin(&gnj, candidate->i, candidate->j, nodeNumber++, numJoinsLeft);
+        free(candidate);
+    }
+    if (threadPool != NULL) {
+        stThreadPool_destruct(threadPool);
+    }
+
+    // Slot 0 is never the higher slot of a join, so holds the root.
+    stTree *ret = gnj.nodes[0];
+    assert(ret != NULL);
+
+    // Clean up.
     for (int64_t i = 0; i < numLeaves; i++) {
-        free(joinDistances[i]);
+        free(gnj.rows[i].entries);
+    }
+    free(gnj.rows);
+    free(gnj.liveSlots);
+    free(gnj.liveSlotPositions);
+    free(gnj.nodeNumbers);
+    free(gnj.nodes);
+    free(gnj.r);
+    free(gnj.distances);
+    free(gnj.joinCosts);
+    free(gnj.recon);
+    if (gnj.speciesLCAIndex != NULL) {
+        stTreeLCAIndex_destruct(gnj.speciesLCAIndex);
+        free(gnj.indexToSpecies);
     }
-    free(joinDistances);
 
     assert(stTree_getNumNodes(ret) == numLeaves * 2 - 1);
 
@@ -1070,6 +1688,18 @@ stTree *stPhylogeny_guidedNeighborJoining(stMatrix *distanceMatrix,
     return ret;
 }
 
+stTree *stPhylogeny_guidedNeighborJoining(stMatrix *distanceMatrix,
+                                          stMatrix *similarityMatrix,
+                                          stMatrix *joinCosts,
+                                          stHash *matrixIndexToJoinCostIndex,
+                                          stHash *speciesToJoinCostIndex,
+                                          int64_t **speciesMRCAMatrix,
+                                          stTree *speciesTree) {
+    return stPhylogeny_guidedNeighborJoining2(distanceMatrix, similarityMatrix, joinCosts,
+                                              matrixIndexToJoinCostIndex, speciesToJoinCostIndex,
+                                              speciesMRCAMatrix, speciesTree, 1);
+}
+
 // Fills in stReconciliationInfo, creating the containing
 // stPhylogenyInfo if necessary.
 static void fillInReconciliationInfo(stTree *gene, stTree *recon,
@@ -1092,8 +1722,31 @@ static void fillInReconciliationInfo(stTree *gene, stTree *recon,
     }
 }
 
+// Build an LCA index of the species tree that the gene tree's leaves
+// are mapped to, so that each reconciliation step is a constant-time
+// MRCA query.
+static stTreeLCAIndex *getSpeciesLCAIndex(stTree *geneTree, stHash *leafToSpecies) {
+    stTree *leaf = geneTree;
+    while (stTree_getChildNumber(leaf) != 0) {
+        leaf = stTree_getChild(leaf, 0);
+    }
+    stTree *speciesRoot = stHash_search(leafToSpecies, leaf);
+    assert(speciesRoot != NULL);
+    while (stTree_getParent(speciesRoot) != NULL) {
+        speciesRoot = stTree_getParent(speciesRoot);
+    }
+    return stTreeLCAIndex_construct(speciesRoot);
+}
+
+static stTree *getSpeciesMRCA(stTreeLCAIndex *speciesIndex, stTree *species1, stTree *species2) {
+    stTree *mrca = stTreeLCAIndex_getMRCA(speciesIndex, species1, species2);
+    assert(mrca != NULL);
+    return mrca;
+}
+
 static stTree *stPhylogeny_reconcileAtMostBinary_R(stTree *gene,
                                                    stHash *leafToSpecies,
+                                                   stTreeLCAIndex *speciesIndex,
                                                    bool relabelAncestors) {
     stTree *recon;
     stReconciliationEvent event;
@@ -1105,11 +1758,11 @@ static stTree *stPhylogeny_reconcileAtMostBinary_R(stTree *gene,
     } else {
         event = SPECIATION;
         recon = stPhylogeny_reconcileAtMostBinary_R(
-            stTree_getChild(gene, 0), leafToSpecies, relabelAncestors);
+            stTree_getChild(gene, 0), leafToSpecies, speciesIndex, relabelAncestors);
         for (int64_t i = 1; i < stTree_getChildNumber(gene); i++) {
             stTree *childRecon = stPhylogeny_reconcileAtMostBinary_R(
-                stTree_getChild(gene, i), leafToSpecies, relabelAncestors);
-            recon = stTree_getMRCA(childRecon, recon);
+                stTree_getChild(gene, i), leafToSpecies, speciesIndex, relabelAncestors);
+            recon = getSpeciesMRCA(speciesIndex, childRecon, recon);
         }
         for (int64_t i = 0; i < stTree_getChildNumber(gene); i++) {
             stPhylogenyInfo *childInfo = stTree_getClientData(stTree_getChild(gene, i));
@@ -1133,8 +1786,10 @@ static stTree *stPhylogeny_reconcileAtMostBinary_R(stTree *gene,
 // children, but may have nodes with only one child.
 void stPhylogeny_reconcileAtMostBinary(stTree *geneTree, stHash *leafToSpecies,
                                        bool relabelAncestors) {
-    stPhylogeny_reconcileAtMostBinary_R(geneTree, leafToSpecies,
+    stTreeLCAIndex *speciesIndex = getSpeciesLCAIndex(geneTree, leafToSpecies);
+    stPhylogeny_reconcileAtMostBinary_R(geneTree, leafToSpecies, speciesIndex,
                                         relabelAncestors);
+    stTreeLCAIndex_destruct(speciesIndex);
 }
 
 static bool getLinkedSpeciesTree_R(stTree *speciesNode, stTree *polytomy, stHash *speciesToNumGenes, stTree *linkedNode) {
@@ -1419,6 +2074,7 @@ void stPhylogeny_reconciliationCostAtMostBinary(stTree *reconciledTree,
 // lowest recon cost if the tree was rooted at that position.
 // curRoot is the child of the branch to root on.
 void stPhylogeny_rootByReconciliationAtMostBinary_R(stTree *curRoot,
+                                                    stTreeLCAIndex *speciesIndex,
                                                     stTree *prevRootParentSpecies,
                                                     int64_t prevRootDups,
                                                     int64_t prevRootLosses,
@@ -1450,7 +2106,7 @@ void stPhylogeny_rootByReconciliationAtMostBinary_R(stTree *curRoot,
     // Call this the parent's new species for consistency, although
     // now it's the sibling in the new tree. The name is confusing
     // either way.
-    stTree *parentNewSpecies = stTree_getMRCA(prevRootParentSpecies, siblingSpecies);
+    stTree *parentNewSpecies = getSpeciesMRCA(speciesIndex, prevRootParentSpecies, siblingSpecies);
 
     // Next, the new root's recon is just the MRCA of our parent's
     // recon in the rerooted tree, and the recon of this node (which
@@ -1458,7 +2114,7 @@ void stPhylogeny_rootByReconciliationAtMostBinary_R(stTree *curRoot,
     stPhylogenyInfo *curInfo = stTree_getClientData(curRoot);
     assert(curInfo != NULL && curInfo->recon != NULL);
     stTree *curSpecies = curInfo->recon->species;
-    stTree *newRootSpecies = stTree_getMRCA(curSpecies, parentNewSpecies);
+    stTree *newRootSpecies = getSpeciesMRCA(speciesIndex, curSpecies, parentNewSpecies);
 
     // Find the new cost in dups. This is just (# of old dups) - (old root
     // was dup? 1 : 0) - (parent used to be dup? 1 : 0) + (new root is
@@ -1467,7 +2123,7 @@ void stPhylogeny_rootByReconciliationAtMostBinary_R(stTree *curRoot,
     if (parentOldSpecies == curSpecies || parentOldSpecies == siblingSpecies) {
         curRootDups--;
     }
-    stTree *oldRootSpecies = stTree_getMRCA(prevRootParentSpecies,
+    stTree *oldRootSpecies = getSpeciesMRCA(speciesIndex, prevRootParentSpecies,
                                             parentOldSpecies);
     if (oldRootSpecies == prevRootParentSpecies || oldRootSpecies == parentOldSpecies) {
         curRootDups--;
@@ -1494,6 +2150,7 @@ void stPhylogeny_rootByReconciliationAtMostBinary_R(stTree *curRoot,
     }
     for (int64_t i = 0; i < stTree_getChildNumber(curRoot); i++) {
         stPhylogeny_rootByReconciliationAtMostBinary_R(stTree_getChild(curRoot, i),
+                                                       speciesIndex,
                                                        parentNewSpecies,
                                                        curRootDups,
                                                        curRootLosses, bestDups,
@@ -1508,7 +2165,8 @@ void stPhylogeny_rootByReconciliationAtMostBinary_R(stTree *curRoot,
 // reconciliation information that potentially already exists.
 stTree *stPhylogeny_rootByReconciliationAtMostBinary(stTree *geneTree,
                                                      stHash *leafToSpecies) {
-    stPhylogeny_reconcileAtMostBinary(geneTree, leafToSpecies, false);
+    stTreeLCAIndex *speciesIndex = getSpeciesLCAIndex(geneTree, leafToSpecies);
+    stPhylogeny_reconcileAtMostBinary_R(geneTree, leafToSpecies, speciesIndex, false);
 
     // Find the root which has the lowest reconciliation cost.
     int64_t dups = 0, losses = 0;
@@ -1517,6 +2175,7 @@ stTree *stPhylogeny_rootByReconciliationAtMostBinary(stTree *geneTree,
     int64_t bestDups = dups;
     int64_t bestLosses = losses;
     if (stTree_getChildNumber(geneTree) == 0) {
+        stTreeLCAIndex_destruct(speciesIndex);
         return stTree_clone(geneTree);
     } else {
         assert(stTree_getChildNumber(geneTree) == 2);
@@ -1528,6 +2187,7 @@ stTree *stPhylogeny_rootByReconciliationAtMostBinary(stTree *geneTree,
         stTree *rightChildSpecies = rightChildInfo->recon->species;
         for (int64_t i = 0; i < stTree_getChildNumber(leftChild); i++) {
             stPhylogeny_rootByReconciliationAtMostBinary_R(stTree_getChild(leftChild, i),
+                                                           speciesIndex,
                                                            rightChildSpecies,
                                                            dups, losses,
                                                            &bestDups,
@@ -1536,12 +2196,14 @@ stTree *stPhylogeny_rootByReconciliationAtMostBinary(stTree *geneTree,
         }
         for (int64_t i = 0; i < stTree_getChildNumber(rightChild); i++) {
             stPhylogeny_rootByReconciliationAtMostBinary_R(stTree_getChild(rightChild, i),
+                                                           speciesIndex,
                                                            leftChildSpecies,
                                                            dups, losses,
                                                            &bestDups,
                                                            &bestLosses,
                                                            &bestRoot);
         }
+        stTreeLCAIndex_destruct(speciesIndex);
         return stTree_reRoot(bestRoot, stTree_getBranchLength(bestRoot)/2);
     }
 }
@@ -1636,6 +2298,7 @@ static stSet *climb(stTree *childGene, stTree *childLCARecon, stTree *parentGene
 }
 
 static stTree *stPhylogeny_reconcileNonBinary_R(stTree *gene, stHash *leafToSpecies,
+                                                stTreeLCAIndex *speciesIndex,
                                                 stHash *N, bool relabelAncestors) {
     stTree *LCARecon;
     stReconciliationEvent event;
@@ -1651,10 +2314,10 @@ static stTree *stPhylogeny_reconcileNonBinary_R(stTree *gene, stHash *leafToSpec
         // Internal node
         // Calculate the LCA mapping
         stTree *leftLCARecon = stPhylogeny_reconcileNonBinary_R(
-            stTree_getChild(gene, 0), leafToSpecies, N, relabelAncestors);
+            stTree_getChild(gene, 0), leafToSpecies, speciesIndex, N, relabelAncestors);
         stTree *rightLCARecon = stPhylogeny_reconcileNonBinary_R(
-            stTree_getChild(gene, 1), leafToSpecies, N, relabelAncestors);
-        LCARecon = stTree_getMRCA(leftLCARecon, rightLCARecon);
+            stTree_getChild(gene, 1), leafToSpecies, speciesIndex, N, relabelAncestors);
+        LCARecon = getSpeciesMRCA(speciesIndex, leftLCARecon, rightLCARecon);
         // Calculate if this is a required duplication. We don't
         // really care if it's a conditional duplication.
         stSet *leftN = climb(stTree_getChild(gene, 0), leftLCARecon,
@@ -1687,7 +2350,9 @@ void stPhylogeny_reconcileNonBinary(stTree *geneTree, stHash *leafToSpecies, boo
     // TODO: this hash is likely unnecessary and values could probably
     // be passed up along the tree by stPhylogeny_reconcile_R.
     stHash *N = stHash_construct();
-    stPhylogeny_reconcileNonBinary_R(geneTree, leafToSpecies, N, relabelAncestors);
+    stTreeLCAIndex *speciesIndex = getSpeciesLCAIndex(geneTree, leafToSpecies);
+    stPhylogeny_reconcileNonBinary_R(geneTree, leafToSpecies, speciesIndex, N, relabelAncestors);
+    stTreeLCAIndex_destruct(speciesIndex);
     stHash_destruct(N);
 }
 
@@ -1838,57 +2503,81 @@ void stPhylogeny_nni(stTree *anc, stTree **tree1, stTree **tree2) {
 // not be larger than *both* inter-split distances), but if false,
 // uses a stricter condition (that the intra-split distance must be
 // smaller than *both* inter-split distances).
-static bool satisfiesFourPoint(stMatrix *distanceMatrix, stList *leftSplitIndices, stList *rightSplitIndices, bool relaxed) {
-    // This is a bit convoluted, but generates all possible
-    // unordered combinations of indices i, j in the left side of the split. i,j
-    // are distance matrix indices, not indices in the split list!
-    for (int64_t left_i = 0; left_i < stList_length(leftSplitIndices); left_i++) {
-        for (int64_t left_j = left_i + 1; left_j < stList_length(leftSplitIndices); left_j++) {
-            int64_t i = stIntTuple_get(stList_get(leftSplitIndices, left_i), 0);
-            int64_t j = stIntTuple_get(stList_get(leftSplitIndices, left_j), 0);
-            // Similarly, generate all possible unordered combinations
-            // k, l from the right side of the split.
-            for (int64_t right_i = 0; right_i < stList_length(rightSplitIndices); right_i++) {
-                for (int64_t right_j = right_i + 1; right_j < stList_length(rightSplitIndices); right_j++) {
-                    int64_t k = stIntTuple_get(stList_get(rightSplitIndices, right_i), 0);
-                    int64_t l = stIntTuple_get(stList_get(rightSplitIndices, right_j), 0);
-                    // Do the check.
-                    double intra = *stMatrix_getCell(distanceMatrix, i, j) + *stMatrix_getCell(distanceMatrix, k, l);
-                    double inter1 = *stMatrix_getCell(distanceMatrix, i, k) + *stMatrix_getCell(distanceMatrix, j, l);
-                    double inter2 = *stMatrix_getCell(distanceMatrix, i, l) + *stMatrix_getCell(distanceMatrix, j, k);
-                    if (relaxed) {
-                        if (intra >= inter1 && intra >= inter2) {
-                            return false;
-                        }
-                    } else {
-                        if (intra >= inter1 || intra >= inter2) {
-                            return false;
-                        }
-                    }
-                }
-            }
-        }
-    }
-    // If we're here, then we've checked all the possible quartets without failing.
-    return true;
+/*
+ * Split decomposition (Bandelt and Dress, 1992) adds the leaves one at
+ * a time. Each d-split of the leaves so far may extend to a d-split
+ * with the new leaf on its left, on its right, or both. A split is
+ * held as a bitset of its left side over the leaves so far (its right
+ * side is the rest), with the least, over its quartets, of the max of
+ * the three pair sums less the intra-split sum, from which the
+ * isolation index follows. Every quartet of a split has been checked
+ * already, so extending it only checks, and takes the least of, the
+ * quartets containing the new leaf, a row of them at a time, stopping
+ * at the first row that fails.
+ * The splits are extended in parallel.
+ */
+
+typedef struct _bitSplit {
+    uint64_t *left; // The leaves on the left side.
+    int64_t leftSize;
+    double minQuartet; // DBL_MAX if the split has no quartets.
+    double isolationIndex;
+} bitSplit;
+
+static bitSplit *bitSplit_construct(int64_t numWords, int64_t leftSize, double minQuartet) {
+    bitSplit *split = st_malloc(sizeof(bitSplit));
+    split->left = st_calloc(numWords, sizeof(uint64_t));
+    split->leftSize = leftSize;
+    split->minQuartet = minQuartet;
+    split->isolationIndex = 0.0;
+    return split;
 }
 
-static stSplit *stSplit_construct(stList *leftSplit, stList *rightSplit, double isolationIndex) {
-    stSplit *ret = st_malloc(sizeof(stSplit));
-    ret->leftSplit = leftSplit;
-    ret->rightSplit = rightSplit;
-    ret->isolationIndex = isolationIndex;
-    return ret;
+static bitSplit *bitSplit_clone(bitSplit *split, int64_t numWords) {
+    bitSplit *clone = bitSplit_construct(numWords, split->leftSize, split->minQuartet);
+    memcpy(clone->left, split->left, numWords * sizeof(uint64_t));
+    return clone;
 }
 
-static void stSplit_destruct(stSplit *split) {
-    stList_destruct(split->leftSplit);
-    stList_destruct(split->rightSplit);
+static void bitSplit_destruct(bitSplit *split) {
+    free(split->left);
     free(split);
 }
 
+static inline bool bitSplit_isLeft(bitSplit *split, int64_t i) {
+    return (split->left[i / 64] >> (i % 64)) & 1;
+}
+
+static inline void bitSplit_addLeft(bitSplit *split, int64_t i) {
+    split->left[i / 64] |= ((uint64_t) 1) << (i % 64);
+    split->leftSize++;
+}
+
+// Fills in the leaves less than numLeaves on each side, in increasing order.
+static void bitSplit_getSides(bitSplit *split, int64_t numLeaves, int64_t *left, int64_t *right) {
+    int64_t leftLength = 0, rightLength = 0;
+    for (int64_t word = 0; word * 64 < numLeaves; word++) {
+        uint64_t bits = split->left[word];
+        uint64_t rightBits = ~bits;
+        int64_t end = numLeaves - word * 64;
+        if (end < 64) {
+            uint64_t mask = (((uint64_t) 1) << end) - 1;
+            bits &= mask;
+            rightBits &= mask;
+        }
+        while (bits != 0) {
+            left[leftLength++] = word * 64 + __builtin_ctzll(bits);
+            bits &= bits - 1;
+        }
+        while (rightBits != 0) {
+            right[rightLength++] = word * 64 + __builtin_ctzll(rightBits);
+            rightBits &= rightBits - 1;
+        }
+    }
+}
+
 // Compare two d-splits by their isolation indexes.
-static int stSplit_cmp(stSplit *split1, stSplit *split2) {
+static int bitSplit_cmp(bitSplit *split1, bitSplit *split2) {
     if (split1->isolationIndex < split2->isolationIndex) {
         return -1;
     } else if (split1->isolationIndex > split2->isolationIndex) {
@@ -1898,153 +2587,277 @@ static int stSplit_cmp(stSplit *split1, stSplit *split2) {
     }
 }
 
-static void assignIsolationIndex(stMatrix *distanceMatrix, stSplit *split) {
-    // We want to find the minimum of (maximum of inter-split distances - intra-split distance) / 2
-    // from all cross-split quartets.
-    double min_isolation = DBL_MAX;
-    for (int64_t left_i = 0; left_i < stList_length(split->leftSplit); left_i++) {
-        for (int64_t left_j = left_i + 1; left_j < stList_length(split->leftSplit); left_j++) {
-            int64_t i = stIntTuple_get(stList_get(split->leftSplit, left_i), 0);
-            int64_t j = stIntTuple_get(stList_get(split->leftSplit, left_j), 0);
-
-            for (int64_t right_i = 0; right_i < stList_length(split->rightSplit); right_i++) {
-                for (int64_t right_j = right_i + 1; right_j < stList_length(split->rightSplit); right_j++) {
-                    int64_t k = stIntTuple_get(stList_get(split->rightSplit, right_i), 0);
-                    int64_t l = stIntTuple_get(stList_get(split->rightSplit, right_j), 0);
-                    double intra = *stMatrix_getCell(distanceMatrix, i, j) + *stMatrix_getCell(distanceMatrix, k, l);
-                    double inter1 = *stMatrix_getCell(distanceMatrix, i, k) + *stMatrix_getCell(distanceMatrix, j, l);
-                    double inter2 = *stMatrix_getCell(distanceMatrix, i, l) + *stMatrix_getCell(distanceMatrix, j, k);
-                    double max_dist = intra;
-                    if (inter1 > max_dist) {
-                        max_dist = inter1;
-                    }
-                    if (inter2 > max_dist) {
-                        max_dist = inter2;
-                    }
-                    max_dist -= intra;
-                    if (max_dist < min_isolation) {
-                        min_isolation = max_dist;
-                    }
-                }
+// Checks a row of quartets, the mth having the pair sums
+// intraBase + intraRow[m], inter1Base + inter1Row[m] and
+// inter2Base + inter2Row[m], and lowers the minimum by their values,
+// returning false if any fails the four-point condition.
+static inline bool checkQuartetRow(double intraBase, double *intraRow, double inter1Base, double *inter1Row,
+                                   double inter2Base, double *inter2Row, int64_t length, bool relaxed,
+                                   double *minQuartet) {
+    int64_t fails = 0;
+    double min = *minQuartet;
+    for (int64_t m = 0; m < length; m++) {
+        double intra = intraBase + intraRow[m];
+        double inter1 = inter1Base + inter1Row[m];
+        double inter2 = inter2Base + inter2Row[m];
+        int64_t fails1 = intra >= inter1, fails2 = intra >= inter2;
+        fails |= relaxed ? fails1 & fails2 : fails1 | fails2;
+        double maxDist = inter1 > intra ? inter1 : intra;
+        maxDist = inter2 > maxDist ? inter2 : maxDist;
+        maxDist -= intra;
+        min = maxDist < min ? maxDist : min;
+    }
+    *minQuartet = min;
+    return !fails;
+}
+
+typedef struct _splitExtension {
+    double *distances; // Dense copy of the distance matrix.
+    int64_t n;
+    bool relaxed;
+    int64_t newLeaf;
+    bitSplit **splits;
+    bool *addToLeft, *addToRight;
+    double *minQuartetLeft, *minQuartetRight;
+} splitExtension;
+
+// The distances a split's quartets with the new leaf x need, gathered
+// so that the rows of quartets are contiguous.
+typedef struct _splitDistances {
+    int64_t leftLength, rightLength;
+    double *leftRight; // d(left[i], right[k]) at i * rightLength + k.
+    double *leftX, *rightX; // d(left[i], x) and d(right[k], x).
+    double *xRight; // d(x, right[k]).
+    double *rightRow; // Scratch for a row of d(right[k], right[l]).
+} splitDistances;
+
+// Checks the quartets (a, x | k, l), for the new leaf x added to the left.
+static bool checkNewLeafOnLeft(splitExtension *extension, splitDistances *sd, int64_t *right,
+                               double *minQuartet) {
+    int64_t n = extension->n, rightLength = sd->rightLength;
+    for (int64_t k = 0; k < rightLength; k++) {
+        double *dk = extension->distances + right[k] * n;
+        for (int64_t l = k + 1; l < rightLength; l++) {
+            sd->rightRow[l] = dk[right[l]];
+        }
+        for (int64_t a = 0; a < sd->leftLength; a++) {
+            double *daRight = sd->leftRight + a * rightLength;
+            if (!checkQuartetRow(sd->leftX[a], sd->rightRow + k + 1, daRight[k], sd->xRight + k + 1,
+                                 sd->xRight[k], daRight + k + 1, rightLength - k - 1,
+                                 extension->relaxed, minQuartet)) {
+                return false;
             }
         }
     }
-    split->isolationIndex = min_isolation / 2;
+    return true;
 }
 
-stList *stPhylogeny_getSplits(stMatrix *distanceMatrix, bool relaxed) {
+// Checks the quartets (i, j | k, x), for the new leaf x added to the right.
+static bool checkNewLeafOnRight(splitExtension *extension, splitDistances *sd, int64_t *left,
+                                double *minQuartet) {
+    int64_t n = extension->n, rightLength = sd->rightLength;
+    for (int64_t i = 0; i < sd->leftLength; i++) {
+        double *di = extension->distances + left[i] * n;
+        double *diRight = sd->leftRight + i * rightLength;
+        for (int64_t j = i + 1; j < sd->leftLength; j++) {
+            if (!checkQuartetRow(di[left[j]], sd->rightX, sd->leftX[j], diRight,
+                                 sd->leftX[i], sd->leftRight + j * rightLength, rightLength,
+                                 extension->relaxed, minQuartet)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void extendSplits(int64_t start, int64_t end, void *arg) {
+    splitExtension *extension = arg;
+    int64_t n = extension->n, x = extension->newLeaf;
+    double *d = extension->distances, *dx = d + x * n;
+    int64_t *left = st_malloc(2 * x * sizeof(int64_t)), *right = left + x;
+    splitDistances sd;
+    sd.leftRight = st_malloc(((x / 2 + 1) * (x / 2 + 1) + 4 * x) * sizeof(double));
+    sd.leftX = sd.leftRight + (x / 2 + 1) * (x / 2 + 1);
+    sd.rightX = sd.leftX + x;
+    sd.xRight = sd.rightX + x;
+    sd.rightRow = sd.xRight + x;
+    for (int64_t s = start; s < end; s++) {
+        bitSplit *split = extension->splits[s];
+        sd.leftLength = split->leftSize;
+        sd.rightLength = x - split->leftSize;
+        bitSplit_getSides(split, x, left, right);
+        for (int64_t i = 0; i < sd.leftLength; i++) {
+            double *di = d + left[i] * n;
+            for (int64_t k = 0; k < sd.rightLength; k++) {
+                sd.leftRight[i * sd.rightLength + k] = di[right[k]];
+            }
+            sd.leftX[i] = di[x];
+        }
+        for (int64_t k = 0; k < sd.rightLength; k++) {
+            sd.rightX[k] = d[right[k] * n + x];
+            sd.xRight[k] = dx[right[k]];
+        }
+        extension->minQuartetLeft[s] = extension->minQuartetRight[s] = split->minQuartet;
+        extension->addToLeft[s] = checkNewLeafOnLeft(extension, &sd, right, &extension->minQuartetLeft[s]);
+        extension->addToRight[s] = checkNewLeafOnRight(extension, &sd, left, &extension->minQuartetRight[s]);
+    }
+    free(sd.leftRight);
+    free(left);
+}
+
+// Gets the d-splits, as bitSplits, sorted by decreasing isolation index.
+static stList *getBitSplits(stMatrix *distanceMatrix, bool relaxed, int64_t numThreads) {
     assert(stMatrix_m(distanceMatrix) == stMatrix_n(distanceMatrix));
-    stList *splits = stList_construct3(0, (void (*)(void *)) stSplit_destruct);
-    for (int64_t i = 1; i < stMatrix_m(distanceMatrix); i++) {
-        stList *singletonSplitLeft = stList_construct3(0, free);
-        stList_append(singletonSplitLeft, stIntTuple_construct1(i));
-        stList *singletonSplitRight = stList_construct3(0, free);
-        for (int64_t j = 0; j < i; j++) {
-            stList_append(singletonSplitRight, stIntTuple_construct1(j));
-        }
-        stList *newSplits = stList_construct3(0, (void (*)(void *)) stSplit_destruct);
-        stList_append(newSplits, stSplit_construct(singletonSplitLeft, singletonSplitRight, 0.0));
+    int64_t n = stMatrix_n(distanceMatrix), numWords = (n + 63) / 64;
+    splitExtension extension;
+    extension.n = n;
+    extension.relaxed = relaxed;
+    extension.distances = st_malloc(n * n * sizeof(double));
+    for (int64_t i = 0; i < n; i++) {
+        for (int64_t j = 0; j < n; j++) {
+            extension.distances[i * n + j] = *stMatrix_getCell(distanceMatrix, i, j);
+        }
+    }
+    stThreadPool *threadPool = numThreads > 1 ? stThreadPool_construct(numThreads - 1, NULL, NULL) : NULL;
+    stList *splits = stList_construct3(0, (void (*)(void *)) bitSplit_destruct);
+    for (int64_t i = 1; i < n; i++) {
+        // Check each split with i on either side.
+        int64_t numSplits = stList_length(splits);
+        extension.newLeaf = i;
+        int64_t size = numSplits > 0 ? numSplits : 1;
+        extension.splits = st_malloc(size * sizeof(bitSplit *));
+        for (int64_t s = 0; s < numSplits; s++) {
+            extension.splits[s] = stList_get(splits, s);
+        }
+        extension.addToLeft = st_malloc(2 * size * sizeof(bool));
+        extension.addToRight = extension.addToLeft + size;
+        extension.minQuartetLeft = st_malloc(2 * size * sizeof(double));
+        extension.minQuartetRight = extension.minQuartetLeft + size;
+        if (threadPool != NULL) {
+            stThreadPool_parallelFor(threadPool, numSplits, 1, extendSplits, &extension);
+        } else {
+            extendSplits(0, numSplits, &extension);
+        }
+
+        // The new splits are the singleton split, then the extensions
+        // of the old splits from the last to the first, with the one
+        // with i on the right first where there are both.
+        stList *newSplits = stList_construct3(0, (void (*)(void *)) bitSplit_destruct);
+        bitSplit *singletonSplit = bitSplit_construct(numWords, 0, DBL_MAX);
+        bitSplit_addLeft(singletonSplit, i);
+        stList_append(newSplits, singletonSplit);
         while (stList_length(splits) > 0) {
-            stSplit *split = stList_pop(splits);
-            stIntTuple *iTuple = stIntTuple_construct1(i);
-            stList_append(split->leftSplit, iTuple);
-            bool addToLeft = satisfiesFourPoint(distanceMatrix, split->leftSplit, split->rightSplit, relaxed);
-            stList_pop(split->leftSplit);
-            stList_append(split->rightSplit, iTuple);
-            bool addToRight = satisfiesFourPoint(distanceMatrix, split->leftSplit, split->rightSplit, relaxed);
-            stList_pop(split->rightSplit);
-            if (addToRight && addToLeft) {
-                // We are making two new splits, so have to clone the
-                // lists and their elements. For no particular reason,
-                // the cloned one becomes the one with i added to the
-                // right.
-
-                // First we handle the split with i added to its right
-                // split, cloning the existing list, and add that to
-                // the new split list.
-                stList *addedToRight_rightSplit = stList_construct3(0, free);
-                for (int64_t j = 0; j < stList_length(split->rightSplit); j++) {
-                    stIntTuple *new = stIntTuple_construct1(stIntTuple_get(stList_get(split->rightSplit, j), 0));
-                    stList_append(addedToRight_rightSplit, new);
-                }
-                stList_append(addedToRight_rightSplit, stIntTuple_construct1(i));
-                stList *addedToRight_leftSplit = stList_construct3(0, free);
-                for (int64_t j = 0; j < stList_length(split->leftSplit); j++) {
-                    stIntTuple *new = stIntTuple_construct1(stIntTuple_get(stList_get(split->leftSplit, j), 0));
-                    stList_append(addedToRight_leftSplit, new);
-                }
-                stSplit *addedToRight = stSplit_construct(addedToRight_leftSplit, addedToRight_rightSplit, 0.0);
+            int64_t s = stList_length(splits) - 1;
+            bitSplit *split = stList_pop(splits);
+            if (extension.addToRight[s] && extension.addToLeft[s]) {
+                bitSplit *addedToRight = bitSplit_clone(split, numWords);
+                addedToRight->minQuartet = extension.minQuartetRight[s];
                 stList_append(newSplits, addedToRight);
-
-                // Now add i to the left split of the existing split
-                // and add that to the new split list.
-                stList_append(split->leftSplit, iTuple);
+                bitSplit_addLeft(split, i);
+                split->minQuartet = extension.minQuartetLeft[s];
                 stList_append(newSplits, split);
-            } else if (addToRight) {
-                stList_append(split->rightSplit, iTuple);
+            } else if (extension.addToRight[s]) {
+                split->minQuartet = extension.minQuartetRight[s];
                 stList_append(newSplits, split);
-            } else if (addToLeft) {
-                stList_append(split->leftSplit, iTuple);
+            } else if (extension.addToLeft[s]) {
+                bitSplit_addLeft(split, i);
+                split->minQuartet = extension.minQuartetLeft[s];
                 stList_append(newSplits, split);
             } else {
-                stSplit_destruct(split);
+                bitSplit_destruct(split);
             }
         }
         stList_destruct(splits);
         splits = newSplits;
+        free(extension.splits);
+        free(extension.addToLeft);
+        free(extension.minQuartetLeft);
+    }
+    if (threadPool != NULL) {
+        stThreadPool_destruct(threadPool);
     }
+    free(extension.distances);
 
     // Remove the remaining trivial splits and assign isolation indexes.
-    for (int64_t i = 0; i < stList_length(splits); i++) {
-        stSplit *split = stList_get(splits, i);
-        assignIsolationIndex(distanceMatrix, split);
-        if (stList_length(split->leftSplit) == 1 || stList_length(split->rightSplit) == 1) {
-            // inefficient
-            stList_remove(splits, i);
-            stSplit_destruct(split);
-            // adjusting index to account for removed item
-            i--;
+    stList *nonTrivialSplits = stList_construct3(0, (void (*)(void *)) bitSplit_destruct);
+    while (stList_length(splits) > 0) {
+        bitSplit *split = stList_remove(splits, 0);
+        if (split->leftSize == 1 || n - split->leftSize == 1) {
+            bitSplit_destruct(split);
+        } else {
+            split->isolationIndex = split->minQuartet / 2;
+            stList_append(nonTrivialSplits, split);
         }
     }
+    stList_destruct(splits);
 
     // Sort by isolation index in descending order.
-    stList_sort(splits, (int (*)(const void *, const void *)) stSplit_cmp);
-    stList_reverse(splits);
+    stList_sort(nonTrivialSplits, (int (*)(const void *, const void *)) bitSplit_cmp);
+    stList_reverse(nonTrivialSplits);
+    return nonTrivialSplits;
+}
+
+static void stSplit_destruct(stSplit *split) {
+    stList_destruct(split->leftSplit);
+    stList_destruct(split->rightSplit);
+    free(split);
+}
+
+stList *stPhylogeny_getSplits2(stMatrix *distanceMatrix, bool relaxed, int64_t numThreads) {
+    int64_t n = stMatrix_n(distanceMatrix);
+    stList *bitSplits = getBitSplits(distanceMatrix, relaxed, numThreads);
+    stList *splits = stList_construct3(0, (void (*)(void *)) stSplit_destruct);
+    for (int64_t i = 0; i < stList_length(bitSplits); i++) {
+        bitSplit *bits = stList_get(bitSplits, i);
+        stSplit *split = st_malloc(sizeof(stSplit));
+        split->leftSplit = stList_construct3(0, (void (*)(void *)) stIntTuple_destruct);
+        split->rightSplit = stList_construct3(0, (void (*)(void *)) stIntTuple_destruct);
+        for (int64_t j = 0; j < n; j++) {
+            stList_append(bitSplit_isLeft(bits, j) ? split->leftSplit : split->rightSplit,
+                          stIntTuple_constructInline1(j));
+        }
+        split->isolationIndex = bits->isolationIndex;
+        stList_append(splits, split);
+    }
+    stList_destruct(bitSplits);
     return splits;
 }
 
-static bool isCompatibleSplit(stList *splitIndices, stHash *indexToLeaf) {
-    stTree *parent = stTree_getParent(stHash_search(indexToLeaf, stList_get(splitIndices, 0)));
+stList *stPhylogeny_getSplits(stMatrix *distanceMatrix, bool relaxed) {
+    return stPhylogeny_getSplits2(distanceMatrix, relaxed, 1);
+}
+
+static bool isCompatibleSplit(int64_t *splitIndices, int64_t length, stTree **indexToLeaf) {
+    stTree *parent = stTree_getParent(indexToLeaf[splitIndices[0]]);
     assert(parent != NULL);
-    for (int64_t i = 1; i < stList_length(splitIndices); i++) {
-        stTree *leaf = stHash_search(indexToLeaf, stList_get(splitIndices, i));
-        if (stTree_getParent(leaf) != parent) {
+    for (int64_t i = 1; i < length; i++) {
+        if (stTree_getParent(indexToLeaf[splitIndices[i]]) != parent) {
             return false;
         }
     }
     return true;
 }
 
-static void applyCompatibleSplit(stList *splitIndices, stHash *indexToLeaf) {
-    stTree *parent = stTree_getParent(stHash_search(indexToLeaf, stList_get(splitIndices, 0)));
+static void applyCompatibleSplit(int64_t *splitIndices, int64_t length, stTree **indexToLeaf) {
+    stTree *parent = stTree_getParent(indexToLeaf[splitIndices[0]]);
     stTree *newNode = stTree_construct();
     stTree_setParent(newNode, parent);
     // Branch lengths are arbitrarily set to 1.0.
     stTree_setBranchLength(newNode, 1.0);
-    for (int64_t i = 0; i < stList_length(splitIndices); i++) {
-        stTree *leaf = stHash_search(indexToLeaf, stList_get(splitIndices, i));
-        stTree_setParent(leaf, newNode);
+    for (int64_t i = 0; i < length; i++) {
+        stTree_setParent(indexToLeaf[splitIndices[i]], newNode);
     }
 }
 
-stTree *stPhylogeny_greedySplitDecomposition(stMatrix *distanceMatrix, bool relaxed) {
+stTree *stPhylogeny_greedySplitDecomposition2(stMatrix *distanceMatrix, bool relaxed, int64_t numThreads) {
     assert(stMatrix_m(distanceMatrix) == stMatrix_n(distanceMatrix));
-    stHash *indexToLeaf = stHash_construct3((uint64_t (*)(const void *)) stIntTuple_hashKey, (int (*)(const void *, const void *)) stIntTuple_equalsFn, (void (*)(void *)) stIntTuple_destruct, NULL);
+    int64_t n = stMatrix_m(distanceMatrix);
+    stTree **indexToLeaf = st_malloc(n * sizeof(stTree *));
     // We start out with a complete star phylogeny.
     stTree *root = stTree_construct();
-    for (int64_t i = 0; i < stMatrix_m(distanceMatrix); i++) {
+    for (int64_t i = 0; i < n; i++) {
         stTree *leaf = stTree_construct();
-        stHash_insert(indexToLeaf, stIntTuple_construct1(i), leaf);
+        indexToLeaf[i] = leaf;
         char *label = stString_print_r("%" PRIi64, i);
         stTree_setLabel(leaf, label);
         free(label);
@@ -2055,24 +2868,31 @@ stTree *stPhylogeny_greedySplitDecomposition(stMatrix *distanceMatrix, bool rela
         stTree_setBranchLength(leaf, 1.0);
     }
 
-    stList *splits = stPhylogeny_getSplits(distanceMatrix, relaxed);
+    stList *splits = getBitSplits(distanceMatrix, relaxed, numThreads);
     // Start adding compatible splits to the tree, creating a new
     // internal node for each split which groups together one of its
     // sides.
+    int64_t *left = st_malloc(2 * n * sizeof(int64_t)), *right = left + n;
     for (int64_t i = 0; i < stList_length(splits); i++) {
-        stSplit *split = stList_get(splits, i);
-        if (isCompatibleSplit(split->leftSplit, indexToLeaf)) {
-            applyCompatibleSplit(split->leftSplit, indexToLeaf);
-        } else if (isCompatibleSplit(split->rightSplit, indexToLeaf)) {
-            applyCompatibleSplit(split->rightSplit, indexToLeaf);
+        bitSplit *split = stList_get(splits, i);
+        bitSplit_getSides(split, n, left, right);
+        if (isCompatibleSplit(left, split->leftSize, indexToLeaf)) {
+            applyCompatibleSplit(left, split->leftSize, indexToLeaf);
+        } else if (isCompatibleSplit(right, n - split->leftSize, indexToLeaf)) {
+            applyCompatibleSplit(right, n - split->leftSize, indexToLeaf);
         }
     }
+    free(left);
     stList_destruct(splits);
-    stHash_destruct(indexToLeaf);
+    free(indexToLeaf);
     stPhylogeny_addStIndexedTreeInfo(root);
     return root;
 }
 
+stTree *stPhylogeny_greedySplitDecomposition(stMatrix *distanceMatrix, bool relaxed) {
+    return stPhylogeny_greedySplitDecomposition2(distanceMatrix, relaxed, 1);
+}
+
 void stPhylogeny_applyJukesCantorCorrection(stMatrix *distanceMatrix) {
     for (int64_t i = 0; i < stMatrix_m(distanceMatrix); i++) {
         for (int64_t j = 0; j < stMatrix_n(distanceMatrix); j++) {
@@ -0,0 +1,449 @@
+// The calling thread reads the file a block at a time into a buffer,
+// and once the buffer holds one or more whole records cuts it after
+// the last of them, queueing that part as a chunk and carrying the
+// rest over to the next buffer. Pool threads take chunks off the
+// queue in file order and parse them in place: headers, sequences and
+// qualities are terminated where they lie, and fasta sequence lines
+// are moved down over the newlines between them. To bound memory the
+// reader waits while too many chunks are unfinished, and the memory
+// of finished chunks is reused for new ones, which saves the kernel
+// zeroing fresh pages for every chunk. In ordered mode
+// the records of a parsed chunk are passed on by the pool's finishing
+// function, which holds on to chunks parsed out of turn.
+#include "sonLibGlobalsInternal.h"
+#include <pthread.h>
+#include <zlib.h>
+
+const char *ST_SEQ_READER_EXCEPTION = "ST_SEQ_READER_EXCEPTION";
+
+// Files are read in blocks of this many bytes, so most chunks are
+// about this big.
+#define SEQ_READER_BLOCK_SIZE (1 << 22)
+
+// The number of chunks per thread that may be unfinished before the
+// reader waits.
+#define SEQ_READER_CHUNKS_PER_THREAD 4
+
+typedef struct _seqReader {
+    bool fastq;
+    bool ordered;
+    void (*fn)(const stSeqRecord *record, void *arg);
+    void *arg;
+    pthread_mutex_t lock; // Guards the fields below.
+    pthread_cond_t chunkFinished;
+    stList *queue; // Chunks waiting to be parsed, in file order.
+    int64_t unfinishedChunks;
+    stList *freeChunks; // Finished chunks, whose memory can be reused.
+    char *error; // The first error, if any.
+    // Only used by the finishing function, in ordered mode.
+    stList *parsedChunks;
+    int64_t nextChunk;
+} seqReader;
+
+typedef struct _seqChunk {
+    seqReader *reader;
+    int64_t index;
+    char *data; // Has a spare byte after the end, for a terminating zero.
+    int64_t length;
+    int64_t maxLength;
+    stSeqRecord *records;
+    int64_t recordNumber;
+    int64_t maxRecordNumber;
+    char *error;
+} seqChunk;
+
+static void seqChunk_destruct(seqChunk *chunk) {
+    free(chunk->data);
+    free(chunk->records);
+    free(chunk->error);
+    free(chunk);
+}
+
+// Returns a chunk with room for at least maxLength bytes.
+static seqChunk *seqReader_getFreeChunk(seqReader *reader, int64_t maxLength) {
+    pthread_mutex_lock(&reader->lock);
+    seqChunk *chunk = stList_length(reader->freeChunks) > 0 ? stList_pop(reader->freeChunks) : NULL;
+    pthread_mutex_unlock(&reader->lock);
+    if (chunk == NULL) {
+        chunk = st_calloc(1, sizeof(seqChunk));
+        chunk->reader = reader;
+    }
+    if (chunk->maxLength < maxLength) {
+        chunk->maxLength = maxLength;
+        free(chunk->data);
+        chunk->data = st_malloc(maxLength + 1);
+    }
+    chunk->length = 0;
+    return chunk;
+}
+
+// Keeps the chunk for reuse, letting the reader know there is room for
+// another.
+static void seqReader_finishChunk(seqReader *reader, seqChunk *chunk) {
+    chunk->recordNumber = 0;
+    free(chunk->error);
+    chunk->error = NULL;
+    pthread_mutex_lock(&reader->lock);
+    stList_append(reader->freeChunks, chunk);
+    reader->unfinishedChunks--;
+    pthread_cond_signal(&reader->chunkFinished);
+    pthread_mutex_unlock(&reader->lock);
+}
+
+// Keep the first error only, as later ones may just be knock on
+// effects of it.
+static void seqReader_setError(seqReader *reader, const char *error) {
+    pthread_mutex_lock(&reader->lock);
+    if (reader->error == NULL) {
+        reader->error = stString_copy(error);
+    }
+    pthread_mutex_unlock(&reader->lock);
+}
+
+static bool seqReader_hasError(seqReader *reader) {
+    pthread_mutex_lock(&reader->lock);
+    bool hasError = reader->error != NULL;
+    pthread_mutex_unlock(&reader->lock);
+    return hasError;
+}
+
+static void seqChunk_addRecord(seqChunk *chunk, const char *header, const char *sequence,
+                               const char *qualities, int64_t length) {
+    if (chunk->recordNumber == chunk->maxRecordNumber) {
+        chunk->maxRecordNumber = chunk->maxRecordNumber * 2 + 16;
+        chunk->records = st_realloc(chunk->records, chunk->maxRecordNumber * sizeof(stSeqRecord));
+    }
+    stSeqRecord *record = &chunk->records[chunk->recordNumber++];
+    record->header = header;
+    record->sequence = sequence;
+    record->qualities = qualities;
+    record->length = length;
+}
+
+// Returns true iff the characters are all roman alphabet characters
+// or gaps. Written without branches so that the compiler vectorises
+// the loop.
+static bool isValidSequence(const char *sequence, int64_t length) {
+    unsigned char invalid = 0;
+    for (int64_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char) sequence[i];
+        invalid |= (unsigned char) ((unsigned char) ((c | 0x20) - 'a') >= 26) & (c != '-');
+    }
+    return invalid == 0;
+}
+
+static bool isValidQualities(const char *qualities, int64_t length) {
+    unsigned char invalid = 0;
+    for (int64_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char) qualities[i];
+        invalid |= (unsigned char) (c < '!') | (unsigned char) (c > '~');
+    }
+    return invalid == 0;
+}
+
+// Returns the end of the line starting at c, excluding any carriage
+// return, and sets *next to the start of the following line.
+static char *getLineEnd(char *c, char *end, char **next) {
+    char *newLine = memchr(c, '\n', end - c);
+    char *lineEnd = newLine != NULL ? newLine : end;
+    *next = newLine != NULL ? newLine + 1 : end;
+    if (lineEnd > c && lineEnd[-1] == '\r') {
+        lineEnd--;
+    }
+    return lineEnd;
+}
+
+static void parseFastaChunk(seqChunk *chunk) {
+    char *c = chunk->data, *end = chunk->data + chunk->length;
+    while (c < end && *c != '>') { // Skip anything before the first header.
+        getLineEnd(c, end, &c);
+    }
+    while (c < end) {
+        char *header = c + 1;
+        *getLineEnd(header, end, &c) = '\0';
+        char *sequence = c, *sequenceEnd = c;
+        while (c < end && *c != '>') {
+            char *lineStart = c;
+            char *lineEnd = getLineEnd(lineStart, end, &c);
+            if (isValidSequence(lineStart, lineEnd - lineStart)) {
+                memmove(sequenceEnd, lineStart, lineEnd - lineStart);
+                sequenceEnd += lineEnd - lineStart;
+            } else { // The line contains white space, or isn't valid.
+                for (char *d = lineStart; d < lineEnd; d++) {
+                    if (*d == ' ' || *d == '\t') {
+                        continue;
+                    }
+                    if (!isValidSequence(d, 1)) {
+                        char *error = stString_print("Got an unexpected character in fasta sequence %s: '%c'",
+                                                     header, *d);
+                        chunk->error = error;
+                        return;
+                    }
+                    *sequenceEnd++ = *d;
+                }
+            }
+        }
+        // An empty sequence may end right where the next header starts.
+        if (sequenceEnd == sequence) {
+            seqChunk_addRecord(chunk, header, "", NULL, 0);
+        } else {
+            *sequenceEnd = '\0';
+            seqChunk_addRecord(chunk, header, sequence, NULL, sequenceEnd - sequence);
+        }
+    }
+}
+
+static void parseFastqChunk(seqChunk *chunk) {
+    char *c = chunk->data, *end = chunk->data + chunk->length;
+    while (c < end) {
+        char *header = c;
+        char *headerEnd = getLineEnd(header, end, &c);
+        if (headerEnd == header) { // Blank line between records.
+            continue;
+        }
+        if (*header != '@') {
+            chunk->error = stString_print("Expected a fastq header but got the line: %.*s",
+                                          (int) (headerEnd - header), header);
+            return;
+        }
+        char *sequence = c, *sequenceEnd = getLineEnd(sequence, end, &c);
+        char *plus = c;
+        getLineEnd(plus, end, &c);
+        char *qualities = c, *qualitiesEnd = getLineEnd(qualities, end, &c);
+        *headerEnd = '\0';
+        if (plus == end || *plus != '+') {
+            chunk->error = stString_print("Got an incomplete fastq record: %s", header + 1);
+            return;
+        }
+        if (!isValidSequence(sequence, sequenceEnd - sequence)) {
+            chunk->error = stString_print("Got an unexpected character in fastq sequence %s", header + 1);
+            return;
+        }
+        if (qualitiesEnd - qualities != sequenceEnd - sequence) {
+            chunk->error = stString_print("Got a mismatch between the number of sequence characters (%" PRIi64
+                                          ") and number of qual values (%" PRIi64 ") for sequence: %s",
+                                          (int64_t) (sequenceEnd - sequence), (int64_t) (qualitiesEnd - qualities),
+                                          header + 1);
+            return;
+        }
+        if (!isValidQualities(qualities, qualitiesEnd - qualities)) {
+            chunk->error = stString_print("Got a qual value out of range (range is 33 to 126) for sequence: %s",
+                                          header + 1);
+            return;
+        }
+        *sequenceEnd = '\0';
+        *qualitiesEnd = '\0';
+        seqChunk_addRecord(chunk, header + 1, sequence, qualities, sequenceEnd - sequence);
+    }
+}
+
+// Passes on the records parsed before any error, and returns false
+// if there was an error.
+static bool seqReader_passOnRecords(seqReader *reader, seqChunk *chunk) {
+    for (int64_t i = 0; i < chunk->recordNumber; i++) {
+        reader->fn(&chunk->records[i], reader->arg);
+    }
+    if (chunk->error != NULL) {
+        seqReader_setError(reader, chunk->error);
+        return 0;
+    }
+    return 1;
+}
+
+// Parse the oldest queued chunk. The work unit is the reader itself,
+// so that chunks are parsed in file order although the pool's work
+// "queue" is a stack.
+static void *parseChunk(void *workUnit) {
+    seqReader *reader = workUnit;
+    pthread_mutex_lock(&reader->lock);
+    seqChunk *chunk = stList_remove(reader->queue, 0);
+    pthread_mutex_unlock(&reader->lock);
+    if (!seqReader_hasError(reader)) {
+        if (reader->fastq) {
+            parseFastqChunk(chunk);
+        } else {
+            parseFastaChunk(chunk);
+        }
+    }
+    if (reader->ordered) {
+        return chunk;
+    }
+    if (!seqReader_hasError(reader)) {
+        seqReader_passOnRecords(reader, chunk);
+    }
+    seqReader_finishChunk(reader, chunk);
+    return NULL;
+}
+
+// Pass on the records of each chunk whose turn has come. Runs
+// serially.
+static void passOnChunksInOrder(void *result) {
+    seqChunk *parsedChunk = result;
+    seqReader *reader = parsedChunk->reader;
+    stList_append(reader->parsedChunks, parsedChunk);
+    bool found = 1;
+    while (found) {
+        found = 0;
+        for (int64_t i = 0; i < stList_length(reader->parsedChunks); i++) {
+            seqChunk *chunk = stList_get(reader->parsedChunks, i);
+            if (chunk->index == reader->nextChunk) {
+                stList_remove(reader->parsedChunks, i);
+                if (!seqReader_hasError(reader)) {
+                    seqReader_passOnRecords(reader, chunk);
+                }
+                seqReader_finishChunk(reader, chunk);
+                reader->nextChunk++;
+                found = 1;
+                break;
+            }
+        }
+    }
+}
+
+// Returns the start of the last fasta record in the buffer, or 0 if
+// the buffer holds no whole record. The first searchedLength bytes
+// are known to hold no record start but the first.
+static int64_t findFastaBoundary(const char *buffer, int64_t searchedLength, int64_t length) {
+    int64_t boundary = 0;
+    const char *c = buffer + (searchedLength > 1 ? searchedLength : 1), *end = buffer + length;
+    while ((c = memchr(c, '>', end - c)) != NULL) {
+        if (c[-1] == '\n') {
+            boundary = c - buffer;
+        }
+        c++;
+    }
+    return boundary;
+}
+
+// Returns the end of the last whole fastq record in the buffer, or 0
+// if there is none.
+static int64_t findFastqBoundary(const char *buffer, int64_t length) {
+    const char *c = buffer, *end = buffer + length;
+    int64_t boundary = 0;
+    while (c < end) {
+        const char *newLine = memchr(c, '\n', end - c);
+        if (newLine == NULL) {
+            break;
+        }
+        if (newLine == c || (newLine == c + 1 && *c == '\r')) { // Blank line between records.
+            c = newLine + 1;
+            boundary = c - buffer;
+            continue;
+        }
+        int64_t lineNumber = 1;
+        c = newLine + 1;
+        while (lineNumber < 4 && (newLine = memchr(c, '\n', end - c)) != NULL) {
+            lineNumber++;
+            c = newLine + 1;
+        }
+        if (lineNumber < 4) {
+            break;
+        }
+        boundary = c - buffer;
+    }
+    return boundary;
+}
+
+void stSeqReader_read(const char *fileName, int64_t numThreads, bool ordered,
+                      void (*fn)(const stSeqRecord *record, void *arg), void *arg) {
+    gzFile file = gzopen(fileName, "rb");
+    if (file == NULL) {
+        stThrowNew(ST_SEQ_READER_EXCEPTION, "Could not open sequence file %s", fileName);
+    }
+    gzbuffer(file, 1 << 20);
+
+    seqReader reader;
+    reader.fastq = 0;
+    reader.ordered = ordered;
+    reader.fn = fn;
+    reader.arg = arg;
+    pthread_mutex_init(&reader.lock, NULL);
+    pthread_cond_init(&reader.chunkFinished, NULL);
+    reader.queue = stList_construct();
+    reader.unfinishedChunks = 0;
+    reader.freeChunks = stList_construct3(0, (void (*)(void *)) seqChunk_destruct);
+    reader.error = NULL;
+    reader.parsedChunks = stList_construct();
+    reader.nextChunk = 0;
+    stThreadPool *threadPool = stThreadPool_construct(numThreads, parseChunk,
+                                                      ordered ? passOnChunksInOrder : NULL);
+
+    seqChunk *chunk = seqReader_getFreeChunk(&reader, SEQ_READER_BLOCK_SIZE);
+    int64_t searchedLength = 0, chunkNumber = 0;
+    bool formatKnown = 0, endOfFile = 0;
+    while (!endOfFile) {
+        if (chunk->length + SEQ_READER_BLOCK_SIZE > chunk->maxLength) {
+            chunk->maxLength = 2 * (chunk->length + SEQ_READER_BLOCK_SIZE);
+            chunk->data = st_realloc(chunk->data, chunk->maxLength + 1);
+        }
+        int bytesRead = gzread(file, chunk->data + chunk->length, SEQ_READER_BLOCK_SIZE);
+        if (bytesRead < 0) {
+            int errorNumber;
+            char *error = stString_print("Could not read sequence file %s: %s", fileName,
+                                         gzerror(file, &errorNumber));
+            seqReader_setError(&reader, error);
+            free(error);
+            break;
+        }
+        endOfFile = bytesRead == 0;
+        chunk->length += bytesRead;
+        if (!formatKnown) {
+            int64_t i = 0;
+            while (i < chunk->length && isspace((unsigned char) chunk->data[i])) {
+                i++;
+            }
+            if (i == chunk->length) {
+                continue;
+            }
+            reader.fastq = chunk->data[i] == '@';
+            formatKnown = 1;
+        }
+        int64_t length = chunk->length;
+        int64_t boundary = endOfFile ? length : reader.fastq ? findFastqBoundary(chunk->data, length)
+                                                              : findFastaBoundary(chunk->data, searchedLength, length);
+        searchedLength = length;
+        if (boundary == 0) {
+            continue;
+        }
+        // Carry the start of the next record over to the next chunk.
+        seqChunk *nextChunk = seqReader_getFreeChunk(&reader, length - boundary + SEQ_READER_BLOCK_SIZE);
+        memcpy(nextChunk->data, chunk->data + boundary, length - boundary);
+        nextChunk->length = length - boundary;
+        searchedLength = nextChunk->length;
+        chunk->length = boundary;
+        chunk->index = chunkNumber++;
+        pthread_mutex_lock(&reader.lock);
+        while (reader.unfinishedChunks >= SEQ_READER_CHUNKS_PER_THREAD * numThreads && reader.error == NULL) {
+            pthread_cond_wait(&reader.chunkFinished, &reader.lock);
+        }
+        bool hasError = reader.error != NULL;
+        if (!hasError) {
+            stList_append(reader.queue, chunk);
+            reader.unfinishedChunks++;
+        } else {
+            stList_append(reader.freeChunks, chunk);
+        }
+        pthread_mutex_unlock(&reader.lock);
+        chunk = nextChunk;
+        if (hasError) {
+            break;
+        }
+        stThreadPool_push(threadPool, &reader);
+    }
+    stThreadPool_wait(threadPool);
+    stThreadPool_destruct(threadPool);
+    gzclose(file);
+    seqChunk_destruct(chunk);
+    assert(stList_length(reader.queue) == 0);
+    assert(stList_length(reader.parsedChunks) == 0);
+    stList_destruct(reader.queue);
+    stList_destruct(reader.parsedChunks);
+    stList_destruct(reader.freeChunks);
+    pthread_mutex_destroy(&reader.lock);
+    pthread_cond_destroy(&reader.chunkFinished);
+    if (reader.error != NULL) {
+        stExcept *except = stExcept_new(ST_SEQ_READER_EXCEPTION, "%s: %s", fileName, reader.error);
+        free(reader.error);
+        stThrow(except);
+    }
+}
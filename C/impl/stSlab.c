@@ -0,0 +1,411 @@
+// Slabs are SLAB_SIZE bytes, aligned to their size, so the slab of an
+// object is found by masking its address. A slab starts with a header,
+// followed by its objects. Each slab is taken from the system on its
+// own, and given back when none of its objects are allocated, unless
+// it is the slab its owner is allocating from.
+//
+// Each slab is owned by a thread, which allocates from it and keeps a
+// free list of its objects, linked through their first word, so the
+// objects allocated together mostly come from the same slab, however
+// much memory has been freed in between. An object freed by another
+// thread is pushed, without locking, onto the slab's list of remote
+// frees, which its owner takes back when it runs out of free objects.
+// A thread keeps the slabs of each class in two lists, those that may
+// have free objects and those that are full. When a thread exits all
+// its slabs are abandoned, to be taken by other threads; until then
+// objects freed in an abandoned slab are returned to it under a lock.
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include "sonLibGlobalsInternal.h"
+
+#define ALIGNMENT 16
+#define ARENA_BLOCK_SIZE (1 << 16)
+
+#if defined(ST_SLAB_DISABLE) || defined(__SANITIZE_ADDRESS__)
+
+void *st_slabMalloc(size_t size) {
+    assert(size <= ST_SLAB_MAX_SIZE);
+    return st_malloc(size > 0 ? size : 1);
+}
+
+void st_slabFree(void *object) {
+    free(object);
+}
+
+int64_t st_slabGetMemoryUsage(void) {
+    return 0;
+}
+
+#else
+
+#define SLAB_SIZE ((uintptr_t) 1 << 16)
+#define SLAB_HEADER_SIZE ((sizeof(slab) + ALIGNMENT - 1) & ~((size_t) ALIGNMENT - 1))
+#define NUM_CLASSES (ST_SLAB_MAX_SIZE / ALIGNMENT)
+
+typedef struct _threadHeap threadHeap;
+
+typedef struct _slab {
+    threadHeap *owner; // Read by other threads, so accessed atomically.
+    void *remoteFreeObjects; // Pushed onto by other threads, so accessed atomically.
+    // In one of the owner's lists, or the list of abandoned slabs.
+    struct _slab *previous;
+    struct _slab *next;
+    void *freeObjects;
+    char *unused; // The objects from here to the end have never been allocated.
+    int64_t sizeClass;
+    int64_t allocated; // Objects allocated and not yet returned to the slab.
+    bool full; // Whether in the owner's list of full slabs.
+} slab;
+
+struct _threadHeap {
+    // For each class, the slabs owned by the thread that may have free
+    // objects. Allocation is from the first.
+    slab *slabs[NUM_CLASSES];
+    // For each class, the slabs owned by the thread that had no free
+    // objects when last looked at.
+    slab *fullSlabs[NUM_CLASSES];
+};
+
+static pthread_mutex_t abandonedMutex = PTHREAD_MUTEX_INITIALIZER;
+static slab *abandonedSlabs[NUM_CLASSES]; // Slabs of threads that have exited.
+static int64_t memoryUsage; // Accessed atomically.
+
+static pthread_once_t threadExitKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t threadExitKey;
+
+static __thread threadHeap heap;
+static __thread bool threadRegistered;
+
+static inline void *getNext(void *object) {
+    return ((void **) object)[0];
+}
+
+static inline void setNext(void *object, void *next) {
+    ((void **) object)[0] = next;
+}
+
+static inline int64_t getObjectSize(int64_t sizeClass) {
+    return (sizeClass + 1) * ALIGNMENT;
+}
+
+static inline slab *getSlab(void *object) {
+    return (slab *) ((uintptr_t) object & ~(SLAB_SIZE - 1));
+}
+
+static void pushSlab(slab **list, slab *s) {
+    s->previous = NULL;
+    s->next = *list;
+    if (s->next != NULL) {
+        s->next->previous = s;
+    }
+    *list = s;
+}
+
+static void removeSlab(slab **list, slab *s) {
+    if (s->previous != NULL) {
+        s->previous->next = s->next;
+    } else {
+        *list = s->next;
+    }
+    if (s->next != NULL) {
+        s->next->previous = s->previous;
+    }
+}
+
+static slab **getOwnerList(threadHeap *owner, slab *s) {
+    return s->full ? &owner->fullSlabs[s->sizeClass] : &owner->slabs[s->sizeClass];
+}
+
+static void freeSlab(slab *s) {
+    __atomic_sub_fetch(&memoryUsage, SLAB_SIZE, __ATOMIC_RELAXED);
+    free(s);
+}
+
+// Makes the slab the one the thread allocates from, giving the slab it
+// replaces back to the system if that is empty.
+static void pushCurrentSlab(slab *s) {
+    slab *previous = heap.slabs[s->sizeClass];
+    pushSlab(&heap.slabs[s->sizeClass], s);
+    if (previous != NULL && previous->allocated == 0) {
+        removeSlab(&heap.slabs[s->sizeClass], previous);
+        freeSlab(previous);
+    }
+}
+
+// Moves the objects freed by other threads onto the slab's free list,
+// returning true if there were any.
+static bool takeRemoteFrees(slab *s) {
+    void *objects = __atomic_exchange_n(&s->remoteFreeObjects, NULL, __ATOMIC_ACQUIRE);
+    if (objects == NULL) {
+        return 0;
+    }
+    void *last = objects;
+    s->allocated--;
+    while (getNext(last) != NULL) {
+        last = getNext(last);
+        s->allocated--;
+    }
+    setNext(last, s->freeObjects);
+    s->freeObjects = objects;
+    return 1;
+}
+
+static inline bool hasFreeObject(slab *s) {
+    return s->freeObjects != NULL
+            || s->unused + getObjectSize(s->sizeClass) <= (char *) s + SLAB_SIZE;
+}
+
+// Gives the thread's slabs to other threads, and the empty ones back
+// to the system.
+static void releaseThreadHeap(void *threadHeapToRelease) {
+    threadHeap *exitingHeap = threadHeapToRelease;
+    pthread_mutex_lock(&abandonedMutex);
+    for (int64_t i = 0; i < NUM_CLASSES; i++) {
+        slab **lists[2] = { &exitingHeap->slabs[i], &exitingHeap->fullSlabs[i] };
+        for (int64_t j = 0; j < 2; j++) {
+            while (*lists[j] != NULL) {
+                slab *s = *lists[j];
+                removeSlab(lists[j], s);
+                __atomic_store_n(&s->owner, NULL, __ATOMIC_RELEASE);
+                takeRemoteFrees(s);
+                if (s->allocated == 0) {
+                    freeSlab(s);
+                } else {
+                    s->full = 0;
+                    pushSlab(&abandonedSlabs[i], s);
+                }
+            }
+        }
+    }
+    pthread_mutex_unlock(&abandonedMutex);
+    // Registered again if the thread allocates in a later destructor.
+    threadRegistered = 0;
+}
+
+static void createThreadExitKey(void) {
+    if (pthread_key_create(&threadExitKey, releaseThreadHeap) != 0) {
+        st_errAbort("stSlab: pthread_key_create failed");
+    }
+}
+
+// Arranges for the thread's heap to be released when it exits.
+static void registerThread(void) {
+    pthread_once(&threadExitKeyOnce, createThreadExitKey);
+    pthread_setspecific(threadExitKey, &heap);
+    threadRegistered = 1;
+}
+
+// Returns an abandoned slab, taking it over, or, if there are none, a
+// new one.
+static slab *getFreeSlab(int64_t sizeClass) {
+    pthread_mutex_lock(&abandonedMutex);
+    slab *s = abandonedSlabs[sizeClass];
+    if (s != NULL) {
+        removeSlab(&abandonedSlabs[sizeClass], s);
+        __atomic_store_n(&s->owner, &heap, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&abandonedMutex);
+        return s;
+    }
+    pthread_mutex_unlock(&abandonedMutex);
+    void *newSlab;
+    if (posix_memalign(&newSlab, SLAB_SIZE, SLAB_SIZE) != 0) {
+        st_errAbort("stSlab: failed to allocate a slab of %" PRIi64 " bytes", (int64_t) SLAB_SIZE);
+    }
+    __atomic_add_fetch(&memoryUsage, SLAB_SIZE, __ATOMIC_RELAXED);
+    s = newSlab;
+    s->owner = &heap;
+    s->remoteFreeObjects = NULL;
+    s->freeObjects = NULL;
+    s->unused = (char *) s + SLAB_HEADER_SIZE;
+    s->sizeClass = sizeClass;
+    s->allocated = 0;
+    return s;
+}
+
+// Allocates an object when the first of the thread's slabs of the
+// class has no free objects. The object comes from, in order of
+// preference, that slab, including the objects freed in it by other
+// threads, another of the thread's slabs, a full slab of the thread's
+// in which other threads have since freed objects, or a slab new to
+// the thread.
+static void *slabMallocSlow(int64_t sizeClass) {
+    if (!threadRegistered) {
+        registerThread();
+    }
+    int64_t objectSize = getObjectSize(sizeClass);
+    while (1) {
+        slab *s = heap.slabs[sizeClass];
+        if (s != NULL) {
+            if (s->freeObjects == NULL) {
+                takeRemoteFrees(s);
+            }
+            void *object = s->freeObjects;
+            if (object != NULL) {
+                s->freeObjects = getNext(object);
+                s->allocated++;
+                return object;
+            }
+            if (s->unused + objectSize <= (char *) s + SLAB_SIZE) {
+                object = s->unused;
+                s->unused += objectSize;
+                s->allocated++;
+                return object;
+            }
+            // The slab is full, it is listed again when an object in it is freed.
+            removeSlab(&heap.slabs[sizeClass], s);
+            s->full = 1;
+            pushSlab(&heap.fullSlabs[sizeClass], s);
+            continue;
+        }
+        for (s = heap.fullSlabs[sizeClass]; s != NULL;) {
+            slab *next = s->next;
+            if (takeRemoteFrees(s)) {
+                removeSlab(&heap.fullSlabs[sizeClass], s);
+                s->full = 0;
+                pushCurrentSlab(s);
+            }
+            s = next;
+        }
+        if (heap.slabs[sizeClass] == NULL) {
+            s = getFreeSlab(sizeClass);
+            s->full = !hasFreeObject(s);
+            pushSlab(getOwnerList(&heap, s), s);
+        }
+    }
+}
+
+void *st_slabMalloc(size_t size) {
+    assert(size <= ST_SLAB_MAX_SIZE);
+    int64_t sizeClass = size > 0 ? (size - 1) / ALIGNMENT : 0;
+    slab *s = heap.slabs[sizeClass];
+    if (s != NULL && s->freeObjects != NULL) {
+        void *object = s->freeObjects;
+        s->freeObjects = getNext(object);
+        s->allocated++;
+        return object;
+    }
+    return slabMallocSlow(sizeClass);
+}
+
+// Frees an object of an abandoned slab, giving the slab back to the
+// system if it is then empty. Returns false if the slab has since been
+// taken by a thread.
+static bool freeAbandoned(slab *s, void *object) {
+    pthread_mutex_lock(&abandonedMutex);
+    if (__atomic_load_n(&s->owner, __ATOMIC_ACQUIRE) != NULL) {
+        pthread_mutex_unlock(&abandonedMutex);
+        return 0;
+    }
+    takeRemoteFrees(s);
+    setNext(object, s->freeObjects);
+    s->freeObjects = object;
+    if (--s->allocated == 0) {
+        removeSlab(&abandonedSlabs[s->sizeClass], s);
+        freeSlab(s);
+    }
+    pthread_mutex_unlock(&abandonedMutex);
+    return 1;
+}
+
+void st_slabFree(void *object) {
+    if (object == NULL) {
+        return;
+    }
+    slab *s = getSlab(object);
+    threadHeap *owner = __atomic_load_n(&s->owner, __ATOMIC_ACQUIRE);
+    if (owner == &heap) {
+        setNext(object, s->freeObjects);
+        s->freeObjects = object;
+        s->allocated--;
+        if (s->full) {
+            removeSlab(&heap.fullSlabs[s->sizeClass], s);
+            s->full = 0;
+            pushCurrentSlab(s);
+        } else if (s->allocated == 0 && heap.slabs[s->sizeClass] != s) {
+            // Objects freed by other threads but not yet taken back are still counted.
+            removeSlab(&heap.slabs[s->sizeClass], s);
+            freeSlab(s);
+        }
+        return;
+    }
+    if (owner == NULL && freeAbandoned(s, object)) {
+        return;
+    }
+    void *objects = __atomic_load_n(&s->remoteFreeObjects, __ATOMIC_RELAXED);
+    do {
+        setNext(object, objects);
+    } while (!__atomic_compare_exchange_n(&s->remoteFreeObjects, &objects, object, 1, __ATOMIC_RELEASE,
+            __ATOMIC_RELAXED));
+}
+
+int64_t st_slabGetMemoryUsage(void) {
+    return __atomic_load_n(&memoryUsage, __ATOMIC_RELAXED);
+}
+
+#endif
+
+void *st_slabCalloc(size_t size) {
+    void *object = st_slabMalloc(size);
+    memset(object, 0, size);
+    return object;
+}
+
+typedef struct _arenaBlock {
+    struct _arenaBlock *previous;
+    int64_t size;
+} arenaBlock;
+
+struct _stArena {
+    arenaBlock *blocks;
+    char *next; // The free memory of the newest block.
+    char *end;
+    int64_t memoryUsage;
+};
+
+stArena *stArena_construct(void) {
+    return st_calloc(1, sizeof(stArena));
+}
+
+void stArena_destruct(stArena *arena) {
+    while (arena->blocks != NULL) {
+        arenaBlock *block = arena->blocks;
+        arena->blocks = block->previous;
+        free(block);
+    }
+    free(arena);
+}
+
+void *stArena_malloc(stArena *arena, size_t size) {
+    size = (size + ALIGNMENT - 1) & ~((size_t) ALIGNMENT - 1);
+    if (size > (size_t) (arena->end - arena->next)) {
+        // Big requests get a block of their own, behind the newest, so
+        // the rest of the newest block is not wasted.
+        bool ownBlock = size > ARENA_BLOCK_SIZE / 4 && arena->blocks != NULL;
+        int64_t blockSize = sizeof(arenaBlock) + (size > ARENA_BLOCK_SIZE / 4 ? size : ARENA_BLOCK_SIZE);
+        arenaBlock *block = st_malloc(blockSize);
+        block->size = blockSize;
+        arena->memoryUsage += blockSize;
+        if (ownBlock) {
+            block->previous = arena->blocks->previous;
+            arena->blocks->previous = block;
+            return block + 1;
+        }
+        block->previous = arena->blocks;
+        arena->blocks = block;
+        arena->next = (char *) (block + 1);
+        arena->end = (char *) block + blockSize;
+    }
+    void *memory = arena->next;
+    arena->next += size;
+    return memory;
+}
+
+void *stArena_calloc(stArena *arena, size_t size) {
+    void *memory = stArena_malloc(arena, size);
+    memset(memory, 0, size);
+    return memory;
+}
+
+int64_t stArena_getMemoryUsage(stArena *arena) {
+    return arena->memoryUsage;
+}
@@ -15,9 +15,55 @@
 // Note that the work "queue" is actually a stack, not a queue. This
 // shouldn't matter, as you have absolutely no ordering guarantees on
 // what order the work is completed in regardless.
+//
+// In work-stealing mode each thread instead owns a deque of work. A
+// thread takes work from the bottom of its own deque, and when that is
+// empty steals from the top of another thread's deque, so threads only
+// contend when one of them has run dry. Work pushed from within a work
+// function goes onto the deque of the thread running it.
 #include <stdlib.h>
 #include <pthread.h>
 #include "sonLib.h"
+#include "sonLibListPrivate.h"
+
+#define INITIAL_DEQUE_SIZE 64
+
+// A double-ended work queue owned by a single worker, stored as a
+// circular buffer.
+struct workDeque {
+    pthread_mutex_t lock;
+    void **units;
+    int64_t capacity;
+    int64_t top;               // Index of the oldest unit (stolen first).
+    int64_t length;
+};
+
+// A parallel loop over [0, n), shared by the calling thread and any
+// pool threads that join it. Ranges are handed out in chunks that
+// shrink as the loop nears completion (guided scheduling), so
+// threads that join late or run slowly still balance out.
+struct parallelJob {
+    int64_t n;
+    int64_t grainSize;
+    int64_t next;               // Start of the next unclaimed chunk.
+                                // Accessed atomically.
+    int64_t numParticipants;    // Threads that have joined the job,
+                                // also used to hand out accumulator
+                                // slots. Accessed atomically.
+    int64_t numActive;          // Threads currently working on the
+                                // job. Locked by stackLock.
+    void (*forFunc)(int64_t, int64_t, void *);
+    void (*reduceFunc)(int64_t, int64_t, void *, void *);
+    void *(*constructAccumulator)(void *);
+    void **accumulators;        // One per participant, for reductions.
+    void *arg;
+};
+
+// Passed to each thread in work-stealing mode.
+struct workerContext {
+    stThreadPool *threadPool;
+    int64_t index;             // Index of the worker's own deque.
+};
 
 struct _stThreadPool {
     pthread_mutex_t stackLock;  // Locks the stack so work can be
@@ -55,8 +101,100 @@ struct _stThreadPool {
                                 // requires that they hit a
                                 // cancellation point, which isn't
                                 // guaranteed to happen.
+
+    bool workStealing;          // If set, the stack is unused and
+                                // work is instead held in deques,
+                                // one per thread. The stackLock
+                                // then only guards sleeping and
+                                // waiting on the condition variables.
+
+    struct workDeque *deques;   // The per-thread deques.
+
+    struct workerContext *contexts;
+
+    pthread_key_t workerKey;    // Maps a pool thread to its context,
+                                // so pushes from a work function go
+                                // onto the thread's own deque.
+
+    int64_t numQueued;          // Units held in deques, waiting to be
+                                // started. Accessed atomically.
+
+    int64_t numPending;         // Units pushed but not yet finished.
+                                // Accessed atomically.
+
+    int64_t numSleeping;        // Threads asleep waiting for work.
+                                // Accessed atomically.
+
+    uint64_t nextDeque;         // Round-robin index for pushes from
+                                // outside the pool.
+
+    struct parallelJob *job;    // The running parallel loop, if
+                                // any. Set under stackLock.
+
+    pthread_mutex_t jobLock;    // Held by the thread running a parallel
+                                // loop, so only one runs at once.
+
+    pthread_cond_t jobCond;     // Signals the thread running a parallel
+                                // loop that a helper has left
+                                // it. Locked by stackLock.
 };
 
+// Claim the next chunk of the loop, returning false if none is left.
+static bool parallelJob_claim(struct parallelJob *job, int64_t numThreads, int64_t *start, int64_t *end) {
+    int64_t next = __atomic_load_n(&job->next, __ATOMIC_RELAXED);
+    while (next < job->n) {
+        int64_t chunk = (job->n - next) / (2 * numThreads);
+        if (chunk < job->grainSize) {
+            chunk = job->grainSize;
+        }
+        int64_t newNext = next + chunk < job->n ? next + chunk : job->n;
+        if (__atomic_compare_exchange_n(&job->next, &next, newNext, false,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            *start = next;
+            *end = newNext;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Run chunks of the loop until none are left.
+static void parallelJob_run(struct parallelJob *job, int64_t numThreads) {
+    int64_t slot = __atomic_fetch_add(&job->numParticipants, 1, __ATOMIC_SEQ_CST);
+    int64_t start, end;
+    while (parallelJob_claim(job, numThreads, &start, &end)) {
+        if (job->reduceFunc != NULL) {
+            if (job->accumulators[slot] == NULL) {
+                job->accumulators[slot] = job->constructAccumulator(job->arg);
+            }
+            job->reduceFunc(start, end, job->accumulators[slot], job->arg);
+        } else {
+            job->forFunc(start, end, job->arg);
+        }
+    }
+}
+
+// True if there is a parallel loop with chunks left to claim. Must
+// hold stackLock.
+static bool jobAvailable(stThreadPool *threadPool) {
+    return threadPool->job != NULL
+        && __atomic_load_n(&threadPool->job->next, __ATOMIC_RELAXED) < threadPool->job->n;
+}
+
+// Help with the current parallel loop, if there is one. Must hold
+// stackLock, which is released while working and held again on
+// return.
+static void joinJob(stThreadPool *threadPool) {
+    struct parallelJob *job = threadPool->job;
+    job->numActive++;
+    pthread_mutex_unlock(&threadPool->stackLock);
+    parallelJob_run(job, threadPool->numThreads + 1);
+    pthread_mutex_lock(&threadPool->stackLock);
+    if (--job->numActive == 0) {
+        pthread_cond_signal(&threadPool->jobCond);
+    }
+}
+
 // Worker function for each thread spawned. This function should never
 // return until it is cancelled in the destructor.
 static void worker(stThreadPool *threadPool) {
@@ -69,7 +207,7 @@ static void worker(stThreadPool *threadPool) {
         pthread_mutex_lock(&threadPool->stackLock);
         // Signal that we're waiting for work.
         threadPool->numFinishedThreads++;
-        while (stList_length(threadPool->stack) == 0 && !threadPool->killFlag) {
+        while (stList_length(threadPool->stack) == 0 && !threadPool->killFlag && !jobAvailable(threadPool)) {
             // Wake up the main thread in case it's waiting for us to be
             // done.
             pthread_cond_signal(&threadPool->finishedCond);
@@ -84,6 +222,14 @@ static void worker(stThreadPool *threadPool) {
             pthread_exit(NULL);
         }
 
+        if (jobAvailable(threadPool)) {
+            // Parallel loops take priority, as their caller is blocked.
+            threadPool->numFinishedThreads--;
+            joinJob(threadPool);
+            pthread_mutex_unlock(&threadPool->stackLock);
+            continue;
+        }
+
         void *workUnit = stList_pop(threadPool->stack);
         // Before unlocking the lock, un-signal that we're waiting for work.
         threadPool->numFinishedThreads--;
@@ -101,11 +247,166 @@ static void worker(stThreadPool *threadPool) {
     }
 }
 
+static void deque_init(struct workDeque *deque) {
+    int pthreadError = pthread_mutex_init(&deque->lock, NULL);
+    if (pthreadError) {
+        st_errAbort("stThreadPool: pthread_mutex_init failed: %s",
+                    strerror(pthreadError));
+    }
+    deque->capacity = INITIAL_DEQUE_SIZE;
+    deque->units = st_malloc(deque->capacity * sizeof(void *));
+    deque->top = 0;
+    deque->length = 0;
+}
+
+// Add units to the bottom of the deque. Must hold the deque lock.
+static void deque_pushBottom(struct workDeque *deque, void **units, int64_t numUnits) {
+    if (deque->length + numUnits > deque->capacity) {
+        int64_t newCapacity = deque->capacity;
+        while (deque->length + numUnits > newCapacity) {
+            newCapacity *= 2;
+        }
+        void **newUnits = st_malloc(newCapacity * sizeof(void *));
+        for (int64_t i = 0; i < deque->length; i++) {
+            newUnits[i] = deque->units[(deque->top + i) % deque->capacity];
+        }
+        free(deque->units);
+        deque->units = newUnits;
+        deque->capacity = newCapacity;
+        deque->top = 0;
+    }
+    for (int64_t i = 0; i < numUnits; i++) {
+        deque->units[(deque->top + deque->length++) % deque->capacity] = units[i];
+    }
+}
+
+// Take the newest unit from the deque, as its owner does. Returns
+// false if the deque is empty.
+static bool deque_popBottom(struct workDeque *deque, void **unit) {
+    pthread_mutex_lock(&deque->lock);
+    bool found = deque->length > 0;
+    if (found) {
+        *unit = deque->units[(deque->top + --deque->length) % deque->capacity];
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+// Take the oldest unit from the deque, as a thief does.
+static bool deque_popTop(struct workDeque *deque, void **unit) {
+    pthread_mutex_lock(&deque->lock);
+    bool found = deque->length > 0;
+    if (found) {
+        *unit = deque->units[deque->top];
+        deque->top = (deque->top + 1) % deque->capacity;
+        deque->length--;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+// Find the next unit for the given worker: first from its own deque,
+// then by stealing from the others.
+static bool findWork(stThreadPool *threadPool, int64_t index, void **unit) {
+    if (deque_popBottom(&threadPool->deques[index], unit)) {
+        return true;
+    }
+    for (int64_t i = 1; i < threadPool->numThreads; i++) {
+        if (deque_popTop(&threadPool->deques[(index + i) % threadPool->numThreads], unit)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Worker function for each thread in work-stealing mode. Returns when
+// the kill flag is set.
+static void *stealingWorker(struct workerContext *context) {
+    stThreadPool *threadPool = context->threadPool;
+    pthread_setspecific(threadPool->workerKey, context);
+    while (1) {
+        if (__atomic_load_n(&threadPool->job, __ATOMIC_SEQ_CST) != NULL) {
+            pthread_mutex_lock(&threadPool->stackLock);
+            if (jobAvailable(threadPool)) {
+                joinJob(threadPool);
+            }
+            pthread_mutex_unlock(&threadPool->stackLock);
+        }
+        void *workUnit;
+        if (findWork(threadPool, context->index, &workUnit)) {
+            __atomic_sub_fetch(&threadPool->numQueued, 1, __ATOMIC_SEQ_CST);
+            void *result = threadPool->workFunc(workUnit);
+            if (threadPool->finishFunc != NULL) {
+                pthread_mutex_lock(&threadPool->finishLock);
+                threadPool->finishFunc(result);
+                pthread_mutex_unlock(&threadPool->finishLock);
+            }
+            if (__atomic_sub_fetch(&threadPool->numPending, 1, __ATOMIC_SEQ_CST) == 0) {
+                // Wake anyone in stThreadPool_wait.
+                pthread_mutex_lock(&threadPool->stackLock);
+                pthread_cond_broadcast(&threadPool->finishedCond);
+                pthread_mutex_unlock(&threadPool->stackLock);
+            }
+            continue;
+        }
+        // Nothing to do, so go to sleep until something is
+        // pushed. Registering as asleep before checking the queue
+        // count (and pushers doing the reverse) means that a push
+        // can't be missed.
+        pthread_mutex_lock(&threadPool->stackLock);
+        __atomic_add_fetch(&threadPool->numSleeping, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&threadPool->numQueued, __ATOMIC_SEQ_CST) == 0 && !threadPool->killFlag
+               && !jobAvailable(threadPool)) {
+            pthread_cond_wait(&threadPool->stackCond, &threadPool->stackLock);
+        }
+        __atomic_sub_fetch(&threadPool->numSleeping, 1, __ATOMIC_SEQ_CST);
+        bool kill = threadPool->killFlag;
+        pthread_mutex_unlock(&threadPool->stackLock);
+        if (kill) {
+            return NULL;
+        }
+    }
+}
+
+// Push a number of units in work-stealing mode.
+static void pushToDeque(stThreadPool *threadPool, void **units, int64_t numUnits) {
+    if (numUnits == 0) {
+        return;
+    }
+    __atomic_add_fetch(&threadPool->numPending, numUnits, __ATOMIC_SEQ_CST);
+    struct workerContext *context = pthread_getspecific(threadPool->workerKey);
+    int64_t index = context != NULL ? context->index :
+        (int64_t) (__atomic_fetch_add(&threadPool->nextDeque, 1, __ATOMIC_RELAXED) % threadPool->numThreads);
+    struct workDeque *deque = &threadPool->deques[index];
+    pthread_mutex_lock(&deque->lock);
+    deque_pushBottom(deque, units, numUnits);
+    pthread_mutex_unlock(&deque->lock);
+    __atomic_add_fetch(&threadPool->numQueued, numUnits, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&threadPool->numSleeping, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&threadPool->stackLock);
+        if (numUnits == 1) {
+            pthread_cond_signal(&threadPool->stackCond);
+        } else {
+            pthread_cond_broadcast(&threadPool->stackCond);
+        }
+        pthread_mutex_unlock(&threadPool->stackLock);
+    }
+}
+
 // Initialize the thread pool. finishFunc can be NULL if you are
 // managing your own locks for output.
 stThreadPool *stThreadPool_construct(int64_t numThreads,
                                      void *(*workFunc)(void *),
                                      void (*finishFunc)(void *)) {
+    return stThreadPool_construct2(numThreads, workFunc, finishFunc, false);
+}
+
+// As stThreadPool_construct, but optionally using per-thread deques
+// and work stealing rather than a single shared stack.
+stThreadPool *stThreadPool_construct2(int64_t numThreads,
+                                      void *(*workFunc)(void *),
+                                      void (*finishFunc)(void *),
+                                      bool workStealing) {
     assert(numThreads > 0);
     stThreadPool *ret = st_calloc(1, sizeof(stThreadPool));
     ret->threads = st_calloc(numThreads, sizeof(pthread_t));
@@ -113,6 +414,7 @@ stThreadPool *stThreadPool_construct(int64_t numThreads,
     ret->workFunc = workFunc;
     ret->finishFunc = finishFunc;
     ret->numThreads = numThreads;
+    ret->workStealing = workStealing;
 
     // Set up the locks.
     int pthreadError;
@@ -136,6 +438,40 @@ stThreadPool *stThreadPool_construct(int64_t numThreads,
         st_errAbort("stThreadPool: pthread_cond_init failed: %s",
                     strerror(pthreadError));
     }
+    pthreadError = pthread_mutex_init(&ret->jobLock, NULL);
+    if (pthreadError) {
+        st_errAbort("stThreadPool: pthread_mutex_init failed: %s",
+                    strerror(pthreadError));
+    }
+    pthreadError = pthread_cond_init(&ret->jobCond, NULL);
+    if (pthreadError) {
+        st_errAbort("stThreadPool: pthread_cond_init failed: %s",
+                    strerror(pthreadError));
+    }
+
+    if (workStealing) {
+        pthreadError = pthread_key_create(&ret->workerKey, NULL);
+        if (pthreadError) {
+            st_errAbort("stThreadPool: pthread_key_create failed: %s",
+                        strerror(pthreadError));
+        }
+        ret->deques = st_calloc(numThreads, sizeof(struct workDeque));
+        ret->contexts = st_calloc(numThreads, sizeof(struct workerContext));
+        for (int64_t i = 0; i < numThreads; i++) {
+            deque_init(&ret->deques[i]);
+            ret->contexts[i].threadPool = ret;
+            ret->contexts[i].index = i;
+        }
+        for (int64_t i = 0; i < numThreads; i++) {
+            pthreadError = pthread_create(&ret->threads[i], NULL,
+                                          (void *(*)(void *)) stealingWorker, &ret->contexts[i]);
+            if (pthreadError) {
+                st_errAbort("stThreadPool: pthread_create failed: %s",
+                            strerror(pthreadError));
+            }
+        }
+        return ret;
+    }
 
     // Start the threads. All initialization of the thread pool struct
     // must happen before this, as the threads will look for work
@@ -153,26 +489,123 @@ stThreadPool *stThreadPool_construct(int64_t numThreads,
 
 // Push work onto the stack to be consumed by a thread.
 void stThreadPool_push(stThreadPool *threadPool, void *workUnit) {
+    if (threadPool->workStealing) {
+        pushToDeque(threadPool, &workUnit, 1);
+        return;
+    }
     pthread_mutex_lock(&threadPool->stackLock);
     stList_append(threadPool->stack, workUnit);
     pthread_cond_signal(&threadPool->stackCond);
     pthread_mutex_unlock(&threadPool->stackLock);
 }
 
+// Push all the work units in the list, taking the locks only once.
+void stThreadPool_pushAll(stThreadPool *threadPool, stList *workUnits) {
+    if (threadPool->workStealing) {
+        pushToDeque(threadPool, workUnits->list, stList_length(workUnits));
+        return;
+    }
+    pthread_mutex_lock(&threadPool->stackLock);
+    stList_appendAll(threadPool->stack, workUnits);
+    pthread_cond_broadcast(&threadPool->stackCond);
+    pthread_mutex_unlock(&threadPool->stackLock);
+}
+
 // Block until all work currently in the stack is complete. Can block
 // indefinitely if something goes wrong. Use stThreadPool_waitSafe to
 // ensure that you can get execution back after a timeout.
 void stThreadPool_wait(stThreadPool *threadPool) {
     pthread_mutex_lock(&threadPool->stackLock);
+    if (threadPool->workStealing) {
+        while (__atomic_load_n(&threadPool->numPending, __ATOMIC_SEQ_CST) != 0) {
+            pthread_cond_wait(&threadPool->finishedCond, &threadPool->stackLock);
+        }
+        pthread_mutex_unlock(&threadPool->stackLock);
+        return;
+    }
     while (stList_length(threadPool->stack) != 0 || threadPool->numFinishedThreads != threadPool->numThreads) {
         pthread_cond_wait(&threadPool->finishedCond, &threadPool->stackLock);
     }
     pthread_mutex_unlock(&threadPool->stackLock);
 }
 
+int64_t stThreadPool_getNumThreads(stThreadPool *threadPool) {
+    return threadPool->numThreads;
+}
+
+// Run the job on the calling thread and any idle pool threads,
+// returning once every chunk is done.
+static void runParallelJob(stThreadPool *threadPool, struct parallelJob *job) {
+    if (pthread_mutex_trylock(&threadPool->jobLock) != 0) {
+        // Another loop is running, possibly the one that called us,
+        // so just do the work here rather than risk deadlock.
+        parallelJob_run(job, 1);
+        return;
+    }
+    pthread_mutex_lock(&threadPool->stackLock);
+    __atomic_store_n(&threadPool->job, job, __ATOMIC_SEQ_CST);
+    pthread_cond_broadcast(&threadPool->stackCond);
+    pthread_mutex_unlock(&threadPool->stackLock);
+
+    parallelJob_run(job, threadPool->numThreads + 1);
+
+    pthread_mutex_lock(&threadPool->stackLock);
+    while (job->numActive > 0) {
+        pthread_cond_wait(&threadPool->jobCond, &threadPool->stackLock);
+    }
+    __atomic_store_n(&threadPool->job, NULL, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&threadPool->stackLock);
+    pthread_mutex_unlock(&threadPool->jobLock);
+}
+
+static void parallelJob_init(struct parallelJob *job, int64_t n, int64_t grainSize, void *arg) {
+    memset(job, 0, sizeof(struct parallelJob));
+    job->n = n;
+    job->grainSize = grainSize > 0 ? grainSize : 1;
+    job->arg = arg;
+}
+
+void stThreadPool_parallelFor(stThreadPool *threadPool, int64_t n, int64_t grainSize,
+                              void (*fn)(int64_t start, int64_t end, void *arg), void *arg) {
+    struct parallelJob job;
+    parallelJob_init(&job, n, grainSize, arg);
+    job.forFunc = fn;
+    runParallelJob(threadPool, &job);
+}
+
+void *stThreadPool_parallelReduce(stThreadPool *threadPool, int64_t n, int64_t grainSize,
+                                  void *(*constructAccumulator)(void *arg),
+                                  void (*fn)(int64_t start, int64_t end, void *accumulator, void *arg),
+                                  void (*merge)(void *accumulator, void *accumulatorToMerge, void *arg),
+                                  void *arg) {
+    struct parallelJob job;
+    parallelJob_init(&job, n, grainSize, arg);
+    job.reduceFunc = fn;
+    job.constructAccumulator = constructAccumulator;
+    // Every thread in the pool plus the caller can join at most once.
+    job.accumulators = st_calloc(threadPool->numThreads + 1, sizeof(void *));
+    runParallelJob(threadPool, &job);
+
+    void *result = NULL;
+    for (int64_t i = 0; i < job.numParticipants; i++) {
+        if (job.accumulators[i] != NULL) {
+            if (result == NULL) {
+                result = job.accumulators[i];
+            } else {
+                merge(result, job.accumulators[i], arg);
+            }
+        }
+    }
+    free(job.accumulators);
+    return result != NULL ? result : constructAccumulator(arg);
+}
+
 // Doesn't wait on all the work to complete, just returns whether the
 // work in the stack is all done or not.
 bool stThreadPool_done(stThreadPool *threadPool) {
+    if (threadPool->workStealing) {
+        return __atomic_load_n(&threadPool->numPending, __ATOMIC_SEQ_CST) == 0;
+    }
     pthread_mutex_lock(&threadPool->stackLock);
     bool ret = stList_length(threadPool->stack) == 0 && threadPool->numFinishedThreads == threadPool->numThreads;
     pthread_mutex_unlock(&threadPool->stackLock);
@@ -184,11 +617,12 @@ bool stThreadPool_done(stThreadPool *threadPool) {
 // queue will be unfinished.
 void stThreadPool_destruct(stThreadPool *threadPool) {
     // Wake all currently running threads so they know that they need
-    // to die.
+    // to die. The flag is set under the lock so a thread about to wait
+    // can't miss the wake up.
+    pthread_mutex_lock(&threadPool->stackLock);
     threadPool->killFlag = true;
-    for (int64_t i = 0; i < threadPool->numThreads; i++) {
-        pthread_cond_signal(&threadPool->stackCond);
-    }
+    pthread_cond_broadcast(&threadPool->stackCond);
+    pthread_mutex_unlock(&threadPool->stackLock);
     // Ensure that all threads are dead before freeing the memory out
     // from under them.
     for (int64_t i = 0; i < threadPool->numThreads; i++) {
@@ -197,11 +631,22 @@ void stThreadPool_destruct(stThreadPool *threadPool) {
     free(threadPool->threads);
 
     stList_destruct(threadPool->stack);
+    if (threadPool->workStealing) {
+        for (int64_t i = 0; i < threadPool->numThreads; i++) {
+            pthread_mutex_destroy(&threadPool->deques[i].lock);
+            free(threadPool->deques[i].units);
+        }
+        free(threadPool->deques);
+        free(threadPool->contexts);
+        pthread_key_delete(threadPool->workerKey);
+    }
 
     pthread_mutex_destroy(&threadPool->stackLock);
     pthread_mutex_destroy(&threadPool->finishLock);
     pthread_cond_destroy(&threadPool->finishedCond);
     pthread_cond_destroy(&threadPool->stackCond);
+    pthread_mutex_destroy(&threadPool->jobLock);
+    pthread_cond_destroy(&threadPool->jobCond);
 
     free(threadPool);
 }
@@ -1,7 +1,11 @@
 #include "sonLibGlobalsInternal.h"
 
+/*
+ * Entries are never removed, so are allocated from an arena and freed together.
+ */
 struct _stUnionFind {
     stHash *objectToEntry;
+    stArena *entries;
 };
 
 struct _stUnionFindIt {
@@ -15,23 +19,21 @@ typedef struct _stUnionFindEntry {
     int64_t rank;
 } stUnionFindEntry;
 
-static void stUnionFindEntry_destruct(stUnionFindEntry *entry) {
-    free(entry);
-}
-
 stUnionFind *stUnionFind_construct(void) {
     stUnionFind *ret = st_malloc(sizeof(stUnionFind));
-    ret->objectToEntry = stHash_construct2(NULL, (void (*)(void *)) stUnionFindEntry_destruct);
+    ret->objectToEntry = stHash_construct();
+    ret->entries = stArena_construct();
     return ret;
 }
 
 void stUnionFind_destruct(stUnionFind *unionFind) {
     stHash_destruct(unionFind->objectToEntry);
+    stArena_destruct(unionFind->entries);
     free(unionFind);
 }
 
 void stUnionFind_add(stUnionFind *unionFind, void *object) {
-    stUnionFindEntry *entry = st_malloc(sizeof(stUnionFindEntry));
+    stUnionFindEntry *entry = stArena_malloc(unionFind->entries, sizeof(stUnionFindEntry));
     entry->object = object;
     entry->parent = NULL;
     entry->rank = 0;
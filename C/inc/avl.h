@@ -54,6 +54,11 @@ extern struct libavl_allocator avl_allocator_default;
 void *avl_malloc (struct libavl_allocator *, size_t);
 void avl_free (struct libavl_allocator *, void *);
 
+/* Memory allocator using the slabs of stSlab.h. */
+extern struct libavl_allocator avl_allocator_slab;
+void *avl_slabMalloc (struct libavl_allocator *, size_t);
+void avl_slabFree (struct libavl_allocator *, void *);
+
 /* Maximum AVL height. */
 #ifndef AVL_MAX_HEIGHT
 #define AVL_MAX_HEIGHT 64
@@ -58,6 +58,11 @@ void fastaRead_readToMapFunction(void *fastaRead_map, const char *fastaHeader, c
 
 stHash *fastaReadToMap(FILE *fastaFile);
 
+/*
+ * As fastaReadToMap, but the values are the sequences packed as stPackedSeqs.
+ */
+stHash *fastaReadToPackedSeqMap(FILE *fastaFile);
+
 void fastaWrite(char *sequence, char *header, FILE *file);
 
 /////////////////////////////////////////////////////////
@@ -28,12 +28,18 @@ struct hashtable {
     int (*eqfn) (const void *k1, const void *k2);
     void (*keyFree)(void *);
     void (*valueFree)(void *);
+    int64_t useSlabs; /* entries are allocated from the slabs of stSlab.h */
 };
 
 /*****************************************************************************/
 uint64_t
 hashP(struct hashtable *h, void *k);
 
+/*****************************************************************************/
+/* frees an entry, back to the slabs if the table uses them */
+void
+hashtable_freeEntry(struct hashtable *h, struct entry *e);
+
 /*****************************************************************************/
 /* indexFor
 static uint64_t
@@ -29,6 +29,7 @@
 #include "sonLibKVDatabaseConf.h"
 #include "sonLibCompression.h"
 #include "sonLibFile.h"
+#include "sonLibFastaIndex.h"
 #include "sonLibMath.h"
 #include "sonLibCache.h"
 #include "stGraph.h"
@@ -40,6 +41,9 @@
 #include "stMatrix.h"
 #include "stPhylogeny.h"
 #include "stThreadPool.h"
+#include "stSeqReader.h"
+#include "stPackedSeq.h"
+#include "stSlab.h"
 #include "stUnionFind.h"
 #include "stSafeC.h"
 #include "jsmn.h"
@@ -27,6 +27,20 @@ extern "C" {
  */
 stCache *stCache_construct(void);
 
+/*
+ * Create an empty cache which holds at most the given number of bytes of record fragments. When
+ * a set pushes the cache over this size the least recently used fragments are evicted, though
+ * the fragment just set is always kept.
+ */
+stCache *stCache_construct2(int64_t maxSizeInBytes);
+
+/*
+ * As stCache_construct2, but if numShards > 0 the cache may be shared between threads. Records are
+ * split between numShards independent caches by the hash of their key, each with its own lock and an
+ * equal share of the size budget, so threads working on different keys rarely contend.
+ */
+stCache *stCache_construct3(int64_t maxSizeInBytes, int64_t numShards);
+
 /*
  * Destructs the cache.
  */
@@ -37,12 +51,41 @@ void stCache_destruct(stCache *cache);
  */
 void stCache_clear(stCache *cache);
 
+/*
+ * Sets the maximum number of bytes of fragments held, evicting fragments if the cache is now over
+ * the limit. INT64_MAX (the default) means the cache is unbounded.
+ */
+void stCache_setMaxSize(stCache *cache, int64_t maxSizeInBytes);
+
+/*
+ * Gets the maximum number of bytes of fragments held.
+ */
+int64_t stCache_getMaxSize(stCache *cache);
+
+/*
+ * Gets the number of bytes of fragments currently held.
+ */
+int64_t stCache_getSize(stCache *cache);
+
+/*
+ * Statistics: the number of calls to stCache_getRecord that were satisfied (hits) or not (misses)
+ * and the number of fragments evicted to keep the cache within its maximum size.
+ */
+int64_t stCache_getHits(stCache *cache);
+int64_t stCache_getMisses(stCache *cache);
+int64_t stCache_getEvictions(stCache *cache);
+
 /*
  * Update an existing key/value record fragment in the cache. If the record does not exist it is inserted. Throws an exception if unsuccessful.
  * The offset is the start of the record fragment.
  */
 void stCache_setRecord(stCache *cache, int64_t key, int64_t zeroBasedByteOffset, int64_t sizeInBytes, const void *value);
 
+/*
+ * Removes all the fragments of the record with the given key from the cache.
+ */
+void stCache_removeRecord(stCache *cache, int64_t key);
+
 /*
  * Returns non-zero if the cache contains all of the given record fragment. If zeroBasedByteOffset=INT64_MAX and
  * sizeInBytes=INT64_MAX then no overlap is required.
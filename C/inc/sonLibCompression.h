@@ -35,6 +35,58 @@ void *stCompression_compress(void *data, int64_t sizeInBytes, int64_t *compresse
  */
 void *stCompression_decompress(void *compressedData, int64_t compressedSizeInBytes, int64_t *sizeInBytes);
 
+/*
+ * Compresses the data into an lz4 frame. The data is split into fixed size blocks that are compressed
+ * independently, on numThreads threads, and the frame records the original size of each block, so
+ * decompression allocates its output once. The level is -1 or 0 for lz4's fast compressor, or from
+ * 1 to 16 for lz4hc, with 9 its default and higher levels searching harder for matches.
+ */
+void *stCompression_compressFramed(void *data, int64_t sizeInBytes, int64_t *compressedSizeInBytes, int64_t level,
+        int64_t numThreads);
+
+/*
+ * Decompresses an lz4 frame, as written by stCompression_compressFramed or an stCompressionWriter,
+ * decompressing its blocks on numThreads threads. Throws an exception if the frame is corrupt.
+ */
+void *stCompression_decompressFramed(void *compressedData, int64_t compressedSizeInBytes, int64_t *sizeInBytes,
+        int64_t numThreads);
+
+/*
+ * Starts writing an lz4 frame to the file. Data written is buffered and compressed a batch of
+ * blocks at a time, on numThreads threads, with the level as for stCompression_compressFramed.
+ */
+stCompressionWriter *stCompressionWriter_construct(FILE *file, int64_t level, int64_t numThreads);
+
+/*
+ * Appends the data to the frame. If this throws an exception the frame is incomplete, but the
+ * writer must still be destructed.
+ */
+void stCompressionWriter_write(stCompressionWriter *writer, const void *data, int64_t sizeInBytes);
+
+/*
+ * Writes out the remaining data and the end of the frame, and frees the writer, which is freed
+ * even if writing throws an exception. Does not close the file.
+ */
+void stCompressionWriter_destruct(stCompressionWriter *writer);
+
+/*
+ * Starts reading an lz4 frame from the file, decompressing a batch of blocks at a time on
+ * numThreads threads. Throws an exception if the file does not start with a frame.
+ */
+stCompressionReader *stCompressionReader_construct(FILE *file, int64_t numThreads);
+
+/*
+ * Reads up to sizeInBytes bytes of decompressed data, returning the number read, which is less
+ * than sizeInBytes only at the end of the frame. Throws an exception if the frame is corrupt or
+ * truncated, after which every read throws, but the reader must still be destructed.
+ */
+int64_t stCompressionReader_read(stCompressionReader *reader, void *data, int64_t sizeInBytes);
+
+/*
+ * Frees the reader. Does not close the file.
+ */
+void stCompressionReader_destruct(stCompressionReader *reader);
+
 /*
  * Uses Zlib.
  */
@@ -20,6 +20,18 @@
 extern "C" {
 #endif
 
+/*
+ * The table used to back a hash. The chained table allocates an entry per key, with malloc, or, for
+ * stHashTypeChainedSlab, from the slabs of stSlab.h, which is faster for big tables. The open addressing
+ * table stores entries inline using Robin Hood probing, so uses less memory and inserts with a single
+ * probe, but entries may be skipped by an iterator if the hash is modified during the iteration.
+ */
+typedef enum {
+    stHashTypeChained,
+    stHashTypeOpenAddressing,
+    stHashTypeChainedSlab
+} stHashType;
+
 // FIXME: passing key as non-const is causing unnecessary casts
 
 /*
@@ -43,6 +55,17 @@ stHash *stHash_construct2(void (*destructKeys)(void *), void (*destructValues)(v
 stHash *stHash_construct3(uint64_t (*hashKey)(const void *), int (*hashEqualsKey)(const void *, const void *),
                           void (*destructKeys)(void *), void (*destructValues)(void *));
 
+/*
+ * As stHash_construct3, but using the given type of table.
+ */
+stHash *stHash_construct4(uint64_t (*hashKey)(const void *), int (*hashEqualsKey)(const void *, const void *),
+                          void (*destructKeys)(void *), void (*destructValues)(void *), stHashType type);
+
+/*
+ * Returns the type of table backing the hash.
+ */
+stHashType stHash_getType(stHash *hash);
+
 /*
  * Destructs a hash.
  */
@@ -34,6 +34,19 @@ extern const char *ST_KV_DATABASE_RETRY_TRANSACTION_EXCEPTION_ID;
  */
 stKVDatabase *stKVDatabase_construct(stKVDatabaseConf *conf, bool create);
 
+/*
+ * Constructs a database that caches the given database, which it takes ownership of (it is
+ * destructed or deleted along with the returned database, and must not be used directly while
+ * the returned database exists). Records read and written are held in an in memory cache
+ * of at most cacheSizeInBytes bytes, from which later reads, including partial reads, are served.
+ * Writes are held back in a buffer, coalescing repeated writes to the same record, and are sent on
+ * in one bulk set when more than writeBufferSizeInBytes bytes are buffered, or when the database is
+ * flushed or destructed. Consequently an error in a write, such as inserting a record that already
+ * exists, may only be reported on a later call. The int64 functions are passed straight through.
+ */
+stKVDatabase *stKVDatabase_constructCached(stKVDatabase *database, int64_t cacheSizeInBytes,
+        int64_t writeBufferSizeInBytes);
+
 /*
  * Destructs a database. If the destruction occurs during a transaction the transaction
  * is aborted and any changes are not committed to the database.
@@ -47,6 +60,12 @@ void stKVDatabase_destruct(stKVDatabase *database);
  */
 void stKVDatabase_deleteFromDisk(stKVDatabase *database);
 
+/*
+ * Sends any writes held back by the database (see stKVDatabase_constructCached) on to the
+ * underlying database. Does nothing for databases that write immediately.
+ */
+void stKVDatabase_flush(stKVDatabase *database);
+
 /*
  * Returns non-zero if the database contains a record with the given key.
  */
@@ -173,11 +192,44 @@ void stKVDatabase_removeRecord(stKVDatabase *database, int64_t key);
  */
 void *stKVDatabase_getPartialRecord(stKVDatabase *database, int64_t key, int64_t zeroBasedByteOffset, int64_t sizeInBytes, int64_t recordSize);
 
+/*
+ * Gets a read-only view of a record in the database, given the key, which must be released with
+ * stKVDatabaseRecordView_destruct. Returns NULL if the database does not contain the record. File based
+ * databases map big records into memory rather than copying them, other databases return a copy. The view
+ * is unaffected by later changes to the record.
+ */
+stKVDatabaseRecordView *stKVDatabase_getRecordView(stKVDatabase *database, int64_t key);
+
+/*
+ * As stKVDatabase_getRecordView, but a view of part of the record, as for stKVDatabase_getPartialRecord.
+ * Throws an exception if the record does not exist or the part lies outside of it.
+ */
+stKVDatabaseRecordView *stKVDatabase_getPartialRecordView(stKVDatabase *database, int64_t key, int64_t zeroBasedByteOffset,
+        int64_t sizeInBytes, int64_t recordSize);
+
+/*
+ * Gets the record (or part of a record) held in the view, putting its size in recordSize. The memory is read-only
+ * and valid until the view is destructed.
+ */
+const void *stKVDatabaseRecordView_getRecord(stKVDatabaseRecordView *view, int64_t *recordSize);
+
+/*
+ * Releases the view.
+ */
+void stKVDatabaseRecordView_destruct(stKVDatabaseRecordView *view);
+
 /*
  * Returns number of records in database.
  */
 int64_t stKVDatabase_getNumberOfRecords(stKVDatabase *database);
 
+/*
+ * Returns the total size of the records written through this handle once compressed, over their size
+ * before, see stKVDatabaseConf_setCompression. Returns 1.0 if the database does not compress records or
+ * no records have been written.
+ */
+double stKVDatabase_getCompressionRatio(stKVDatabase *database);
+
 
 /*
  * get the configuration object for the database.
@@ -16,14 +16,29 @@ typedef enum {
     stKVDatabaseTypeTokyoCabinet,
     stKVDatabaseTypeKyotoTycoon,
     stKVDatabaseTypeMySql,
+    stKVDatabaseTypeLogStructured,
 } stKVDatabaseType;
 
+typedef enum {
+    stKVDatabaseCompressionNone,
+    stKVDatabaseCompressionLz4,
+    stKVDatabaseCompressionLz4hc,
+    stKVDatabaseCompressionZlib,
+} stKVDatabaseCompression;
+
 /* 
  * Construct a new database configuration object for a Tokyo Cabinet
  * database.
  */
 stKVDatabaseConf *stKVDatabaseConf_constructTokyoCabinet(const char *databaseDir);
 
+/*
+ * Construct a new database configuration object for the built in log structured
+ * database, which keeps its records in a single file in the given directory. It
+ * needs no external library or server.
+ */
+stKVDatabaseConf *stKVDatabaseConf_constructLogStructured(const char *databaseDir);
+
 /* 
  * Construct a new database configuration object for a Kyoto Tycoon
  * database remote object.
@@ -45,14 +60,17 @@ stKVDatabaseConf *stKVDatabaseConf_constructMySql(const char *host, unsigned por
  * Decodes a simple piece of XML, structured as follows:
  * <st_kv_database_conf type="TYPE">
  *      <tokyo_cabinet database_dir=""/>
+ *      <log_structured database_dir=""/>
  *      <mysql host="" port="" user="" password="" database_name="" table_name=""/>
  *      <kyoto_cabinet host="" port=""/>
  * </st_kv_database_conf>
  *
- * Type can be "tokyo_cabinet", "mysql", or "kyoto_cabinet". If it is of that type then
+ * Type can be "tokyo_cabinet", "log_structured", "mysql", or "kyoto_cabinet". If it is of that type then
  * you need to include a nested tag with the parameters for that conf constructor.
  * The labels for the nested tag are name value pairs (no order assumed) for the conf constructor
  * (see above).  The port is optional.
+ * The nested tag may also have a compression attribute, one of "none", "lz4", "lz4hc" or "zlib"
+ * (see stKVDatabaseConf_setCompression), which defaults to "none".
  */
 stKVDatabaseConf *stKVDatabaseConf_constructFromString(const char *xmlString);
 
@@ -66,6 +84,19 @@ stKVDatabaseConf *stKVDatabaseConf_constructClone(stKVDatabaseConf *srcConf);
  */
 void stKVDatabaseConf_destruct(stKVDatabaseConf *conf);
 
+/*
+ * Set the compression of the database's records. Records are compressed as they are written and
+ * decompressed as they are read, in independently compressed blocks, so that partial reads
+ * only decompress the blocks they need. Int64 records are not compressed. A database must always
+ * be opened with the compression it was created with.
+ */
+void stKVDatabaseConf_setCompression(stKVDatabaseConf *conf, stKVDatabaseCompression compression);
+
+/*
+ * Get the compression of the database's records.
+ */
+stKVDatabaseCompression stKVDatabaseConf_getCompression(stKVDatabaseConf *conf);
+
 /* 
  * get the database type.
  */
@@ -171,6 +171,7 @@ void stList_shuffle(stList *list);
  * Gets a sorted set representation of the stList, using the given cmpFn as backing. The sorted set
  * has no defined destruct element function, so when the sorted set is destructed the elements in it and
  * in this list will not be destructed. If the cmpFn is NULL then we use the default cmpFn.
+ * The sorted set is a B-tree, built in one pass once the elements are sorted.
  */
 stSortedSet *stList_getSortedSet(stList *list,
         int(*cmpFn)(const void *a, const void *b));
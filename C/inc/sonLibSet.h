@@ -44,6 +44,12 @@ stSet *stSet_construct2(void (*destructKeys)(void *));
 stSet *stSet_construct3(uint64_t (*hashKey)(const void *), int (*hashEqualsKey)(const void *, const void *),
                         void (*destructKeys)(void *));
 
+/*
+ * As stSet_construct3, but using the given type of hash table, see stHashType.
+ */
+stSet *stSet_construct4(uint64_t (*hashKey)(const void *), int (*hashEqualsKey)(const void *, const void *),
+                        void (*destructKeys)(void *), stHashType type);
+
 /*
  * Destructs a set.
  */
@@ -16,6 +16,18 @@ extern "C" {
 //The exception string
 extern const char *SORTED_SET_EXCEPTION_ID;
 
+/*
+ * The tree used to back a sorted set. The AVL tree allocates a node per element, with malloc, or,
+ * for stSortedSetTypeAVLSlab, from the slabs of stSlab.h, which is faster for big sets. The B-tree
+ * keeps the elements in wide, linked leaves, so searches and ordered iteration touch far fewer
+ * cache lines, and can be built from a sorted list in linear time.
+ */
+typedef enum {
+    stSortedSetTypeAVL,
+    stSortedSetTypeBTree,
+    stSortedSetTypeAVLSlab
+} stSortedSetType;
+
 ////////////////////////////////////////////////
 ////////////////////////////////////////////////
 ////////////////////////////////////////////////
@@ -43,8 +55,28 @@ stSortedSet *stSortedSet_construct2(void (*destructElementFn)(void *));
 stSortedSet *stSortedSet_construct3(int (*compareFn)(const void *, const void *),
                                       void (*destructElementFn)(void *));
 
+/*
+ * As stSortedSet_construct3, but using the given type of tree.
+ */
+stSortedSet *stSortedSet_construct4(int (*compareFn)(const void *, const void *),
+                                      void (*destructElementFn)(void *), stSortedSetType type);
+
+/*
+ * Constructs a B-tree backed sorted set from a list sorted under the comparison function (which
+ * if null is pointer comparison), in linear time. Of equal elements in the list, the last is kept.
+ * Creates an exception if the list is not sorted.
+ */
+stSortedSet *stSortedSet_constructFromSortedList(stList *list, int (*compareFn)(const void *, const void *),
+                                                   void (*destructElementFn)(void *));
+
+/*
+ * Returns the type of tree backing the sorted set.
+ */
+stSortedSetType stSortedSet_getType(stSortedSet *sortedSet);
+
 /*
  * Clones the given sorted set, setting the element destructor to the given function.
+ * The copy is backed by the same type of tree.
  */
 stSortedSet *stSortedSet_copyConstruct(stSortedSet *sortedSet, void (*destructElementFn)(void *));
 
@@ -159,16 +191,19 @@ int stSortedSet_equals(stSortedSet *sortedSet1, stSortedSet *sortedSet2);
 
 /*
  * Get the union of two sorted sets. Creates exception if they have different comparators.
+ * The result is backed by the same type of tree as sortedSet1.
  */
 stSortedSet *stSortedSet_getUnion(stSortedSet *sortedSet1, stSortedSet *sortedSet2);
 
 /*
  * Get the intersection of two sorted sets. Creates exception if they have different comparators.
+ * The result is backed by the same type of tree as sortedSet1.
  */
 stSortedSet *stSortedSet_getIntersection(stSortedSet *sortedSet1, stSortedSet *sortedSet2);
 
 /*
  * Get the set difference of sortedSet1 \ sortedSet2. Creates exception if they have different comparators.
+ * The result is backed by the same type of tree as sortedSet1.
  */
 stSortedSet *stSortedSet_getDifference(stSortedSet *sortedSet1, stSortedSet *sortedSet2);
 
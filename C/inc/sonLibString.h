@@ -121,6 +121,12 @@ char *stString_reverseComplementString(const char *string);
  */
 char stString_reverseComplementChar(char c);
 
+/*
+ * As stString_reverseComplementString, but reverse complements the first length
+ * characters of the string in place, without allocating.
+ */
+void stString_reverseComplementStringInPlace(char *string, int64_t length);
+
 #ifdef __cplusplus
 }
 #endif
@@ -140,6 +140,33 @@ void stTree_setChild(stTree *tree, int64_t childIndex, stTree *newChild);
  */
 stTree *stTree_getMRCA(stTree *node1, stTree *node2);
 
+/*
+ * Constructs an index of the tree below the given node, which answers
+ * most recent common ancestor and path length queries in constant
+ * time, rather than by walking up the tree. Construction takes
+ * O(n log n) time and space. The index is of the tree as it is when
+ * constructed, and must be rebuilt if the tree changes.
+ */
+stTreeLCAIndex *stTreeLCAIndex_construct(stTree *root);
+
+/*
+ * Destructs the index, leaving the tree alone.
+ */
+void stTreeLCAIndex_destruct(stTreeLCAIndex *index);
+
+/*
+ * As stTree_getMRCA, for two nodes of the indexed tree. Returns NULL if
+ * either node is not in the indexed tree.
+ */
+stTree *stTreeLCAIndex_getMRCA(stTreeLCAIndex *index, stTree *node1, stTree *node2);
+
+/*
+ * Returns the sum of the branch lengths on the path between two nodes
+ * of the indexed tree, computed from the distances of the nodes from
+ * the root.
+ */
+double stTreeLCAIndex_getDistance(stTreeLCAIndex *index, stTree *node1, stTree *node2);
+
 #ifdef __cplusplus
 }
 #endif
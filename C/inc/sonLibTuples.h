@@ -39,6 +39,24 @@ stIntTuple *stIntTuple_construct5(int64_t value1, int64_t value2, int64_t value3
 
 stIntTuple *stIntTuple_constructN(int64_t length, const int64_t iA[]);
 
+/*
+ * Constructs a tuple held in the pointer itself, with no allocation, if the value fits in
+ * 62 bits, else an allocated tuple. An inline tuple can be used anywhere a tuple can, and stored
+ * in containers as is, but must be freed with stIntTuple_destruct, never with free.
+ */
+stIntTuple *stIntTuple_constructInline1(int64_t value);
+
+/*
+ * As stIntTuple_constructInline1, for a pair of values, which are held inline if each fits
+ * in 31 bits.
+ */
+stIntTuple *stIntTuple_constructInline2(int64_t value1, int64_t value2);
+
+/*
+ * Returns non-zero iff the tuple is held inline.
+ */
+bool stIntTuple_isInline(stIntTuple *intTuple);
+
 /*
  * Destructs the tuple.
  */
@@ -74,6 +92,34 @@ int64_t stIntTuple_length(stIntTuple *intTuple);
  */
 int64_t stIntTuple_get(stIntTuple *intTuple, int64_t index);
 
+/*
+ * An interner holds a single copy of each distinct tuple given to it, so interned tuples
+ * can be compared by pointer. Not thread safe.
+ */
+stIntTupleInterner *stIntTupleInterner_construct(void);
+
+/*
+ * Frees the interner and all the tuples it holds.
+ */
+void stIntTupleInterner_destruct(stIntTupleInterner *interner);
+
+/*
+ * Returns the interned tuple of the given values. Tuples that can be held inline are returned
+ * inline, as these are already unique, otherwise the tuple belongs to the interner and must not
+ * be destructed.
+ */
+stIntTuple *stIntTupleInterner_intern(stIntTupleInterner *interner, int64_t length, const int64_t values[]);
+
+/*
+ * Returns the interned tuple equal to the given tuple.
+ */
+stIntTuple *stIntTupleInterner_internTuple(stIntTupleInterner *interner, stIntTuple *intTuple);
+
+/*
+ * Returns the number of tuples held by the interner, which does not include inline tuples.
+ */
+int64_t stIntTupleInterner_size(stIntTupleInterner *interner);
+
 /*
  * The following are double variants of the above functions.
  *  One must be very careful to ensure that the variable arguments are of type double!
@@ -34,13 +34,14 @@ extern "C" {
 typedef struct _stTree stTree;
 typedef struct _stHash stHash;
 typedef struct _stSet stSet;
-typedef struct hashtable_itr stHashIterator;
+typedef struct _stHashIterator stHashIterator;
 typedef struct _stSetIterator stSetIterator;
 typedef struct _stSortedSet stSortedSet;
 typedef struct _stSortedSetIterator stSortedSetIterator;
 typedef struct _stList stList;
 typedef struct _stListIterator stListIterator;
 typedef int64_t stIntTuple;
+typedef struct _stIntTupleInterner stIntTupleInterner;
 typedef double stDoubleTuple;
 typedef struct stExcept stExcept;
 typedef struct stAlign stAlign;
@@ -53,6 +54,7 @@ typedef struct stKVDatabase stKVDatabase;
 typedef struct stKVDatabaseConf stKVDatabaseConf;
 typedef struct stKVDatabaseBulkRequest stKVDatabaseBulkRequest;
 typedef struct stKVDatabaseBulkResult stKVDatabaseBulkResult;
+typedef struct stKVDatabaseRecordView stKVDatabaseRecordView;
 typedef struct _stEdge stEdge;
 typedef struct _stGraph stGraph;
 typedef struct _stPosetAlignment stPosetAlignment;
@@ -75,6 +77,12 @@ typedef struct _stNaiveConnectedComponent stNaiveConnectedComponent;
 typedef struct _stNaiveConnectedComponentIterator stNaiveConnectedComponentIterator;
 typedef struct _stNaiveConnectedComponentNodeIterator stNaiveConnectedComponentNodeIterator;
 typedef struct _stMatrix stMatrix;
+typedef struct _stFastaIndex stFastaIndex;
+typedef struct _stPackedSeq stPackedSeq;
+typedef struct _stCompressionWriter stCompressionWriter;
+typedef struct _stCompressionReader stCompressionReader;
+typedef struct _stArena stArena;
+typedef struct _stTreeLCAIndex stTreeLCAIndex;
 
 #ifdef __cplusplus
 }
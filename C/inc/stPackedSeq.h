@@ -0,0 +1,78 @@
+// A nucleotide sequence packed at two bits a base, a quarter of the
+// memory of a char string.
+//
+// A, C, G and T, in either case, are packed as 0, 1, 2 and 3, 32
+// bases to a 64 bit word. Any other characters, such as N, IUPAC
+// codes or gaps, are kept as runs of the same character, as are runs
+// of lower case bases (soft masking), so converting a string to a
+// packed sequence and back gives the same string. Genome sequences
+// have few such runs, so take little more than two bits a base.
+//
+// The work is done a word (32 bases) at a time, in branch free loops
+// the compiler can vectorise.
+#ifndef SONLIB_PACKEDSEQ_H_
+#define SONLIB_PACKEDSEQ_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//The exception string
+extern const char *ST_PACKED_SEQ_EXCEPTION;
+
+typedef struct _stPackedSeqKmerIterator stPackedSeqKmerIterator;
+
+// Pack the zero terminated string.
+stPackedSeq *stPackedSeq_construct(const char *string);
+
+// Pack the first length characters of the string, which need not be
+// zero terminated.
+stPackedSeq *stPackedSeq_construct2(const char *string, int64_t length);
+
+void stPackedSeq_destruct(stPackedSeq *seq);
+
+// Append length characters of the string to the sequence.
+void stPackedSeq_append(stPackedSeq *seq, const char *string, int64_t length);
+
+int64_t stPackedSeq_getLength(stPackedSeq *seq);
+
+// Get the character at position i.
+char stPackedSeq_getBase(stPackedSeq *seq, int64_t i);
+
+// Get the whole sequence as a zero terminated string.
+char *stPackedSeq_getString(stPackedSeq *seq);
+
+// Get the characters [start, start + length) as a zero terminated
+// string. Throws an exception if the interval is not within the
+// sequence.
+char *stPackedSeq_getSubstring(stPackedSeq *seq, int64_t start, int64_t length);
+
+// As stPackedSeq_getSubstring, but returns a packed sequence.
+stPackedSeq *stPackedSeq_getSubsequence(stPackedSeq *seq, int64_t start, int64_t length);
+
+// Returns the reverse complement of the sequence, complementing
+// characters other than A, C, G and T as
+// stString_reverseComplementChar does.
+stPackedSeq *stPackedSeq_reverseComplement(stPackedSeq *seq);
+
+// Returns the number of G and C bases, in either case.
+int64_t stPackedSeq_getGCCount(stPackedSeq *seq);
+
+// Returns the bytes of memory used by the sequence.
+int64_t stPackedSeq_getMemoryUsage(stPackedSeq *seq);
+
+// Iterate over the k-mers of the sequence that contain only A, C, G
+// and T (in either case), for 1 <= k <= 32. Each k-mer is packed with
+// its first base in the most significant bits, so that k-mers sort
+// as their strings do.
+stPackedSeqKmerIterator *stPackedSeq_getKmerIterator(stPackedSeq *seq, int64_t k);
+
+// Get the next k-mer and its start position, returning false at the
+// end of iteration.
+bool stPackedSeqKmerIterator_getNext(stPackedSeqKmerIterator *it, uint64_t *kmer, int64_t *position);
+
+void stPackedSeq_destructKmerIterator(stPackedSeqKmerIterator *it);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // SONLIB_PACKEDSEQ_H_
@@ -94,6 +94,10 @@ stTree *stPhylogeny_scoreFromBootstrap(stTree *tree, stTree *bootstrap);
 // stPhylogenyInfo.
 stTree *stPhylogeny_scoreFromBootstraps(stTree *tree, stList *bootstraps);
 
+// As stPhylogeny_scoreFromBootstraps, scoring the bootstraps with the
+// given number of threads.
+stTree *stPhylogeny_scoreFromBootstraps2(stTree *tree, stList *bootstraps, int64_t numThreads);
+
 stTree *stPhylogeny_scoreReconciliationFromBootstrap(stTree *tree,
                                                      stTree *bootstrap);
 
@@ -105,6 +109,10 @@ stTree *stPhylogeny_scoreReconciliationFromBootstrap(stTree *tree,
 stTree *stPhylogeny_scoreReconciliationFromBootstraps(stTree *tree,
                                                       stList *bootstraps);
 
+// As stPhylogeny_scoreReconciliationFromBootstraps, scoring the
+// bootstraps with the given number of threads.
+stTree *stPhylogeny_scoreReconciliationFromBootstraps2(stTree *tree, stList *bootstraps, int64_t numThreads);
+
 // Only one half of the distanceMatrix is used, distances[i][j] for which i > j
 // Tree returned is labeled by the indices of the distance matrix. The
 // tree is rooted halfway along the longest branch if outgroups is
@@ -112,6 +120,18 @@ stTree *stPhylogeny_scoreReconciliationFromBootstraps(stTree *tree,
 // branch.
 stTree *stPhylogeny_neighborJoin(stMatrix *distances, stList *outgroups);
 
+// As stPhylogeny_neighborJoin, searching for each join with the given
+// number of threads. Neighbor-joining needs O(n^2) memory, and each
+// join searches only the closest pairs of each node (those that could
+// be the next join), so it is usually much faster than the O(n^3)
+// method. The tree is the same as that of stPhylogeny_neighborJoin,
+// whatever the number of threads.
+stTree *stPhylogeny_neighborJoin2(stMatrix *distances, stList *outgroups, int64_t numThreads);
+
+// As stPhylogeny_neighborJoin, using QuickTree's neighbor-joining. It
+// builds the same tree, more slowly.
+stTree *stPhylogeny_neighborJoinQuickTree(stMatrix *distances, stList *outgroups);
+
 // Gets the (leaf) node corresponding to an index in the distance matrix.
 // Requires an indexed tree (which has stPhylogenyInfo with non-null
 // stIndexedTreeInfo.)
@@ -131,7 +151,8 @@ double stPhylogeny_distanceBetweenLeaves(stTree *tree, int64_t leaf1,
                                          int64_t leaf2);
 
 // Return the MRCA of the given leaves. More efficient than
-// stTree_getMRCA.
+// stTree_getMRCA. For many queries on the same tree, an
+// stTreeLCAIndex answers each in constant time.
 // Requires an indexed tree (which has stPhylogenyInfo with non-null
 // stIndexedTreeInfo.)
 stTree *stPhylogeny_getMRCA(stTree *tree, int64_t leaf1, int64_t leaf2);
@@ -148,7 +169,10 @@ stMatrix *stPhylogeny_computeJoinCosts(stTree *speciesTree,
                                        stHash *speciesToIndex,
                                        double costPerDup, double costPerLoss);
 
-// Precompute an MRCA matrix to pass to guided neighbor-joining.
+// Precompute an MRCA matrix to pass to guided neighbor-joining. This
+// takes O(n^2) memory in the number of species; guided
+// neighbor-joining can instead be passed NULL, in which case it
+// answers MRCA queries with an stTreeLCAIndex of the species tree.
 int64_t **stPhylogeny_getMRCAMatrix(stTree *speciesTree, stHash *speciesToIndex);
 
 // Neighbor joining guided by a species tree. The similarity matrix
@@ -156,7 +180,8 @@ int64_t **stPhylogeny_getMRCAMatrix(stTree *speciesTree, stHash *speciesToIndex)
 // differences between i and j, i < j is # similarities between i and
 // j. Join costs should be precomputed by
 // stPhylogeny_computeJoinCosts. indexToSpecies is a map from matrix
-// index (of the similarity matrix) to species leaves.
+// index (of the similarity matrix) to species leaves. speciesMRCAMatrix
+// (from stPhylogeny_getMRCAMatrix) may be NULL.
 stTree *stPhylogeny_guidedNeighborJoining(stMatrix *distanceMatrix,
                                           stMatrix *similarityMatrix,
                                           stMatrix *joinCosts,
@@ -165,6 +190,18 @@ stTree *stPhylogeny_guidedNeighborJoining(stMatrix *distanceMatrix,
                                           int64_t **speciesMRCAMatrix,
                                           stTree *speciesTree);
 
+// As stPhylogeny_guidedNeighborJoining, searching for each join with
+// the given number of threads. The tree is the same whatever the
+// number of threads.
+stTree *stPhylogeny_guidedNeighborJoining2(stMatrix *distanceMatrix,
+                                           stMatrix *similarityMatrix,
+                                           stMatrix *joinCosts,
+                                           stHash *matrixIndexToJoinCostIndex,
+                                           stHash *speciesToJoinCostIndex,
+                                           int64_t **speciesMRCAMatrix,
+                                           stTree *speciesTree,
+                                           int64_t numThreads);
+
 // Reconcile a gene tree (without rerooting), set the proper
 // stReconcilationInfo (as an entry of stPhylogenyInfo) as client data
 // on all nodes, and optionally set the labels of the ancestors to the
@@ -216,9 +253,17 @@ void stPhylogeny_nni(stTree *anc, stTree **tree1, stTree **tree2);
 // *both* inter-split distances).
 stList *stPhylogeny_getSplits(stMatrix *distanceMatrix, bool relaxed);
 
+// As stPhylogeny_getSplits, checking the splits with the given number
+// of threads.
+stList *stPhylogeny_getSplits2(stMatrix *distanceMatrix, bool relaxed, int64_t numThreads);
+
 // Build a tree greedily using the d-splits from stPhylogeny_getSplits.
 stTree *stPhylogeny_greedySplitDecomposition(stMatrix *distanceMatrix, bool relaxed);
 
+// As stPhylogeny_greedySplitDecomposition, finding the splits with
+// the given number of threads.
+stTree *stPhylogeny_greedySplitDecomposition2(stMatrix *distanceMatrix, bool relaxed, int64_t numThreads);
+
 // Apply the Jukes-Cantor distance correction to the input distance matrix.
 void stPhylogeny_applyJukesCantorCorrection(stMatrix *distanceMatrix);
 
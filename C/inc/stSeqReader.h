@@ -0,0 +1,53 @@
+// A pipelined, multi-threaded reader for fasta and fastq files.
+//
+// The calling thread reads the file in large chunks, each ending at a
+// record boundary, and hands them to a thread pool whose threads
+// parse the records and pass them to a callback. Gzipped files are
+// decompressed as they are read, and plain files are read as is.
+//
+// Whether a file is fasta or fastq is decided by its first character
+// that is not white space: '@' for fastq, anything else for fasta,
+// where as with fastaRead anything before the first '>' is ignored.
+// A fasta record runs from a line starting with '>' to the next such
+// line, and white space in its sequence is dropped. A fastq record is
+// four lines: '@' and the header, the sequence, '+' (and optionally
+// the header again) and the qualities, which must be as long as the
+// sequence and lie between '!' and '~'. In both formats sequences may
+// only contain roman alphabet characters and gaps.
+#ifndef SONLIB_SEQREADER_H_
+#define SONLIB_SEQREADER_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//The exception string
+extern const char *ST_SEQ_READER_EXCEPTION;
+
+// A record passed to the callback. The strings are zero terminated
+// and only valid until the callback returns.
+typedef struct _stSeqRecord {
+    const char *header; // The header line, without the '>' or '@'.
+    const char *sequence;
+    const char *qualities; // NULL for fasta records.
+    int64_t length; // The length of the sequence (and of the qualities).
+} stSeqRecord;
+
+// Read the fasta or fastq file, calling fn(record, arg) for each
+// record, using numThreads threads to parse the records.
+//
+// If ordered is set the records are passed to fn in the order they
+// appear in the file, and fn is called from one thread at a time
+// (although not necessarily the calling thread). Otherwise fn is
+// called concurrently from the pool's threads, in no particular
+// order, so must manage its own locks.
+//
+// Throws an exception if the file can not be read or is malformed.
+// All records before the first malformed one are passed to fn when
+// ordered is set; otherwise which records are passed is undefined.
+void stSeqReader_read(const char *fileName, int64_t numThreads, bool ordered,
+                      void (*fn)(const stSeqRecord *record, void *arg), void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // SONLIB_SEQREADER_H_
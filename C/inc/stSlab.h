@@ -0,0 +1,66 @@
+// Allocation of small objects from slabs, and of short lived objects
+// from arenas.
+//
+// st_slabMalloc rounds a request up to a size class, a multiple of 16
+// bytes up to ST_SLAB_MAX_SIZE, and takes an object of that class
+// from a slab, a block of objects of a single class, owned by the
+// calling thread, so most allocations and frees take no lock and
+// objects allocated together are close in memory. Objects freed by
+// other threads are passed back to their slab, to be reused. Objects
+// carry no header: the size class is found from the slab holding
+// them. A slab is given back to the system once all its objects are
+// freed, unless it is the one its thread is allocating from.
+//
+// Chained hashes of type stHashTypeChainedSlab and sorted sets of type
+// stSortedSetTypeAVLSlab allocate their elements this way; other
+// containers use malloc. If compiled with ST_SLAB_DISABLE defined, or
+// with the address sanitizer, the slab functions simply call malloc
+// and free, so memory checkers see each object.
+//
+// An arena hands out memory from large blocks, all freed at once when
+// the arena is destructed, for structures that are torn down as a
+// whole, such as the entries of a union find. An arena is not thread
+// safe.
+#ifndef SONLIB_SLAB_H_
+#define SONLIB_SLAB_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The largest request st_slabMalloc takes.
+#define ST_SLAB_MAX_SIZE 512
+
+// Returns memory for an object of the given size, which must not be
+// more than ST_SLAB_MAX_SIZE, aligned to 16 bytes.
+void *st_slabMalloc(size_t size);
+
+// As st_slabMalloc, but the memory is zeroed.
+void *st_slabCalloc(size_t size);
+
+// Frees an object from st_slabMalloc or st_slabCalloc. The object may
+// be freed by a different thread to the one that allocated it.
+void st_slabFree(void *object);
+
+// Returns the bytes of memory taken from the system for slabs.
+int64_t st_slabGetMemoryUsage(void);
+
+stArena *stArena_construct(void);
+
+// Frees all the memory allocated from the arena.
+void stArena_destruct(stArena *arena);
+
+// Returns memory from the arena, aligned to 16 bytes. It can only be
+// freed by destructing the arena.
+void *stArena_malloc(stArena *arena, size_t size);
+
+// As stArena_malloc, but the memory is zeroed.
+void *stArena_calloc(stArena *arena, size_t size);
+
+// Returns the bytes of memory allocated from the arena, including the
+// unused ends of its blocks.
+int64_t stArena_getMemoryUsage(stArena *arena);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // SONLIB_SLAB_H_
@@ -30,6 +30,10 @@ CuSuite* sonLib_stMatrixTestSuite(void);
 CuSuite* sonLib_stPhylogenyTestSuite(void);
 CuSuite* sonLib_stThreadPoolTestSuite(void);
 CuSuite* sonLib_stUnionFindTestSuite(void);
+CuSuite* sonLib_fastaTestSuite(void);
+CuSuite* sonLib_stSeqReaderTestSuite(void);
+CuSuite* sonLib_stPackedSeqTestSuite(void);
+CuSuite* sonLib_stSlabTestSuite(void);
 
 int sonLibRunAllTests(void) {
     CuString *output = CuStringNew();
@@ -58,6 +62,10 @@ int sonLibRunAllTests(void) {
     CuSuiteAddSuite(suite, sonLibFileTestSuite());
     CuSuiteAddSuite(suite, stCacheSuite());
     CuSuiteAddSuite(suite, sonLib_stUnionFindTestSuite());
+    CuSuiteAddSuite(suite, sonLib_fastaTestSuite());
+    CuSuiteAddSuite(suite, sonLib_stSeqReaderTestSuite());
+    CuSuiteAddSuite(suite, sonLib_stPackedSeqTestSuite());
+    CuSuiteAddSuite(suite, sonLib_stSlabTestSuite());
     CuSuiteRun(suite);
     CuSuiteSummary(suite, output);
     CuSuiteDetails(suite, output);
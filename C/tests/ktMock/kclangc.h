@@ -0,0 +1,10 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * Empty stand-in for the Kyoto Cabinet C API header, which the Kyoto Tycoon backend includes
+ * but does not use. See ktremotedb.h.
+ */
@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * ktremotedb.h
+ *
+ * An in memory stand-in for the parts of the Kyoto Tycoon client used by
+ * sonLibKVDatabase_KyotoTycoon.cpp, so that the backend can be tested without a
+ * ktserver. All connections share one map, as they would share one server.
+ * Bulk sets take longer the earlier they are sent, so batches sent together
+ * finish in the reverse of the order they were sent in.
+ */
+
+#ifndef KT_MOCK_REMOTEDB_H_
+#define KT_MOCK_REMOTEDB_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace kyotocabinet {
+
+const int64_t INT64MAX = INT64_MAX;
+const int64_t INT64MIN = INT64_MIN;
+
+inline uint64_t hton64(uint64_t num) {
+    uint64_t ret;
+    unsigned char *bytes = (unsigned char *) &ret;
+    for (int i = 7; i >= 0; i--) {
+        bytes[i] = (unsigned char) (num & 0xff);
+        num >>= 8;
+    }
+    return ret;
+}
+
+inline uint64_t ntoh64(uint64_t num) {
+    const unsigned char *bytes = (const unsigned char *) &num;
+    uint64_t ret = 0;
+    for (int i = 0; i < 8; i++) {
+        ret = (ret << 8) | bytes[i];
+    }
+    return ret;
+}
+
+}
+
+namespace kc = kyotocabinet;
+
+namespace kyototycoon {
+
+typedef std::map<std::string, std::string> MockRecords;
+
+struct MockServer {
+    MockRecords records;
+    pthread_mutex_t lock;
+    int64_t bulkSets;
+};
+
+inline MockServer &mockServer() {
+    static MockServer server = { MockRecords(), PTHREAD_MUTEX_INITIALIZER, 0 };
+    return server;
+}
+
+class MockLock {
+public:
+    MockLock() {
+        pthread_mutex_lock(&mockServer().lock);
+    }
+    ~MockLock() {
+        pthread_mutex_unlock(&mockServer().lock);
+    }
+};
+
+class RemoteDB {
+public:
+    struct Error {
+        const char *name() const {
+            return "mock error";
+        }
+    };
+
+    struct BulkRecord {
+        uint32_t dbidx;
+        std::string key;
+        std::string value;
+        int64_t xt;
+    };
+
+    bool open(const std::string &host, int32_t port, double timeout) {
+        return true;
+    }
+
+    bool close(bool grace = true) {
+        return true;
+    }
+
+    Error error() const {
+        return Error();
+    }
+
+    char *get(const char *kbuf, size_t ksiz, size_t *sp, int64_t *xtp) {
+        MockLock lock;
+        MockRecords::iterator it = mockServer().records.find(std::string(kbuf, ksiz));
+        if (it == mockServer().records.end()) {
+            *sp = 0;
+            return NULL;
+        }
+        char *value = new char[it->second.size() + 1];
+        memcpy(value, it->second.data(), it->second.size());
+        value[it->second.size()] = '\0';
+        *sp = it->second.size();
+        return value;
+    }
+
+    bool add(const char *kbuf, size_t ksiz, const char *vbuf, size_t vsiz, int64_t xt = INT64_MAX) {
+        MockLock lock;
+        std::string key(kbuf, ksiz);
+        if (mockServer().records.count(key) > 0) {
+            return false;
+        }
+        mockServer().records[key] = std::string(vbuf, vsiz);
+        return true;
+    }
+
+    bool replace(const char *kbuf, size_t ksiz, const char *vbuf, size_t vsiz, int64_t xt = INT64_MAX) {
+        MockLock lock;
+        std::string key(kbuf, ksiz);
+        if (mockServer().records.count(key) == 0) {
+            return false;
+        }
+        mockServer().records[key] = std::string(vbuf, vsiz);
+        return true;
+    }
+
+    bool set(const char *kbuf, size_t ksiz, const char *vbuf, size_t vsiz, int64_t xt = INT64_MAX) {
+        MockLock lock;
+        mockServer().records[std::string(kbuf, ksiz)] = std::string(vbuf, vsiz);
+        return true;
+    }
+
+    bool remove(const char *kbuf, size_t ksiz) {
+        MockLock lock;
+        return mockServer().records.erase(std::string(kbuf, ksiz)) > 0;
+    }
+
+    int64_t increment(const char *kbuf, size_t ksiz, int64_t num, int64_t orig = 0, int64_t xt = INT64_MAX) {
+        MockLock lock;
+        std::string &value = mockServer().records[std::string(kbuf, ksiz)];
+        int64_t current = 0;
+        if (value.size() == sizeof(int64_t)) {
+            uint64_t networkOrder;
+            memcpy(&networkOrder, value.data(), sizeof(int64_t));
+            current = (int64_t) kc::ntoh64(networkOrder);
+        }
+        current += num;
+        uint64_t networkOrder = kc::hton64((uint64_t) current);
+        value.assign((const char *) &networkOrder, sizeof(int64_t));
+        return current;
+    }
+
+    int64_t set_bulk_binary(const std::vector<BulkRecord> &recs, bool atomic = true) {
+        int64_t delay;
+        {
+            MockLock lock;
+            delay = 4 - mockServer().bulkSets++ % 4;
+        }
+        usleep(1000 * delay);
+        MockLock lock;
+        for (size_t i = 0; i < recs.size(); i++) {
+            mockServer().records[recs[i].key] = recs[i].value;
+        }
+        return recs.size();
+    }
+
+    int64_t get_bulk_binary(std::vector<BulkRecord> *recs, bool atomic = true) {
+        MockLock lock;
+        for (size_t i = 0; i < recs->size(); i++) {
+            BulkRecord &rec = (*recs)[i];
+            MockRecords::iterator it = mockServer().records.find(rec.key);
+            if (it == mockServer().records.end()) {
+                rec.value.clear();
+                rec.xt = -1;
+            } else {
+                rec.value = it->second;
+                rec.xt = INT64_MAX;
+            }
+        }
+        return recs->size();
+    }
+
+    int64_t get_bulk(const std::vector<std::string> &keys, std::map<std::string, std::string> *recs,
+            bool atomic = true) {
+        MockLock lock;
+        for (size_t i = 0; i < keys.size(); i++) {
+            MockRecords::iterator it = mockServer().records.find(keys[i]);
+            if (it != mockServer().records.end()) {
+                (*recs)[keys[i]] = it->second;
+            }
+        }
+        return recs->size();
+    }
+
+    int64_t remove_bulk(const std::vector<std::string> &keys, bool atomic = true) {
+        MockLock lock;
+        int64_t numRemoved = 0;
+        for (size_t i = 0; i < keys.size(); i++) {
+            numRemoved += mockServer().records.erase(keys[i]);
+        }
+        return numRemoved;
+    }
+
+    int64_t count() {
+        MockLock lock;
+        return mockServer().records.size();
+    }
+
+    bool clear() {
+        MockLock lock;
+        mockServer().records.clear();
+        return true;
+    }
+};
+
+}
+
+#endif
@@ -11,6 +11,7 @@
 
 #include "sonLibGlobalsTest.h"
 #include "kvDatabaseTestCommon.h"
+#include <sys/time.h>
 
 static stKVDatabaseConf *conf = NULL;
 static stKVDatabase *database = NULL;
@@ -280,6 +281,147 @@ static void testBulkSetRecords(CuTest *testCase) {
     teardown();
 }
 
+/*
+ * Tests a bulk set of more records than fit in a single batch, of mixed sizes, overwriting some.
+ */
+static void testBulkSetManyRecords(CuTest *testCase) {
+    setup();
+    int64_t numRecords = 5000;
+    char **values = st_malloc(sizeof(char *) * numRecords);
+    int64_t *sizes = st_malloc(sizeof(int64_t) * numRecords);
+    for (int64_t round = 0; round < 2; round++) {
+        stList *requests = stList_construct3(0, (void(*)(void *)) stKVDatabaseBulkRequest_destruct);
+        for (int64_t i = round * numRecords / 2; i < numRecords; i++) {
+            if (round > 0) {
+                free(values[i]);
+            }
+            sizes[i] = st_randomInt(1, i % 100 == 0 ? 100000 : 1000);
+            values[i] = st_malloc(sizes[i]);
+            for (int64_t j = 0; j < sizes[i]; j++) {
+                values[i][j] = (char) st_randomInt(0, 100);
+            }
+            stList_append(requests, stKVDatabaseBulkRequest_constructSetRequest(i, values[i], sizes[i]));
+        }
+        stKVDatabase_bulkSetRecords(database, requests);
+        stList_destruct(requests);
+    }
+    CuAssertIntEquals(testCase, numRecords, stKVDatabase_getNumberOfRecords(database));
+    for (int64_t i = 0; i < numRecords; i++) {
+        int64_t size;
+        char *record = stKVDatabase_getRecord2(database, i, &size);
+        CuAssertTrue(testCase, record != NULL && size == sizes[i] && memcmp(record, values[i], size) == 0);
+        free(record);
+    }
+    for (int64_t i = 0; i < numRecords; i++) {
+        free(values[i]);
+    }
+    free(values);
+    free(sizes);
+    teardown();
+}
+
+/*
+ * Tests a bulk set that writes each key several times, across batches, and with records both
+ * small and too big for a batch, checking the last write of each key wins.
+ */
+static void testBulkSetDuplicateKeys(CuTest *testCase) {
+    setup();
+    int64_t numKeys = 100, numWrites = 8;
+    char **values = st_calloc(numKeys, sizeof(char *));
+    int64_t *sizes = st_malloc(sizeof(int64_t) * numKeys);
+    stList *requests = stList_construct3(0, (void(*)(void *)) stKVDatabaseBulkRequest_destruct);
+    for (int64_t write = 0; write < numWrites; write++) {
+        for (int64_t key = 0; key < numKeys; key++) {
+            free(values[key]);
+            // Alternate some keys between records that fit in a batch and ones that don't.
+            sizes[key] = key % 10 == write % 2 ? st_randomInt(60000, 100000) : st_randomInt(1, 1000);
+            values[key] = st_malloc(sizes[key]);
+            for (int64_t j = 0; j < sizes[key]; j++) {
+                values[key][j] = (char) st_randomInt(0, 100);
+            }
+            stList_append(requests, stKVDatabaseBulkRequest_constructSetRequest(key, values[key], sizes[key]));
+        }
+    }
+    stKVDatabase_bulkSetRecords(database, requests);
+    stList_destruct(requests);
+    CuAssertIntEquals(testCase, numKeys, stKVDatabase_getNumberOfRecords(database));
+    for (int64_t key = 0; key < numKeys; key++) {
+        int64_t size;
+        char *record = stKVDatabase_getRecord2(database, key, &size);
+        CuAssertTrue(testCase, record != NULL && size == sizes[key] && memcmp(record, values[key], size) == 0);
+        free(record);
+        free(values[key]);
+    }
+    free(values);
+    free(sizes);
+    teardown();
+}
+
+static void checkBulkSetThrows(CuTest *testCase, stList *requests) {
+    stTry {
+        stKVDatabase_bulkSetRecords(database, requests);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_KV_DATABASE_EXCEPTION_ID));
+    } stTryEnd;
+    stList_destruct(requests);
+}
+
+/*
+ * Tests that the requests of a bulk set or remove are each checked as if those before them
+ * had been made, and that none are made if any fails. Only the log structured database checks
+ * its bulk requests before making them.
+ */
+static void testBulkRequestsAllOrNothing(CuTest *testCase) {
+    if (stKVDatabaseConf_getType(conf) != stKVDatabaseTypeLogStructured) {
+        return;
+    }
+    setup();
+    int64_t i = 100, j = 110;
+    stKVDatabase_insertRecord(database, 1, &i, sizeof(int64_t));
+
+    //A key inserted twice
+    stList *requests = stList_construct3(0, (void(*)(void *)) stKVDatabaseBulkRequest_destruct);
+    stList_append(requests, stKVDatabaseBulkRequest_constructInsertRequest(2, &i, sizeof(int64_t)));
+    stList_append(requests, stKVDatabaseBulkRequest_constructInsertRequest(2, &j, sizeof(int64_t)));
+    checkBulkSetThrows(testCase, requests);
+    CuAssertTrue(testCase, !stKVDatabase_containsRecord(database, 2));
+
+    //A failing request after a set
+    requests = stList_construct3(0, (void(*)(void *)) stKVDatabaseBulkRequest_destruct);
+    stList_append(requests, stKVDatabaseBulkRequest_constructSetRequest(3, &i, sizeof(int64_t)));
+    stList_append(requests, stKVDatabaseBulkRequest_constructInsertRequest(1, &j, sizeof(int64_t)));
+    checkBulkSetThrows(testCase, requests);
+    CuAssertTrue(testCase, !stKVDatabase_containsRecord(database, 3));
+
+    //An update of a key inserted earlier in the same set
+    requests = stList_construct3(0, (void(*)(void *)) stKVDatabaseBulkRequest_destruct);
+    stList_append(requests, stKVDatabaseBulkRequest_constructInsertRequest(4, &i, sizeof(int64_t)));
+    stList_append(requests, stKVDatabaseBulkRequest_constructUpdateRequest(4, &j, sizeof(int64_t)));
+    stKVDatabase_bulkSetRecords(database, requests);
+    stList_destruct(requests);
+    int64_t *record = stKVDatabase_getRecord(database, 4);
+    CuAssertIntEquals(testCase, j, *record);
+    free(record);
+
+    //A key removed twice
+    requests = stList_construct3(0, (void(*)(void *)) stIntTuple_destruct);
+    stList_append(requests, stIntTuple_construct1(4));
+    stList_append(requests, stIntTuple_construct1(1));
+    stList_append(requests, stIntTuple_construct1(1));
+    stTry {
+        stKVDatabase_bulkRemoveRecords(database, requests);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_KV_DATABASE_EXCEPTION_ID));
+    } stTryEnd;
+    stList_destruct(requests);
+    CuAssertTrue(testCase, stKVDatabase_containsRecord(database, 1));
+    CuAssertTrue(testCase, stKVDatabase_containsRecord(database, 4));
+    CuAssertIntEquals(testCase, 2, stKVDatabase_getNumberOfRecords(database));
+    teardown();
+}
+
 static void testBulkGetRecords(CuTest* testCase) {
 	/*
 	 * Tests the new bulk get functions
@@ -344,6 +486,17 @@ static void testBulkGetRecords(CuTest* testCase) {
 
     stList_destruct(results);
 
+    //Missing records have no record, rather than an empty one
+    int64_t kMissing = 7;
+    stList_set(keys, 4, &kMissing);
+    results = stKVDatabase_bulkGetRecords(database, keys);
+    CuAssertTrue(testCase, stList_length(results) == 5);
+    record = stKVDatabaseBulkResult_getRecord(stList_get(results, 4), &size);
+    CuAssertPtrEquals(testCase, NULL, record);
+    record = stKVDatabaseBulkResult_getRecord(stList_get(results, 3), &size);
+    CuAssertTrue(testCase, record != NULL && *(int64_t*)record == l && size == sizeof(int64_t));
+    stList_destruct(results);
+
     results = stKVDatabase_bulkGetRecordsRange(database, 1, 6);
     CuAssertTrue(testCase, stList_length(results) == 6);
 
@@ -450,6 +603,309 @@ static void bigRecordRetrieval(CuTest *testCase) {
     teardown();
 }
 
+/*
+ * Tests views of small and big records, which must be unchanged by later updates and removals.
+ */
+static void testRecordView(CuTest *testCase) {
+    setup();
+    CuAssertPtrEquals(testCase, NULL, stKVDatabase_getRecordView(database, 1));
+
+    stKVDatabase_insertRecord(database, 1, "Red", sizeof(char) * 4);
+    int64_t bigSize = 1000000;
+    char *bigRecord = st_malloc(bigSize);
+    for (int64_t i = 0; i < bigSize; i++) {
+        bigRecord[i] = (char) st_randomInt(0, 100);
+    }
+    stKVDatabase_insertRecord(database, 2, bigRecord, bigSize);
+
+    stKVDatabaseRecordView *view = stKVDatabase_getRecordView(database, 1);
+    int64_t size;
+    const char *record = stKVDatabaseRecordView_getRecord(view, &size);
+    CuAssertIntEquals(testCase, 4, size);
+    CuAssertStrEquals(testCase, "Red", record);
+    stKVDatabaseRecordView *bigView = stKVDatabase_getRecordView(database, 2);
+    CuAssertTrue(testCase, memcmp(stKVDatabaseRecordView_getRecord(bigView, &size), bigRecord, bigSize) == 0);
+    CuAssertIntEquals(testCase, bigSize, size);
+    stKVDatabaseRecordView *partialView = stKVDatabase_getPartialRecordView(database, 2, 12345, 500000, bigSize);
+    CuAssertTrue(testCase, memcmp(stKVDatabaseRecordView_getRecord(partialView, &size), bigRecord + 12345, 500000) == 0);
+    CuAssertIntEquals(testCase, 500000, size);
+
+    stKVDatabase_updateRecord(database, 1, "Blue", sizeof(char) * 5);
+    char *originalBigRecord = memcpy(st_malloc(bigSize), bigRecord, bigSize);
+    memset(bigRecord, 'a', bigSize);
+    stKVDatabase_updateRecord(database, 2, bigRecord, bigSize / 2);
+    CuAssertStrEquals(testCase, "Red", stKVDatabaseRecordView_getRecord(view, &size));
+    stKVDatabaseRecordView_destruct(view);
+    view = stKVDatabase_getRecordView(database, 2);
+    CuAssertTrue(testCase, memcmp(stKVDatabaseRecordView_getRecord(view, &size), bigRecord, bigSize / 2) == 0);
+    CuAssertIntEquals(testCase, bigSize / 2, size);
+    stKVDatabaseRecordView_destruct(view);
+
+    stKVDatabase_removeRecord(database, 2);
+    CuAssertPtrEquals(testCase, NULL, stKVDatabase_getRecordView(database, 2));
+    record = stKVDatabaseRecordView_getRecord(bigView, &size);
+    CuAssertIntEquals(testCase, bigSize, size);
+    CuAssertTrue(testCase, memcmp(record, originalBigRecord, bigSize) == 0);
+    record = stKVDatabaseRecordView_getRecord(partialView, &size);
+    CuAssertIntEquals(testCase, 500000, size);
+    CuAssertTrue(testCase, memcmp(record, originalBigRecord + 12345, 500000) == 0);
+    stKVDatabaseRecordView_destruct(bigView);
+    stKVDatabaseRecordView_destruct(partialView);
+    free(bigRecord);
+    free(originalBigRecord);
+
+    teardown();
+}
+
+/*
+ * Tests a cache in front of the database, checking writes are held back until flushed.
+ */
+static void testCachedDatabase(CuTest *testCase) {
+    setup();
+    stKVDatabase *wrappedDatabase = database;
+    database = stKVDatabase_constructCached(wrappedDatabase, 1000, 100);
+
+    stKVDatabase_insertRecord(database, 1, "Red", sizeof(char) * 4);
+    stKVDatabase_insertRecord(database, 2, "Green", sizeof(char) * 6);
+    stKVDatabase_updateRecord(database, 1, "Blue", sizeof(char) * 5);
+    CuAssertTrue(testCase, stKVDatabase_containsRecord(database, 1));
+    CuAssertTrue(testCase, !stKVDatabase_containsRecord(wrappedDatabase, 1));
+    char *record = stKVDatabase_getRecord(database, 1);
+    CuAssertStrEquals(testCase, "Blue", record);
+    free(record);
+    record = stKVDatabase_getPartialRecord(database, 2, 1, 3, 6);
+    CuAssertTrue(testCase, memcmp(record, "ree", 3) == 0);
+    free(record);
+
+    stKVDatabase_flush(database);
+    CuAssertTrue(testCase, stKVDatabase_containsRecord(wrappedDatabase, 1));
+    record = stKVDatabase_getRecord(wrappedDatabase, 1);
+    CuAssertStrEquals(testCase, "Blue", record);
+    free(record);
+    record = stKVDatabase_getPartialRecord(database, 2, 1, 3, 6);
+    CuAssertTrue(testCase, memcmp(record, "ree", 3) == 0);
+    free(record);
+
+    //Filling the write buffer sends the writes on
+    char bigRecord[200];
+    memset(bigRecord, 'a', 200);
+    stKVDatabase_setRecord(database, 3, bigRecord, 200);
+    CuAssertTrue(testCase, stKVDatabase_containsRecord(wrappedDatabase, 3));
+
+    //Removal of written and buffered records
+    stKVDatabase_removeRecord(database, 1);
+    stKVDatabase_insertRecord(database, 4, "Black", sizeof(char) * 6);
+    stKVDatabase_removeRecord(database, 4);
+    CuAssertTrue(testCase, !stKVDatabase_containsRecord(database, 1));
+    CuAssertTrue(testCase, !stKVDatabase_containsRecord(database, 4));
+    CuAssertPtrEquals(testCase, NULL, stKVDatabase_getRecord(database, 1));
+    CuAssertIntEquals(testCase, 2, stKVDatabase_getNumberOfRecords(database));
+
+    //Int64 records are written through, after any buffered write
+    int64_t i = 5;
+    stKVDatabase_setRecord(database, 2, &i, sizeof(int64_t));
+    stKVDatabase_removeRecord(database, 2);
+    stKVDatabase_insertInt64(database, 2, 100);
+    CuAssertTrue(testCase, stKVDatabase_incrementInt64(database, 2, 10) == 110);
+    CuAssertTrue(testCase, stKVDatabase_getInt64(database, 2) == 110);
+    CuAssertTrue(testCase, stKVDatabase_getInt64(wrappedDatabase, 2) == 110);
+
+    stList *results = stKVDatabase_bulkGetRecordsRange(database, 3, 2);
+    int64_t size;
+    record = stKVDatabaseBulkResult_getRecord(stList_get(results, 0), &size);
+    CuAssertTrue(testCase, record != NULL && size == 200 && record[199] == 'a');
+    CuAssertPtrEquals(testCase, NULL, stKVDatabaseBulkResult_getRecord(stList_get(results, 1), &size));
+    stList_destruct(results);
+
+    //Inserting a record that already exists fails at once if its write is buffered or cached
+    stKVDatabase_insertRecord(database, 6, "White", sizeof(char) * 6);
+    stKVDatabase_setRecord(database, 7, "Grey", sizeof(char) * 5);
+    int64_t existingKeys[] = { 3, 6, 7 };
+    for (int64_t j = 0; j < 3; j++) {
+        stTry {
+            stKVDatabase_insertRecord(database, existingKeys[j], "Pink", sizeof(char) * 5);
+            CuAssertTrue(testCase, 0);
+        } stCatch(except) {
+            CuAssertTrue(testCase, stExcept_idEq(except, ST_KV_DATABASE_EXCEPTION_ID));
+        } stTryEnd;
+    }
+    //and when it is flushed if the record is only stored, without losing the other buffered writes
+    stKVDatabase_insertRecord(database, 2, "Pink", sizeof(char) * 5);
+    stTry {
+        stKVDatabase_flush(database);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_KV_DATABASE_EXCEPTION_ID));
+    } stTryEnd;
+    CuAssertTrue(testCase, stKVDatabase_getInt64(database, 2) == 110);
+    record = stKVDatabase_getRecord(wrappedDatabase, 7);
+    CuAssertStrEquals(testCase, "Grey", record);
+    free(record);
+    stKVDatabase_flush(database);
+    stTry {
+        stKVDatabase_insertRecord(database, 6, "Pink", sizeof(char) * 5);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_KV_DATABASE_EXCEPTION_ID));
+    } stTryEnd;
+    record = stKVDatabase_getRecord(database, 6);
+    CuAssertStrEquals(testCase, "White", record);
+    free(record);
+
+    teardown();
+}
+
+/*
+ * Writes a record file as kept by earlier versions of the big record database.
+ */
+static char *writeLegacyBigRecord(const char *name, int64_t key, const char *value) {
+    char *recordPath = stString_print("%s/%s.BIG__RECORD__FILE__%lld", stKVDatabaseConf_getDir(conf), name,
+            (long long) key);
+    FILE *fileHandle = fopen(recordPath, "wb");
+    fwrite(value, sizeof(char), strlen(value) + 1, fileHandle);
+    fclose(fileHandle);
+    return recordPath;
+}
+
+/*
+ * Tests that opening a Kyoto Tycoon database moves in the big records that earlier versions kept
+ * in the database directory, and only those of that database.
+ */
+static void testImportLegacyBigRecords(CuTest *testCase) {
+    if (stKVDatabaseConf_getType(conf) != stKVDatabaseTypeKyotoTycoon) {
+        return;
+    }
+    setup();
+    teardown();
+    const char *name = stKVDatabaseConf_getDatabaseName(conf) != NULL ? stKVDatabaseConf_getDatabaseName(conf) : "db";
+    char *otherName = stString_print("%sOther", name);
+    char *recordPath = writeLegacyBigRecord(name, 5, "Legacy");
+    char *otherRecordPath = writeLegacyBigRecord(otherName, 5, "Other");
+
+    database = stKVDatabase_construct(conf, false);
+    char *record = stKVDatabase_getRecord(database, 5);
+    CuAssertStrEquals(testCase, "Legacy", record);
+    free(record);
+    CuAssertTrue(testCase, !stFile_exists(recordPath));
+    CuAssertTrue(testCase, stFile_exists(otherRecordPath));
+
+    remove(otherRecordPath);
+    free(otherRecordPath);
+    free(recordPath);
+    free(otherName);
+    teardown();
+}
+
+/*
+ * Returns a record of the given size that compresses well.
+ */
+static char *getCompressibleRecord(int64_t size) {
+    char *record = st_malloc(size + 1);
+    for (int64_t i = 0; i < size; i++) {
+        record[i] = st_random() < 0.05 ? "ACGT"[st_randomInt(0, 4)] : "ACGTTGCA"[i % 8];
+    }
+    return record;
+}
+
+/*
+ * Tests each of the compressions, checking that whole, partial and bulk reads of records, including
+ * those of many blocks, give back what was written.
+ */
+static void testCompressedDatabase(CuTest *testCase) {
+    setup();
+    //Int64 records are stored uncompressed, in the wrapped database's own format
+    stKVDatabase_insertInt64(database, 0, 5);
+    int64_t intSize;
+    int64_t *intRecord = stKVDatabase_getRecord2(database, 0, &intSize);
+    int64_t storedInt = *intRecord;
+    free(intRecord);
+    teardown();
+    int64_t sizes[] = { 0, 1, 100, 65535, 65536, 65537, 1000000 };
+    const int64_t numRecords = sizeof(sizes) / sizeof(int64_t);
+    stKVDatabaseCompression compressions[] = { stKVDatabaseCompressionLz4, stKVDatabaseCompressionLz4hc,
+            stKVDatabaseCompressionZlib };
+    for (int64_t i = 0; i < 3; i++) {
+        stKVDatabaseConf *compressedConf = stKVDatabaseConf_constructClone(conf);
+        stKVDatabaseConf_setCompression(compressedConf, compressions[i]);
+        database = stKVDatabase_construct(compressedConf, true);
+        char *records[sizeof(sizes) / sizeof(int64_t)];
+        stList *requests = stList_construct3(0, (void (*)(void *)) stKVDatabaseBulkRequest_destruct);
+        for (int64_t j = 0; j < numRecords; j++) {
+            records[j] = getCompressibleRecord(sizes[j]);
+            if (j % 2 == 0) {
+                stKVDatabase_insertRecord(database, j, records[j], sizes[j]);
+            } else {
+                stList_append(requests, stKVDatabaseBulkRequest_constructInsertRequest(j, records[j], sizes[j]));
+            }
+        }
+        stKVDatabase_bulkSetRecords(database, requests);
+        stList_destruct(requests);
+        stKVDatabase_insertInt64(database, numRecords, 5);
+        CuAssertTrue(testCase, stKVDatabase_getCompressionRatio(database) < 0.5);
+
+        for (int64_t reopen = 0; reopen < 2; reopen++) {
+            CuAssertIntEquals(testCase, numRecords + 1, stKVDatabase_getNumberOfRecords(database));
+            for (int64_t j = 0; j < numRecords; j++) {
+                int64_t size;
+                char *record = stKVDatabase_getRecord2(database, j, &size);
+                CuAssertIntEquals(testCase, sizes[j], size);
+                CuAssertTrue(testCase, memcmp(record, records[j], size) == 0);
+                free(record);
+                for (int64_t k = 0; k < 10 && sizes[j] > 0; k++) {
+                    int64_t start = st_randomInt(0, sizes[j]);
+                    int64_t length = st_randomInt(0, sizes[j] - start + 1);
+                    record = stKVDatabase_getPartialRecord(database, j, start, length, sizes[j]);
+                    CuAssertTrue(testCase, memcmp(record, records[j] + start, length) == 0);
+                    free(record);
+                }
+            }
+            stList *results = stKVDatabase_bulkGetRecordsRange(database, 0, numRecords + 1);
+            for (int64_t j = 0; j < numRecords; j++) {
+                int64_t size;
+                char *record = stKVDatabaseBulkResult_getRecord(stList_get(results, j), &size);
+                CuAssertIntEquals(testCase, sizes[j], size);
+                CuAssertTrue(testCase, memcmp(record, records[j], size) == 0);
+            }
+            //Int64 records are read back as they are
+            intRecord = stKVDatabaseBulkResult_getRecord(stList_get(results, numRecords), &intSize);
+            CuAssertIntEquals(testCase, sizeof(int64_t), intSize);
+            CuAssertTrue(testCase, *intRecord == storedInt);
+            stList_destruct(results);
+            intRecord = stKVDatabase_getRecord2(database, numRecords, &intSize);
+            CuAssertIntEquals(testCase, sizeof(int64_t), intSize);
+            CuAssertTrue(testCase, *intRecord == storedInt);
+            free(intRecord);
+            CuAssertIntEquals(testCase, 5, stKVDatabase_getInt64(database, numRecords));
+            stKVDatabase_destruct(database);
+            database = stKVDatabase_construct(compressedConf, false);
+        }
+
+        //Updates and removals
+        stKVDatabase_updateRecord(database, 2, records[6], sizes[6]);
+        stKVDatabase_setRecord(database, 6, "Red", 4);
+        stKVDatabase_removeRecord(database, 5);
+        char *record = stKVDatabase_getRecord(database, 6);
+        CuAssertStrEquals(testCase, "Red", record);
+        free(record);
+        record = stKVDatabase_getPartialRecord(database, 2, 65530, 10, sizes[6]);
+        CuAssertTrue(testCase, memcmp(record, records[6] + 65530, 10) == 0);
+        free(record);
+        CuAssertTrue(testCase, !stKVDatabase_containsRecord(database, 5));
+        stTry {
+            stKVDatabase_getPartialRecord(database, 2, 0, 10, sizes[6] + 1);
+            CuAssertTrue(testCase, 0);
+        } stCatch(except) {
+            CuAssertTrue(testCase, stExcept_idEq(except, ST_KV_DATABASE_EXCEPTION_ID));
+        } stTryEnd;
+
+        for (int64_t j = 0; j < numRecords; j++) {
+            free(records[j]);
+        }
+        teardown();
+        stKVDatabaseConf_destruct(compressedConf);
+    }
+}
+
 /* Check that all tuple records in a set are present and have the expect
  * value.  The expected value in the set is multiplied by valueMult to get
  * the actual expected value */
@@ -542,6 +998,89 @@ static void readWriteAndRemoveRecordsLots(CuTest *testCase) {
     teardown();
 }
 
+static void checkRewrittenRecords(CuTest *testCase, int64_t numRecords, int64_t recordSize, int64_t version) {
+    CuAssertIntEquals(testCase, numRecords / 2, stKVDatabase_getNumberOfRecords(database));
+    for (int64_t key = 0; key < numRecords; key++) {
+        int64_t size;
+        char *record = stKVDatabase_getRecord2(database, key, &size);
+        if (key % 2 == 1) {
+            CuAssertPtrEquals(testCase, NULL, record);
+            continue;
+        }
+        CuAssertTrue(testCase, record != NULL);
+        CuAssertIntEquals(testCase, recordSize, size);
+        for (int64_t j = 0; j < size; j += 997) {
+            CuAssertIntEquals(testCase, (char) (key + version + j), record[j]);
+        }
+        free(record);
+    }
+}
+
+/*
+ * Rewrites the same records many times over, so that databases that keep superseded values
+ * around (such as the log structured database) must reclaim the space, then reopens the database.
+ */
+static void rewriteRecordsAndReopen(CuTest *testCase) {
+    setup();
+    int64_t numRecords = 64, recordSize = 1 << 16, numVersions = 8;
+    char *record = st_malloc(recordSize);
+    for (int64_t version = 0; version < numVersions; version++) {
+        for (int64_t key = 0; key < numRecords; key++) {
+            for (int64_t j = 0; j < recordSize; j++) {
+                record[j] = (char) (key + version + j);
+            }
+            stKVDatabase_setRecord(database, key, record, recordSize);
+        }
+    }
+    for (int64_t key = 1; key < numRecords; key += 2) {
+        stKVDatabase_removeRecord(database, key);
+    }
+    checkRewrittenRecords(testCase, numRecords, recordSize, numVersions - 1);
+    stKVDatabase_destruct(database);
+    database = stKVDatabase_construct(conf, false);
+    checkRewrittenRecords(testCase, numRecords, recordSize, numVersions - 1);
+    free(record);
+    teardown();
+}
+
+static double wallTime(void) {
+    struct timeval time;
+    gettimeofday(&time, NULL);
+    return time.tv_sec + time.tv_usec * 1e-6;
+}
+
+/*
+ * Reports the rate of small record writes and reads, to compare databases.
+ */
+static void recordThroughput(CuTest *testCase) {
+    setup();
+    int64_t numRecords = 100000, recordSize = 100, batchSize = 1000;
+    char record[100];
+    memset(record, 'x', recordSize);
+    double startTime = wallTime();
+    for (int64_t key = 0; key < numRecords; key++) {
+        stKVDatabase_insertRecord(database, key, record, recordSize);
+    }
+    double insertTime = wallTime();
+    for (int64_t i = 0; i < numRecords; i++) {
+        int64_t size;
+        char *value = stKVDatabase_getRecord2(database, st_randomInt64(0, numRecords), &size);
+        CuAssertIntEquals(testCase, recordSize, size);
+        free(value);
+    }
+    double getTime = wallTime();
+    for (int64_t key = 0; key < numRecords; key += batchSize) {
+        stList *results = stKVDatabase_bulkGetRecordsRange(database, key, batchSize);
+        CuAssertIntEquals(testCase, batchSize, stList_length(results));
+        stList_destruct(results);
+    }
+    double bulkGetTime = wallTime();
+    st_logInfo("%" PRIi64 " records of %" PRIi64 " bytes: %.0f inserts/s, %.0f random gets/s, "
+            "%.0f records/s by bulk get range\n", numRecords, recordSize, numRecords / (insertTime - startTime),
+            numRecords / (getTime - insertTime), numRecords / (bulkGetTime - getTime));
+    teardown();
+}
+
 static void test_stKVDatabaseConf_constructFromString_tokyoCabinet(CuTest *testCase) {
     const char *xmlTestString =
             "<st_kv_database_conf type='tokyo_cabinet'><tokyo_cabinet database_dir='foo'/></st_kv_database_conf>";
@@ -550,6 +1089,33 @@ static void test_stKVDatabaseConf_constructFromString_tokyoCabinet(CuTest *testC
     CuAssertStrEquals(testCase, "foo", stKVDatabaseConf_getDir(conf));
 }
 
+static void test_stKVDatabaseConf_constructFromString_logStructured(CuTest *testCase) {
+    const char *xmlTestString =
+            "<st_kv_database_conf type='log_structured'><log_structured database_dir='foo'/></st_kv_database_conf>";
+    stKVDatabaseConf *conf = stKVDatabaseConf_constructFromString(xmlTestString);
+    CuAssertTrue(testCase, stKVDatabaseConf_getType(conf) == stKVDatabaseTypeLogStructured);
+    CuAssertStrEquals(testCase, "foo", stKVDatabaseConf_getDir(conf));
+    stKVDatabaseConf_destruct(conf);
+}
+
+static void test_stKVDatabaseConf_constructFromString_compression(CuTest *testCase) {
+    const char *xmlTestString =
+            "<st_kv_database_conf type='log_structured'><log_structured database_dir='foo' compression='lz4hc'/></st_kv_database_conf>";
+    stKVDatabaseConf *conf = stKVDatabaseConf_constructFromString(xmlTestString);
+    CuAssertTrue(testCase, stKVDatabaseConf_getCompression(conf) == stKVDatabaseCompressionLz4hc);
+    stKVDatabaseConf *conf2 = stKVDatabaseConf_constructClone(conf);
+    CuAssertTrue(testCase, stKVDatabaseConf_getCompression(conf2) == stKVDatabaseCompressionLz4hc);
+    stKVDatabaseConf_destruct(conf2);
+    stKVDatabaseConf_destruct(conf);
+    stTry {
+        stKVDatabaseConf_constructFromString(
+                "<st_kv_database_conf type='log_structured'><log_structured database_dir='foo' compression='lzma'/></st_kv_database_conf>");
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_KV_DATABASE_EXCEPTION_ID));
+    } stTryEnd;
+}
+
 static void test_stKVDatabaseConf_constructFromString_mysql(CuTest *testCase) {
 #ifdef HAVE_MYSQL
     const char *xmlTestString =
@@ -572,15 +1138,26 @@ static CuSuite* stKVDatabaseTestSuite(void) {
     SUITE_ADD_TEST(suite, readWriteAndRemoveRecords);
     SUITE_ADD_TEST(suite, readWriteAndUpdateIntRecords);
     SUITE_ADD_TEST(suite, readWriteAndRemoveRecordsLots);
+    SUITE_ADD_TEST(suite, rewriteRecordsAndReopen);
     SUITE_ADD_TEST(suite, partialRecordRetrieval);
     SUITE_ADD_TEST(suite, bigRecordRetrieval);
+    SUITE_ADD_TEST(suite, testRecordView);
     SUITE_ADD_TEST(suite, testIncrementRecord);
     SUITE_ADD_TEST(suite, testSetRecord);
     SUITE_ADD_TEST(suite, testBulkRemoveRecords);
     SUITE_ADD_TEST(suite, testBulkSetRecords);
+    SUITE_ADD_TEST(suite, testBulkSetManyRecords);
+    SUITE_ADD_TEST(suite, testBulkSetDuplicateKeys);
+    SUITE_ADD_TEST(suite, testBulkRequestsAllOrNothing);
     SUITE_ADD_TEST(suite, testBulkGetRecords);
+    SUITE_ADD_TEST(suite, testCachedDatabase);
+    SUITE_ADD_TEST(suite, testImportLegacyBigRecords);
+    SUITE_ADD_TEST(suite, testCompressedDatabase);
     SUITE_ADD_TEST(suite, constructDestructAndDelete);
+    SUITE_ADD_TEST(suite, recordThroughput);
     SUITE_ADD_TEST(suite, test_stKVDatabaseConf_constructFromString_tokyoCabinet);
+    SUITE_ADD_TEST(suite, test_stKVDatabaseConf_constructFromString_logStructured);
+    SUITE_ADD_TEST(suite, test_stKVDatabaseConf_constructFromString_compression);
     SUITE_ADD_TEST(suite, test_stKVDatabaseConf_constructFromString_mysql);
     return suite;
 }
@@ -17,15 +17,17 @@ static void usage(const char *desc) {
     static const char *help = 
         "Options:\n"
         "\n"
-        "-t --type=dbtype - one of 'KyotoTycoon', 'TokyoCabinet' or 'MySql'.\n"
+        "-t --type=dbtype - one of 'KyotoTycoon', 'TokyoCabinet', 'LogStructured' or 'MySql'.\n"
         "    Values area case-insensitive, defaults to TokyoCabinet.\n"
-        "-d --db=database - database directory for TokyoCabinet or database name\n"
+        "-d --db=database - database directory for TokyoCabinet or LogStructured or database name\n"
         "    for SQL databases. Defaults to testTCDatabase for TokyoCabinet,\n"
         "    SQL databases must specify.\n"
         "--host=host - Tycoon or SQL database host, defaults to localhost\n"
         "--port=port - Tycoon or SQL database port.\n"
         "-u, --user=user - SQL database user.\n"
         "-p, --pass=pass - SQL database password.\n"
+        "-c, --compression=compression - one of 'none', 'lz4', 'lz4hc' or 'zlib', the compression\n"
+        "    of the records, defaults to none.\n"
         "-h, --help - print this message.\n";
     fprintf(stderr, "%s\n%s\n", desc, help);
     exit(1);
@@ -38,12 +40,29 @@ static stKVDatabaseType parseDbType(const char *dbTypeStr) {
         return stKVDatabaseTypeKyotoTycoon;
     } else if (stString_eqcase(dbTypeStr, "MySql")) {
         return stKVDatabaseTypeMySql;
+    } else if (stString_eqcase(dbTypeStr, "LogStructured")) {
+        return stKVDatabaseTypeLogStructured;
     } else {
         fprintf(stderr, "Error: invalid value for --type: %s\n", dbTypeStr);
         exit(1);
     }
 }
 
+static stKVDatabaseCompression parseCompression(const char *compressionStr) {
+    if (stString_eqcase(compressionStr, "none")) {
+        return stKVDatabaseCompressionNone;
+    } else if (stString_eqcase(compressionStr, "lz4")) {
+        return stKVDatabaseCompressionLz4;
+    } else if (stString_eqcase(compressionStr, "lz4hc")) {
+        return stKVDatabaseCompressionLz4hc;
+    } else if (stString_eqcase(compressionStr, "zlib")) {
+        return stKVDatabaseCompressionZlib;
+    } else {
+        fprintf(stderr, "Error: invalid value for --compression: %s\n", compressionStr);
+        exit(1);
+    }
+}
+
 /* Parse options for specifying database to tests.  Fill in positional argument vector, setting unused ones to NULL.
  * The positional and numPositionalRet maybe NULL. */
 stKVDatabaseConf *kvDatabaseTestParseOptions(int argc, char *const *argv, const char *desc, int minNumPositional, int maxNumPositional,
@@ -59,6 +78,7 @@ stKVDatabaseConf *kvDatabaseTestParseOptions(int argc, char *const *argv, const
         {"user", required_argument, NULL, 'u'},
         {"pass", required_argument, NULL, 'p'},
         {"name", required_argument, NULL, 'n'},
+        {"compression", required_argument, NULL, 'c'},
         {"help", no_argument,       NULL, 'h'},
         {NULL, 0, NULL, '\0'}
     };
@@ -73,8 +93,9 @@ stKVDatabaseConf *kvDatabaseTestParseOptions(int argc, char *const *argv, const
     const char *optUser = NULL;
     const char *optPass = NULL;
     const char *optName = NULL;
+    stKVDatabaseCompression optCompression = stKVDatabaseCompressionNone;
     int optKey, optIndex;
-    while ((optKey = getopt_long(argc, argv, "t:d:H:P:i:r:b:u:p:h", longOptions, &optIndex)) >= 0) {
+    while ((optKey = getopt_long(argc, argv, "t:d:H:P:i:r:b:u:p:c:h", longOptions, &optIndex)) >= 0) {
         switch (optKey) {
         case 't':
             optType = parseDbType(optarg);
@@ -106,6 +127,9 @@ stKVDatabaseConf *kvDatabaseTestParseOptions(int argc, char *const *argv, const
         case 'n':
         	optName = optarg;
         	break;
+        case 'c':
+            optCompression = parseCompression(optarg);
+            break;
         case 'h':
             usage(desc);
             break;
@@ -135,6 +159,9 @@ stKVDatabaseConf *kvDatabaseTestParseOptions(int argc, char *const *argv, const
     if (optType == stKVDatabaseTypeTokyoCabinet) {
         conf = stKVDatabaseConf_constructTokyoCabinet(optDb);
         fprintf(stderr, "running Tokyo Cabinet sonLibKVDatabase tests\n");
+    } else if (optType == stKVDatabaseTypeLogStructured) {
+        conf = stKVDatabaseConf_constructLogStructured(optDb);
+        fprintf(stderr, "running log structured sonLibKVDatabase tests\n");
     } else if (optType == stKVDatabaseTypeKyotoTycoon) {
         conf = stKVDatabaseConf_constructKyotoTycoon(optHost, optPort, optTimeout,
         		optMaxKTRecordSize, optMaxKTBulkSetSize, optMaxKTBulkSetNumRecords, optDb, optName);
@@ -143,6 +170,7 @@ stKVDatabaseConf *kvDatabaseTestParseOptions(int argc, char *const *argv, const
         conf = stKVDatabaseConf_constructMySql(optHost, 0, optUser, optPass, optDb, "cactusDbTest");
         fprintf(stderr, "running MySQL sonLibKVDatabase tests\n");
     }
+    stKVDatabaseConf_setCompression(conf, optCompression);
     return conf;
 }
 
@@ -135,10 +135,155 @@ static void readAndUpdateRecords(CuTest *testCase) {
     teardown();
 }
 
+static void evictLeastRecentlyUsed(CuTest *testCase) {
+    teardown();
+    cache = stCache_construct2(12);
+    stCache_setRecord(cache, 1, 0, 6, "hello");
+    stCache_setRecord(cache, 2, 0, 6, "world");
+    CuAssertIntEquals(testCase, 12, stCache_getSize(cache));
+    CuAssertIntEquals(testCase, 0, stCache_getEvictions(cache));
+
+    //Using record 1 makes record 2 the least recently used, so it is evicted by the next set.
+    char *s = stCache_getRecord(cache, 1, 0, INT64_MAX, &recordSize);
+    CuAssertStrEquals(testCase, "hello", s);
+    free(s);
+    stCache_setRecord(cache, 3, 0, 6, "cruel");
+    CuAssertTrue(testCase, stCache_containsRecord(cache, 1, 0, 6));
+    CuAssertTrue(testCase, !stCache_containsRecord(cache, 2, 0, 6));
+    CuAssertTrue(testCase, stCache_containsRecord(cache, 3, 0, 6));
+    CuAssertIntEquals(testCase, 12, stCache_getSize(cache));
+    CuAssertIntEquals(testCase, 1, stCache_getEvictions(cache));
+
+    CuAssertTrue(testCase, stCache_getRecord(cache, 2, 0, INT64_MAX, &recordSize) == NULL);
+    CuAssertIntEquals(testCase, 1, stCache_getHits(cache));
+    CuAssertIntEquals(testCase, 1, stCache_getMisses(cache));
+
+    //A record larger than the budget is kept, but only on its own.
+    stCache_setRecord(cache, 4, 0, 14, "goodbye earth");
+    CuAssertTrue(testCase, stCache_containsRecord(cache, 4, 0, 14));
+    CuAssertTrue(testCase, !stCache_containsRecord(cache, 1, 0, 6));
+    CuAssertTrue(testCase, !stCache_containsRecord(cache, 3, 0, 6));
+    CuAssertIntEquals(testCase, 14, stCache_getSize(cache));
+    CuAssertIntEquals(testCase, 3, stCache_getEvictions(cache));
+
+    //Shrinking the budget evicts immediately, growing it allows more to be kept.
+    stCache_setMaxSize(cache, 100);
+    CuAssertIntEquals(testCase, 100, stCache_getMaxSize(cache));
+    stCache_setRecord(cache, 1, 0, 6, "hello");
+    CuAssertIntEquals(testCase, 20, stCache_getSize(cache));
+    stCache_setMaxSize(cache, 10);
+    CuAssertTrue(testCase, stCache_containsRecord(cache, 1, 0, 6));
+    CuAssertTrue(testCase, !stCache_containsRecord(cache, 4, 0, 14));
+    CuAssertIntEquals(testCase, 6, stCache_getSize(cache));
+
+    stCache_clear(cache);
+    CuAssertIntEquals(testCase, 0, stCache_getSize(cache));
+    teardown();
+}
+
+static void randomFragmentsWithEviction(CuTest *testCase) {
+    /*
+     * Sets random fragments of a few records in a small cache, checking that whatever is still cached
+     * matches what was last written and that the cache stays within its budget.
+     */
+    int64_t recordNumber = 5, recordLength = 100;
+    for (int64_t test = 0; test < 100; test++) {
+        teardown();
+        int64_t maxSize = st_randomInt(1, 300);
+        cache = stCache_construct2(maxSize);
+        char *records = st_calloc(recordNumber * recordLength, sizeof(char));
+        for (int64_t i = 0; i < 1000; i++) {
+            int64_t key = st_randomInt(0, recordNumber);
+            int64_t start = st_randomInt(0, recordLength);
+            int64_t size = st_randomInt(0, recordLength - start + 1);
+            char *value = st_malloc(size + 1);
+            for (int64_t j = 0; j < size; j++) {
+                value[j] = (char) st_randomInt('a', 'z' + 1);
+            }
+            memcpy(records + key * recordLength + start, value, size);
+            stCache_setRecord(cache, key, start, size, value);
+            free(value);
+            //Only the most recent fragment is kept if over budget, and it can be no longer than the record.
+            CuAssertTrue(testCase, stCache_getSize(cache) <= (maxSize > recordLength ? maxSize : recordLength));
+
+            key = st_randomInt(0, recordNumber);
+            start = st_randomInt(0, recordLength);
+            char *cached = stCache_getRecord(cache, key, start, INT64_MAX, &recordSize);
+            if (cached != NULL) {
+                CuAssertTrue(testCase, start + recordSize <= recordLength);
+                CuAssertTrue(testCase, memcmp(cached, records + key * recordLength + start, recordSize) == 0);
+                free(cached);
+            }
+        }
+        CuAssertIntEquals(testCase, 1000, stCache_getHits(cache) + stCache_getMisses(cache));
+        free(records);
+    }
+    teardown();
+}
+
+/*
+ * Threads concurrently set and get fragments of a shared set of records. Every writer writes the same
+ * byte at a given position of a record, so whatever is read back can be checked however the writes
+ * were interleaved.
+ */
+static char expectedByte(int64_t key, int64_t position) {
+    return (char) ('a' + (key * 31 + position) % 26);
+}
+
+static void setAndGetFragments(int64_t start, int64_t end, CuTest *testCase) {
+    int64_t recordNumber = 20, recordLength = 200;
+    char *value = st_malloc(recordLength);
+    for (int64_t i = start; i < end; i++) {
+        int64_t key = st_randomInt(0, recordNumber);
+        int64_t offset = st_randomInt(0, recordLength);
+        int64_t size = st_randomInt(0, recordLength - offset + 1);
+        for (int64_t j = 0; j < size; j++) {
+            value[j] = expectedByte(key, offset + j);
+        }
+        stCache_setRecord(cache, key, offset, size, value);
+
+        key = st_randomInt(0, recordNumber);
+        offset = st_randomInt(0, recordLength);
+        int64_t sizeRead;
+        char *cached = stCache_getRecord(cache, key, offset, INT64_MAX, &sizeRead);
+        if (cached != NULL) {
+            for (int64_t j = 0; j < sizeRead; j++) {
+                if (cached[j] != expectedByte(key, offset + j)) {
+                    // CuAssert is not thread safe, so just record the failure.
+                    __atomic_store_n(&recordSize, -1, __ATOMIC_SEQ_CST);
+                }
+            }
+            free(cached);
+        }
+    }
+    free(value);
+}
+
+static void concurrentSetAndGet(CuTest *testCase) {
+    for (int64_t test = 0; test < 10; test++) {
+        teardown();
+        int64_t maxSize = st_random() > 0.5 ? INT64_MAX : st_randomInt(1, 4000);
+        cache = stCache_construct3(maxSize, st_randomInt(1, 16));
+        stThreadPool *threadPool = stThreadPool_construct(st_randomInt(1, 8), NULL, NULL);
+        recordSize = 0;
+        stThreadPool_parallelFor(threadPool, 20000, 100, (void (*)(int64_t, int64_t, void *)) setAndGetFragments, testCase);
+        CuAssertIntEquals(testCase, 0, recordSize);
+        CuAssertIntEquals(testCase, 20000, stCache_getHits(cache) + stCache_getMisses(cache));
+        CuAssertTrue(testCase, maxSize == INT64_MAX || stCache_getSize(cache) <= maxSize + 16 * 200);
+        stCache_clear(cache);
+        CuAssertIntEquals(testCase, 0, stCache_getSize(cache));
+        stThreadPool_destruct(threadPool);
+    }
+    teardown();
+}
+
 CuSuite* stCacheSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, readAndUpdateRecord);
     SUITE_ADD_TEST(suite, readAndUpdateRecords);
+    SUITE_ADD_TEST(suite, evictLeastRecentlyUsed);
+    SUITE_ADD_TEST(suite, randomFragmentsWithEviction);
+    SUITE_ADD_TEST(suite, concurrentSetAndGet);
 
     return suite;
 }
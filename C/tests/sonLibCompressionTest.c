@@ -11,6 +11,7 @@
  *      Author: benedictpaten
  */
 
+#define _POSIX_C_SOURCE 200809L
 #include "sonLibGlobalsTest.h"
 #include <time.h>
 
@@ -78,11 +79,175 @@ static void test_stCompression_compressAndDecompress_Big_Zlib(CuTest *testCase)
     test_stCompression_compressAndDecompressP(testCase, 5, 10000000, 50000000, stCompression_compressZlib, stCompression_decompressZlib);
 }
 
+/*
+ * Returns a string of runs of nearly random and completely random bytes, so that some blocks compress
+ * and some are stored.
+ */
+static char *getFramedTestString(int64_t size) {
+    char *string = st_malloc(size);
+    int64_t i = 0;
+    while (i < size) {
+        int64_t runLength = st_randomInt64(1, 10000000);
+        int64_t alphabetSize = st_random() > 0.3 ? 4 : 256;
+        for (int64_t j = i; j < i + runLength && j < size; j++) {
+            string[j] = (char) st_randomInt(0, alphabetSize);
+        }
+        i += runLength;
+    }
+    return string;
+}
+
+static int64_t getFramedTestLevel(void) {
+    int64_t levels[] = { -1, 0, 1, 4, 9 };
+    return levels[st_randomInt(0, 5)];
+}
+
+/*
+ * Round trips strings from empty to several blocks long through lz4 frames in memory.
+ */
+static void test_stCompression_compressAndDecompressFramed(CuTest *testCase) {
+    for (int64_t i = 0; i < 20; i++) {
+        int64_t size = i < 2 ? i : st_randomInt64(0, i < 10 ? 10000 : 20000000);
+        int64_t level = getFramedTestLevel(), numThreads = st_randomInt(1, 5);
+        char *string = getFramedTestString(size);
+        int64_t compressedSize, size2;
+        void *compressedString = stCompression_compressFramed(string, size, &compressedSize, level, numThreads);
+        char *string2 = stCompression_decompressFramed(compressedString, compressedSize, &size2, st_randomInt(1, 5));
+        CuAssertIntEquals(testCase, size, size2);
+        CuAssertTrue(testCase, memcmp(string, string2, size) == 0);
+        st_logDebug("Compressed %" PRIi64 " bytes to %" PRIi64 " bytes at level %" PRIi64 " on %" PRIi64 " threads\n",
+                size, compressedSize, level, numThreads);
+        free(string);
+        free(string2);
+        free(compressedString);
+    }
+}
+
+/*
+ * Round trips strings through a file, writing and reading in pieces of random sizes, and checks
+ * the frame written can also be decompressed in memory.
+ */
+static void test_stCompression_writerAndReader(CuTest *testCase) {
+    for (int64_t i = 0; i < 10; i++) {
+        int64_t size = st_randomInt64(0, i < 5 ? 10000 : 30000000);
+        char *string = getFramedTestString(size);
+        FILE *file = tmpfile();
+        stCompressionWriter *writer = stCompressionWriter_construct(file, getFramedTestLevel(), st_randomInt(1, 5));
+        for (int64_t j = 0; j < size;) {
+            int64_t length = st_randomInt64(0, size - j + 1);
+            stCompressionWriter_write(writer, string + j, length);
+            j += length;
+        }
+        stCompressionWriter_destruct(writer);
+
+        rewind(file);
+        stCompressionReader *reader = stCompressionReader_construct(file, st_randomInt(1, 5));
+        char *string2 = st_malloc(size + 1);
+        int64_t size2 = 0, length;
+        do {
+            length = stCompressionReader_read(reader, string2 + size2, st_randomInt64(1, size - size2 + 2));
+            size2 += length;
+        } while (length > 0);
+        stCompressionReader_destruct(reader);
+        CuAssertIntEquals(testCase, size, size2);
+        CuAssertTrue(testCase, memcmp(string, string2, size) == 0);
+        free(string2);
+
+        int64_t compressedSize = ftell(file);
+        char *compressedString = st_malloc(compressedSize);
+        rewind(file);
+        CuAssertIntEquals(testCase, compressedSize, fread(compressedString, 1, compressedSize, file));
+        string2 = stCompression_decompressFramed(compressedString, compressedSize, &size2, 2);
+        CuAssertIntEquals(testCase, size, size2);
+        CuAssertTrue(testCase, memcmp(string, string2, size) == 0);
+        free(string2);
+        free(compressedString);
+        fclose(file);
+        free(string);
+    }
+}
+
+static void checkDecompressFramedThrows(CuTest *testCase, void *compressedData, int64_t compressedSizeInBytes) {
+    stTry {
+        int64_t size;
+        free(stCompression_decompressFramed(compressedData, compressedSizeInBytes, &size, 2));
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_getId(except) == ST_COMPRESSION_EXCEPTION_ID);
+    } stTryEnd;
+}
+
+/*
+ * Truncated, unframed and corrupted frames are reported, not decompressed.
+ */
+static void test_stCompression_decompressFramedCorrupt(CuTest *testCase) {
+    int64_t size = 10000000, compressedSize;
+    char *string = getFramedTestString(size);
+    for (int64_t i = 0; i < size; i++) {
+        string[i] = (char) st_randomInt(0, 4);
+    }
+    char *compressedString = stCompression_compressFramed(string, size, &compressedSize, -1, 1);
+    checkDecompressFramedThrows(testCase, compressedString, compressedSize - 1);
+    checkDecompressFramedThrows(testCase, compressedString, 10);
+    checkDecompressFramedThrows(testCase, string, size);
+    // Make the first block's stored size too small.
+    compressedString[20]--;
+    checkDecompressFramedThrows(testCase, compressedString, compressedSize);
+    free(compressedString);
+    free(string);
+}
+
+static void checkReadThrows(CuTest *testCase, stCompressionReader *reader, char *string, int64_t size) {
+    stTry {
+        stCompressionReader_read(reader, string, size);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_getId(except) == ST_COMPRESSION_EXCEPTION_ID);
+    } stTryEnd;
+}
+
+/*
+ * A writer whose file fills up is still freed by its destructor, and a reader of a truncated frame
+ * keeps throwing until it is destructed.
+ */
+static void test_stCompression_writerAndReaderErrors(CuTest *testCase) {
+    int64_t size = 10000, compressedSize;
+    char *string = getFramedTestString(size);
+    char fileBuffer[32];
+    FILE *file = fmemopen(fileBuffer, sizeof(fileBuffer), "w");
+    setvbuf(file, NULL, _IONBF, 0);
+    stCompressionWriter *writer = stCompressionWriter_construct(file, -1, 2);
+    stCompressionWriter_write(writer, string, size);
+    stTry {
+        stCompressionWriter_destruct(writer);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_getId(except) == ST_COMPRESSION_EXCEPTION_ID);
+    } stTryEnd;
+    fclose(file);
+
+    char *compressedString = stCompression_compressFramed(string, size, &compressedSize, -1, 1);
+    file = tmpfile();
+    CuAssertIntEquals(testCase, compressedSize - 10, fwrite(compressedString, 1, compressedSize - 10, file));
+    rewind(file);
+    stCompressionReader *reader = stCompressionReader_construct(file, 2);
+    checkReadThrows(testCase, reader, string, size);
+    checkReadThrows(testCase, reader, string, size);
+    stCompressionReader_destruct(reader);
+    fclose(file);
+    free(compressedString);
+    free(string);
+}
+
 CuSuite* sonLib_stCompressionTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, test_stCompression_compressAndDecompress_Lots);
     SUITE_ADD_TEST(suite, test_stCompression_compressAndDecompress_Big);
     SUITE_ADD_TEST(suite, test_stCompression_compressAndDecompress_Lots_Zlib);
         SUITE_ADD_TEST(suite, test_stCompression_compressAndDecompress_Big_Zlib);
+    SUITE_ADD_TEST(suite, test_stCompression_compressAndDecompressFramed);
+    SUITE_ADD_TEST(suite, test_stCompression_writerAndReader);
+    SUITE_ADD_TEST(suite, test_stCompression_decompressFramedCorrupt);
+    SUITE_ADD_TEST(suite, test_stCompression_writerAndReaderErrors);
     return suite;
 }
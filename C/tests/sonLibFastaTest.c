@@ -0,0 +1,293 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "sonLibGlobalsTest.h"
+#include "commonC.h"
+#include "bioioC.h"
+#include <sys/time.h>
+#include <utime.h>
+
+static char *tempFileDir = "sonLibFastaTestTempDir";
+static char *tempFileName = "sonLibFastaTestTempDir/sonLibFastaTestTempFile.fa";
+
+static void teardown() {
+    if (stFile_exists(tempFileDir)) {
+        stFile_rmrf(tempFileDir);
+    }
+}
+
+static void setup() {
+    teardown();
+    stFile_mkdir(tempFileDir);
+}
+
+static stHash *readTempFile() {
+    FILE *fileHandle = fopen(tempFileName, "r");
+    stHash *sequences = fastaReadToMap(fileHandle);
+    fclose(fileHandle);
+    return sequences;
+}
+
+static void test_fastaReadToMap(CuTest *testCase) {
+    setup();
+    FILE *fileHandle = fopen(tempFileName, "w");
+    fprintf(fileHandle, "ignored\n>one  a\tdescription\nAC GT\n\tac-gt\n\nN>two\nAAAA>three\n>four");
+    fclose(fileHandle);
+    stHash *sequences = readTempFile();
+    CuAssertIntEquals(testCase, 4, stHash_size(sequences));
+    CuAssertStrEquals(testCase, "ACGTac-gtN", stHash_search(sequences, "one  a\tdescription"));
+    CuAssertStrEquals(testCase, "AAAA", stHash_search(sequences, "two"));
+    CuAssertStrEquals(testCase, "", stHash_search(sequences, "three"));
+    CuAssertStrEquals(testCase, "", stHash_search(sequences, "four"));
+    stHash_destruct(sequences);
+    fileHandle = fopen(tempFileName, "r");
+    sequences = fastaReadToPackedSeqMap(fileHandle);
+    fclose(fileHandle);
+    CuAssertIntEquals(testCase, 4, stHash_size(sequences));
+    char *sequence = stPackedSeq_getString(stHash_search(sequences, "one  a\tdescription"));
+    CuAssertStrEquals(testCase, "ACGTac-gtN", sequence);
+    free(sequence);
+    CuAssertIntEquals(testCase, 0, stPackedSeq_getLength(stHash_search(sequences, "four")));
+    stHash_destruct(sequences);
+    teardown();
+}
+
+/*
+ * Headers and sequences much longer than the blocks the file is read in.
+ */
+static void test_fastaReadLongRecords(CuTest *testCase) {
+    setup();
+    int64_t headerLength = 3000000, sequenceLength = 5000000;
+    char *header = st_malloc(headerLength + 1);
+    char *sequence = st_malloc(sequenceLength + 1);
+    for (int64_t i = 0; i < headerLength; i++) {
+        header[i] = "ab c1|"[st_randomInt(0, 6)];
+    }
+    header[headerLength] = '\0';
+    for (int64_t i = 0; i < sequenceLength; i++) {
+        sequence[i] = "ACGTNacgtn-"[st_randomInt(0, 11)];
+    }
+    sequence[sequenceLength] = '\0';
+    FILE *fileHandle = fopen(tempFileName, "w");
+    fprintf(fileHandle, ">short\nACGT\n");
+    fastaWrite(sequence, header, fileHandle);
+    fprintf(fileHandle, ">%s\n%s\n", "unwrapped", sequence);
+    fclose(fileHandle);
+    stHash *sequences = readTempFile();
+    CuAssertIntEquals(testCase, 3, stHash_size(sequences));
+    CuAssertStrEquals(testCase, "ACGT", stHash_search(sequences, "short"));
+    CuAssertStrEquals(testCase, sequence, stHash_search(sequences, header));
+    CuAssertStrEquals(testCase, sequence, stHash_search(sequences, "unwrapped"));
+    stHash_destruct(sequences);
+    free(header);
+    free(sequence);
+    teardown();
+}
+
+static void addSequenceLength(void *destination, const char *fastaHeader, const char *sequence, int64_t length) {
+    *(int64_t *) destination += length;
+}
+
+static double wallTime() {
+    struct timeval time;
+    gettimeofday(&time, NULL);
+    return time.tv_sec + time.tv_usec / 1000000.0;
+}
+
+/*
+ * Reports the rate a fasta file is read at, at info log level.
+ */
+static void test_fastaReadThroughput(CuTest *testCase) {
+    setup();
+    int64_t lineLength = 60, linesPerSequence = 1000, sequences = 10;
+    char line[lineLength + 1];
+    FILE *fileHandle = fopen(tempFileName, "w");
+    for (int64_t i = 0; i < sequences; i++) {
+        fprintf(fileHandle, ">chr%" PRIi64 "\n", i);
+        for (int64_t j = 0; j < linesPerSequence; j++) {
+            for (int64_t k = 0; k < lineLength; k++) {
+                line[k] = "ACGT"[st_randomInt(0, 4)];
+            }
+            line[lineLength] = '\0';
+            fprintf(fileHandle, "%s\n", line);
+        }
+    }
+    fclose(fileHandle);
+    double startTime = wallTime();
+    int64_t totalLength = 0;
+    fileHandle = fopen(tempFileName, "r");
+    fastaReadToFunction(fileHandle, &totalLength, addSequenceLength);
+    fclose(fileHandle);
+    double time = wallTime() - startTime;
+    CuAssertIntEquals(testCase, sequences * linesPerSequence * lineLength, totalLength);
+    st_logInfo("Read %" PRIi64 " bases of fasta in %f seconds, %f MB/s\n", totalLength, time,
+            totalLength / time / 1000000.0);
+    teardown();
+}
+
+static void test_stFastaIndex_faidxFormat(CuTest *testCase) {
+    setup();
+    FILE *fileHandle = fopen(tempFileName, "w");
+    fprintf(fileHandle, ">one description\nACGTA\nCGTAC\nGT\n>two\r\nAAAA\r\nCC\r\n>empty\n>three\nTTT");
+    fclose(fileHandle);
+    stFastaIndex *fastaIndex = stFastaIndex_construct(tempFileName);
+    char *indexFile = stString_print("%s.fai", tempFileName);
+    stList *lines = stFile_getLinesFromFile(indexFile);
+    CuAssertIntEquals(testCase, 4, stList_length(lines));
+    CuAssertStrEquals(testCase, "one\t12\t17\t5\t6", stList_get(lines, 0));
+    CuAssertStrEquals(testCase, "two\t6\t38\t4\t6", stList_get(lines, 1));
+    CuAssertStrEquals(testCase, "empty\t0\t55\t0\t0", stList_get(lines, 2));
+    CuAssertStrEquals(testCase, "three\t3\t62\t3\t3", stList_get(lines, 3));
+    stList_destruct(lines);
+
+    CuAssertIntEquals(testCase, 4, stFastaIndex_getSequenceNumber(fastaIndex));
+    CuAssertStrEquals(testCase, "two", stFastaIndex_getSequenceName(fastaIndex, 1));
+    CuAssertTrue(testCase, stFastaIndex_containsSequence(fastaIndex, "empty"));
+    CuAssertTrue(testCase, !stFastaIndex_containsSequence(fastaIndex, "four"));
+    CuAssertIntEquals(testCase, 12, stFastaIndex_getSequenceLength(fastaIndex, "one"));
+    char *sequence = stFastaIndex_getSequence(fastaIndex, "one");
+    CuAssertStrEquals(testCase, "ACGTACGTACGT", sequence);
+    free(sequence);
+    sequence = stFastaIndex_getSubsequence(fastaIndex, "two", 3, 2);
+    CuAssertStrEquals(testCase, "AC", sequence);
+    free(sequence);
+    sequence = stFastaIndex_getSequence(fastaIndex, "empty");
+    CuAssertStrEquals(testCase, "", sequence);
+    free(sequence);
+    CuAssertTrue(testCase, strncmp(stFastaIndex_getSubsequenceView(fastaIndex, "one", 6, 4), "GTAC", 4) == 0);
+    CuAssertTrue(testCase, stFastaIndex_getSubsequenceView(fastaIndex, "one", 3, 3) == NULL);
+    CuAssertTrue(testCase, strncmp(stFastaIndex_getSubsequenceView(fastaIndex, "three", 0, 3), "TTT", 3) == 0);
+
+    stTry {
+        stFastaIndex_getSubsequence(fastaIndex, "one", 10, 3);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_getId(except) == ST_FASTA_INDEX_EXCEPTION);
+    } stTryEnd;
+    stTry {
+        stFastaIndex_getSequenceLength(fastaIndex, "four");
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_getId(except) == ST_FASTA_INDEX_EXCEPTION);
+    } stTryEnd;
+    stFastaIndex_destruct(fastaIndex);
+    free(indexFile);
+    teardown();
+}
+
+static void test_stFastaIndex_unindexable(CuTest *testCase) {
+    setup();
+    FILE *fileHandle = fopen(tempFileName, "w");
+    fprintf(fileHandle, ">one\nACGT\nAC\nACGT\n");
+    fclose(fileHandle);
+    stTry {
+        stFastaIndex_construct(tempFileName);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_getId(except) == ST_FASTA_INDEX_EXCEPTION);
+    } stTryEnd;
+    teardown();
+}
+
+static void test_stFastaIndex_unwritableIndex(CuTest *testCase) {
+    /*
+     * The index can't be saved when a directory is in its place, which must not stop the fasta file
+     * being indexed. The directory is made older than the fasta file so it is not loaded as an index.
+     */
+    setup();
+    char *indexFile = stString_print("%s.fai", tempFileName);
+    stFile_mkdir(indexFile);
+    struct utimbuf times = { 0, 0 };
+    utime(indexFile, &times);
+    FILE *fileHandle = fopen(tempFileName, "w");
+    fprintf(fileHandle, ">one\nACGT\nAC\n");
+    fclose(fileHandle);
+    for (int64_t i = 0; i < 2; i++) {
+        stFastaIndex *fastaIndex = stFastaIndex_construct(tempFileName);
+        char *sequence = stFastaIndex_getSequence(fastaIndex, "one");
+        CuAssertStrEquals(testCase, "ACGTAC", sequence);
+        free(sequence);
+        stFastaIndex_destruct(fastaIndex);
+    }
+    free(indexFile);
+    teardown();
+}
+
+/*
+ * Compares random intervals of sequences with random line lengths against the sequences read
+ * by fastaReadToMap, first building the index and then loading it.
+ */
+static void checkRandomFastaIndex(CuTest *testCase) {
+    setup();
+    int64_t sequenceNumber = st_randomInt(1, 20);
+    FILE *fileHandle = fopen(tempFileName, "w");
+    for (int64_t i = 0; i < sequenceNumber; i++) {
+        int64_t length = st_randomInt(0, 10000), lineLength = st_randomInt(1, 100);
+        fprintf(fileHandle, ">seq%" PRIi64 " %s\n", i, st_random() > 0.5 ? "a description" : "");
+        for (int64_t j = 0; j < length; j++) {
+            fputc("ACGTNacgtn"[st_randomInt(0, 10)], fileHandle);
+            if ((j + 1) % lineLength == 0 || j + 1 == length) {
+                fputc('\n', fileHandle);
+            }
+        }
+    }
+    fclose(fileHandle);
+    fileHandle = fopen(tempFileName, "r");
+    stHash *headerToSequence = fastaReadToMap(fileHandle);
+    fclose(fileHandle);
+    for (int64_t reload = 0; reload < 2; reload++) {
+        stFastaIndex *fastaIndex = stFastaIndex_construct(tempFileName);
+        CuAssertIntEquals(testCase, sequenceNumber, stFastaIndex_getSequenceNumber(fastaIndex));
+        stHashIterator *it = stHash_getIterator(headerToSequence);
+        char *header;
+        while ((header = stHash_getNext(it)) != NULL) {
+            char *sequence = stHash_search(headerToSequence, header);
+            char *name = stString_copy(header);
+            *strchr(name, ' ') = '\0';
+            int64_t length = strlen(sequence);
+            CuAssertIntEquals(testCase, length, stFastaIndex_getSequenceLength(fastaIndex, name));
+            for (int64_t j = 0; j < 100; j++) {
+                int64_t start = st_randomInt(0, length + 1);
+                int64_t subsequenceLength = st_randomInt(0, length - start + 1);
+                char *subsequence = stFastaIndex_getSubsequence(fastaIndex, name, start, subsequenceLength);
+                CuAssertIntEquals(testCase, subsequenceLength, strlen(subsequence));
+                CuAssertTrue(testCase, memcmp(subsequence, sequence + start, subsequenceLength) == 0);
+                const char *view = stFastaIndex_getSubsequenceView(fastaIndex, name, start, subsequenceLength);
+                CuAssertTrue(testCase, view == NULL || memcmp(view, sequence + start, subsequenceLength) == 0);
+                free(subsequence);
+                stPackedSeq *packedSubsequence = stFastaIndex_getPackedSubsequence(fastaIndex, name, start,
+                        subsequenceLength);
+                subsequence = stPackedSeq_getString(packedSubsequence);
+                CuAssertTrue(testCase, memcmp(subsequence, sequence + start, subsequenceLength) == 0);
+                stPackedSeq_destruct(packedSubsequence);
+                free(subsequence);
+            }
+            free(name);
+        }
+        stHash_destructIterator(it);
+        stFastaIndex_destruct(fastaIndex);
+    }
+    stHash_destruct(headerToSequence);
+    teardown();
+}
+
+static void test_stFastaIndex_random(CuTest *testCase) {
+    for (int64_t i = 0; i < 10; i++) {
+        checkRandomFastaIndex(testCase);
+    }
+}
+
+CuSuite* sonLib_fastaTestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, test_fastaReadToMap);
+    SUITE_ADD_TEST(suite, test_fastaReadLongRecords);
+    SUITE_ADD_TEST(suite, test_fastaReadThroughput);
+    SUITE_ADD_TEST(suite, test_stFastaIndex_faidxFormat);
+    SUITE_ADD_TEST(suite, test_stFastaIndex_unindexable);
+    SUITE_ADD_TEST(suite, test_stFastaIndex_unwritableIndex);
+    SUITE_ADD_TEST(suite, test_stFastaIndex_random);
+    return suite;
+}
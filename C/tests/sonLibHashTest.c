@@ -5,6 +5,7 @@
  */
 
 #include "sonLibGlobalsTest.h"
+#include <time.h>
 
 static stHash *hash;
 static stHash *hash2;
@@ -191,6 +192,100 @@ static void test_stHash_testGetValues(CuTest *testCase) {
     testTeardown();
 }
 
+static void test_stHash_openAddressing(CuTest *testCase) {
+    /*
+     * Randomly inserts, overwrites and removes keys in an open addressing hash and a chained hash
+     * with slab allocated entries, checking them against a chained hash given the same operations.
+     */
+    for (int64_t test = 0; test < 10; test++) {
+        stHash *openHash = stHash_construct4((uint64_t(*)(const void *)) stIntTuple_hashKey,
+                (int(*)(const void *, const void *)) stIntTuple_equalsFn, (void(*)(void *)) stIntTuple_destruct, NULL,
+                stHashTypeOpenAddressing);
+        stHash *chainedHash = stHash_construct3((uint64_t(*)(const void *)) stIntTuple_hashKey,
+                (int(*)(const void *, const void *)) stIntTuple_equalsFn, (void(*)(void *)) stIntTuple_destruct, NULL);
+        stHash *slabHash = stHash_construct4((uint64_t(*)(const void *)) stIntTuple_hashKey,
+                (int(*)(const void *, const void *)) stIntTuple_equalsFn, (void(*)(void *)) stIntTuple_destruct, NULL,
+                stHashTypeChainedSlab);
+        CuAssertTrue(testCase, stHash_getType(openHash) == stHashTypeOpenAddressing);
+        CuAssertTrue(testCase, stHash_getType(chainedHash) == stHashTypeChained);
+        CuAssertTrue(testCase, stHash_getType(slabHash) == stHashTypeChainedSlab);
+        int64_t keyRange = st_randomInt(1, 10000);
+        for (int64_t i = 0; i < 50000; i++) {
+            int64_t k = st_randomInt(0, keyRange);
+            stIntTuple *key = stIntTuple_construct1(k);
+            if (st_random() > 0.3) {
+                // Insert replaces the stored key without freeing it, so free any key being overwritten.
+                stHash_removeAndFreeKey(openHash, key);
+                stHash_removeAndFreeKey(chainedHash, key);
+                stHash_removeAndFreeKey(slabHash, key);
+                void *value = (void *) (size_t) (i + 1);
+                stHash_insert(openHash, key, value);
+                stHash_insert(chainedHash, stIntTuple_construct1(k), value);
+                stHash_insert(slabHash, stIntTuple_construct1(k), value);
+            } else {
+                void *value = stHash_removeAndFreeKey(chainedHash, key);
+                CuAssertPtrEquals(testCase, value, stHash_removeAndFreeKey(openHash, key));
+                CuAssertPtrEquals(testCase, value, stHash_removeAndFreeKey(slabHash, key));
+                stIntTuple_destruct(key);
+            }
+            CuAssertIntEquals(testCase, stHash_size(chainedHash), stHash_size(openHash));
+            CuAssertIntEquals(testCase, stHash_size(chainedHash), stHash_size(slabHash));
+        }
+        for (int64_t k = 0; k < keyRange; k++) {
+            stIntTuple *key = stIntTuple_construct1(k);
+            CuAssertPtrEquals(testCase, stHash_search(chainedHash, key), stHash_search(openHash, key));
+            CuAssertPtrEquals(testCase, stHash_search(chainedHash, key), stHash_search(slabHash, key));
+            stIntTuple_destruct(key);
+        }
+        stHashIterator *it = stHash_getIterator(openHash);
+        stIntTuple *key;
+        int64_t keysSeen = 0;
+        while ((key = stHash_getNext(it)) != NULL) {
+            CuAssertPtrEquals(testCase, stHash_search(chainedHash, key), stHash_search(openHash, key));
+            keysSeen++;
+        }
+        stHash_destructIterator(it);
+        CuAssertIntEquals(testCase, stHash_size(openHash), keysSeen);
+        stHash_destruct(openHash);
+        stHash_destruct(chainedHash);
+        stHash_destruct(slabHash);
+    }
+}
+
+static int pointerEqualKey(const void *key1, const void *key2) {
+    return key1 == key2;
+}
+
+static double timeHashInserts(CuTest *testCase, stHashType type, stList *keys) {
+    clock_t startTime = clock();
+    stHash *hash = stHash_construct4(stHash_pointer, pointerEqualKey, NULL, NULL, type);
+    for (int64_t i = 0; i < stList_length(keys); i++) {
+        stHash_insert(hash, stList_get(keys, i), stList_get(keys, i));
+    }
+    for (int64_t i = 0; i < stList_length(keys); i++) {
+        CuAssertPtrEquals(testCase, stList_get(keys, i), stHash_search(hash, stList_get(keys, i)));
+    }
+    stHash_destruct(hash);
+    return ((double) (clock() - startTime)) / CLOCKS_PER_SEC;
+}
+
+static void test_stHash_openAddressingSpeed(CuTest *testCase) {
+    /*
+     * Compares the time taken to fill and query the chained, slab allocated chained and open
+     * addressing tables with pointer keys.
+     */
+    stList *keys = stList_construct();
+    for (int64_t i = 0; i < 100000; i++) {
+        stList_append(keys, (void *) (size_t) (st_randomInt64(1, INT64_MAX) & ~((int64_t) 7)));
+    }
+    double chainedTime = timeHashInserts(testCase, stHashTypeChained, keys);
+    double slabTime = timeHashInserts(testCase, stHashTypeChainedSlab, keys);
+    double openTime = timeHashInserts(testCase, stHashTypeOpenAddressing, keys);
+    st_logInfo("Inserted and searched %" PRIi64 " pointers: chained hash %f seconds, slab chained hash %f seconds, "
+               "open addressing hash %f seconds\n", stList_length(keys), chainedTime, slabTime, openTime);
+    stList_destruct(keys);
+}
+
 CuSuite* sonLib_stHashTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, test_stHash_search);
@@ -202,5 +297,7 @@ CuSuite* sonLib_stHashTestSuite(void) {
     SUITE_ADD_TEST(suite, test_stHash_construct);
     SUITE_ADD_TEST(suite, test_stHash_testGetKeys);
     SUITE_ADD_TEST(suite, test_stHash_testGetValues);
+    SUITE_ADD_TEST(suite, test_stHash_openAddressing);
+    SUITE_ADD_TEST(suite, test_stHash_openAddressingSpeed);
     return suite;
 }
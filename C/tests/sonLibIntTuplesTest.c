@@ -12,6 +12,7 @@
  */
 
 #include "sonLibGlobalsTest.h"
+#include <time.h>
 
 static stIntTuple *intTuple1 = NULL;
 static stIntTuple *intTuple2, *intTuple3, *intTuple4, *intTuple5;
@@ -102,6 +103,196 @@ static void test_stIntTuple_getPosition(CuTest *testCase) {
     teardown();
 }
 
+/*
+ * Checks an inline tuple against the allocated tuple of the same values.
+ */
+static void checkInlineTuple(CuTest *testCase, stIntTuple *inlineTuple, int64_t length, int64_t value1, int64_t value2) {
+    stIntTuple *intTuple = length == 1 ? stIntTuple_construct1(value1) : stIntTuple_construct2(value1, value2);
+    CuAssertTrue(testCase, !stIntTuple_isInline(intTuple));
+    CuAssertIntEquals(testCase, length, stIntTuple_length(inlineTuple));
+    CuAssertTrue(testCase, stIntTuple_get(inlineTuple, 0) == value1);
+    if (length == 2) {
+        CuAssertTrue(testCase, stIntTuple_get(inlineTuple, 1) == value2);
+    }
+    CuAssertTrue(testCase, stIntTuple_equalsFn(inlineTuple, intTuple));
+    CuAssertTrue(testCase, stIntTuple_equalsFn(intTuple, inlineTuple));
+    CuAssertIntEquals(testCase, 0, stIntTuple_cmpFn(inlineTuple, intTuple));
+    CuAssertTrue(testCase, stIntTuple_hashKey(inlineTuple) == stIntTuple_hashKey(intTuple));
+    stIntTuple_destruct(intTuple);
+}
+
+static void test_stIntTuple_inline(CuTest *testCase) {
+    int64_t max62 = (INT64_C(1) << 61) - 1, max31 = (INT64_C(1) << 30) - 1;
+    int64_t values1[] = { 0, 1, -1, 5, -5, max62, -max62 - 1, INT64_MAX, INT64_MIN, max62 + 1, -max62 - 2 };
+    for (int64_t i = 0; i < 11; i++) {
+        stIntTuple *intTuple = stIntTuple_constructInline1(values1[i]);
+        CuAssertTrue(testCase, stIntTuple_isInline(intTuple) == (i < 7));
+        checkInlineTuple(testCase, intTuple, 1, values1[i], 0);
+        stIntTuple_destruct(intTuple);
+    }
+    int64_t values2[] = { 0, 1, -1, max31, -max31 - 1, max31 + 1, -max31 - 2, INT64_MAX };
+    for (int64_t i = 0; i < 8; i++) {
+        for (int64_t j = 0; j < 8; j++) {
+            stIntTuple *intTuple = stIntTuple_constructInline2(values2[i], values2[j]);
+            CuAssertTrue(testCase, stIntTuple_isInline(intTuple) == (i < 5 && j < 5));
+            checkInlineTuple(testCase, intTuple, 2, values2[i], values2[j]);
+            stIntTuple_destruct(intTuple);
+        }
+    }
+    // Equal inline tuples are the same pointer, and order as allocated tuples do.
+    CuAssertTrue(testCase, stIntTuple_constructInline2(3, -4) == stIntTuple_constructInline2(3, -4));
+    CuAssertTrue(testCase, stIntTuple_constructInline1(3) != stIntTuple_constructInline2(3, 0));
+    CuAssertTrue(testCase, stIntTuple_cmpFn(stIntTuple_constructInline1(3), stIntTuple_constructInline2(3, -4)) < 0);
+    CuAssertTrue(testCase, stIntTuple_cmpFn(stIntTuple_constructInline2(3, -4), stIntTuple_constructInline2(3, -5)) > 0);
+    CuAssertTrue(testCase, stIntTuple_cmpFn(stIntTuple_constructInline1(-7), stIntTuple_constructInline1(2)) < 0);
+
+    // Inline and allocated tuples mix in a hash.
+    stHash *hash = stHash_construct3((uint64_t (*)(const void *))stIntTuple_hashKey,
+            (int (*)(const void *, const void *))stIntTuple_equalsFn, (void (*)(void *))stIntTuple_destruct, NULL);
+    for (int64_t i = 0; i < 1000; i++) {
+        stHash_insert(hash, i % 2 == 0 ? stIntTuple_constructInline1(i) : stIntTuple_construct1(i), hash);
+    }
+    for (int64_t i = 0; i < 1000; i++) {
+        stIntTuple *query = i % 3 == 0 ? stIntTuple_construct1(i) : stIntTuple_constructInline1(i);
+        CuAssertTrue(testCase, stHash_search(hash, query) == hash);
+        stIntTuple_destruct(query);
+    }
+    stHash_destruct(hash);
+}
+
+static int64_t *randomValues(int64_t length) {
+    int64_t *values = st_malloc(sizeof(int64_t) * (length + 1));
+    for (int64_t i = 0; i < length; i++) {
+        values[i] = st_randomInt(-2, 3);
+    }
+    return values;
+}
+
+static int referenceCmp(int64_t length1, int64_t *values1, int64_t length2, int64_t *values2) {
+    for (int64_t i = 0; i < length1 && i < length2; i++) {
+        if (values1[i] != values2[i]) {
+            return values1[i] < values2[i] ? -1 : 1;
+        }
+    }
+    return length1 < length2 ? -1 : length1 > length2 ? 1 : 0;
+}
+
+/*
+ * Compares and hashes tuples long enough to take the vector code, whose values have
+ * long common prefixes.
+ */
+static void test_stIntTuple_longTuples(CuTest *testCase) {
+    for (int64_t test = 0; test < 10000; test++) {
+        int64_t length1 = st_randomInt(0, 40), length2 = st_random() < 0.5 ? length1 : st_randomInt(0, 40);
+        int64_t *values1 = randomValues(length1), *values2 = randomValues(length2);
+        // Make the second mostly a copy of the first, with a change at a random position.
+        for (int64_t i = 0; i < length1 && i < length2; i++) {
+            values2[i] = values1[i];
+        }
+        if (length2 > 0 && st_random() < 0.7) {
+            values2[st_randomInt(0, length2)] = st_randomInt(-2, 3);
+        }
+        stIntTuple *intTuple1 = stIntTuple_constructN(length1, values1);
+        stIntTuple *intTuple2 = stIntTuple_constructN(length2, values2);
+        int c = referenceCmp(length1, values1, length2, values2);
+        CuAssertIntEquals(testCase, c, stIntTuple_cmpFn(intTuple1, intTuple2));
+        CuAssertIntEquals(testCase, -c, stIntTuple_cmpFn(intTuple2, intTuple1));
+        CuAssertIntEquals(testCase, c == 0, stIntTuple_equalsFn(intTuple1, intTuple2));
+        if (c == 0) {
+            CuAssertTrue(testCase, stIntTuple_hashKey(intTuple1) == stIntTuple_hashKey(intTuple2));
+        }
+        stIntTuple_destruct(intTuple1);
+        stIntTuple_destruct(intTuple2);
+        free(values1);
+        free(values2);
+    }
+}
+
+static void test_stIntTupleInterner(CuTest *testCase) {
+    stIntTupleInterner *interner = stIntTupleInterner_construct();
+    stList *tuples = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
+    stList *interned = stList_construct();
+    for (int64_t i = 0; i < 20000; i++) {
+        int64_t length = st_randomInt(0, 25);
+        int64_t *values = randomValues(length);
+        for (int64_t j = 0; j < length; j++) {
+            values[j] = st_randomInt(0, 2) * (j == 0 ? INT64_MAX : 1);
+        }
+        stList_append(tuples, stIntTuple_constructN(length, values));
+        stList_append(interned, stIntTupleInterner_intern(interner, length, values));
+        free(values);
+    }
+    for (int64_t i = 0; i < stList_length(tuples); i++) {
+        stIntTuple *intTuple = stList_get(tuples, i);
+        CuAssertTrue(testCase, stIntTuple_equalsFn(intTuple, stList_get(interned, i)));
+        CuAssertTrue(testCase, stIntTupleInterner_internTuple(interner, intTuple) == stList_get(interned, i));
+    }
+    // Interned tuples are equal if and only if they are the same.
+    for (int64_t i = 0; i < 20000; i++) {
+        int64_t j = st_randomInt(0, stList_length(tuples)), k = st_randomInt(0, stList_length(tuples));
+        CuAssertIntEquals(testCase, stIntTuple_equalsFn(stList_get(tuples, j), stList_get(tuples, k)),
+                          stList_get(interned, j) == stList_get(interned, k));
+    }
+    stSet *distinct = stSet_construct3((uint64_t (*)(const void *))stIntTuple_hashKey,
+            (int (*)(const void *, const void *))stIntTuple_equalsFn, NULL);
+    int64_t numInline = 0;
+    for (int64_t i = 0; i < stList_length(interned); i++) {
+        stIntTuple *intTuple = stList_get(interned, i);
+        if (stIntTuple_isInline(intTuple)) {
+            if (stSet_search(distinct, intTuple) == NULL) {
+                numInline++;
+            }
+        }
+        stSet_insert(distinct, intTuple);
+    }
+    CuAssertIntEquals(testCase, stSet_size(distinct) - numInline, stIntTupleInterner_size(interner));
+    stSet_destruct(distinct);
+    stList_destruct(interned);
+    stList_destruct(tuples);
+    stIntTupleInterner_destruct(interner);
+}
+
+static double timeTupleHash(CuTest *testCase, bool inlineTuples, int64_t n) {
+    clock_t startTime = clock();
+    stHash *hash = stHash_construct4((uint64_t (*)(const void *))stIntTuple_hashKey,
+            (int (*)(const void *, const void *))stIntTuple_equalsFn, (void (*)(void *))stIntTuple_destruct, NULL,
+            stHashTypeOpenAddressing);
+    for (int64_t i = 0; i < n; i++) {
+        stHash_insert(hash, inlineTuples ? stIntTuple_constructInline2(i, -i) : stIntTuple_construct2(i, -i), hash);
+    }
+    for (int64_t i = 0; i < n; i++) {
+        stIntTuple *query = inlineTuples ? stIntTuple_constructInline2(i, -i) : stIntTuple_construct2(i, -i);
+        CuAssertPtrEquals(testCase, hash, stHash_search(hash, query));
+        stIntTuple_destruct(query);
+    }
+    stHash_destruct(hash);
+    return (double) (clock() - startTime) / CLOCKS_PER_SEC;
+}
+
+static void test_stIntTuple_speed(CuTest *testCase) {
+    /*
+     * Compares filling and searching a hash of pairs held inline and allocated, and
+     * times hashing and comparing long tuples.
+     */
+    int64_t n = 100000;
+    double allocatedTime = timeTupleHash(testCase, 0, n);
+    double inlineTime = timeTupleHash(testCase, 1, n);
+    int64_t *values = randomValues(256);
+    stIntTuple *intTuple1 = stIntTuple_constructN(256, values), *intTuple2 = stIntTuple_constructN(256, values);
+    clock_t startTime = clock();
+    uint64_t h = 0;
+    for (int64_t i = 0; i < 10000; i++) {
+        h += stIntTuple_hashKey(intTuple1) + stIntTuple_equalsFn(intTuple1, intTuple2) + stIntTuple_cmpFn(intTuple1, intTuple2);
+    }
+    double longTime = (double) (clock() - startTime) / CLOCKS_PER_SEC;
+    st_logInfo("Inserted and searched %" PRIi64 " pairs: allocated %f seconds, inline %f seconds; "
+               "hashed and compared 256 value tuples %" PRIi64 " times in %f seconds (%" PRIu64 ")\n",
+               n, allocatedTime, inlineTime, (int64_t) 10000, longTime, h);
+    stIntTuple_destruct(intTuple1);
+    stIntTuple_destruct(intTuple2);
+    free(values);
+}
+
 CuSuite* sonLib_stIntTuplesTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, test_stIntTuple_construct);
@@ -110,5 +301,9 @@ CuSuite* sonLib_stIntTuplesTestSuite(void) {
     SUITE_ADD_TEST(suite, test_stIntTuple_equalsFn);
     SUITE_ADD_TEST(suite, test_stIntTuple_length);
     SUITE_ADD_TEST(suite, test_stIntTuple_getPosition);
+    SUITE_ADD_TEST(suite, test_stIntTuple_inline);
+    SUITE_ADD_TEST(suite, test_stIntTuple_longTuples);
+    SUITE_ADD_TEST(suite, test_stIntTupleInterner);
+    SUITE_ADD_TEST(suite, test_stIntTuple_speed);
     return suite;
 }
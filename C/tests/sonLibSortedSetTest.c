@@ -5,6 +5,7 @@
  */
 
 #include "sonLibGlobalsTest.h"
+#include <time.h>
 
 static stSortedSet *sortedSet = NULL;
 static stSortedSet *sortedSet2 = NULL;
@@ -12,6 +13,7 @@ static int64_t size = 7;
 static int64_t input[] = { 1, 5, -1, 10, 12, 3, -10 };
 static int64_t sortedInput[] = { -10, -1, 1, 3, 5, 10, 12 };
 static int64_t sortedSize = 7;
+static stSortedSetType sortedSetType = stSortedSetTypeAVL; // The type of the sets made by the setup.
 
 
 static void sonLibSortedSetTestTeardown() {
@@ -24,10 +26,10 @@ static void sonLibSortedSetTestTeardown() {
 
 static void sonLibSortedSetTestSetup() {
     sonLibSortedSetTestTeardown();
-    sortedSet = stSortedSet_construct3((int (*)(const void *, const void *))stIntTuple_cmpFn,
-            (void (*)(void *))stIntTuple_destruct);
-    sortedSet2 = stSortedSet_construct3((int (*)(const void *, const void *))stIntTuple_cmpFn,
-                (void (*)(void *))stIntTuple_destruct);
+    sortedSet = stSortedSet_construct4((int (*)(const void *, const void *))stIntTuple_cmpFn,
+            (void (*)(void *))stIntTuple_destruct, sortedSetType);
+    sortedSet2 = stSortedSet_construct4((int (*)(const void *, const void *))stIntTuple_cmpFn,
+                (void (*)(void *))stIntTuple_destruct, sortedSetType);
 }
 
 static void test_stSortedSet_construct(CuTest* testCase) {
@@ -46,6 +48,7 @@ static void test_stSortedSet_copyConstruct(CuTest* testCase) {
     stSortedSet *sortedSet2 = stSortedSet_copyConstruct(sortedSet, NULL);
     CuAssertTrue(testCase, stSortedSet_size(sortedSet2) == stSortedSet_size(sortedSet));
     CuAssertTrue(testCase, stSortedSet_equals(sortedSet2, sortedSet));
+    CuAssertIntEquals(testCase, stSortedSet_getType(sortedSet), stSortedSet_getType(sortedSet2));
     stSortedSet_destruct(sortedSet2);
     sonLibSortedSetTestTeardown();
 }
@@ -497,6 +500,223 @@ static void test_stSortedSet_searchGreaterThan(CuTest* testCase) {
     sonLibSortedSetTestTeardown();
 }
 
+/*
+ * Runs the tests above on sets of the given type.
+ */
+static void testSortedSetType(CuTest* testCase, stSortedSetType type) {
+    sortedSetType = type;
+    sonLibSortedSetTestSetup();
+    CuAssertIntEquals(testCase, type, stSortedSet_getType(sortedSet));
+    sonLibSortedSetTestTeardown();
+    test_stSortedSet_copyConstruct(testCase);
+    test_stSortedSet(testCase);
+    test_stSortedSetIterator(testCase);
+    test_stSortedSetIterator_getIteratorFrom(testCase);
+    test_stSortedSetIterator_getReverseIterator(testCase);
+    test_stSortedSetEquals(testCase);
+    test_stSortedSetIntersection(testCase);
+    test_stSortedSetUnion(testCase);
+    test_stSortedSetDifference(testCase);
+    test_stSortedSet_searchLessThanOrEqual(testCase);
+    test_stSortedSet_searchLessThan(testCase);
+    test_stSortedSet_searchGreaterThanOrEqual(testCase);
+    test_stSortedSet_searchGreaterThan(testCase);
+    sortedSetType = stSortedSetTypeAVL;
+}
+
+static void test_stSortedSet_bTree(CuTest* testCase) {
+    testSortedSetType(testCase, stSortedSetTypeBTree);
+}
+
+static void test_stSortedSet_avlSlab(CuTest* testCase) {
+    testSortedSetType(testCase, stSortedSetTypeAVLSlab);
+}
+
+static void checkSameSets(CuTest *testCase, stSortedSet *avlSet, stSortedSet *bTreeSet) {
+    CuAssertIntEquals(testCase, stSortedSet_size(avlSet), stSortedSet_size(bTreeSet));
+    CuAssertTrue(testCase, stSortedSet_getFirst(avlSet) == stSortedSet_getFirst(bTreeSet));
+    CuAssertTrue(testCase, stSortedSet_getLast(avlSet) == stSortedSet_getLast(bTreeSet));
+    stSortedSetIterator *it1 = stSortedSet_getIterator(avlSet);
+    stSortedSetIterator *it2 = stSortedSet_getIterator(bTreeSet);
+    void *o;
+    while ((o = stSortedSet_getNext(it1)) != NULL) {
+        CuAssertTrue(testCase, stSortedSet_getNext(it2) == o);
+    }
+    CuAssertTrue(testCase, stSortedSet_getNext(it2) == NULL);
+    while ((o = stSortedSet_getPrevious(it1)) != NULL) {
+        CuAssertTrue(testCase, stSortedSet_getPrevious(it2) == o);
+    }
+    CuAssertTrue(testCase, stSortedSet_getPrevious(it2) == NULL);
+    stSortedSet_destructIterator(it1);
+    stSortedSet_destructIterator(it2);
+}
+
+/*
+ * Checks the B-tree against the AVL tree through many random inserts and removes, so
+ * nodes are split, borrow from their siblings and merged at every level.
+ */
+static void test_stSortedSet_bTreeRandom(CuTest* testCase) {
+    stSortedSet *avlSet = stSortedSet_construct3((int (*)(const void *, const void *))stIntTuple_cmpFn, NULL);
+    stSortedSet *bTreeSet = stSortedSet_construct4((int (*)(const void *, const void *))stIntTuple_cmpFn, NULL,
+                                                   stSortedSetTypeBTree);
+    stList *tuples = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
+    int64_t range = 40000;
+    for (int64_t round = 0; round < 4; round++) {
+        // Grow the sets then shrink them, most of the way to empty in the last round.
+        for (int64_t i = 0; i < 60000; i++) {
+            stIntTuple *tuple = stIntTuple_construct1(st_randomInt(0, range));
+            stList_append(tuples, tuple);
+            CuAssertTrue(testCase, stSortedSet_search(avlSet, tuple) == stSortedSet_search(bTreeSet, tuple));
+            stSortedSet_insert(avlSet, tuple);
+            stSortedSet_insert(bTreeSet, tuple);
+        }
+        checkSameSets(testCase, avlSet, bTreeSet);
+        for (int64_t i = 0; i < (round == 3 ? 200000 : 40000); i++) {
+            stIntTuple *tuple = stIntTuple_construct1(st_randomInt(0, range));
+            void *removed = stSortedSet_remove(avlSet, tuple);
+            CuAssertTrue(testCase, stSortedSet_remove(bTreeSet, tuple) == removed);
+            stIntTuple_destruct(tuple);
+        }
+        checkSameSets(testCase, avlSet, bTreeSet);
+        for (int64_t i = 0; i < 1000; i++) {
+            stIntTuple *tuple = stIntTuple_construct1(st_randomInt(-10, range + 10));
+            CuAssertTrue(testCase, stSortedSet_search(avlSet, tuple) == stSortedSet_search(bTreeSet, tuple));
+            CuAssertTrue(testCase, stSortedSet_searchLessThanOrEqual(avlSet, tuple) ==
+                                   stSortedSet_searchLessThanOrEqual(bTreeSet, tuple));
+            CuAssertTrue(testCase, stSortedSet_searchLessThan(avlSet, tuple) ==
+                                   stSortedSet_searchLessThan(bTreeSet, tuple));
+            CuAssertTrue(testCase, stSortedSet_searchGreaterThanOrEqual(avlSet, tuple) ==
+                                   stSortedSet_searchGreaterThanOrEqual(bTreeSet, tuple));
+            CuAssertTrue(testCase, stSortedSet_searchGreaterThan(avlSet, tuple) ==
+                                   stSortedSet_searchGreaterThan(bTreeSet, tuple));
+            stIntTuple_destruct(tuple);
+        }
+    }
+    stSortedSet_destruct(avlSet);
+    stSortedSet_destruct(bTreeSet);
+    stList_destruct(tuples);
+}
+
+static void test_stSortedSet_constructFromSortedList(CuTest* testCase) {
+    for (int64_t length = 0; length < 3000; length += st_randomInt(1, 200)) {
+        stList *list = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
+        for (int64_t i = 0; i < length; i++) {
+            stList_append(list, stIntTuple_construct1(2 * i));
+        }
+        stSortedSet *bTreeSet = stSortedSet_constructFromSortedList(list,
+                (int (*)(const void *, const void *))stIntTuple_cmpFn, NULL);
+        CuAssertIntEquals(testCase, stSortedSetTypeBTree, stSortedSet_getType(bTreeSet));
+        // Check the built tree is valid, by removing elements from it.
+        stSortedSet *avlSet = stSortedSet_construct3((int (*)(const void *, const void *))stIntTuple_cmpFn, NULL);
+        for (int64_t i = 0; i < length; i++) {
+            stSortedSet_insert(avlSet, stList_get(list, i));
+        }
+        checkSameSets(testCase, avlSet, bTreeSet);
+        for (int64_t i = 0; i < length; i++) {
+            stIntTuple *tuple = stIntTuple_construct1(st_randomInt(0, 2 * length));
+            void *removed = stSortedSet_remove(avlSet, tuple);
+            CuAssertTrue(testCase, stSortedSet_remove(bTreeSet, tuple) == removed);
+            stIntTuple_destruct(tuple);
+        }
+        checkSameSets(testCase, avlSet, bTreeSet);
+        stSortedSet_destruct(avlSet);
+        stSortedSet_destruct(bTreeSet);
+        stList_destruct(list);
+    }
+
+    // Of equal elements the last is kept.
+    int64_t values[] = { 1, 2, 2, 3 };
+    stList *list = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
+    for (int64_t i = 0; i < 4; i++) {
+        stList_append(list, stIntTuple_construct1(values[i]));
+    }
+    stSortedSet *bTreeSet = stSortedSet_constructFromSortedList(list,
+            (int (*)(const void *, const void *))stIntTuple_cmpFn, NULL);
+    CuAssertIntEquals(testCase, 3, stSortedSet_size(bTreeSet));
+    CuAssertTrue(testCase, stSortedSet_search(bTreeSet, stList_get(list, 1)) == stList_get(list, 2));
+    stSortedSet_destruct(bTreeSet);
+
+    // An unsorted list is rejected.
+    void *first = stList_get(list, 0);
+    stList_set(list, 0, stList_get(list, 3));
+    stList_set(list, 3, first);
+    stTry {
+        stSortedSet_constructFromSortedList(list, (int (*)(const void *, const void *))stIntTuple_cmpFn, NULL);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_getId(except) == SORTED_SET_EXCEPTION_ID);
+    } stTryEnd
+    stList_destruct(list);
+}
+
+static double timeSortedSet(CuTest *testCase, stSortedSetType type, stList *tuples, stList *queries,
+                            double *iterationTime) {
+    clock_t startTime = clock();
+    stSortedSet *set = stSortedSet_construct4((int (*)(const void *, const void *))stIntTuple_cmpFn, NULL, type);
+    for (int64_t i = 0; i < stList_length(tuples); i++) {
+        stSortedSet_insert(set, stList_get(tuples, i));
+    }
+    for (int64_t i = 0; i < stList_length(queries); i++) {
+        // A range scan of a few elements from each query.
+        stIntTuple *tuple = stSortedSet_searchGreaterThanOrEqual(set, stList_get(queries, i));
+        if (tuple != NULL) {
+            stSortedSetIterator *it = stSortedSet_getIteratorFrom(set, tuple);
+            for (int64_t j = 0; j < 10 && stSortedSet_getNext(it) != NULL; j++);
+            stSortedSet_destructIterator(it);
+        }
+    }
+    double time = (double) (clock() - startTime) / CLOCKS_PER_SEC;
+    startTime = clock();
+    for (int64_t round = 0; round < 10; round++) {
+        stSortedSetIterator *it = stSortedSet_getIterator(set);
+        int64_t iterated = 0;
+        while (stSortedSet_getNext(it) != NULL) {
+            iterated++;
+        }
+        stSortedSet_destructIterator(it);
+        CuAssertIntEquals(testCase, stSortedSet_size(set), iterated);
+    }
+    *iterationTime = (double) (clock() - startTime) / CLOCKS_PER_SEC;
+    stSortedSet_destruct(set);
+    return time;
+}
+
+static void test_stSortedSet_bTreeSpeed(CuTest* testCase) {
+    /*
+     * Compares the time taken to fill, range scan and iterate over AVL and B-tree backed
+     * sets of integer tuples, and to build them from a sorted list.
+     */
+    stList *tuples = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
+    stList *queries = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
+    for (int64_t i = 0; i < 100000; i++) {
+        stList_append(tuples, stIntTuple_construct1(st_randomInt64(0, INT64_MAX)));
+        stList_append(queries, stIntTuple_construct1(st_randomInt64(0, INT64_MAX)));
+    }
+    double avlIterationTime, avlSlabIterationTime, bTreeIterationTime;
+    double avlTime = timeSortedSet(testCase, stSortedSetTypeAVL, tuples, queries, &avlIterationTime);
+    double avlSlabTime = timeSortedSet(testCase, stSortedSetTypeAVLSlab, tuples, queries, &avlSlabIterationTime);
+    double bTreeTime = timeSortedSet(testCase, stSortedSetTypeBTree, tuples, queries, &bTreeIterationTime);
+    stList_sort(tuples, (int (*)(const void *, const void *))stIntTuple_cmpFn);
+    clock_t startTime = clock();
+    stSortedSet *set = stSortedSet_construct3((int (*)(const void *, const void *))stIntTuple_cmpFn, NULL);
+    for (int64_t i = 0; i < stList_length(tuples); i++) {
+        stSortedSet_insert(set, stList_get(tuples, i));
+    }
+    double avlBuildTime = (double) (clock() - startTime) / CLOCKS_PER_SEC;
+    stSortedSet_destruct(set);
+    startTime = clock();
+    set = stSortedSet_constructFromSortedList(tuples, (int (*)(const void *, const void *))stIntTuple_cmpFn, NULL);
+    double bTreeBuildTime = (double) (clock() - startTime) / CLOCKS_PER_SEC;
+    stSortedSet_destruct(set);
+    st_logInfo("Inserted %" PRIi64 " tuples and range scanned from as many: AVL %f seconds, slab AVL %f seconds, "
+               "B-tree %f seconds; iterated ten times: AVL %f seconds, slab AVL %f seconds, B-tree %f seconds; "
+               "built from a sorted list: AVL %f seconds, B-tree %f seconds\n", stList_length(tuples), avlTime,
+               avlSlabTime, bTreeTime, avlIterationTime, avlSlabIterationTime, bTreeIterationTime, avlBuildTime,
+               bTreeBuildTime);
+    stList_destruct(tuples);
+    stList_destruct(queries);
+}
+
 CuSuite* sonLib_stSortedSetTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, test_stSortedSet_construct);
@@ -513,5 +733,10 @@ CuSuite* sonLib_stSortedSetTestSuite(void) {
     SUITE_ADD_TEST(suite, test_stSortedSet_searchLessThan);
     SUITE_ADD_TEST(suite, test_stSortedSet_searchGreaterThanOrEqual);
     SUITE_ADD_TEST(suite, test_stSortedSet_searchGreaterThan);
+    SUITE_ADD_TEST(suite, test_stSortedSet_bTree);
+    SUITE_ADD_TEST(suite, test_stSortedSet_avlSlab);
+    SUITE_ADD_TEST(suite, test_stSortedSet_bTreeRandom);
+    SUITE_ADD_TEST(suite, test_stSortedSet_constructFromSortedList);
+    SUITE_ADD_TEST(suite, test_stSortedSet_bTreeSpeed);
     return suite;
 }
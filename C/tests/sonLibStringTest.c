@@ -12,6 +12,7 @@
  */
 
 #include "sonLibGlobalsTest.h"
+#include <sys/time.h>
 
 static void test_stString_copy(CuTest* testCase) {
     const char *test[3] = { "hello this is a test", "", "BOO\nTOO\n" };
@@ -157,6 +158,54 @@ void test_stString_reverseComplementString(CuTest* testCase) {
     free(cA);
 }
 
+/*
+ * Checks the vectorised reverse complement against stString_reverseComplementChar, for strings
+ * of every byte value and of lengths either side of the vector widths.
+ */
+static void test_stString_reverseComplementStringRandom(CuTest* testCase) {
+    for (int64_t length = 0; length < 300; length++) {
+        char *string = st_malloc(length + 1);
+        for (int64_t i = 0; i < length; i++) {
+            string[i] = st_random() > 0.5 ? "ACGTNacgtnMKRYBVDHWSmkrybvdhws-*"[st_randomInt(0, 32)] : st_randomInt(1, 256);
+        }
+        string[length] = '\0';
+        char *cA = stString_reverseComplementString(string);
+        CuAssertIntEquals(testCase, length, strlen(cA));
+        for (int64_t i = 0; i < length; i++) {
+            CuAssertIntEquals(testCase, stString_reverseComplementChar(string[length - 1 - i]), cA[i]);
+        }
+        stString_reverseComplementStringInPlace(cA, length);
+        CuAssertStrEquals(testCase, string, cA);
+        free(cA);
+        free(string);
+    }
+}
+
+static double wallTime(void) {
+    struct timeval time;
+    gettimeofday(&time, NULL);
+    return time.tv_sec + time.tv_usec * 1e-6;
+}
+
+/*
+ * Reports the rate a string is reverse complemented at, at info log level.
+ */
+static void test_stString_reverseComplementStringThroughput(CuTest* testCase) {
+    int64_t length = 1000000, repeats = 10;
+    char *string = stRandom_getRandomDNAString(length, 0, 0, 0);
+    double startTime = wallTime();
+    char *cA = stString_reverseComplementString(string);
+    for (int64_t i = 1; i < repeats; i++) {
+        stString_reverseComplementStringInPlace(cA, length);
+    }
+    double time = wallTime() - startTime;
+    CuAssertTrue(testCase, strcmp(string, cA) == 0); // An even number of reverse complements is the identity
+    st_logInfo("Reverse complemented %" PRIi64 " bases in %f seconds, %f MB/s\n", length * repeats, time,
+            length * repeats / time / 1000000.0);
+    free(cA);
+    free(string);
+}
+
 static void test_stString_splitByString(CuTest *testCase) {
     stList *fields = stString_splitByString("aba", "a");
     CuAssertStrEquals(testCase, "", stList_get(fields, 0));
@@ -178,6 +227,8 @@ CuSuite* sonLib_stStringTestSuite(void) {
     SUITE_ADD_TEST(suite, test_stString_getSubString);
     SUITE_ADD_TEST(suite, test_stString_reverseComplementChar);
     SUITE_ADD_TEST(suite, test_stString_reverseComplementString);
+    SUITE_ADD_TEST(suite, test_stString_reverseComplementStringRandom);
+    SUITE_ADD_TEST(suite, test_stString_reverseComplementStringThroughput);
     SUITE_ADD_TEST(suite, test_stString_splitByString);
     return suite;
 }
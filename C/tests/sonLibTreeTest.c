@@ -250,6 +250,70 @@ static void test_stTree_getMRCA(CuTest *testCase) {
     teardown();
 }
 
+// Build a random tree, attaching each node to a random earlier node,
+// or (if caterpillar is true) mostly to the previous one, so that the
+// tree is deep.
+static stTree *getRandomTree(int64_t numNodes, bool caterpillar, stList *nodes) {
+    stTree *randomRoot = stTree_construct();
+    stList_append(nodes, randomRoot);
+    for (int64_t i = 1; i < numNodes; i++) {
+        stTree *node = stTree_construct();
+        stTree *parent;
+        if (caterpillar && st_random() < 0.9) {
+            parent = stList_peek(nodes);
+        } else {
+            parent = stList_get(nodes, st_randomInt(0, stList_length(nodes)));
+        }
+        stTree_setParent(node, parent);
+        stTree_setBranchLength(node, st_random());
+        stList_append(nodes, node);
+    }
+    return randomRoot;
+}
+
+static double getDistanceToAncestor(stTree *node, stTree *ancestor) {
+    double distance = 0.0;
+    while (node != ancestor) {
+        distance += stTree_getBranchLength(node);
+        node = stTree_getParent(node);
+    }
+    return distance;
+}
+
+static void test_stTreeLCAIndex(CuTest *testCase) {
+    setup();
+    stTreeLCAIndex *index = stTreeLCAIndex_construct(root);
+    CuAssertTrue(testCase, stTreeLCAIndex_getMRCA(index, internal, internal) == internal);
+    CuAssertTrue(testCase, stTreeLCAIndex_getMRCA(index, root, child1) == root);
+    CuAssertTrue(testCase, stTreeLCAIndex_getMRCA(index, child2, root) == root);
+    CuAssertTrue(testCase, stTreeLCAIndex_getMRCA(index, child2, child1) == internal);
+    CuAssertDblEquals(testCase, 1.6, stTreeLCAIndex_getDistance(index, child1, root), 1e-9);
+    // Nodes outside the indexed tree have no MRCA.
+    stTree *other = stTree_construct();
+    CuAssertTrue(testCase, stTreeLCAIndex_getMRCA(index, other, child1) == NULL);
+    stTree_destruct(other);
+    stTreeLCAIndex_destruct(index);
+    teardown();
+
+    for (int64_t testNum = 0; testNum < 100; testNum++) {
+        stList *nodes = stList_construct();
+        stTree *randomRoot = getRandomTree(st_randomInt(1, 300), testNum % 2 == 0, nodes);
+        index = stTreeLCAIndex_construct(randomRoot);
+        for (int64_t i = 0; i < 200; i++) {
+            stTree *node1 = stList_get(nodes, st_randomInt(0, stList_length(nodes)));
+            stTree *node2 = stList_get(nodes, st_randomInt(0, stList_length(nodes)));
+            stTree *mrca = stTree_getMRCA(node1, node2);
+            CuAssertTrue(testCase, stTreeLCAIndex_getMRCA(index, node1, node2) == mrca);
+            CuAssertTrue(testCase, stTreeLCAIndex_getMRCA(index, node2, node1) == mrca);
+            double distance = getDistanceToAncestor(node1, mrca) + getDistanceToAncestor(node2, mrca);
+            CuAssertDblEquals(testCase, distance, stTreeLCAIndex_getDistance(index, node1, node2), 1e-6);
+        }
+        stTreeLCAIndex_destruct(index);
+        stTree_destruct(randomRoot);
+        stList_destruct(nodes);
+    }
+}
+
 CuSuite* sonLib_ETreeTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, test_stTree_construct);
@@ -265,5 +329,6 @@ CuSuite* sonLib_ETreeTestSuite(void) {
     SUITE_ADD_TEST(suite, test_stTree_clone);
     SUITE_ADD_TEST(suite, test_stTree_reRoot);
     SUITE_ADD_TEST(suite, test_stTree_getMRCA);
+    SUITE_ADD_TEST(suite, test_stTreeLCAIndex);
     return suite;
 }
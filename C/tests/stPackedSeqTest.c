@@ -0,0 +1,178 @@
+#include "CuTest.h"
+#include "sonLib.h"
+#include <ctype.h>
+
+// Returns a random string of mostly bases, with runs of Ns, lower
+// case, gaps and other IUPAC characters.
+static char *getRandomSeqString(int64_t length) {
+    char *string = stRandom_getRandomDNAString(length, 0, 0, 0);
+    int64_t i = 0;
+    while (i < length) {
+        int64_t runLength = st_randomInt(1, 100);
+        double p = st_random();
+        for (int64_t j = i; j < i + runLength && j < length; j++) {
+            if (p < 0.1) {
+                string[j] = 'N';
+            } else if (p < 0.2) {
+                string[j] = tolower(string[j]);
+            } else if (p < 0.22) {
+                string[j] = "-nRYswx*"[st_randomInt(0, 8)];
+            }
+        }
+        i += runLength;
+    }
+    return string;
+}
+
+static void test_stPackedSeq_string(CuTest *testCase) {
+    for (int64_t test = 0; test < 100; test++) {
+        int64_t length = st_randomInt(0, 1000);
+        char *string = getRandomSeqString(length);
+        stPackedSeq *seq = stPackedSeq_construct(string);
+        CuAssertIntEquals(testCase, length, stPackedSeq_getLength(seq));
+        char *unpacked = stPackedSeq_getString(seq);
+        CuAssertStrEquals(testCase, string, unpacked);
+        free(unpacked);
+        for (int64_t i = 0; i < length; i++) {
+            CuAssertIntEquals(testCase, string[i], stPackedSeq_getBase(seq, i));
+        }
+        for (int64_t i = 0; i < 10; i++) {
+            int64_t start = st_randomInt(0, length + 1);
+            int64_t subLength = st_randomInt(0, length - start + 1);
+            char *expected = stString_getSubString(string, start, subLength);
+            char *substring = stPackedSeq_getSubstring(seq, start, subLength);
+            CuAssertStrEquals(testCase, expected, substring);
+            stPackedSeq *subsequence = stPackedSeq_getSubsequence(seq, start, subLength);
+            free(substring);
+            substring = stPackedSeq_getString(subsequence);
+            CuAssertStrEquals(testCase, expected, substring);
+            stPackedSeq_destruct(subsequence);
+            free(substring);
+            free(expected);
+        }
+        // Build the same sequence up in pieces.
+        stPackedSeq *appendedSeq = stPackedSeq_construct("");
+        int64_t i = 0;
+        while (i < length) {
+            int64_t pieceLength = st_randomInt(0, length - i + 1);
+            stPackedSeq_append(appendedSeq, string + i, pieceLength);
+            i += pieceLength;
+        }
+        unpacked = stPackedSeq_getString(appendedSeq);
+        CuAssertStrEquals(testCase, string, unpacked);
+        free(unpacked);
+        stPackedSeq_destruct(appendedSeq);
+        stPackedSeq_destruct(seq);
+        free(string);
+    }
+}
+
+static void test_stPackedSeq_reverseComplement(CuTest *testCase) {
+    for (int64_t test = 0; test < 100; test++) {
+        char *string = getRandomSeqString(st_randomInt(0, 1000));
+        stPackedSeq *seq = stPackedSeq_construct(string);
+        stPackedSeq *reverseComplement = stPackedSeq_reverseComplement(seq);
+        char *expected = stString_reverseComplementString(string);
+        char *unpacked = stPackedSeq_getString(reverseComplement);
+        CuAssertStrEquals(testCase, expected, unpacked);
+        // The complement of a complement is the original.
+        stPackedSeq *seq2 = stPackedSeq_reverseComplement(reverseComplement);
+        free(unpacked);
+        unpacked = stPackedSeq_getString(seq2);
+        CuAssertStrEquals(testCase, string, unpacked);
+        CuAssertIntEquals(testCase, stPackedSeq_getGCCount(seq), stPackedSeq_getGCCount(reverseComplement));
+        stPackedSeq_destruct(seq2);
+        free(unpacked);
+        free(expected);
+        stPackedSeq_destruct(reverseComplement);
+        stPackedSeq_destruct(seq);
+        free(string);
+    }
+}
+
+static void test_stPackedSeq_gcCount(CuTest *testCase) {
+    for (int64_t test = 0; test < 100; test++) {
+        int64_t length = st_randomInt(0, 1000);
+        char *string = getRandomSeqString(length);
+        stPackedSeq *seq = stPackedSeq_construct(string);
+        int64_t gcCount = 0;
+        for (int64_t i = 0; i < length; i++) {
+            gcCount += toupper(string[i]) == 'G' || toupper(string[i]) == 'C';
+        }
+        CuAssertIntEquals(testCase, gcCount, stPackedSeq_getGCCount(seq));
+        stPackedSeq_destruct(seq);
+        free(string);
+    }
+}
+
+static void test_stPackedSeq_kmers(CuTest *testCase) {
+    for (int64_t test = 0; test < 100; test++) {
+        int64_t length = st_randomInt(0, 1000), k = st_randomInt(1, 33);
+        char *string = getRandomSeqString(length);
+        stPackedSeq *seq = stPackedSeq_construct(string);
+        stPackedSeqKmerIterator *it = stPackedSeq_getKmerIterator(seq, k);
+        uint64_t kmer;
+        int64_t position;
+        for (int64_t i = 0; i + k <= length; i++) {
+            uint64_t expectedKmer = 0;
+            bool valid = 1;
+            for (int64_t j = i; j < i + k; j++) {
+                const char *base = strchr("ACGT", toupper(string[j]));
+                valid = valid && base != NULL;
+                expectedKmer = (expectedKmer << 2) | (base != NULL ? base - "ACGT" : 0);
+            }
+            if (valid) {
+                CuAssertTrue(testCase, stPackedSeqKmerIterator_getNext(it, &kmer, &position));
+                CuAssertIntEquals(testCase, i, position);
+                CuAssertTrue(testCase, kmer == expectedKmer);
+            }
+        }
+        CuAssertTrue(testCase, !stPackedSeqKmerIterator_getNext(it, &kmer, &position));
+        stPackedSeq_destructKmerIterator(it);
+        stPackedSeq_destruct(seq);
+        free(string);
+    }
+}
+
+// A soft masked sequence takes little more than two bits a base.
+static void test_stPackedSeq_memoryUsage(CuTest *testCase) {
+    int64_t length = 1000000;
+    char *string = stRandom_getRandomDNAString(length, 0, 0, 0);
+    for (int64_t i = 0; i < length; i += 10000) {
+        for (int64_t j = i; j < i + 1000; j++) {
+            string[j] = tolower(string[j]);
+        }
+    }
+    stPackedSeq *seq = stPackedSeq_construct(string);
+    CuAssertTrue(testCase, stPackedSeq_getMemoryUsage(seq) < length / 4 + 10000);
+    stPackedSeq_destruct(seq);
+    free(string);
+}
+
+static void test_stPackedSeq_outOfRange(CuTest *testCase) {
+    stPackedSeq *seq = stPackedSeq_construct("ACGT");
+    stTry {
+        stPackedSeq_getSubstring(seq, 2, 3);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_getId(except) == ST_PACKED_SEQ_EXCEPTION);
+    } stTryEnd;
+    stTry {
+        stPackedSeq_getKmerIterator(seq, 33);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_getId(except) == ST_PACKED_SEQ_EXCEPTION);
+    } stTryEnd;
+    stPackedSeq_destruct(seq);
+}
+
+CuSuite *sonLib_stPackedSeqTestSuite(void) {
+    CuSuite *suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, test_stPackedSeq_string);
+    SUITE_ADD_TEST(suite, test_stPackedSeq_reverseComplement);
+    SUITE_ADD_TEST(suite, test_stPackedSeq_gcCount);
+    SUITE_ADD_TEST(suite, test_stPackedSeq_kmers);
+    SUITE_ADD_TEST(suite, test_stPackedSeq_memoryUsage);
+    SUITE_ADD_TEST(suite, test_stPackedSeq_outOfRange);
+    return suite;
+}
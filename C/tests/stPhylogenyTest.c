@@ -1,5 +1,7 @@
 #include <stdlib.h>
 #include <math.h>
+#include <float.h>
+#include <sys/time.h>
 #include "CuTest.h"
 #include "sonLib.h"
 #include "stPhylogeny.h"
@@ -478,6 +480,129 @@ static void testRandomNeighborJoin(CuTest *testCase) {
     }
 }
 
+// Returns true if the trees are identical: the same labels, branch
+// lengths and leaf indices, with the children in the same order.
+static bool isTreeIdentical(stTree *tree1, stTree *tree2) {
+    const char *label1 = stTree_getLabel(tree1), *label2 = stTree_getLabel(tree2);
+    if ((label1 == NULL) != (label2 == NULL) || (label1 != NULL && strcmp(label1, label2) != 0)
+            || stTree_getBranchLength(tree1) != stTree_getBranchLength(tree2)
+            || getIndex(tree1)->matrixIndex != getIndex(tree2)->matrixIndex
+            || stTree_getChildNumber(tree1) != stTree_getChildNumber(tree2)) {
+        return false;
+    }
+    for (int64_t i = 0; i < stTree_getChildNumber(tree1); i++) {
+        if (!isTreeIdentical(stTree_getChild(tree1, i), stTree_getChild(tree2, i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Gets a random distance matrix whose distances are small integers,
+// so that many pairs tie for the least Q.
+static stMatrix *getRandomIntegerDistanceMatrix(int64_t size) {
+    stMatrix *ret = stMatrix_construct(size, size);
+    for (int64_t i = 0; i < size; i++) {
+        for (int64_t j = 0; j < i; j++) {
+            double val = st_randomInt64(0, 5);
+            *stMatrix_getCell(ret, i, j) = val;
+            *stMatrix_getCell(ret, j, i) = val;
+        }
+    }
+    return ret;
+}
+
+// The native neighbor-joining should build exactly the trees
+// QuickTree does, with any number of threads.
+static void testNeighborJoinMatchesQuickTree(CuTest *testCase) {
+    for (int64_t testNum = 0; testNum < 30; testNum++) {
+        int64_t numLeaves = st_randomInt64(3, 300);
+        stMatrix *matrix = testNum % 2 == 0 ? getRandomDistanceMatrix(numLeaves)
+                                            : getRandomIntegerDistanceMatrix(numLeaves);
+        stList *outgroups = NULL;
+        if (st_random() > 0.5) {
+            outgroups = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
+            stList_append(outgroups, stIntTuple_construct1(st_randomInt64(0, numLeaves)));
+        }
+        stTree *quickTreeTree = stPhylogeny_neighborJoinQuickTree(matrix, outgroups);
+        stTree *tree = stPhylogeny_neighborJoin2(matrix, outgroups, st_randomInt64(1, 5));
+        CuAssertTrue(testCase, isTreeIdentical(quickTreeTree, tree));
+        testOnTree(testCase, tree, checkLeavesBelow);
+
+        if (outgroups != NULL) {
+            stList_destruct(outgroups);
+        }
+        stMatrix_destruct(matrix);
+        stPhylogenyInfo_destructOnTree(tree);
+        stTree_destruct(tree);
+        stPhylogenyInfo_destructOnTree(quickTreeTree);
+        stTree_destruct(quickTreeTree);
+    }
+}
+
+static double wallTime(void) {
+    struct timeval time;
+    gettimeofday(&time, NULL);
+    return time.tv_sec + time.tv_usec * 1e-6;
+}
+
+// Gets the distances between the leaves of a random tree, with a
+// little noise. The leaves of the tree are numbered so that leaves i
+// and j meet at the node at the top bit in which their numbers differ.
+static stMatrix *getRandomTreeDistanceMatrix(int64_t numLeaves, double noise) {
+    int64_t depth = 0;
+    while ((((int64_t) 1) << depth) < numLeaves) {
+        depth++;
+    }
+    double *branchLengths = st_malloc((((int64_t) 1) << (depth + 1)) * sizeof(double));
+    for (int64_t i = 0; i < (((int64_t) 1) << (depth + 1)); i++) {
+        branchLengths[i] = st_random();
+    }
+    stMatrix *matrix = stMatrix_construct(numLeaves, numLeaves);
+    for (int64_t i = 0; i < numLeaves; i++) {
+        for (int64_t j = 0; j < i; j++) {
+            // Heap indices of the nodes above leaf i and leaf j.
+            int64_t nodeI = (((int64_t) 1) << depth) + i, nodeJ = (((int64_t) 1) << depth) + j;
+            double val = st_random() * noise;
+            while (nodeI != nodeJ) {
+                val += branchLengths[nodeI] + branchLengths[nodeJ];
+                nodeI /= 2;
+                nodeJ /= 2;
+            }
+            *stMatrix_getCell(matrix, i, j) = val;
+            *stMatrix_getCell(matrix, j, i) = val;
+        }
+    }
+    free(branchLengths);
+    return matrix;
+}
+
+// Compare the speed of the native neighbor-joining with QuickTree's.
+static void testNeighborJoin_speed(CuTest *testCase) {
+    int64_t numLeaves = 1000;
+    stMatrix *matrix = getRandomTreeDistanceMatrix(numLeaves, 0.01);
+    double start = wallTime();
+    stTree *quickTreeTree = stPhylogeny_neighborJoinQuickTree(matrix, NULL);
+    double quickTreeTime = wallTime() - start;
+    start = wallTime();
+    stTree *tree = stPhylogeny_neighborJoin(matrix, NULL);
+    double time = wallTime() - start;
+    start = wallTime();
+    stTree *threadedTree = stPhylogeny_neighborJoin2(matrix, NULL, 4);
+    double threadedTime = wallTime() - start;
+    st_logInfo("Neighbor-joining %" PRIi64 " leaves: QuickTree %f seconds, native %f seconds, "
+               "native with 4 threads %f seconds\n", numLeaves, quickTreeTime, time, threadedTime);
+    CuAssertTrue(testCase, isTreeIdentical(quickTreeTree, tree));
+    CuAssertTrue(testCase, isTreeIdentical(quickTreeTree, threadedTree));
+
+    stTree *trees[3] = { quickTreeTree, tree, threadedTree };
+    for (int64_t i = 0; i < 3; i++) {
+        stPhylogenyInfo_destructOnTree(trees[i]);
+        stTree_destruct(trees[i]);
+    }
+    stMatrix_destruct(matrix);
+}
+
 static int64_t numBootstraps; // Totally lazy, but enables
                               // checkPartitionSupport to see the
                               // number of bootstraps used
@@ -541,6 +666,168 @@ static void testRandomBootstraps(CuTest *testCase) {
     stList_destruct(bootstraps);
 }
 
+// Gives every node of the tree a random reconciliation, drawn from
+// few enough species that matches are common.
+static void setRandomReconInfo(stTree *tree) {
+    stPhylogenyInfo *info = stTree_getClientData(tree);
+    if (info->recon == NULL) {
+        info->recon = st_malloc(sizeof(stReconciliationInfo));
+    }
+    // Dummy species that are never dereferenced.
+    info->recon->species = (stTree *) st_randomInt64(0, 2);
+    info->recon->event = st_random() > 0.5 ? DUPLICATION : SPECIATION;
+    for (int64_t i = 0; i < stTree_getChildNumber(tree); i++) {
+        setRandomReconInfo(stTree_getChild(tree, i));
+    }
+}
+
+// Gets the support of a node from a bootstrap as the original scoring
+// did: walking down the bootstrap to the deepest node whose leaves
+// include the node's, which supports it if its leaves are the same
+// (and, for reconciliations, its parent is reconciled the same way).
+static bool getBootstrapSupportReference(stTree *node, stTree *bootstrap, bool reconciliation) {
+    stIndexedTreeInfo *index = getIndex(node);
+    bool descended = true;
+    while (descended) {
+        descended = false;
+        for (int64_t i = 0; i < stTree_getChildNumber(bootstrap) && !descended; i++) {
+            stIndexedTreeInfo *childIndex = getIndex(stTree_getChild(bootstrap, i));
+            bool isSuperset = true;
+            for (int64_t j = 0; j < index->totalNumLeaves; j++) {
+                if (index->leavesBelow[j] && !childIndex->leavesBelow[j]) {
+                    isSuperset = false;
+                }
+            }
+            if (isSuperset) {
+                bootstrap = stTree_getChild(bootstrap, i);
+                descended = true;
+            }
+        }
+    }
+    if (memcmp(index->leavesBelow, getIndex(bootstrap)->leavesBelow, index->totalNumLeaves)) {
+        return false;
+    }
+    if (!reconciliation) {
+        return true;
+    }
+    stTree *parent = stTree_getParent(node), *bootstrapParent = stTree_getParent(bootstrap);
+    if (parent == NULL || bootstrapParent == NULL) {
+        return parent == NULL && bootstrapParent == NULL;
+    }
+    stReconciliationInfo *recon = ((stPhylogenyInfo *) stTree_getClientData(parent))->recon;
+    stReconciliationInfo *bootstrapRecon = ((stPhylogenyInfo *) stTree_getClientData(bootstrapParent))->recon;
+    return recon->event == bootstrapRecon->event && recon->species == bootstrapRecon->species;
+}
+
+// Checks the support of each node of a scored tree against the
+// original scoring of the corresponding node of the unscored tree.
+static void checkBootstrapSupportR(CuTest *testCase, stTree *tree, stTree *scoredTree, stList *bootstraps,
+                                   bool reconciliation) {
+    int64_t support = getIndex(tree)->numBootstraps;
+    for (int64_t i = 0; i < stList_length(bootstraps); i++) {
+        support += getBootstrapSupportReference(tree, stList_get(bootstraps, i), reconciliation);
+    }
+    CuAssertIntEquals(testCase, support, getIndex(scoredTree)->numBootstraps);
+    CuAssertDblEquals(testCase, ((double) support) / stList_length(bootstraps),
+                      getIndex(scoredTree)->bootstrapSupport, 0.0);
+    CuAssertIntEquals(testCase, stTree_getChildNumber(tree), stTree_getChildNumber(scoredTree));
+    for (int64_t i = 0; i < stTree_getChildNumber(tree); i++) {
+        checkBootstrapSupportR(testCase, stTree_getChild(tree, i), stTree_getChild(scoredTree, i), bootstraps,
+                               reconciliation);
+    }
+}
+
+// Gets a copy of the matrix with some noise added to each distance.
+static stMatrix *getNoisyDistanceMatrix(stMatrix *matrix, double noise) {
+    int64_t n = stMatrix_n(matrix);
+    stMatrix *ret = stMatrix_construct(n, n);
+    for (int64_t i = 0; i < n; i++) {
+        for (int64_t j = 0; j < i; j++) {
+            double val = *stMatrix_getCell(matrix, i, j) + st_random() * noise;
+            *stMatrix_getCell(ret, i, j) = val;
+            *stMatrix_getCell(ret, j, i) = val;
+        }
+    }
+    return ret;
+}
+
+static stList *getBootstrapTrees(stMatrix *matrix, int64_t numBootstraps, double noise) {
+    stList *bootstraps = stList_construct();
+    for (int64_t i = 0; i < numBootstraps; i++) {
+        stMatrix *bootstrapMatrix = getNoisyDistanceMatrix(matrix, noise);
+        stList_append(bootstraps, stPhylogeny_neighborJoin(bootstrapMatrix, NULL));
+        stMatrix_destruct(bootstrapMatrix);
+    }
+    return bootstraps;
+}
+
+static void destructTrees(stList *trees) {
+    for (int64_t i = 0; i < stList_length(trees); i++) {
+        stPhylogenyInfo_destructOnTree(stList_get(trees, i));
+        stTree_destruct(stList_get(trees, i));
+    }
+    stList_destruct(trees);
+}
+
+// The hashed bootstrap scoring should give the support the original
+// scoring did, with any number of threads.
+static void testBootstrapScoringMatchesReference(CuTest *testCase) {
+    for (int64_t testNum = 0; testNum < 30; testNum++) {
+        int64_t numLeaves = st_randomInt64(3, 100);
+        stMatrix *matrix = getRandomTreeDistanceMatrix(numLeaves, 0.01);
+        stTree *tree = stPhylogeny_neighborJoin(matrix, NULL);
+        stList *bootstraps = getBootstrapTrees(matrix, st_randomInt64(1, 50), st_random());
+        setRandomReconInfo(tree);
+        for (int64_t i = 0; i < stList_length(bootstraps); i++) {
+            setRandomReconInfo(stList_get(bootstraps, i));
+        }
+        int64_t numThreads = st_randomInt64(1, 5);
+        stTree *scoredTree = stPhylogeny_scoreFromBootstraps2(tree, bootstraps, numThreads);
+        checkBootstrapSupportR(testCase, tree, scoredTree, bootstraps, false);
+        stTree *reconScoredTree = stPhylogeny_scoreReconciliationFromBootstraps2(tree, bootstraps, numThreads);
+        checkBootstrapSupportR(testCase, tree, reconScoredTree, bootstraps, true);
+
+        // Scoring a scored tree adds to its support.
+        stTree *rescoredTree = stPhylogeny_scoreFromBootstraps(scoredTree, bootstraps);
+        checkBootstrapSupportR(testCase, scoredTree, rescoredTree, bootstraps, false);
+
+        stTree *trees[4] = { tree, scoredTree, reconScoredTree, rescoredTree };
+        for (int64_t i = 0; i < 4; i++) {
+            stPhylogenyInfo_destructOnTree(trees[i]);
+            stTree_destruct(trees[i]);
+        }
+        destructTrees(bootstraps);
+        stMatrix_destruct(matrix);
+    }
+}
+
+static void testBootstrapScoring_speed(CuTest *testCase) {
+    int64_t numLeaves = 500;
+    stMatrix *matrix = getRandomTreeDistanceMatrix(numLeaves, 0.01);
+    stTree *tree = stPhylogeny_neighborJoin(matrix, NULL);
+    stList *bootstraps = getBootstrapTrees(matrix, 100, 0.5);
+    double start = wallTime();
+    stTree *scoredTree = stPhylogeny_scoreFromBootstraps(tree, bootstraps);
+    double time = wallTime() - start;
+    start = wallTime();
+    stTree *threadedScoredTree = stPhylogeny_scoreFromBootstraps2(tree, bootstraps, 4);
+    double threadedTime = wallTime() - start;
+    start = wallTime();
+    checkBootstrapSupportR(testCase, tree, scoredTree, bootstraps, false);
+    double referenceTime = wallTime() - start;
+    checkBootstrapSupportR(testCase, tree, threadedScoredTree, bootstraps, false);
+    st_logInfo("Scoring a %" PRIi64 " leaf tree against 100 bootstraps: walking partitions %f seconds, "
+               "hashing %f seconds, %f seconds with 4 threads\n", numLeaves, referenceTime, time, threadedTime);
+
+    stTree *trees[3] = { tree, scoredTree, threadedScoredTree };
+    for (int64_t i = 0; i < 3; i++) {
+        stPhylogenyInfo_destructOnTree(trees[i]);
+        stTree_destruct(trees[i]);
+    }
+    destructTrees(bootstraps);
+    stMatrix_destruct(matrix);
+}
+
 static double getJoinCost(stMatrix *matrix, stHash *speciesToIndex, stTree *tree, const char *label1, const char *label2) {
     stTree *node1;
     if (strcmp(stTree_getLabel(tree), label1) == 0) {
@@ -828,6 +1115,194 @@ static void testGuidedNeighborJoiningReducesToNeighborJoining(CuTest *testCase)
 
 // Check that when join costs are ratcheted up to insane levels, the
 // tree produced has minimal reconciliation cost.
+// The guided neighbor-joining of the full O(n^3) search, which the
+// faster search must match.
+static stTree *guidedNeighborJoiningReference(stMatrix *distanceMatrix, stMatrix *joinCosts,
+                                              int64_t *leafRecon, int64_t **speciesMRCAMatrix) {
+    int64_t numLeaves = stMatrix_n(distanceMatrix);
+    int64_t *recon = st_malloc(numLeaves * sizeof(int64_t));
+    memcpy(recon, leafRecon, numLeaves * sizeof(int64_t));
+    // Only valid for i < j.
+    double **distances = st_calloc(numLeaves, sizeof(double *));
+    double **joinDistances = st_calloc(numLeaves, sizeof(double *));
+    for (int64_t i = 0; i < numLeaves; i++) {
+        distances[i] = st_calloc(numLeaves, sizeof(double));
+        joinDistances[i] = st_calloc(numLeaves, sizeof(double));
+        for (int64_t j = i + 1; j < numLeaves; j++) {
+            distances[i][j] = *stMatrix_getCell(distanceMatrix, i, j);
+            joinDistances[i][j] = *stMatrix_getCell(joinCosts, recon[i], recon[j]);
+        }
+    }
+    double *r = st_calloc(numLeaves, sizeof(double));
+    for (int64_t i = 0; i < numLeaves; i++) {
+        for (int64_t j = 0; j < numLeaves; j++) {
+            if (i != j) {
+                r[i] += i < j ? distances[i][j] : distances[j][i];
+            }
+        }
+        r[i] /= numLeaves - 2;
+    }
+    stTree **nodes = st_calloc(numLeaves, sizeof(stTree *));
+    for (int64_t i = 0; i < numLeaves; i++) {
+        nodes[i] = stTree_construct();
+        char *name = stString_print_r("%" PRIi64, i);
+        stTree_setLabel(nodes[i], name);
+        free(name);
+    }
+    for (int64_t numJoinsLeft = numLeaves - 1; numJoinsLeft > 0; numJoinsLeft--) {
+        double minDist = DBL_MAX;
+        int64_t mini = -1, minj = -1;
+        for (int64_t i = 0; i < numLeaves; i++) {
+            for (int64_t j = i + 1; j < numLeaves && recon[i] != -1; j++) {
+                if (recon[j] == -1) {
+                    continue;
+                }
+                double dist = distances[i][j] + joinDistances[i][j] - r[i] - r[j];
+                if (dist < minDist) {
+                    mini = i;
+                    minj = j;
+                    minDist = dist;
+                }
+            }
+        }
+        double dist_mini_minj = distances[mini][minj];
+        double branchLength_mini = (dist_mini_minj + r[mini] - r[minj]) / 2;
+        double branchLength_minj = dist_mini_minj - branchLength_mini;
+        if ((branchLength_mini <= 0 || branchLength_minj <= 0) && dist_mini_minj < 0) {
+            branchLength_mini = 0;
+            branchLength_minj = 0;
+        } else if (branchLength_mini < 0) {
+            branchLength_mini = 0;
+            branchLength_minj = dist_mini_minj;
+        } else if (branchLength_minj < 0) {
+            branchLength_mini = dist_mini_minj;
+            branchLength_minj = 0;
+        }
+        stTree *joined = stTree_construct();
+        stTree_setParent(nodes[mini], joined);
+        stTree_setParent(nodes[minj], joined);
+        stTree_setBranchLength(nodes[mini], branchLength_mini);
+        stTree_setBranchLength(nodes[minj], branchLength_minj);
+        nodes[mini] = joined;
+        nodes[minj] = NULL;
+        recon[mini] = speciesMRCAMatrix[recon[mini]][recon[minj]];
+        recon[minj] = -1;
+        for (int64_t k = 0; k < numLeaves; k++) {
+            if (recon[k] == -1 || k == mini) {
+                continue;
+            }
+            double *dist_mini_k = mini < k ? &distances[mini][k] : &distances[k][mini];
+            double dist_minj_k = minj < k ? distances[minj][k] : distances[k][minj];
+            double oldDist_mini_k = *dist_mini_k;
+            *dist_mini_k = (oldDist_mini_k + dist_minj_k - dist_mini_minj) / 2;
+            *(mini < k ? &joinDistances[mini][k] : &joinDistances[k][mini]) = *stMatrix_getCell(joinCosts, recon[mini], recon[k]);
+            if (numJoinsLeft > 2) {
+                r[k] = ((r[k] * (numJoinsLeft - 1)) - oldDist_mini_k - dist_minj_k + *dist_mini_k) / (numJoinsLeft - 2);
+            } else {
+                r[k] = 0.0;
+            }
+        }
+        r[mini] = 0.0;
+        if (numJoinsLeft > 2) {
+            for (int64_t k = 0; k < numLeaves; k++) {
+                if (recon[k] != -1) {
+                    r[mini] += k < mini ? distances[k][mini] : distances[mini][k];
+                }
+            }
+            r[mini] /= numJoinsLeft - 2;
+        }
+    }
+    stTree *ret = nodes[0];
+    for (int64_t i = 0; i < numLeaves; i++) {
+        free(distances[i]);
+        free(joinDistances[i]);
+    }
+    free(distances);
+    free(joinDistances);
+    free(recon);
+    free(r);
+    free(nodes);
+    stPhylogeny_addStIndexedTreeInfo(ret);
+    return ret;
+}
+
+// Runs the guided neighbor-joining and the reference on a random
+// problem with the given number of genes, checking the
+// trees are identical, and returns the time taken by each.
+static void testGuidedNeighborJoiningMatchesReference(CuTest *testCase, int64_t maxDepth,
+                                                      int64_t numGenes, int64_t numThreads,
+                                                      bool runReference, double *time, double *referenceTime) {
+    int64_t numSpecies = 0;
+    stTree *speciesTree = getRandomBinaryTree(maxDepth, &numSpecies);
+    while (numSpecies < 3) {
+        stTree_destruct(speciesTree);
+        numSpecies = 0;
+        speciesTree = getRandomBinaryTree(maxDepth, &numSpecies);
+    }
+    stHash *speciesToIndex = stHash_construct2(NULL, (void (*)(void *)) stIntTuple_destruct);
+    stMatrix *joinCosts = stPhylogeny_computeJoinCosts(speciesTree, speciesToIndex, st_random(), st_random());
+    int64_t **speciesMRCAMatrix = stPhylogeny_getMRCAMatrix(speciesTree, speciesToIndex);
+
+    // Gene i is in species i modulo the number of species.
+    int64_t *recon = st_malloc(numGenes * sizeof(int64_t));
+    stHash *matrixIndexToJoinCostIndex = stHash_construct3((uint64_t (*)(const void *)) stIntTuple_hashKey, (int (*)(const void *, const void *)) stIntTuple_equalsFn, (void (*)(void *)) stIntTuple_destruct, (void (*)(void *)) stIntTuple_destruct);
+    for (int64_t i = 0; i < numGenes; i++) {
+        char *speciesName = stString_print("%" PRIi64, i % numSpecies);
+        recon[i] = stIntTuple_get(stHash_search(speciesToIndex, stTree_findChild(speciesTree, speciesName)), 0);
+        stHash_insert(matrixIndexToJoinCostIndex, stIntTuple_construct1(i), stIntTuple_construct1(recon[i]));
+        free(speciesName);
+    }
+    stMatrix *similarityMatrix = getRandomSimilarityMatrix(numGenes, 50, 50);
+    stMatrix *distanceMatrix = getDistanceMatrixFromSimilarityMatrix(similarityMatrix);
+
+    // Alternate between the precomputed MRCA matrix and the species
+    // tree's LCA index.
+    double start = wallTime();
+    stTree *tree = stPhylogeny_guidedNeighborJoining2(distanceMatrix, similarityMatrix, joinCosts,
+                                                      matrixIndexToJoinCostIndex, speciesToIndex,
+                                                      numGenes % 2 == 0 ? speciesMRCAMatrix : NULL,
+                                                      speciesTree, numThreads);
+    *time = wallTime() - start;
+    if (runReference) {
+        start = wallTime();
+        stTree *referenceTree = guidedNeighborJoiningReference(distanceMatrix, joinCosts, recon, speciesMRCAMatrix);
+        *referenceTime = wallTime() - start;
+        CuAssertTrue(testCase, isTreeIdentical(referenceTree, tree));
+        stPhylogenyInfo_destructOnTree(referenceTree);
+        stTree_destruct(referenceTree);
+    }
+
+    stPhylogenyInfo_destructOnTree(tree);
+    stTree_destruct(tree);
+    stMatrix_destruct(distanceMatrix);
+    stMatrix_destruct(similarityMatrix);
+    stHash_destruct(matrixIndexToJoinCostIndex);
+    free(recon);
+    for (int64_t i = 0; i < stTree_getNumNodes(speciesTree); i++) {
+        free(speciesMRCAMatrix[i]);
+    }
+    free(speciesMRCAMatrix);
+    stMatrix_destruct(joinCosts);
+    stHash_destruct(speciesToIndex);
+    stTree_destruct(speciesTree);
+}
+
+static void testGuidedNeighborJoining_random(CuTest *testCase) {
+    for (int64_t testNum = 0; testNum < 50; testNum++) {
+        double time, referenceTime;
+        testGuidedNeighborJoiningMatchesReference(testCase, st_randomInt64(2, 7), st_randomInt64(3, 200),
+                                                  st_randomInt64(1, 5), true, &time, &referenceTime);
+    }
+}
+
+static void testGuidedNeighborJoining_speed(CuTest *testCase) {
+    double time, referenceTime, threadedTime;
+    testGuidedNeighborJoiningMatchesReference(testCase, 8, 1000, 1, true, &time, &referenceTime);
+    testGuidedNeighborJoiningMatchesReference(testCase, 8, 1000, 4, false, &threadedTime, &referenceTime);
+    st_logInfo("Guided neighbor-joining of 1000 genes: full search %f seconds, "
+               "%f seconds, %f seconds with 4 threads\n", referenceTime, time, threadedTime);
+}
+
 static void testGuidedNeighborJoiningLowersReconCost(CuTest *testCase)
 {
     for (int64_t testNum = 0; testNum < 100; testNum++) {
@@ -1353,6 +1828,192 @@ _|               |                 ________________ CAT.0
     stTree_destruct(tree);
 }
 
+// The d-splits as the original stPhylogeny_getSplits found them,
+// checking every quartet of every candidate split.
+static bool satisfiesFourPointReference(stMatrix *distanceMatrix, stList *leftSplit, stList *rightSplit,
+                                        bool relaxed, double *minQuartet) {
+    *minQuartet = DBL_MAX;
+    for (int64_t left_i = 0; left_i < stList_length(leftSplit); left_i++) {
+        for (int64_t left_j = left_i + 1; left_j < stList_length(leftSplit); left_j++) {
+            int64_t i = stIntTuple_get(stList_get(leftSplit, left_i), 0);
+            int64_t j = stIntTuple_get(stList_get(leftSplit, left_j), 0);
+            for (int64_t right_i = 0; right_i < stList_length(rightSplit); right_i++) {
+                for (int64_t right_j = right_i + 1; right_j < stList_length(rightSplit); right_j++) {
+                    int64_t k = stIntTuple_get(stList_get(rightSplit, right_i), 0);
+                    int64_t l = stIntTuple_get(stList_get(rightSplit, right_j), 0);
+                    double intra = *stMatrix_getCell(distanceMatrix, i, j) + *stMatrix_getCell(distanceMatrix, k, l);
+                    double inter1 = *stMatrix_getCell(distanceMatrix, i, k) + *stMatrix_getCell(distanceMatrix, j, l);
+                    double inter2 = *stMatrix_getCell(distanceMatrix, i, l) + *stMatrix_getCell(distanceMatrix, j, k);
+                    if (relaxed ? (intra >= inter1 && intra >= inter2) : (intra >= inter1 || intra >= inter2)) {
+                        return false;
+                    }
+                    double maxDist = intra;
+                    if (inter1 > maxDist) {
+                        maxDist = inter1;
+                    }
+                    if (inter2 > maxDist) {
+                        maxDist = inter2;
+                    }
+                    if (maxDist - intra < *minQuartet) {
+                        *minQuartet = maxDist - intra;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+static stList *cloneIndexList(stList *indices) {
+    stList *ret = stList_construct3(0, (void (*)(void *)) stIntTuple_destruct);
+    for (int64_t i = 0; i < stList_length(indices); i++) {
+        stList_append(ret, stIntTuple_construct1(stIntTuple_get(stList_get(indices, i), 0)));
+    }
+    return ret;
+}
+
+static void splitReference_destruct(stSplit *split) {
+    stList_destruct(split->leftSplit);
+    stList_destruct(split->rightSplit);
+    free(split);
+}
+
+static int splitReference_cmp(stSplit *split1, stSplit *split2) {
+    return split1->isolationIndex < split2->isolationIndex ? -1 : split1->isolationIndex > split2->isolationIndex;
+}
+
+static stList *getSplitsReference(stMatrix *distanceMatrix, bool relaxed) {
+    stList *splits = stList_construct3(0, (void (*)(void *)) splitReference_destruct);
+    for (int64_t i = 1; i < stMatrix_m(distanceMatrix); i++) {
+        stList *newSplits = stList_construct3(0, (void (*)(void *)) splitReference_destruct);
+        stSplit *singletonSplit = st_malloc(sizeof(stSplit));
+        singletonSplit->leftSplit = stList_construct3(0, (void (*)(void *)) stIntTuple_destruct);
+        stList_append(singletonSplit->leftSplit, stIntTuple_construct1(i));
+        singletonSplit->rightSplit = stList_construct3(0, (void (*)(void *)) stIntTuple_destruct);
+        for (int64_t j = 0; j < i; j++) {
+            stList_append(singletonSplit->rightSplit, stIntTuple_construct1(j));
+        }
+        singletonSplit->isolationIndex = 0.0;
+        stList_append(newSplits, singletonSplit);
+        while (stList_length(splits) > 0) {
+            stSplit *split = stList_pop(splits);
+            double minQuartet;
+            stList_append(split->leftSplit, stIntTuple_construct1(i));
+            bool addToLeft = satisfiesFourPointReference(distanceMatrix, split->leftSplit, split->rightSplit,
+                                                         relaxed, &minQuartet);
+            stIntTuple_destruct(stList_pop(split->leftSplit));
+            stList_append(split->rightSplit, stIntTuple_construct1(i));
+            bool addToRight = satisfiesFourPointReference(distanceMatrix, split->leftSplit, split->rightSplit,
+                                                          relaxed, &minQuartet);
+            split->isolationIndex = minQuartet / 2;
+            if (addToRight) {
+                stSplit *addedToRight = st_malloc(sizeof(stSplit));
+                addedToRight->leftSplit = cloneIndexList(split->leftSplit);
+                addedToRight->rightSplit = cloneIndexList(split->rightSplit);
+                addedToRight->isolationIndex = split->isolationIndex;
+                stList_append(newSplits, addedToRight);
+            }
+            stIntTuple_destruct(stList_pop(split->rightSplit));
+            if (addToLeft) {
+                stList_append(split->leftSplit, stIntTuple_construct1(i));
+                satisfiesFourPointReference(distanceMatrix, split->leftSplit, split->rightSplit,
+                                            relaxed, &minQuartet);
+                split->isolationIndex = minQuartet / 2;
+                stList_append(newSplits, split);
+            } else {
+                splitReference_destruct(split);
+            }
+        }
+        stList_destruct(splits);
+        splits = newSplits;
+    }
+    for (int64_t i = 0; i < stList_length(splits); i++) {
+        stSplit *split = stList_get(splits, i);
+        if (stList_length(split->leftSplit) == 1 || stList_length(split->rightSplit) == 1) {
+            stList_remove(splits, i--);
+            splitReference_destruct(split);
+        }
+    }
+    stList_sort(splits, (int (*)(const void *, const void *)) splitReference_cmp);
+    stList_reverse(splits);
+    return splits;
+}
+
+static bool isIndexListIdentical(stList *indices1, stList *indices2) {
+    if (stList_length(indices1) != stList_length(indices2)) {
+        return false;
+    }
+    for (int64_t i = 0; i < stList_length(indices1); i++) {
+        if (stIntTuple_get(stList_get(indices1, i), 0) != stIntTuple_get(stList_get(indices2, i), 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The bitset splits should be exactly the splits, in the same order
+// and with the same isolation indexes, that checking every quartet
+// finds, with any number of threads.
+static void testStPhylogeny_getSplits_random(CuTest *testCase) {
+    for (int64_t testNum = 0; testNum < 40; testNum++) {
+        int64_t numLeaves = st_randomInt64(2, 40);
+        stMatrix *distanceMatrix = testNum % 2 == 0 ? getRandomTreeDistanceMatrix(numLeaves, st_random())
+                                                    : getRandomIntegerDistanceMatrix(numLeaves);
+        bool relaxed = st_random() > 0.5;
+        stList *referenceSplits = getSplitsReference(distanceMatrix, relaxed);
+        stList *splits = stPhylogeny_getSplits2(distanceMatrix, relaxed, st_randomInt64(1, 5));
+        CuAssertIntEquals(testCase, stList_length(referenceSplits), stList_length(splits));
+        for (int64_t i = 0; i < stList_length(splits); i++) {
+            stSplit *referenceSplit = stList_get(referenceSplits, i);
+            stSplit *split = stList_get(splits, i);
+            CuAssertTrue(testCase, isIndexListIdentical(referenceSplit->leftSplit, split->leftSplit));
+            CuAssertTrue(testCase, isIndexListIdentical(referenceSplit->rightSplit, split->rightSplit));
+            CuAssertTrue(testCase, referenceSplit->isolationIndex == split->isolationIndex);
+        }
+
+        // The greedy decomposition should be the same with any number
+        // of threads.
+        stTree *tree = stPhylogeny_greedySplitDecomposition(distanceMatrix, relaxed);
+        stTree *threadedTree = stPhylogeny_greedySplitDecomposition2(distanceMatrix, relaxed, st_randomInt64(2, 5));
+        char *newick = stTree_getNewickTreeString(tree);
+        char *threadedNewick = stTree_getNewickTreeString(threadedTree);
+        CuAssertStrEquals(testCase, newick, threadedNewick);
+        free(newick);
+        free(threadedNewick);
+        stPhylogenyInfo_destructOnTree(tree);
+        stTree_destruct(tree);
+        stPhylogenyInfo_destructOnTree(threadedTree);
+        stTree_destruct(threadedTree);
+
+        stList_destruct(splits);
+        stList_destruct(referenceSplits);
+        stMatrix_destruct(distanceMatrix);
+    }
+}
+
+static void testStPhylogeny_greedySplitDecomposition_speed(CuTest *testCase) {
+    int64_t numLeaves = 100;
+    stMatrix *distanceMatrix = getRandomTreeDistanceMatrix(numLeaves, 0.01);
+    double start = wallTime();
+    stList *referenceSplits = getSplitsReference(distanceMatrix, false);
+    double referenceTime = wallTime() - start;
+    start = wallTime();
+    stTree *tree = stPhylogeny_greedySplitDecomposition(distanceMatrix, false);
+    double time = wallTime() - start;
+    start = wallTime();
+    stTree *threadedTree = stPhylogeny_greedySplitDecomposition2(distanceMatrix, false, 4);
+    double threadedTime = wallTime() - start;
+    st_logInfo("Split decomposition of %" PRIi64 " leaves: every quartet %f seconds, "
+               "%f seconds, %f seconds with 4 threads\n", numLeaves, referenceTime, time, threadedTime);
+    CuAssertTrue(testCase, stList_length(referenceSplits) > 0);
+    stList_destruct(referenceSplits);
+    stPhylogenyInfo_destructOnTree(tree);
+    stTree_destruct(tree);
+    stPhylogenyInfo_destructOnTree(threadedTree);
+    stTree_destruct(threadedTree);
+    stMatrix_destruct(distanceMatrix);
+}
+
 static void testStPhylogeny_getLinkedSpeciesTree(CuTest *testCase) {
     // Hackily including the definition here, so I don't have to
     // create a whole stPhylogeny_private.h and worry about where it
@@ -1452,6 +2113,8 @@ CuSuite* sonLib_stPhylogenyTestSuite(void) {
     SUITE_ADD_TEST(suite, testStPhylogeny_getLinkedSpeciesTree);
     SUITE_ADD_TEST(suite, testStPhylogeny_greedySplitDecomposition);
     SUITE_ADD_TEST(suite, testStPhylogeny_getSplits);
+    SUITE_ADD_TEST(suite, testStPhylogeny_getSplits_random);
+    SUITE_ADD_TEST(suite, testStPhylogeny_greedySplitDecomposition_speed);
     SUITE_ADD_TEST(suite, testStPhylogeny_nni);
     SUITE_ADD_TEST(suite, testJoinCosts_random);
     SUITE_ADD_TEST(suite, testStPhylogeny_reconcileAtMostBinary_degree2Nodes);
@@ -1459,10 +2122,16 @@ CuSuite* sonLib_stPhylogenyTestSuite(void) {
     SUITE_ADD_TEST(suite, testSimpleBootstrapPartitionScoring);
     SUITE_ADD_TEST(suite, testSimpleBootstrapReconciliationScoring);
     SUITE_ADD_TEST(suite, testRandomNeighborJoin);
+    SUITE_ADD_TEST(suite, testNeighborJoinMatchesQuickTree);
+    SUITE_ADD_TEST(suite, testNeighborJoin_speed);
     SUITE_ADD_TEST(suite, testRandomBootstraps);
+    SUITE_ADD_TEST(suite, testBootstrapScoringMatchesReference);
+    SUITE_ADD_TEST(suite, testBootstrapScoring_speed);
     SUITE_ADD_TEST(suite, testSimpleJoinCosts);
     SUITE_ADD_TEST(suite, testGuidedNeighborJoiningReducesToNeighborJoining);
     SUITE_ADD_TEST(suite, testGuidedNeighborJoiningLowersReconCost);
+    SUITE_ADD_TEST(suite, testGuidedNeighborJoining_random);
+    SUITE_ADD_TEST(suite, testGuidedNeighborJoining_speed);
     SUITE_ADD_TEST(suite, testStPhylogeny_rootByReconciliationAtMostBinary_simpleTests);
     SUITE_ADD_TEST(suite, testStPhylogeny_rootByReconciliationAtMostBinary_random);
     SUITE_ADD_TEST(suite, testStPhylogeny_reconcileNonBinary);
@@ -1473,6 +2142,8 @@ CuSuite* sonLib_stPhylogenyTestSuite(void) {
     (void) testStPhylogeny_getLinkedSpeciesTree;
     (void) testStPhylogeny_greedySplitDecomposition;
     (void) testStPhylogeny_getSplits;
+    (void) testStPhylogeny_getSplits_random;
+    (void) testStPhylogeny_greedySplitDecomposition_speed;
     (void) testStPhylogeny_nni;
     (void) testJoinCosts_random;
     (void) testStPhylogeny_reconcileAtMostBinary_degree2Nodes;
@@ -1481,6 +2152,8 @@ CuSuite* sonLib_stPhylogenyTestSuite(void) {
     (void) testSimpleBootstrapReconciliationScoring;
     (void) testRandomNeighborJoin;
     (void) testRandomBootstraps;
+    (void) testBootstrapScoringMatchesReference;
+    (void) testBootstrapScoring_speed;
     (void) testSimpleJoinCosts;
     (void) testGuidedNeighborJoiningReducesToNeighborJoining;
     (void) testGuidedNeighborJoiningLowersReconCost;
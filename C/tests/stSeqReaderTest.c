@@ -0,0 +1,214 @@
+#include "CuTest.h"
+#include "sonLib.h"
+#include <pthread.h>
+#include <zlib.h>
+
+static char *tempFileDir = "stSeqReaderTestTempDir";
+static char *tempFileName = "stSeqReaderTestTempDir/reads";
+static char *tempGzFileName = "stSeqReaderTestTempDir/reads.gz";
+
+static void teardown(void) {
+    if (stFile_exists(tempFileDir)) {
+        stFile_rmrf(tempFileDir);
+    }
+}
+
+static void setup(void) {
+    teardown();
+    stFile_mkdir(tempFileDir);
+}
+
+// Holds copies of the records passed to the callback.
+typedef struct _recordCollector {
+    pthread_mutex_t lock;
+    stList *headers;
+    stList *sequences;
+    stList *qualities;
+} recordCollector;
+
+static recordCollector *recordCollector_construct(void) {
+    recordCollector *collector = st_malloc(sizeof(recordCollector));
+    pthread_mutex_init(&collector->lock, NULL);
+    collector->headers = stList_construct3(0, free);
+    collector->sequences = stList_construct3(0, free);
+    collector->qualities = stList_construct3(0, free);
+    return collector;
+}
+
+static void recordCollector_destruct(recordCollector *collector) {
+    pthread_mutex_destroy(&collector->lock);
+    stList_destruct(collector->headers);
+    stList_destruct(collector->sequences);
+    stList_destruct(collector->qualities);
+    free(collector);
+}
+
+static void collectRecord(const stSeqRecord *record, void *arg) {
+    recordCollector *collector = arg;
+    assert(strlen(record->sequence) == record->length);
+    pthread_mutex_lock(&collector->lock);
+    stList_append(collector->headers, stString_copy(record->header));
+    stList_append(collector->sequences, stString_copy(record->sequence));
+    stList_append(collector->qualities, record->qualities == NULL ? NULL : stString_copy(record->qualities));
+    pthread_mutex_unlock(&collector->lock);
+}
+
+// Writes a gzipped copy of the temp file.
+static void gzipTempFile(void) {
+    FILE *fileHandle = fopen(tempFileName, "r");
+    gzFile gzFileHandle = gzopen(tempGzFileName, "wb");
+    char buffer[65536];
+    size_t bytesRead;
+    while ((bytesRead = fread(buffer, 1, sizeof(buffer), fileHandle)) > 0) {
+        gzwrite(gzFileHandle, buffer, bytesRead);
+    }
+    gzclose(gzFileHandle);
+    fclose(fileHandle);
+}
+
+static char *getRandomString(int64_t length, const char *alphabet) {
+    char *string = st_malloc(length + 1);
+    int64_t alphabetSize = strlen(alphabet);
+    for (int64_t i = 0; i < length; i++) {
+        string[i] = alphabet[st_randomInt(0, alphabetSize)];
+    }
+    string[length] = '\0';
+    return string;
+}
+
+// Reads the file in each mode and checks the records against the
+// expected ones, comparing unordered records by header.
+static void checkRecords(CuTest *testCase, const char *fileName, stList *headers, stList *sequences,
+                         stList *qualities) {
+    for (int64_t ordered = 0; ordered < 2; ordered++) {
+        for (int64_t numThreads = 1; numThreads <= 4; numThreads += 3) {
+            recordCollector *collector = recordCollector_construct();
+            stSeqReader_read(fileName, numThreads, ordered, collectRecord, collector);
+            CuAssertIntEquals(testCase, stList_length(headers), stList_length(collector->headers));
+            stHash *headerToIndex = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, NULL, NULL);
+            for (int64_t i = 0; i < stList_length(collector->headers); i++) {
+                stHash_insert(headerToIndex, stList_get(collector->headers, i), (void *) (i + 1));
+            }
+            for (int64_t i = 0; i < stList_length(headers); i++) {
+                int64_t j = ordered ? i : (int64_t) stHash_search(headerToIndex, stList_get(headers, i)) - 1;
+                CuAssertTrue(testCase, j >= 0);
+                CuAssertStrEquals(testCase, stList_get(headers, i), stList_get(collector->headers, j));
+                CuAssertStrEquals(testCase, stList_get(sequences, i), stList_get(collector->sequences, j));
+                if (qualities == NULL) {
+                    CuAssertTrue(testCase, stList_get(collector->qualities, j) == NULL);
+                } else {
+                    CuAssertStrEquals(testCase, stList_get(qualities, i), stList_get(collector->qualities, j));
+                }
+            }
+            stHash_destruct(headerToIndex);
+            recordCollector_destruct(collector);
+        }
+    }
+}
+
+// Fasta with a range of line lengths, white space and record sizes,
+// including one record much bigger than a chunk.
+static void test_stSeqReader_fasta(CuTest *testCase) {
+    setup();
+    stList *headers = stList_construct3(0, free);
+    stList *sequences = stList_construct3(0, free);
+    FILE *fileHandle = fopen(tempFileName, "w");
+    fprintf(fileHandle, "text before the first header is ignored\n");
+    for (int64_t i = 0; i < 3000; i++) {
+        int64_t length = i == 1000 ? 6000000 : st_randomInt(0, 10000);
+        char *sequence = getRandomString(length, "ACGTNacgtn-");
+        char *header = stString_print("seq%" PRIi64 " description", i);
+        int64_t lineLength = st_randomInt(1, 200);
+        const char *newLine = st_random() > 0.9 ? "\r\n" : "\n";
+        fprintf(fileHandle, ">%s%s", header, newLine);
+        for (int64_t j = 0; j < length; j += lineLength) {
+            if (st_random() > 0.99) {
+                fprintf(fileHandle, " \t");
+            }
+            fprintf(fileHandle, "%.*s%s", (int) (length - j < lineLength ? length - j : lineLength), sequence + j,
+                    newLine);
+        }
+        if (st_random() > 0.9) {
+            fprintf(fileHandle, "\n");
+        }
+        stList_append(headers, header);
+        stList_append(sequences, sequence);
+    }
+    fclose(fileHandle);
+    gzipTempFile();
+    checkRecords(testCase, tempFileName, headers, sequences, NULL);
+    checkRecords(testCase, tempGzFileName, headers, sequences, NULL);
+    stList_destruct(headers);
+    stList_destruct(sequences);
+    teardown();
+}
+
+static void test_stSeqReader_fastq(CuTest *testCase) {
+    setup();
+    stList *headers = stList_construct3(0, free);
+    stList *sequences = stList_construct3(0, free);
+    stList *qualities = stList_construct3(0, free);
+    FILE *fileHandle = fopen(tempFileName, "w");
+    for (int64_t i = 0; i < 50000; i++) {
+        int64_t length = st_randomInt(0, 300);
+        char *header = stString_print("read%" PRIi64 " description", i);
+        char *sequence = getRandomString(length, "ACGTN");
+        char *quality = getRandomString(length, "!#+5?IJ~");
+        fprintf(fileHandle, "@%s\n%s\n+%s\n%s\n", header, sequence, st_random() > 0.5 ? header : "", quality);
+        stList_append(headers, header);
+        stList_append(sequences, sequence);
+        stList_append(qualities, quality);
+    }
+    fclose(fileHandle);
+    gzipTempFile();
+    checkRecords(testCase, tempFileName, headers, sequences, qualities);
+    checkRecords(testCase, tempGzFileName, headers, sequences, qualities);
+    stList_destruct(headers);
+    stList_destruct(sequences);
+    stList_destruct(qualities);
+    teardown();
+}
+
+static void checkThrows(CuTest *testCase, const char *fileName, bool ordered, recordCollector *collector) {
+    stTry {
+        stSeqReader_read(fileName, 4, ordered, collectRecord, collector);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_getId(except) == ST_SEQ_READER_EXCEPTION);
+    } stTryEnd;
+}
+
+// Records before a malformed one are all passed on in ordered mode.
+static void test_stSeqReader_malformed(CuTest *testCase) {
+    setup();
+    FILE *fileHandle = fopen(tempFileName, "w");
+    for (int64_t i = 0; i < 100000; i++) {
+        fprintf(fileHandle, "@read%" PRIi64 "\nACGT\n+\n%s\n", i, i == 90000 ? "III" : "IIII");
+    }
+    fclose(fileHandle);
+    recordCollector *collector = recordCollector_construct();
+    checkThrows(testCase, tempFileName, 1, collector);
+    CuAssertIntEquals(testCase, 90000, stList_length(collector->headers));
+    recordCollector_destruct(collector);
+    collector = recordCollector_construct();
+    checkThrows(testCase, tempFileName, 0, collector);
+    recordCollector_destruct(collector);
+
+    fileHandle = fopen(tempFileName, "w");
+    fprintf(fileHandle, ">one\nACGT\n>two\nAC*GT\n");
+    fclose(fileHandle);
+    collector = recordCollector_construct();
+    checkThrows(testCase, tempFileName, 1, collector);
+    CuAssertIntEquals(testCase, 1, stList_length(collector->headers));
+    checkThrows(testCase, "stSeqReaderTestTempDir/missing", 1, collector);
+    recordCollector_destruct(collector);
+    teardown();
+}
+
+CuSuite *sonLib_stSeqReaderTestSuite(void) {
+    CuSuite *suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, test_stSeqReader_fasta);
+    SUITE_ADD_TEST(suite, test_stSeqReader_fastq);
+    SUITE_ADD_TEST(suite, test_stSeqReader_malformed);
+    return suite;
+}
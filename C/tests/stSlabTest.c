@@ -0,0 +1,172 @@
+#include "CuTest.h"
+#include "sonLib.h"
+
+// Fills the object with bytes that depend on its index, to check
+// objects don't overlap.
+static void fillObject(unsigned char *object, int64_t size, int64_t i) {
+    for (int64_t j = 0; j < size; j++) {
+        object[j] = (unsigned char) (i + j);
+    }
+}
+
+static bool checkObject(unsigned char *object, int64_t size, int64_t i) {
+    for (int64_t j = 0; j < size; j++) {
+        if (object[j] != (unsigned char) (i + j)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void test_st_slabMalloc(CuTest *testCase) {
+    int64_t numObjects = 100000;
+    unsigned char **objects = st_malloc(numObjects * sizeof(unsigned char *));
+    int64_t *sizes = st_malloc(numObjects * sizeof(int64_t));
+    for (int64_t i = 0; i < numObjects; i++) {
+        sizes[i] = st_randomInt(0, ST_SLAB_MAX_SIZE + 1);
+        objects[i] = st_slabMalloc(sizes[i]);
+        CuAssertTrue(testCase, ((uintptr_t) objects[i]) % 16 == 0);
+        fillObject(objects[i], sizes[i], i);
+    }
+    // Free and replace a random half, several times.
+    for (int64_t round = 0; round < 5; round++) {
+        for (int64_t i = 0; i < numObjects; i++) {
+            if (st_random() < 0.5) {
+                CuAssertTrue(testCase, checkObject(objects[i], sizes[i], i));
+                st_slabFree(objects[i]);
+                objects[i] = NULL;
+            }
+        }
+        for (int64_t i = 0; i < numObjects; i++) {
+            if (objects[i] == NULL) {
+                sizes[i] = st_randomInt(0, ST_SLAB_MAX_SIZE + 1);
+                objects[i] = st_random() < 0.5 ? st_slabMalloc(sizes[i]) : st_slabCalloc(sizes[i]);
+                fillObject(objects[i], sizes[i], i);
+            }
+        }
+    }
+    for (int64_t i = 0; i < numObjects; i++) {
+        CuAssertTrue(testCase, checkObject(objects[i], sizes[i], i));
+        st_slabFree(objects[i]);
+    }
+    st_slabFree(NULL);
+    unsigned char *object = st_slabCalloc(100);
+    for (int64_t i = 0; i < 100; i++) {
+        CuAssertIntEquals(testCase, 0, object[i]);
+    }
+    st_slabFree(object);
+    free(sizes);
+    free(objects);
+}
+
+static unsigned char **threadObjects;
+
+static void allocateObjects(int64_t start, int64_t end, void *arg) {
+    for (int64_t i = start; i < end; i++) {
+        threadObjects[i] = st_slabMalloc(i % 200);
+        fillObject(threadObjects[i], i % 200, i);
+    }
+}
+
+// Frees the objects in reverse, so mostly by a different thread to
+// the one that allocated them.
+static void freeObjects(int64_t start, int64_t end, void *arg) {
+    int64_t numObjects = *(int64_t *) arg;
+    for (int64_t i = start; i < end; i++) {
+        int64_t j = numObjects - 1 - i;
+        if (!checkObject(threadObjects[j], j % 200, j)) {
+            fprintf(stderr, "Object %" PRIi64 " was overwritten\n", j);
+            abort();
+        }
+        st_slabFree(threadObjects[j]);
+    }
+}
+
+// Objects allocated and freed by many threads, including ones that
+// exit, are reused rather than taking more memory.
+static void test_st_slabMallocThreads(CuTest *testCase) {
+    int64_t numObjects = 200000;
+    threadObjects = st_malloc(numObjects * sizeof(unsigned char *));
+    int64_t memoryUsage = 0;
+    for (int64_t round = 0; round < 10; round++) {
+        stThreadPool *threadPool = stThreadPool_construct(st_randomInt(1, 8), NULL, NULL);
+        stThreadPool_parallelFor(threadPool, numObjects, 100, allocateObjects, NULL);
+        stThreadPool_parallelFor(threadPool, numObjects, 100, freeObjects, &numObjects);
+        stThreadPool_destruct(threadPool);
+        if (round == 0) {
+            memoryUsage = st_slabGetMemoryUsage();
+        }
+    }
+    CuAssertTrue(testCase, st_slabGetMemoryUsage() <= 2 * memoryUsage);
+    free(threadObjects);
+}
+
+// Slabs are given back to the system once all their objects are freed,
+// apart from the one being allocated from.
+static void test_st_slabFreeReleasesSlabs(CuTest *testCase) {
+    int64_t numObjects = 100000;
+    void **objects = st_malloc(numObjects * sizeof(void *));
+    int64_t memoryUsage = st_slabGetMemoryUsage();
+    for (int64_t i = 0; i < numObjects; i++) {
+        objects[i] = st_slabMalloc(64);
+    }
+    for (int64_t i = 0; i < numObjects; i++) {
+        st_slabFree(objects[i]);
+    }
+    CuAssertTrue(testCase, st_slabGetMemoryUsage() <= memoryUsage + (1 << 16));
+    free(objects);
+}
+
+// The slabs of threads that have exited, including full ones, are
+// neither reused by new threads while their objects are allocated nor
+// kept once their objects are freed.
+static void test_st_slabFreeAfterThreadExit(CuTest *testCase) {
+    int64_t numObjects = 200000, halfNumObjects = numObjects / 2;
+    threadObjects = st_malloc(numObjects * sizeof(unsigned char *));
+    int64_t memoryUsage = st_slabGetMemoryUsage();
+    stThreadPool *threadPool = stThreadPool_construct(4, NULL, NULL);
+    stThreadPool_parallelFor(threadPool, numObjects, 100, allocateObjects, NULL);
+    stThreadPool_destruct(threadPool);
+    // Frees the second half, by new threads.
+    threadPool = stThreadPool_construct(4, NULL, NULL);
+    stThreadPool_parallelFor(threadPool, halfNumObjects, 100, freeObjects, &numObjects);
+    stThreadPool_destruct(threadPool);
+    for (int64_t i = 0; i < halfNumObjects; i++) {
+        CuAssertTrue(testCase, checkObject(threadObjects[i], i % 200, i));
+        st_slabFree(threadObjects[i]);
+    }
+    CuAssertTrue(testCase, st_slabGetMemoryUsage() <= memoryUsage);
+    free(threadObjects);
+}
+
+static void test_stArena(CuTest *testCase) {
+    stArena *arena = stArena_construct();
+    int64_t numObjects = 10000, totalSize = 0;
+    unsigned char **objects = st_malloc(numObjects * sizeof(unsigned char *));
+    int64_t *sizes = st_malloc(numObjects * sizeof(int64_t));
+    for (int64_t i = 0; i < numObjects; i++) {
+        sizes[i] = st_random() < 0.01 ? st_randomInt(0, 100000) : st_randomInt(0, 100);
+        objects[i] = i % 2 == 0 ? stArena_malloc(arena, sizes[i]) : stArena_calloc(arena, sizes[i]);
+        CuAssertTrue(testCase, ((uintptr_t) objects[i]) % 16 == 0);
+        fillObject(objects[i], sizes[i], i);
+        totalSize += sizes[i];
+    }
+    for (int64_t i = 0; i < numObjects; i++) {
+        CuAssertTrue(testCase, checkObject(objects[i], sizes[i], i));
+    }
+    CuAssertTrue(testCase, stArena_getMemoryUsage(arena) >= totalSize);
+    CuAssertTrue(testCase, stArena_getMemoryUsage(arena) < 2 * totalSize + 100000);
+    stArena_destruct(arena);
+    free(sizes);
+    free(objects);
+}
+
+CuSuite *sonLib_stSlabTestSuite(void) {
+    CuSuite *suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, test_st_slabMalloc);
+    SUITE_ADD_TEST(suite, test_st_slabMallocThreads);
+    SUITE_ADD_TEST(suite, test_st_slabFreeReleasesSlabs);
+    SUITE_ADD_TEST(suite, test_st_slabFreeAfterThreadExit);
+    SUITE_ADD_TEST(suite, test_stArena);
+    return suite;
+}
@@ -1,5 +1,7 @@
 #include "CuTest.h"
 #include "sonLib.h"
+#include <sys/time.h>
+#include <math.h>
 
 // Test sorting a few sublists into a larger list to try to catch out
 // any race conditions.
@@ -29,8 +31,8 @@ static void insertSubList(stList *result) {
     sorted = newSorted;
 }
 
-static void testStThreadPoolSort(CuTest *testCase) {
-    for (int64_t testNum = 0; testNum < 3; testNum++) {
+static void testStThreadPoolSort2(CuTest *testCase, int64_t numTests, bool workStealing) {
+    for (int64_t testNum = 0; testNum < numTests; testNum++) {
         // Create two lists, one containing a bunch of random numbers
         // and the other containing a bunch of sublists that contain
         // the same numbers, in aggregate.
@@ -54,11 +56,16 @@ static void testStThreadPoolSort(CuTest *testCase) {
         stList_sort(truth, (int (*)(const void *, const void *)) stIntTuple_cmpFn);
 
         // Now create a bunch of threads and ask them to sort theirs.
-        stThreadPool *threadPool = stThreadPool_construct(st_randomInt64(1, 6),
-                                                          (void *(*)(void *)) sortSubList,
-                                                          (void (*)(void *)) insertSubList);
-        for (int64_t i = 0; i < stList_length(lists); i++) {
-            stThreadPool_push(threadPool, stList_get(lists, i));
+        stThreadPool *threadPool = stThreadPool_construct2(st_randomInt64(1, 6),
+                                                           (void *(*)(void *)) sortSubList,
+                                                           (void (*)(void *)) insertSubList,
+                                                           workStealing);
+        if (st_random() > 0.5) {
+            stThreadPool_pushAll(threadPool, lists);
+        } else {
+            for (int64_t i = 0; i < stList_length(lists); i++) {
+                stThreadPool_push(threadPool, stList_get(lists, i));
+            }
         }
 
         // Wait for the process to complete.
@@ -79,8 +86,262 @@ static void testStThreadPoolSort(CuTest *testCase) {
     }
 }
 
+static void testStThreadPoolSort(CuTest *testCase) {
+    testStThreadPoolSort2(testCase, 3, false);
+}
+
+static void testStThreadPoolSortWorkStealing(CuTest *testCase) {
+    testStThreadPoolSort2(testCase, 1, true);
+}
+
+// Test work functions pushing more work, by summing a range of
+// integers that is recursively split into child work units.
+typedef struct _range {
+    int64_t start;
+    int64_t end;
+    int64_t sum;
+} range;
+
+static stThreadPool *rangePool;
+static int64_t rangeTotal;
+static int64_t rangeGrainSize;
+
+static range *sumRange(range *r) {
+    if (r->end - r->start > rangeGrainSize) {
+        int64_t mid = r->start + (r->end - r->start) / 2;
+        range *left = st_malloc(sizeof(range));
+        left->start = r->start;
+        left->end = mid;
+        range *right = st_malloc(sizeof(range));
+        right->start = mid;
+        right->end = r->end;
+        stThreadPool_push(rangePool, left);
+        stThreadPool_push(rangePool, right);
+        r->sum = 0;
+    } else {
+        r->sum = 0;
+        for (int64_t i = r->start; i < r->end; i++) {
+            r->sum += i;
+        }
+    }
+    return r;
+}
+
+static void addRange(range *r) {
+    rangeTotal += r->sum;
+    free(r);
+}
+
+static double wallTime(void) {
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    return t.tv_sec + t.tv_usec / 1000000.0;
+}
+
+static double timeRangeSum(CuTest *testCase, int64_t numThreads, int64_t n, bool workStealing) {
+    double startTime = wallTime();
+    rangeTotal = 0;
+    rangePool = stThreadPool_construct2(numThreads, (void *(*)(void *)) sumRange,
+                                        (void (*)(void *)) addRange, workStealing);
+    range *r = st_malloc(sizeof(range));
+    r->start = 0;
+    r->end = n;
+    stThreadPool_push(rangePool, r);
+    stThreadPool_wait(rangePool);
+    CuAssertTrue(testCase, stThreadPool_done(rangePool));
+    CuAssertIntEquals(testCase, n * (n - 1) / 2, rangeTotal);
+    stThreadPool_destruct(rangePool);
+    return wallTime() - startTime;
+}
+
+static void testStThreadPoolChildWork(CuTest *testCase) {
+    for (int64_t testNum = 0; testNum < 10; testNum++) {
+        rangeGrainSize = st_randomInt64(1, 1000);
+        int64_t n = st_randomInt64(0, 100000);
+        int64_t numThreads = st_randomInt64(1, 8);
+        timeRangeSum(testCase, numThreads, n, false);
+        timeRangeSum(testCase, numThreads, n, true);
+    }
+}
+
+static void testStThreadPoolWorkStealingSpeed(CuTest *testCase) {
+    // Compares the two modes on many tiny work units.
+    rangeGrainSize = 1;
+    int64_t n = 1 << 14;
+    for (int64_t numThreads = 1; numThreads <= 8; numThreads *= 2) {
+        double stackTime = timeRangeSum(testCase, numThreads, n, false);
+        double stealingTime = timeRangeSum(testCase, numThreads, n, true);
+        st_logInfo("%" PRIi64 " threads, %" PRIi64 " work units: shared stack %f seconds, "
+                   "work stealing %f seconds\n", numThreads, 2 * n - 1, stackTime, stealingTime);
+    }
+}
+
+static void doubleRange(int64_t start, int64_t end, int64_t *values) {
+    for (int64_t i = start; i < end; i++) {
+        values[i] = 2 * i + values[i];
+    }
+}
+
+static void testStThreadPoolParallelFor(CuTest *testCase) {
+    for (int64_t testNum = 0; testNum < 20; testNum++) {
+        stThreadPool *threadPool = stThreadPool_construct2(st_randomInt64(1, 8), NULL, NULL, st_random() > 0.5);
+        int64_t n = st_randomInt64(0, 100000);
+        int64_t *values = st_calloc(n, sizeof(int64_t));
+        stThreadPool_parallelFor(threadPool, n, st_randomInt64(0, 1000),
+                                 (void (*)(int64_t, int64_t, void *)) doubleRange, values);
+        for (int64_t i = 0; i < n; i++) {
+            // Each index must be visited exactly once.
+            CuAssertIntEquals(testCase, 2 * i, values[i]);
+        }
+        free(values);
+        stThreadPool_destruct(threadPool);
+    }
+}
+
+static int64_t *constructSum(void *arg) {
+    return st_calloc(1, sizeof(int64_t));
+}
+
+static void sumRangeInto(int64_t start, int64_t end, int64_t *sum, int64_t *values) {
+    for (int64_t i = start; i < end; i++) {
+        *sum += values[i];
+    }
+}
+
+static void mergeSums(int64_t *sum, int64_t *sumToMerge, void *arg) {
+    *sum += *sumToMerge;
+    free(sumToMerge);
+}
+
+static int64_t *parallelSum(stThreadPool *threadPool, int64_t *values, int64_t n, int64_t grainSize) {
+    return stThreadPool_parallelReduce(threadPool, n, grainSize,
+                                       (void *(*)(void *)) constructSum,
+                                       (void (*)(int64_t, int64_t, void *, void *)) sumRangeInto,
+                                       (void (*)(void *, void *, void *)) mergeSums, values);
+}
+
+static void testStThreadPoolParallelReduce(CuTest *testCase) {
+    for (int64_t testNum = 0; testNum < 20; testNum++) {
+        stThreadPool *threadPool = stThreadPool_construct2(st_randomInt64(1, 8), NULL, NULL, st_random() > 0.5);
+        int64_t n = st_randomInt64(0, 100000);
+        int64_t *values = st_malloc(n * sizeof(int64_t));
+        int64_t total = 0;
+        for (int64_t i = 0; i < n; i++) {
+            values[i] = st_randomInt64(-1000, 1000);
+            total += values[i];
+        }
+        int64_t *sum = parallelSum(threadPool, values, n, st_randomInt64(0, 1000));
+        CuAssertIntEquals(testCase, total, *sum);
+        free(sum);
+        free(values);
+        stThreadPool_destruct(threadPool);
+    }
+}
+
+// Each row is summed by a nested parallel loop, to check that nesting
+// falls back to running serially rather than deadlocking.
+typedef struct _nestedArgs {
+    stThreadPool *threadPool;
+    int64_t **rows;
+    int64_t rowLength;
+    int64_t *rowSums;
+} nestedArgs;
+
+static void sumRows(int64_t start, int64_t end, nestedArgs *args) {
+    for (int64_t i = start; i < end; i++) {
+        int64_t *sum = parallelSum(args->threadPool, args->rows[i], args->rowLength, 10);
+        args->rowSums[i] = *sum;
+        free(sum);
+    }
+}
+
+static void testStThreadPoolNestedParallelFor(CuTest *testCase) {
+    for (int64_t testNum = 0; testNum < 10; testNum++) {
+        nestedArgs args;
+        args.threadPool = stThreadPool_construct2(st_randomInt64(1, 8), NULL, NULL, st_random() > 0.5);
+        int64_t numRows = st_randomInt64(0, 200);
+        args.rowLength = st_randomInt64(0, 200);
+        args.rows = st_malloc(numRows * sizeof(int64_t *));
+        args.rowSums = st_malloc(numRows * sizeof(int64_t));
+        for (int64_t i = 0; i < numRows; i++) {
+            args.rows[i] = st_malloc(args.rowLength * sizeof(int64_t));
+            for (int64_t j = 0; j < args.rowLength; j++) {
+                args.rows[i][j] = i + j;
+            }
+        }
+        stThreadPool_parallelFor(args.threadPool, numRows, 1, (void (*)(int64_t, int64_t, void *)) sumRows, &args);
+        for (int64_t i = 0; i < numRows; i++) {
+            CuAssertIntEquals(testCase, i * args.rowLength + args.rowLength * (args.rowLength - 1) / 2, args.rowSums[i]);
+            free(args.rows[i]);
+        }
+        free(args.rows);
+        free(args.rowSums);
+        stThreadPool_destruct(args.threadPool);
+    }
+}
+
+static void sqrtRange(int64_t start, int64_t end, double *values) {
+    for (int64_t i = start; i < end; i++) {
+        values[i] = sqrt((double) i) * log((double) i + 1.0);
+    }
+}
+
+static double *constructDoubleSum(void *arg) {
+    return st_calloc(1, sizeof(double));
+}
+
+static void sumDoubleRangeInto(int64_t start, int64_t end, double *sum, double *values) {
+    for (int64_t i = start; i < end; i++) {
+        *sum += values[i];
+    }
+}
+
+static void mergeDoubleSums(double *sum, double *sumToMerge, void *arg) {
+    *sum += *sumToMerge;
+    free(sumToMerge);
+}
+
+static void testStThreadPoolParallelForSpeed(CuTest *testCase) {
+    // Logs the time taken by fine-grained parallel loops at a range of
+    // thread counts.
+    int64_t n = 100000;
+    double *values = st_malloc(n * sizeof(double));
+    for (int64_t numThreads = 1; numThreads <= 8; numThreads *= 2) {
+        for (int64_t workStealing = 0; workStealing < 2; workStealing++) {
+            stThreadPool *threadPool = stThreadPool_construct2(numThreads, NULL, NULL, workStealing);
+            double startTime = wallTime();
+            stThreadPool_parallelFor(threadPool, n, 1000, (void (*)(int64_t, int64_t, void *)) sqrtRange, values);
+            double forTime = wallTime() - startTime;
+            startTime = wallTime();
+            double *sum = stThreadPool_parallelReduce(threadPool, n, 1000,
+                                                      (void *(*)(void *)) constructDoubleSum,
+                                                      (void (*)(int64_t, int64_t, void *, void *)) sumDoubleRangeInto,
+                                                      (void (*)(void *, void *, void *)) mergeDoubleSums, values);
+            double reduceTime = wallTime() - startTime;
+            double total = 0.0;
+            for (int64_t i = 0; i < n; i++) {
+                total += values[i];
+            }
+            CuAssertDblEquals(testCase, total, *sum, total * 1e-12);
+            free(sum);
+            st_logInfo("%" PRIi64 " threads%s, %" PRIi64 " elements: parallel for %f seconds, parallel reduce %f seconds\n",
+                       numThreads, workStealing ? " (work stealing)" : "", n, forTime, reduceTime);
+            stThreadPool_destruct(threadPool);
+        }
+    }
+    CuAssertDblEquals(testCase, sqrt(5.0) * log(6.0), values[5], 1e-9);
+    free(values);
+}
+
 CuSuite *sonLib_stThreadPoolTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, testStThreadPoolSort);
+    SUITE_ADD_TEST(suite, testStThreadPoolSortWorkStealing);
+    SUITE_ADD_TEST(suite, testStThreadPoolChildWork);
+    SUITE_ADD_TEST(suite, testStThreadPoolWorkStealingSpeed);
+    SUITE_ADD_TEST(suite, testStThreadPoolParallelFor);
+    SUITE_ADD_TEST(suite, testStThreadPoolParallelReduce);
+    SUITE_ADD_TEST(suite, testStThreadPoolNestedParallelFor);
+    SUITE_ADD_TEST(suite, testStThreadPoolParallelForSpeed);
     return suite;
 }
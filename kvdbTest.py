@@ -17,11 +17,18 @@ class TestCase(unittest.TestCase):
     def testSonLibKVTokyoCabinet(self):
         system("sonLib_kvDatabaseTest --type=tokyocabinet")
 
+    def testSonLibKVLogStructured(self):
+        system("sonLib_kvDatabaseTest --type=logstructured --db=testLogStructuredDatabase")
+
     def testSonLibKVKyotoTycoon(self):
         #Needs a ktserver process running on the local machine, we need to add a check for this condition to stop the test failing
         return #Disabled for now
         system("sonLib_kvDatabaseTest --type=kyototycoon --host=localhost --port=1978 --maxKTRecordSize=6500000")
 
+    def testSonLibKVKyotoTycoonMock(self):
+        #Runs against an in memory stand-in for the Kyoto Tycoon client, with limits small enough that bulk sets are split into many batches
+        system("sonLib_kvDatabaseTest_ktMock --type=kyototycoon --db=testKyotoTycoonMockDatabase --maxKTRecordSize=50000 --maxKTBulkSetSize=20000")
+
     def testSonLibKVMySQLTest(self):
         return
         if socket.gethostname() == "hgwdev": 
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * sonLib.h
+ *
+ *  Created on: 21 May 2010
+ *      Author: benedictpaten
+ */
+
+#ifndef SONLIB_H_
+#define SONLIB_H_
+
+#include "sonLibTree.h"
+#include "sonLibString.h"
+#include "sonLibHash.h"
+#include "sonLibSet.h"
+#include "sonLibSortedSet.h"
+#include "sonLibList.h"
+#include "sonLibCommon.h"
+#include "sonLibTuples.h"
+#include "sonLibAlign.h"
+#include "sonLibExcept.h"
+#include "sonLibRandom.h"
+#include "sonLibKVDatabase.h"
+#include "sonLibKVDatabaseConf.h"
+#include "sonLibCompression.h"
+#include "sonLibFile.h"
+#include "sonLibFastaIndex.h"
+#include "sonLibMath.h"
+#include "sonLibCache.h"
+#include "stGraph.h"
+#include "stPosetAlignment.h"
+#include "sonLibTreap.h"
+#include "sonLibEulerTour.h"
+#include "sonLibConnectivity.h"
+#include "sonLibNaiveConnectivity.h"
+#include "stMatrix.h"
+#include "stPhylogeny.h"
+#include "stThreadPool.h"
+#include "stSeqReader.h"
+#include "stPackedSeq.h"
+#include "stSlab.h"
+#include "stUnionFind.h"
+#include "stSafeC.h"
+#include "jsmn.h"
+#include "stJson.h"
+#endif /* SONLIB_H_ */
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * sonLibCompression.h
+ *
+ *  Created on: 03-Sep-2010
+ *      Author: benedictpaten
+ */
+
+#ifndef SONLIBCOMPRESSION_H_
+#define SONLIBCOMPRESSION_H_
+
+#include "sonLibTypes.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//The exception string
+extern const char *ST_COMPRESSION_EXCEPTION_ID;
+
+/*
+ * Compresses the data and returns it. sizeInBytes in the size of the uncompressed data array, the pointer
+ * compressedSizeInBytes is given the size of the compressed string. The level is a value between 0 and 10 giving the
+ * degree of required compression. If -1 is given then the default level is used.
+ */
+void *stCompression_compress(void *data, int64_t sizeInBytes, int64_t *compressedSizeInBytes, int64_t level);
+
+/*
+ * Decompresses the compressed data string of size compressedSizeInBytes, initialises the sizeInBytes point to the size
+ * of the decompressed string.
+ */
+void *stCompression_decompress(void *compressedData, int64_t compressedSizeInBytes, int64_t *sizeInBytes);
+
+/*
+ * Compresses the data into an lz4 frame. The data is split into fixed size blocks that are compressed
+ * independently, on numThreads threads, and the frame records the original size of each block, so
+ * decompression allocates its output once. The level is -1 or 0 for lz4's fast compressor, or from
+ * 1 to 16 for lz4hc, with 9 its default and higher levels searching harder for matches.
+ */
+void *stCompression_compressFramed(void *data, int64_t sizeInBytes, int64_t *compressedSizeInBytes, int64_t level,
+        int64_t numThreads);
+
+/*
+ * Decompresses an lz4 frame, as written by stCompression_compressFramed or an stCompressionWriter,
+ * decompressing its blocks on numThreads threads. Throws an exception if the frame is corrupt.
+ */
+void *stCompression_decompressFramed(void *compressedData, int64_t compressedSizeInBytes, int64_t *sizeInBytes,
+        int64_t numThreads);
+
+/*
+ * Starts writing an lz4 frame to the file. Data written is buffered and compressed a batch of
+ * blocks at a time, on numThreads threads, with the level as for stCompression_compressFramed.
+ */
+stCompressionWriter *stCompressionWriter_construct(FILE *file, int64_t level, int64_t numThreads);
+
+/*
+ * Appends the data to the frame. If this throws an exception the frame is incomplete, but the
+ * writer must still be destructed.
+ */
+void stCompressionWriter_write(stCompressionWriter *writer, const void *data, int64_t sizeInBytes);
+
+/*
+ * Writes out the remaining data and the end of the frame, and frees the writer, which is freed
+ * even if writing throws an exception. Does not close the file.
+ */
+void stCompressionWriter_destruct(stCompressionWriter *writer);
+
+/*
+ * Starts reading an lz4 frame from the file, decompressing a batch of blocks at a time on
+ * numThreads threads. Throws an exception if the file does not start with a frame.
+ */
+stCompressionReader *stCompressionReader_construct(FILE *file, int64_t numThreads);
+
+/*
+ * Reads up to sizeInBytes bytes of decompressed data, returning the number read, which is less
+ * than sizeInBytes only at the end of the frame. Throws an exception if the frame is corrupt or
+ * truncated, after which every read throws, but the reader must still be destructed.
+ */
+int64_t stCompressionReader_read(stCompressionReader *reader, void *data, int64_t sizeInBytes);
+
+/*
+ * Frees the reader. Does not close the file.
+ */
+void stCompressionReader_destruct(stCompressionReader *reader);
+
+/*
+ * Uses Zlib.
+ */
+void *stCompression_compressZlib(void *data, int64_t sizeInBytes, int64_t *compressedSizeInBytes, int64_t level);
+
+/*
+ * Uses Zlib.
+ */
+void *stCompression_decompressZlib(void *compressedData, int64_t compressedSizeInBytes, int64_t *sizeInBytes);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SONLIBCOMPRESSION_H_ */
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * sonLibFastaIndex.h
+ *
+ * Random access to the sequences of a fasta file, using an index in the format
+ * written by "samtools faidx". The fasta file is memory mapped, so only the
+ * pages holding the requested bases are read from disk.
+ */
+
+#ifndef SONLIBFASTAINDEX_H_
+#define SONLIBFASTAINDEX_H_
+
+#include "sonLibTypes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//The exception string
+extern const char *ST_FASTA_INDEX_EXCEPTION;
+
+/*
+ * Opens the fasta file. The index is loaded from "fastaFile.fai" if that file exists
+ * and is not older than the fasta file, otherwise it is built by scanning the fasta file and,
+ * where the directory is writable, saved as "fastaFile.fai".
+ * Throws an exception if the file can not be opened or if the lines of a sequence other than
+ * its last have differing lengths, which would make the file unindexable.
+ */
+stFastaIndex *stFastaIndex_construct(const char *fastaFile);
+
+/*
+ * Unmaps the fasta file and frees the index.
+ */
+void stFastaIndex_destruct(stFastaIndex *fastaIndex);
+
+/*
+ * Writes the index in .fai format to the given file.
+ */
+void stFastaIndex_write(stFastaIndex *fastaIndex, const char *indexFile);
+
+/*
+ * Returns the number of sequences in the file.
+ */
+int64_t stFastaIndex_getSequenceNumber(stFastaIndex *fastaIndex);
+
+/*
+ * Returns the name of the ith sequence in the file, which is the header up to the first white space.
+ */
+const char *stFastaIndex_getSequenceName(stFastaIndex *fastaIndex, int64_t i);
+
+/*
+ * Returns non-zero iff the file contains a sequence with the given name.
+ */
+bool stFastaIndex_containsSequence(stFastaIndex *fastaIndex, const char *name);
+
+/*
+ * Returns the length of the named sequence. Throws an exception if there is no such sequence.
+ */
+int64_t stFastaIndex_getSequenceLength(stFastaIndex *fastaIndex, const char *name);
+
+/*
+ * Returns a zero terminated copy of the bases [start, start + length) of the named sequence.
+ * Only those bases are read. Throws an exception if there is no such sequence or
+ * the interval is not within it.
+ */
+char *stFastaIndex_getSubsequence(stFastaIndex *fastaIndex, const char *name, int64_t start, int64_t length);
+
+/*
+ * Returns a copy of the whole of the named sequence.
+ */
+char *stFastaIndex_getSequence(stFastaIndex *fastaIndex, const char *name);
+
+/*
+ * As stFastaIndex_getSubsequence, but packs the bases into a stPackedSeq as they are read,
+ * without copying them to a string first.
+ */
+stPackedSeq *stFastaIndex_getPackedSubsequence(stFastaIndex *fastaIndex, const char *name, int64_t start,
+        int64_t length);
+
+/*
+ * As stFastaIndex_getSubsequence, but returns a pointer to the bases in the mapped file
+ * without copying them. This is only possible if the bases are not broken by a newline,
+ * as is always the case for unwrapped sequences, otherwise NULL is returned.
+ * The bases are not zero terminated and are valid until the index is destructed.
+ */
+const char *stFastaIndex_getSubsequenceView(stFastaIndex *fastaIndex, const char *name, int64_t start,
+        int64_t length);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SONLIBFASTAINDEX_H_ */
@@ -0,0 +1,100 @@
+// A very simple pthreads thread pool implementation.
+//
+// A work stack feeds a number of threads. Every work unit is worked
+// on by a single thread, which executes the work function, then
+// fetches a new work unit when finished.
+//
+// Often threads only need to write once to some single "result"
+// variable, after the heavy computational work is done. To avoid
+// needing to manage your own locks for this simple case, an optional
+// "finish" function is available, which is guaranteed to run serially
+// (although the work function and main thread will still run
+// alongside it). If you don't want to use a finishing function, then
+// the value returned by the work function is completely ignored.
+//
+// Note that the work "queue" is actually a stack, not a queue. This
+// shouldn't matter, as you have absolutely no ordering guarantees on
+// what order the work is completed in regardless.
+//
+// Work functions may themselves push more work onto the pool, which
+// stThreadPool_wait will also wait for. For many small work units,
+// construct the pool in work-stealing mode (see
+// stThreadPool_construct2), in which each thread has its own deque
+// of work instead of all threads contending for the single stack.
+#ifndef SONLIB_THREADPOOL_H_
+#define SONLIB_THREADPOOL_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _stThreadPool stThreadPool;
+
+// Initialize the thread pool. finishFunc can be NULL if you are
+// managing your own locks for output.
+stThreadPool *stThreadPool_construct(int64_t numThreads,
+                                     void *(*workFunc)(void *),
+                                     void (*finishFunc)(void *));
+
+// Initialize the thread pool, optionally in work-stealing mode. In
+// this mode each thread owns a deque: work pushed from inside a work
+// function goes onto the deque of the thread running it, work pushed
+// from outside the pool is spread across the deques, and threads that
+// run out of work steal from the others.
+stThreadPool *stThreadPool_construct2(int64_t numThreads,
+                                      void *(*workFunc)(void *),
+                                      void (*finishFunc)(void *),
+                                      bool workStealing);
+
+// Push work onto the stack to be consumed by a thread. Can be called
+// from within the work function.
+void stThreadPool_push(stThreadPool *threadPool, void *workUnit);
+
+// Push every unit in the list onto the stack at once. The list is not
+// modified.
+void stThreadPool_pushAll(stThreadPool *threadPool, stList *workUnits);
+
+// Block until all work currently in the stack is complete. Can block
+// indefinitely if something goes wrong. Use stThreadPool_waitSafe to
+// ensure that you can get execution back after a timeout.
+void stThreadPool_wait(stThreadPool *threadPool);
+
+// Returns the number of threads in the pool.
+int64_t stThreadPool_getNumThreads(stThreadPool *threadPool);
+
+// Calls fn(start, end, arg) over disjoint ranges covering [0, n),
+// on the calling thread and any pool threads free to help, and
+// returns once they are all done. Ranges are at least grainSize long
+// (except the last) but are larger at the start of the loop, so a
+// small grainSize keeps threads balanced without costing much. The
+// pool's own work function is not used. If another parallel loop is
+// already running on the pool (e.g. fn itself runs one) the loop is
+// run serially on the calling thread.
+void stThreadPool_parallelFor(stThreadPool *threadPool, int64_t n, int64_t grainSize,
+                              void (*fn)(int64_t start, int64_t end, void *arg), void *arg);
+
+// As stThreadPool_parallelFor, but each participating thread folds
+// its ranges into its own accumulator, made by constructAccumulator,
+// with fn(start, end, accumulator, arg). Once the loop is done, the
+// accumulators are combined with merge(accumulator,
+// accumulatorToMerge, arg), which must free accumulatorToMerge, and
+// the result is returned. Threads that take no ranges construct no
+// accumulator.
+void *stThreadPool_parallelReduce(stThreadPool *threadPool, int64_t n, int64_t grainSize,
+                                  void *(*constructAccumulator)(void *arg),
+                                  void (*fn)(int64_t start, int64_t end, void *accumulator, void *arg),
+                                  void (*merge)(void *accumulator, void *accumulatorToMerge, void *arg),
+                                  void *arg);
+
+// Doesn't wait on all the work to complete, just returns whether the
+// work in the stack is all done or not.
+bool stThreadPool_done(stThreadPool *threadPool);
+
+// Destroys the thread pool and destroys all threads *without*
+// checking if they are still processing work or if there is work in
+// the queue.
+void stThreadPool_destruct(stThreadPool *threadPool);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // SONLIB_THREADPOOL_H_